@@ -9,6 +9,7 @@
 #include "device_config.h"
 #include "telemetry.h"
 #include "control_data.h"
+#include "time_sync.h"
 
 // ============================================================================
 // TYPE ALIASES
@@ -39,12 +40,20 @@ public:
     // Login device with username/password and obtain JWT token
     bool loginDevice(const String& username, const String& password);
 
+    // Extract the token (and expiresIn, seconds or 0) from a login response;
+    // false for errors and responses without a token. Static for the fuzz targets.
+    static bool parseLoginResponse(const String& response, String& token, unsigned long& expiresIn);
+
     // Refresh JWT token (extends session)
     bool refreshToken();
 
     // Check if device is authenticated (has valid token)
     bool isAuthenticated();
 
+    // Drop the session (token rejected, or a different backend); the main
+    // loop logs in again. The token itself is replaced by the next login.
+    void invalidateSession();
+
     // Check if device is registered (has attempted login/registration before)
     bool isRegistered();
 
@@ -93,26 +102,65 @@ public:
     // Upload telemetry data to server
     // Automatically includes Status field (always 1 for online tracking)
     // Server marks device offline if no telemetry for >60 seconds
-    bool uploadTelemetry(float waterLevel, float currInflow, int pumpStatus);
+    bool uploadTelemetry(float waterLevel, float currInflow, int pumpStatus,
+                         const MLResult* ml = nullptr, const LeakStatus* leak = nullptr);
+
+    // Upload a leak alarm raise/clear immediately (high priority, with retries)
+    bool uploadLeakAlarm(float waterLevel, float currInflow, int pumpStatus, const LeakStatus& leak);
+
+    // Upload a batch of queued telemetry records (store-and-forward backlog)
+    bool uploadTelemetryBatch(const TelemetryRecord* records, size_t count);
 
     // ========================================================================
     // TIME SYNCHRONIZATION
     // ========================================================================
 
-    // Sync time with server and update internal clock
+    // Start SNTP in the background (idempotent, never blocks)
+    // Completion is reported through the SNTP sync notification callback
+    void startTimeSync();
+
+    // Returns true once per completed SNTP sync and stores the synced time
+    // (adjusted for time elapsed since the callback fired). Never blocks.
+    bool consumeTimeSyncEvent(uint64_t& timestamp);
+
+    // Block until SNTP reports a sync or timeoutMs passes (boot only)
+    bool waitForTimeSync(uint32_t timeoutMs);
+
+    // Update internal clock from the system clock if SNTP has set it
+    // Non-blocking: starts SNTP and returns false if time is not yet known
     bool syncTimeWithServer();
 
     // Manually set timestamp (for app-initiated time correction)
     // Used when app detects significant drift and sends corrected time
     void setTimestamp(uint64_t timestamp);
 
+    // Discipline the clock with an NTP reference (drift estimate + slew)
+    void applyTimeSample(uint64_t referenceTime);
+
+    // True if SNTP delivered a sync within the last two resync intervals
+    bool isNtpFresh();
+
+    // HTTP time sync against API_TIME_SYNC (blocking - task or boot only)
+    // Disciplines the clock with the minimum-RTT sample
+    bool syncTimeWithBackend();
+
+    // Compare the clock against HTTP time without changing it
+    // Returns false if the request failed or the offset exceeds the tolerance
+    bool crossCheckTime();
+
+    // Last measured (HTTP time - device clock) offset in ms
+    int64_t getLastTimeOffset() { return lastTimeOffset; }
+
     // Get current Unix timestamp (milliseconds)
-    // Returns calculated time based on lastServerTimestamp + (millis() - millisAtSync)
+    // Drift-corrected and monotonic (see ConnectionSyncManager)
     uint64_t getCurrentTimestamp();
 
     // Check if time is synced
     bool isTimeSynced();
 
+    // Clock set from NTP/HTTP this boot (see ConnectionSyncManager)
+    bool hasReferenceTime();
+
     // ========================================================================
     // SYNC STATUS MANAGEMENT
     // ========================================================================
@@ -155,6 +203,9 @@ private:
     DeviceConfigManager deviceConfigManager;
     TelemetryManager telemetryManager;
     ControlDataManager controlDataManager;
+    TimeSyncManager timeSyncManager;
+
+    int64_t lastTimeOffset;
 
     // Connection sync manager (handles all sync logic)
     ConnectionSyncManager connSyncManager;
@@ -162,6 +213,15 @@ private:
     // Static instance pointer for callbacks
     static APIClient* instance;
 
+    // SNTP state (written from the lwIP task via onSntpTimeSync)
+    static bool sntpStarted;
+    static volatile bool timeSyncPending;
+    static uint64_t timeSyncEventTimestamp;   // Epoch ms reported by SNTP
+    static unsigned long timeSyncEventMillis; // millis() when the callback fired
+    static bool ntpEverSynced;                // SNTP callback fired at least once this boot
+    static portMUX_TYPE timeSyncMux;
+    static SemaphoreHandle_t timeSyncSemaphore;
+
     // ========================================================================
     // HELPER METHODS
     // ========================================================================
@@ -171,6 +231,15 @@ private:
     static bool sendConfigPriorityCallbackWrapper(void* config);
     static uint64_t syncTimeCallbackWrapper();
 
+    // SNTP sync notification (runs in the lwIP task - must not block)
+    static void onSntpTimeSync(struct timeval* tv);
+
+    // Read the system clock as epoch ms, false if SNTP never set it
+    static bool readSystemTime(uint64_t& timestamp);
+
+    // Drop the session if a manager's last request got a 401
+    void checkSession();
+
     // HTTP helper with retry logic
     bool httpRequest(const String& method, const String& endpoint,
                     const String& payload, String& response, int retries = API_RETRY_COUNT);
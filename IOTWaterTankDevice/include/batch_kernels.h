@@ -0,0 +1,42 @@
+#ifndef BATCH_KERNELS_H
+#define BATCH_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// BATCH KERNELS (reductions over sample arrays and int8 model rows)
+// ============================================================================
+// Every kernel returns the same bits as the plain loop it replaces, on the
+// device and in the simulator, whatever the unrolling:
+// - Integer kernels are exact: int32 results without overflow, so any
+//   lane split gives the same sum. On the ESP32-S3 they run whole 16-byte
+//   blocks on the vector unit (EE.VMULAS.S8.ACCX, 40-bit accumulator);
+//   batchDotS8 needs one operand 16-byte aligned for that, else it takes
+//   the scalar loop. Elsewhere the same block split runs in plain C.
+// - Min/max and median only compare and copy values.
+//
+// The vector loop runs in short critical sections: not every ESP-IDF
+// saves the vector registers on a task switch. Float inputs must not
+// contain NaN. sim/bench times every
+// kernel against its reference loop per array length and checks the
+// results match.
+
+// Dot product of two int8 vectors (n <= 65536, exact)
+int32_t batchDotS8(const int8_t* a, const int8_t* b, size_t n);
+
+// Sum of an int8 vector (exact)
+int32_t batchSumS8(const int8_t* x, size_t n);
+
+// Vector path against the scalar loops over every alignment and tail
+// length; turns the vector path off if they disagree. Run once at boot.
+bool batchKernelsSelfTest();
+
+// Smallest and largest value (n >= 1)
+void batchMinMaxF32(const float* x, size_t n, float* lo, float* hi);
+
+// Median (n >= 1; even n: mean of the two middle values).
+// Reorders x - pass a copy if the order matters.
+float batchMedianF32(float* x, size_t n);
+
+#endif // BATCH_KERNELS_H
@@ -8,6 +8,7 @@
 enum ButtonEvent {
     BTN_NONE,
     BTN1_PRESSED,      // Cycle display screens
+    BTN1_DOUBLE_CLICK, // Back to status screen
     BTN2_PRESSED,      // Manual pump ON
     BTN3_PRESSED,      // Toggle Auto/Manual mode
     BTN4_PRESSED,      // Manual pump OFF
@@ -16,25 +17,48 @@ enum ButtonEvent {
     BTN6_PRESSED       // Hardware override toggle
 };
 
+// Called from the button task as soon as an event is recognized, before it
+// is queued for getEvent() - for actions that must not wait for loop()
+typedef void (*ButtonEventCallback)(ButtonEvent event);
+
 struct Button {
     uint8_t pin;
-    bool lastState;
-    bool currentState;
-    unsigned long pressTime;
+    ButtonEvent pressEvent;    // Fired on press (BTN_NONE = none)
+    ButtonEvent doubleEvent;   // Fired instead of pressEvent on a second press within BUTTON_DOUBLE_CLICK_MS
+    ButtonEvent shortEvent;    // Fired on release before BUTTON_LONG_PRESS_MS
+    ButtonEvent longEvent;     // Fired while held for BUTTON_LONG_PRESS_MS
+    volatile bool pressed;     // Debounced state
+    int64_t lockoutUntil;      // Debounce lockout end (us, 0 = none)
+    int64_t pressTime;         // Debounced press time (us)
+    int64_t lastClick;         // Last press time for double-click detection (us, 0 = none)
     bool longPressTriggered;
 };
 
+// ============================================================================
+// BUTTON HANDLER (interrupt driven)
+// ============================================================================
+// Pin edges raise an interrupt that only queues the button index (with
+// light sleep on, a level interrupt that is also the pin's GPIO wakeup
+// source, flipped on each change). A button task does the rest:
+// - Leading-edge debounce: the first edge is reported immediately, further
+//   edges are ignored for BUTTON_DEBOUNCE_MS, then the pin is sampled again
+//   so a release (or press) during the lockout is not lost
+// - Gestures (double click, short/long press) timed in microseconds from
+//   esp_timer, independent of loop() jitter
+// - Events go to a FreeRTOS queue, so rapid or simultaneous presses are
+//   all delivered
+
 class ButtonHandler {
 public:
     ButtonHandler();
 
-    // Initialize button pins
+    // Initialize button pins, interrupts and the button task
     void begin();
 
-    // Update button states (call in loop)
-    void update();
+    // Register a callback run in the button task for every event
+    void setEventCallback(ButtonEventCallback callback);
 
-    // Get button event (non-blocking)
+    // Get next button event (non-blocking, BTN_NONE when the queue is empty)
     ButtonEvent getEvent();
 
     // Check if specific button is pressed (for continuous reading)
@@ -42,14 +66,27 @@ public:
 
 private:
     Button buttons[6];
+    QueueHandle_t edgeQueue;    // Button indices from the ISR
+    QueueHandle_t eventQueue;   // Recognized ButtonEvents for getEvent()
+    TaskHandle_t taskHandle;
+    ButtonEventCallback eventCallback;
+
+    static void IRAM_ATTR onEdge(void* arg);
+    static void buttonTask(void* parameter);
+
+    // Sample a button and process a debounced state change
+    void sampleButton(int index, int64_t now);
+
+    // Expire debounce lockouts and long-press timers
+    void processTimers(int64_t now);
 
-    // Debounce and detect button presses
-    void readButton(int index);
+    // Time until the next lockout / long-press deadline
+    TickType_t nextTimeout(int64_t now);
 
-    // Check for long press on BTN5
-    void checkLongPress();
+    void onPress(int index, int64_t now);
+    void onRelease(int index, int64_t now);
 
-    ButtonEvent pendingEvent;
+    void postEvent(ButtonEvent event);
 };
 
 #endif // BUTTON_HANDLER_H
@@ -59,6 +59,9 @@
 #define OLED_WIDTH 128
 #define OLED_HEIGHT 64
 #define OLED_RESET -1
+#define OLED_I2C_ADDRESS 0x3C
+#define OLED_I2C_CLOCK 400000           // Fast-mode I2C (display is the only device on the bus)
+#define OLED_I2C_CHUNK (I2C_BUFFER_LENGTH - 1) // Data bytes per I2C transaction: Wire's buffer (128 B on ESP32) less the 0x40 control byte
 
 // Ultrasonic Sensor (HC-SR04)
 #define ULTRASONIC_TRIG_PIN 6
@@ -79,7 +82,12 @@
 // BACKEND API CONFIGURATION
 // ============================================================================
 
-#define SERVER_URL "http://103.136.236.16"
+#define SERVER_URL "http://103.136.236.16"  // Default
+#define SERVER_URL_MAX_LENGTH 96             // Runtime override, scheme://host[:port][/path]
+// Development builds only: POST /{id}/server (dashboard login required)
+// switches backends at runtime and accepts plain http:// (mock backend).
+// Release builds keep no route and only honour a stored https:// override.
+// #define SERVER_URL_OVERRIDE
 #define PROJECT_ID "wt001"
 #define DEVICE_NAME "DEV-02"
 #define MONGODB_DEVICE_ID "690e6a9d092433c0acfb9178"
@@ -100,20 +108,170 @@
 #define AP_SSID "AquaFlow-Setup"
 #define AP_PASSWORD "PassAquaWT001"
 #define WIFI_TIMEOUT_MS 20000           // 20 seconds
-#define WIFI_RETRY_INTERVAL_MS 30000    // 30 seconds between reconnection attempts
+#define WIFI_RETRY_INTERVAL_MS 30000    // 30 seconds - max delay between reconnection attempts
+#define WIFI_RETRY_MIN_MS 1000          // First retry delay after a failed reconnect (doubles up to the max)
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000 // Directed connect (cached BSSID/channel) before falling back to a full scan
+#define WIFI_REUSE_DHCP_LEASE false     // Apply the last DHCP lease as a static IP on fast connect (skips DHCP, never renewed - only for an address reserved on the router)
+
+// Multiple networks / roaming
+#define WIFI_MAX_PROFILES 4             // Stored networks (slot 0 = primary)
+#define WIFI_PROFILE_PRIORITY_STEP 10   // dB handicap per slot when choosing between profiles
+#define WIFI_ROAM_CHECK_INTERVAL 10000  // 10 seconds - RSSI sampling while connected
+#define WIFI_ROAM_RSSI_THRESHOLD -75    // Averaged RSSI below this counts as a poor link
+#define WIFI_ROAM_POOR_DURATION 60000   // 60 seconds of poor link before looking for a better AP
+#define WIFI_ROAM_SCAN_INTERVAL 300000  // 5 minutes between roaming scans
+#define WIFI_ROAM_HYSTERESIS 8          // dB a candidate must beat the current link by
+
+// Optional static IP (skips DHCP on every connect) - leave undefined for DHCP
+// #define WIFI_STATIC_IP "192.168.1.50"
+// #define WIFI_STATIC_GATEWAY "192.168.1.1"
+// #define WIFI_STATIC_SUBNET "255.255.255.0"
+// #define WIFI_STATIC_DNS "192.168.1.1"
 #define WIFI_RECONNECT_INTERVAL 30000   // 30 seconds (legacy)
 #define WIFI_TIMEOUT 20000               // 20 seconds (legacy)
 
+// Provisioning (credentials saved from the setup portal)
+#define PROVISIONING_TASK_STACK_SIZE 8192 // Login + config fetch task (HTTP + JSON)
+#define PROVISIONING_AP_LINGER_MS 30000   // Keep the setup AP after success so the app can read the result
+
 // ============================================================================
 // TIMING CONFIGURATION
 // ============================================================================
 
 #define SENSOR_READ_INTERVAL 1000       // 1 second - sensor reading
-#define TELEMETRY_UPLOAD_INTERVAL 30000 // 30 seconds - upload data
 #define CONTROL_FETCH_INTERVAL 300000   // 5 minutes - fetch control data
+#define CONFIG_FETCH_RETRY_INTERVAL 30000 // 30 seconds - initial config fetch after NTP sync
 #define CONFIG_CHECK_INTERVAL 300000    // 5 minutes - check config update
 #define OTA_CHECK_INTERVAL 300000       // 5 minutes - check firmware update
 #define DISPLAY_UPDATE_INTERVAL 500     // 0.5 seconds - update display
+#define DISPLAY_TASK_STACK_SIZE 3072    // Display flush task stack (bytes)
+
+// Telemetry is reported by exception (see telemetry_reporter.h). The
+// backend marks a device offline after 60 s without telemetry, so the
+// default heartbeat stays below that. The device config field
+// "heartbeatSec" overrides it (clamped to the MIN/MAX below) once the
+// backend's timeout allows longer; every upload carries the one in use.
+#define TELEMETRY_MIN_INTERVAL 5000         // 5 seconds - at most one report per interval
+#define TELEMETRY_HEARTBEAT_INTERVAL 45000  // 45 seconds - report at least this often (default)
+#define TELEMETRY_HEARTBEAT_MIN 10000       // 10 seconds - lowest accepted heartbeatSec
+#define TELEMETRY_HEARTBEAT_MAX 3600000     // 1 hour - highest accepted heartbeatSec
+#define TELEMETRY_LEVEL_DEADBAND 1.0f       // % of tank height since the last report
+#define TELEMETRY_INFLOW_DEADBAND 3.0f      // L/min (smoothed) since the last report
+#define TELEMETRY_INFLOW_SMOOTHING 0.05f    // Inflow EMA weight per read (~20 s time constant)
+
+// ============================================================================
+// POWER MANAGEMENT
+// ============================================================================
+
+#define POWER_CPU_MAX_MHZ 240           // Clock while the loop / a PM lock holder is active
+#define POWER_CPU_MIN_MHZ 80            // Idle clock (keeps APB at 80 MHz for the peripherals)
+#define POWER_LIGHT_SLEEP_ENABLED true  // Automatic light sleep when idle (needs tickless idle in the SDK)
+#define POWER_WIFI_MODEM_SLEEP true     // WiFi modem sleep in client mode (AP mode can't sleep)
+#define POWER_LOOP_IDLE_MAX_MS 50       // Longest idle between loop passes (WiFi/provisioning polling)
+#define POWER_REPORT_INTERVAL 300000    // 5 minutes - duty cycle report window
+
+// Current estimate per state (mA) - calibrate per board with a meter
+#define POWER_CURRENT_ACTIVE_MA 45.0f   // CPU at max clock
+#define POWER_CURRENT_IDLE_MA 22.0f     // DFS idle + modem sleep
+#define POWER_CURRENT_SLEEP_MA 4.0f     // Auto light sleep + modem sleep (DTIM wakeups)
+#define POWER_CURRENT_RADIO_MA 90.0f    // Extra while the radio is busy (HTTP, OTA)
+
+// ============================================================================
+// TIME SYNC CONFIGURATION (SNTP)
+// ============================================================================
+
+#define NTP_SERVER_1 "time.google.com"
+#define NTP_SERVER_2 "pool.ntp.org"
+#define NTP_SERVER_3 "time.nist.gov"
+#define NTP_BOOT_WAIT_TIMEOUT 10000     // 10 seconds - max wait for first sync at boot only
+#define NTP_RETRY_INTERVAL 15000        // 15 seconds - offline check for completed sync
+#define MIN_VALID_TIMESTAMP 1763520052526ULL  // 2025-11-19 approx - sanity check for synced time
+#define MAX_VALID_TIMESTAMP 4102444800000ULL  // 2100-01-01 - sanity check for app-supplied time
+#define APP_TIME_MAX_AHEAD 300000       // 5 minutes - app time may lead an NTP/HTTP-set clock by this
+
+// Clock discipline (ConnectionSyncManager)
+#define CLOCK_RESYNC_INTERVAL 3600000   // 1 hour - periodic SNTP resync
+#define CLOCK_SLEW_RATE_PPM 5000        // Max correction rate when slewing (0.5% = 5 ms/s)
+#define CLOCK_STEP_THRESHOLD 10000      // Errors above 10 s are stepped instead of slewed
+#define CLOCK_DRIFT_MIN_INTERVAL 600000 // 10 minutes - min sample spacing for drift estimate
+#define CLOCK_DRIFT_MAX_PPM 500.0f      // Reject drift measurements beyond this (bad sample)
+
+// HTTP time sync against the backend (NTP fallback + cross-check)
+#define HTTP_TIME_SYNC_SAMPLES 5        // Requests per sync, minimum-RTT sample wins
+#define HTTP_TIME_SYNC_MAX_RTT 3000     // Reject if the best round trip is slower (ms)
+#define HTTP_TIME_SYNC_TOLERANCE 1000   // Allowed NTP/HTTP disagreement beyond RTT/2 (ms)
+#define HTTP_TIME_SYNC_INTERVAL 1800000 // 30 minutes - cross-check (or fallback resync)
+#define NTP_FALLBACK_DELAY 30000        // 30 seconds without NTP before using HTTP time
+
+// ============================================================================
+// CONNECTIVITY PROBE
+// ============================================================================
+
+#define CONNECTIVITY_PROBE_TTL 60000        // 60 seconds - a probe/request result stays valid
+#define CONNECTIVITY_PROBE_TIMEOUT 3000     // 3 seconds - TCP connect timeout
+#define CONNECTIVITY_PROBE_FAILURES 3       // Consecutive failed requests before probing
+#define CONNECTIVITY_PROBE_STACK_SIZE 4096
+
+// ============================================================================
+// TELEMETRY QUEUE CONFIGURATION (store-and-forward on LittleFS)
+// ============================================================================
+
+#define TELEMETRY_QUEUE_DIR "/tq"
+#define TELEMETRY_QUEUE_SEGMENT_RECORDS 512   // 512 x 24 B = 12 KB per segment
+#define TELEMETRY_QUEUE_MAX_SEGMENTS 16       // ~8k reports = 4 days of 45 s heartbeats, less while levels move
+#define TELEMETRY_BACKLOG_BATCH_SIZE 16       // Records per backfill request
+#define TELEMETRY_BACKLOG_INTERVAL 5000       // 5 seconds between backfill batches
+#define TELEMETRY_BACKLOG_LIVE_GUARD 3000     // Don't backfill this close to a live upload
+
+// ============================================================================
+// OTA CONFIGURATION
+// ============================================================================
+
+#define OTA_TASK_STACK_SIZE 8192        // Background OTA task stack (bytes)
+#define OTA_BUFFER_SIZE 4096            // Download chunk size (heap)
+#define OTA_HTTP_TIMEOUT 15000          // 15 seconds - per-request timeout
+#define OTA_STALL_TIMEOUT 20000         // 20 seconds without data = connection dropped
+#define OTA_MAX_RESUME_ATTEMPTS 5       // Consecutive attempts without progress before giving up
+#define OTA_RESUME_DELAY 3000           // Base delay between resume attempts (x attempt)
+
+// ============================================================================
+// ML INFERENCE CONFIGURATION (int8 MLP on the level/flow stream)
+// ============================================================================
+
+#define ML_MODEL_DIR "/ml"
+#define ML_CHECK_INTERVAL 3600000       // 1 hour - check for a new model
+#define ML_FIRST_CHECK_DELAY 60000      // 1 minute after boot
+#define ML_TASK_STACK_SIZE 6144         // Background model download task stack (bytes)
+#define ML_HTTP_TIMEOUT 15000           // 15 seconds - per-request timeout
+#define ML_VERSION_MAX_LENGTH 23        // Longer model versions are truncated
+
+// Budgets - models beyond them are rejected at load time
+#define ML_MAX_MODEL_SIZE 32768         // Model file, held on the heap while loaded
+#define ML_MAX_LAYERS 4
+#define ML_MAX_LAYER_WIDTH 128          // Inputs/outputs per layer (2 x static int8 buffers, multiple of 16)
+#define ML_MAX_WINDOW 64                // Samples per inference (window buffer: 64 x 3 floats)
+#define ML_MAX_MACS 16384               // Multiply-accumulates per inference
+#define ML_LATENCY_BUDGET_US 5000       // Inference on the loop above this counts as an overrun
+
+// ============================================================================
+// LEAK DETECTION CONFIGURATION (night flow while the pump is off)
+// ============================================================================
+
+#define LEAK_WINDOW_MINUTES 15          // Pump-off minutes per outflow estimate
+#define LEAK_MIN_WINDOWS 8              // Night flow = lowest of the last 8 windows (2 hours)
+#define LEAK_LEARN_WINDOWS 48           // Windows before the baseline is trusted (12 pump-off hours)
+#define LEAK_BASELINE_DOWN 0.2f         // Baseline step towards a lower night flow (per window)
+#define LEAK_BASELINE_UP 0.002f         // ... towards a higher one (~3 days of pump-off windows)
+#define LEAK_SAVE_WINDOWS 4             // Save the baseline to NVS every 4 windows (1 hour)
+
+// CUSUM on (night flow - baseline), in L/h. Tune for sensor noise x tank area:
+// a 10 L/h leak on a 50 cm tank alarms within ~3 hours
+#define LEAK_CUSUM_K_LPH 3.0f           // Allowance - excess below this is ignored
+#define LEAK_CUSUM_H_LPH 30.0f          // Alarm threshold (L/h x windows)
+#define LEAK_CUSUM_MAX_LPH 120.0f       // Cap, so a cleared leak clears within hours
+
+#define LEAK_ALARM_TASK_PRIORITY 2      // Above server tasks (1)
+#define LEAK_ALARM_RETRY_INTERVAL 15000 // Retry a failed alarm upload after 15 seconds
 
 // ============================================================================
 // BUTTON CONFIGURATION
@@ -121,6 +279,10 @@
 
 #define BUTTON_DEBOUNCE_MS 50
 #define BUTTON_LONG_PRESS_MS 5000  // 5 seconds for setup mode
+#define BUTTON_DOUBLE_CLICK_MS 400 // Max gap between presses of a double click
+#define BUTTON_QUEUE_LENGTH 16     // Edge / event queue depth
+#define BUTTON_TASK_STACK_SIZE 3072
+#define BUTTON_TASK_PRIORITY 3     // Above server tasks (1) so buttons react while HTTP is busy
 
 // ============================================================================
 // SETUP MODE CONFIGURATION
@@ -131,6 +293,10 @@
 #define WIFI_CONNECT_TIMEOUT 30000   // 30 seconds
 #define WIFI_CONNECT_RETRIES 3
 
+// Local web server: POST bodies above this are answered with 413 and never
+// buffered (the largest JSON document a route parses is 2 KB)
+#define WEB_MAX_BODY_SIZE 4096
+
 // ============================================================================
 // API RETRY CONFIGURATION
 // ============================================================================
@@ -139,6 +305,11 @@
 #define API_RETRY_DELAY_MS 2000
 #define HTTP_TIMEOUT 10000
 
+// Login again after the token was rejected (401) or the boot login failed.
+// Backoff doubles per failed attempt, from MIN up to MAX.
+#define RELOGIN_RETRY_MIN_MS 30000       // 30 seconds
+#define RELOGIN_RETRY_MAX_MS 1800000     // 30 minutes
+
 // ============================================================================
 // DEFAULT VALUES
 // ============================================================================
@@ -148,6 +319,9 @@
 #define DEFAULT_LOWER_THRESHOLD 20.0f
 #define DEFAULT_TANK_WIDTH 50.0f
 
+// Plausibility limits for config from the server or the app (cm)
+#define MAX_TANK_DIMENSION 10000.0f
+
 // ============================================================================
 // SENSOR CONFIGURATION
 // ============================================================================
@@ -171,10 +345,12 @@
 #define PREF_WIFI_SSID "wifi_ssid"
 #define PREF_WIFI_PASS "wifi_pass"
 #define PREF_WIFI_CONFIGURED "wifi_configured"
+#define PREF_WIFI_CACHE "wifi_cache"
 #define PREF_DASHBOARD_USER "dash_user"
 #define PREF_DASHBOARD_PASS "dash_pass"
 #define PREF_DEVICE_TOKEN "device_token"
 #define PREF_HARDWARE_ID "hardware_id"
+#define PREF_SERVER_URL "server_url"
 #define PREF_AUTO_MODE "auto_mode"
 
 // Sync status keys
@@ -183,5 +359,10 @@
 #define PREF_SERVER_TIME "server_time"
 #define PREF_MILLIS_SYNC "millis_sync"
 #define PREF_OVERFLOW_CNT "overflow_cnt"
+#define PREF_CLOCK_DRIFT "clock_drift"
+
+// Leak detector (learned night-flow baseline)
+#define PREF_LEAK_BASELINE "leak_base"
+#define PREF_LEAK_LEARNED "leak_learned"
 
 #endif // CONFIG_H
@@ -12,8 +12,9 @@ struct ConnectionSyncStatus {
     bool serverSync;                  // true = connected to server, false = offline
     bool device_config_sync_status;   // true = sync FROM server, false = sync TO server (device priority)
     uint64_t lastServerTimestamp;     // Last server time in milliseconds (64-bit for timestamps > 4.2 billion)
-    uint64_t millisAtSync;            // millis() value when last synced (64-bit for overflow tracking)
-    uint32_t overflowCount;           // Handle millis() overflow (49 days)
+    uint64_t millisAtSync;            // Local clock (ms since boot) at lastServerTimestamp
+    uint32_t overflowCount;           // Unused - local clock is 64-bit (kept for storage compatibility)
+    float driftPpm;                   // Estimated oscillator drift (+ = local clock runs slow)
 };
 
 // ============================================================================
@@ -38,7 +39,7 @@ typedef uint64_t (*SyncTimeCallback)();
  *
  * Handles:
  * - Online/offline state transitions
- * - Time synchronization with overflow protection
+ * - Time synchronization with drift estimation and slewed corrections
  * - Priority-based configuration sync
  * - Local modification tracking
  *
@@ -99,15 +100,27 @@ public:
     bool syncTimeWithServer();
 
     // Manually set timestamp (for app-initiated time correction)
+    // Steps the clock - no slewing, not used for drift estimation
     void setTimestamp(uint64_t timestamp);
 
+    // Discipline the clock with a trusted reference (periodic NTP resync)
+    // - Updates the drift estimate from reference samples >= CLOCK_DRIFT_MIN_INTERVAL apart
+    // - Slews small errors in at <= CLOCK_SLEW_RATE_PPM, steps errors > CLOCK_STEP_THRESHOLD
+    void applyTimeSample(uint64_t referenceTime);
+
     // Get current Unix timestamp (milliseconds)
-    // Returns calculated time based on lastServerTimestamp + (millis() - millisAtSync)
+    // lastServerTimestamp + drift-corrected elapsed time + slewed correction,
+    // never lower than a previously returned value (safe for lastModified)
+    // except right after a step (> CLOCK_STEP_THRESHOLD), which resets the floor
     uint64_t getCurrentTimestamp();
 
     // Check if time is synced
     bool isTimeSynced();
 
+    // Clock set from a trusted reference (NTP/HTTP) this boot - not just the
+    // stored lower bound or an app correction
+    bool hasReferenceTime();
+
     // ========================================================================
     // STATUS QUERIES
     // ========================================================================
@@ -138,6 +151,14 @@ private:
 
     ConnectionSyncStatus syncStatus;
 
+    // Clock discipline state (runtime only)
+    int64_t slewRemaining;          // Correction still to be slewed in (ms, signed)
+    uint64_t lastSampleReference;   // Last reference time used for drift estimation
+    uint64_t lastSampleLocal;       // Local clock at lastSampleReference (0 = none this boot)
+    uint32_t driftSamples;          // Drift measurements taken this boot
+    uint64_t lastIssuedTimestamp;   // Monotonic floor for getCurrentTimestamp()
+    portMUX_TYPE clockMux;
+
     // Callbacks
     FetchConfigCallback fetchConfigCallback;
     SendConfigPriorityCallback sendConfigPriorityCallback;
@@ -147,8 +168,11 @@ private:
     // HELPER METHODS
     // ========================================================================
 
-    // Handle millis() overflow (every 49.7 days)
-    void checkMillisOverflow();
+    // 64-bit milliseconds since boot (no 49-day wrap)
+    static uint64_t localMillis();
+
+    // Disciplined time at a local clock value (no monotonic clamp), caller holds clockMux
+    uint64_t estimateAt(uint64_t local);
 };
 
 #endif // CONNECTION_SYNC_MANAGER_H
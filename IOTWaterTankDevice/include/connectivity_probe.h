@@ -0,0 +1,81 @@
+#ifndef CONNECTIVITY_PROBE_H
+#define CONNECTIVITY_PROBE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// BACKEND CONNECTIVITY PROBE
+// ============================================================================
+// One shared answer to "can we reach the backend?", built from:
+// - Passive signals: every real server request reports success/failure
+// - Active probes: a TCP connect to the server URL's host/port with a
+//   short timeout, run in a background task (never on the main loop)
+//
+// A result (passive or active) is fresh for CONNECTIVITY_PROBE_TTL. An
+// active probe is only started when requests keep failing and there is
+// no fresh result, so a healthy device never probes at all.
+
+enum ConnectivityState {
+    CONNECTIVITY_UNKNOWN,
+    CONNECTIVITY_REACHABLE,
+    CONNECTIVITY_UNREACHABLE
+};
+
+class ConnectivityProbe {
+public:
+    ConnectivityProbe();
+
+    // Parse host/port from the server URL (re-parsed by update() on change)
+    void begin();
+
+    // Passive signals from real requests (any task)
+    void reportSuccess();
+    void reportFailure();
+
+    // Forget failures and results (e.g. after coming back online)
+    void reset();
+
+    // Start an active probe if needed (call in loop, non-blocking)
+    void update();
+
+    // Start an active probe now unless one is running (non-blocking)
+    bool startProbe();
+
+    // Last known state (UNKNOWN once the result is older than the TTL)
+    ConnectivityState getState();
+
+    // Backend reachable according to a fresh result
+    bool isReachable() { return getState() == CONNECTIVITY_REACHABLE; }
+
+    // Consecutive failed requests since the last success
+    uint32_t getFailureCount() { return consecutiveFailures; }
+
+    // Connect time of the last successful active probe (ms)
+    uint32_t getLastProbeTime() { return lastProbeTime; }
+
+    bool isProbing() { return taskHandle != NULL; }
+
+private:
+    String host;
+    uint16_t port;
+
+    ConnectivityState state;
+    unsigned long resultTime;       // millis() of the last result
+    volatile uint32_t consecutiveFailures;
+    uint32_t lastProbeTime;
+    uint32_t targetGeneration;      // serverUrl generation host/port came from
+
+    TaskHandle_t taskHandle;
+    portMUX_TYPE mux;
+
+    static void probeTask(void* parameter);
+
+    void updateTarget();
+
+    void setResult(ConnectivityState newState);
+};
+
+extern ConnectivityProbe connectivityProbe;
+
+#endif // CONNECTIVITY_PROBE_H
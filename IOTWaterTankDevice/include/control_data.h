@@ -62,9 +62,16 @@ public:
     // Upload control data using pre-built JSON payload
     bool uploadControlWithPayload(const String& payload);
 
+    // Parse server JSON response to ControlData (also used by the fuzz targets)
+    bool parseControl(const String& json, ControlData& control);
+
+    // True once since the last call if the server rejected the token (401)
+    bool consumeUnauthorized();
+
 private:
     String deviceToken;
     String hardwareId;
+    volatile bool unauthorized;
 
     // ========================================================================
     // HELPER METHODS
@@ -76,9 +83,6 @@ private:
 
     // Add authorization header to HTTP client
     void addAuthHeader(HTTPClient& http);
-
-    // Parse server JSON response to ControlData
-    bool parseControl(const String& json, ControlData& control);
 };
 
 #endif // CONTROL_DATA_H
@@ -0,0 +1,28 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CRC-32 (IEEE 802.3, reflected, init/xorout 0xFFFFFFFF)
+// ============================================================================
+// Bitwise implementation - only used for small persisted records, so a
+// 1 KB lookup table isn't worth the RAM. Pass the previous result as
+// 'crc' to checksum data in several chunks.
+
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+    return ~crc;
+}
+
+inline uint32_t crc32Compute(const uint8_t* data, size_t length) {
+    return crc32Update(0, data, length);
+}
+
+#endif // CRC32_H
@@ -0,0 +1,132 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "patch_stream.h"
+#include "heatshrink_decoder.h"
+
+// ============================================================================
+// STREAMING DELTA PATCHER (bsdiff blocks, heatshrink-compressed)
+// ============================================================================
+// Applies a delta patch as it streams in, reading the old image with random
+// access and emitting the new image strictly in order. No Arduino
+// dependencies - the I/O goes through PatchSource / PatchSink.
+//
+// Patch layout (own format - not a bsdiff file, see the magic):
+//   "WTDELTA1"          8 bytes magic
+//   newSize             8 bytes (offtin)
+//   hsWindow            1 byte, must be HEATSHRINK_WINDOW_BITS
+//   hsLookahead         1 byte, must be HEATSHRINK_LOOKAHEAD_BITS
+//   reserved            6 bytes (zero)
+//   body                one heatshrink stream of bsdiff blocks:
+//     repeated until newSize bytes are produced:
+//       add, copy, seek   3 x 8 bytes (offtin)
+//       diff[add]         new = old[oldPos + i] + diff[i]
+//       extra[copy]       new = extra[i]
+//       oldPos += add + seek
+//
+// bsdiff keeps control, diff and extra in three separately compressed
+// sections; here each block's control, diff and extra follow each other in
+// one stream, so the patch applies in a single pass. The diff bytes are
+// mostly zero, which is what the compression removes. Patches are made on
+// the host: `ota-tool diff OLD NEW PATCH` (sim/tools).
+//
+// offtin: 8-byte little-endian magnitude, sign in bit 7 of the last byte.
+// RAM use is fixed: the decoder window + one DELTA_PATCH_CHUNK old/new buffer.
+
+#define DELTA_PATCH_MAGIC "WTDELTA1"
+#define DELTA_PATCH_MAGIC_LEN 8
+#define DELTA_PATCH_HEADER_LEN 24
+#define DELTA_PATCH_CHUNK 256
+
+class DeltaPatcher {
+public:
+    DeltaPatcher();
+
+    // Reset and attach old image reader / new image writer
+    void begin(PatchSource* source, PatchSink* sink);
+
+    // Feed the next patch bytes (any chunking). Returns false on error.
+    bool feed(const uint8_t* data, size_t length);
+
+    // End of the patch: flush the decoder. False unless the full new image
+    // has been produced.
+    bool finish();
+
+    // True once the full new image has been produced
+    bool isComplete() const { return state == STATE_DONE; }
+
+    // New image size from the patch header (0 until the header is read)
+    uint64_t getNewSize() const { return newSize; }
+
+    // Bytes of new image written so far
+    uint64_t getWritten() const { return newPos; }
+
+    // Error description (static string) after feed()/finish() returned false
+    const char* getError() const { return error; }
+
+private:
+    enum State {
+        STATE_HEADER,
+        STATE_CONTROL,
+        STATE_DIFF,
+        STATE_EXTRA,
+        STATE_DONE,
+        STATE_ERROR
+    };
+
+    PatchSource* source;
+    PatchSink* sink;
+    State state;
+    const char* error;
+
+    uint8_t header[DELTA_PATCH_HEADER_LEN];   // File header, then one control block (24 bytes)
+    size_t headerFill;
+
+    uint64_t newSize;
+    uint64_t newPos;
+    int64_t oldPos;
+
+    uint64_t diffRemaining;
+    uint64_t extraRemaining;
+    int64_t seek;
+
+    uint8_t oldBuffer[DELTA_PATCH_CHUNK];
+    uint8_t outBuffer[DELTA_PATCH_CHUNK];
+
+    // Body decompression: decoder output -> feedBody()
+    class BodySink : public PatchSink {
+    public:
+        explicit BodySink(DeltaPatcher* owner) : owner(owner) {}
+        bool write(const uint8_t* data, size_t length) override {
+            return owner->feedBody(data, length);
+        }
+    private:
+        DeltaPatcher* owner;
+    };
+    BodySink bodySink;
+    HeatshrinkDecoder decoder;
+
+    // Decompressed body bytes (control blocks, diff, extra)
+    bool feedBody(const uint8_t* data, size_t length);
+
+    // Collect 'needed' bytes into header[]; returns bytes consumed
+    size_t collect(const uint8_t* data, size_t length, size_t needed);
+
+    bool parseHeader();
+    bool parseControl();
+
+    // Apply up to one chunk of diff / extra data; returns bytes consumed or 0 on error
+    size_t applyDiff(const uint8_t* data, size_t length);
+    size_t applyExtra(const uint8_t* data, size_t length);
+
+    // Move to the next control block (or done)
+    void finishBlock();
+
+    bool fail(const char* message);
+
+    static int64_t offtin(const uint8_t* buf);
+};
+
+#endif // DELTA_PATCH_H
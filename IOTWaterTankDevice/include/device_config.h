@@ -47,6 +47,10 @@ struct DeviceConfig {
     bool auto_update;
     uint64_t autoUpdateLastModified;
 
+    // Server-delivered only (must match the backend's offline rule)
+    float heartbeatSec;
+    uint64_t heartbeatSecLastModified;
+
     // Constructor to initialize all fields to default values
     DeviceConfig()
         : upperThreshold(0.0f),
@@ -70,7 +74,9 @@ struct DeviceConfig {
           ipAddress(""),
           ipAddressLastModified(0),
           auto_update(true),
-          autoUpdateLastModified(0) {}
+          autoUpdateLastModified(0),
+          heartbeatSec(TELEMETRY_HEARTBEAT_INTERVAL / 1000),
+          heartbeatSecLastModified(0) {}
 
     // Check if config values have changed (excluding timestamps)
     // Returns true if any value is different
@@ -86,6 +92,7 @@ struct DeviceConfig {
         if (sensorFilter != other.sensorFilter) return true;
         if (ipAddress != other.ipAddress) return true;
         if (auto_update != other.auto_update) return true;
+        if (heartbeatSec != other.heartbeatSec) return true;
         return false;  // All values identical
     }
 };
@@ -127,9 +134,19 @@ public:
     // Check if config values differ (ignores timestamps)
     bool configValuesChanged(const DeviceConfig& a, const DeviceConfig& b);
 
+    // Build config JSON payload for server (also used by the simulator's fleet mode)
+    String buildConfigPayload(const DeviceConfig& config, bool priority = false);
+
+    // Parse server JSON response to DeviceConfig (also used by the fuzz targets)
+    bool parseConfig(const String& json, DeviceConfig& config);
+
+    // True once since the last call if the server rejected the token (401)
+    bool consumeUnauthorized();
+
 private:
     String deviceToken;
     String hardwareId;
+    volatile bool unauthorized;
 
     // ========================================================================
     // HELPER METHODS
@@ -141,12 +158,6 @@ private:
 
     // Add authorization header to HTTP client
     void addAuthHeader(HTTPClient& http);
-
-    // Parse server JSON response to DeviceConfig
-    bool parseConfig(const String& json, DeviceConfig& config);
-
-    // Build config JSON payload for server
-    String buildConfigPayload(const DeviceConfig& config, bool priority = false);
 };
 
 #endif // DEVICE_CONFIG_H
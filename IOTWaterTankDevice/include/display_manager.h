@@ -34,10 +34,18 @@ public:
     // Cycle to next screen (BTN1)
     void nextScreen();
 
+    // Jump to a screen (BTN1 double click)
+    void setScreen(DisplayScreen screen);
+
     // Get current screen
     DisplayScreen getCurrentScreen();
 
+    // Show OTA progress as an overlay on every screen (-1 = hide)
+    void setOtaProgress(int percent);
+
     // Show message (for errors, status updates, etc.)
+    // Non-blocking: the message stays up for 'duration' ms, during which
+    // update() leaves it on screen
     void showMessage(const String& title, const String& message, int duration = 2000);
 
     // Show startup splash screen
@@ -63,6 +71,41 @@ private:
 
     unsigned long uptime;
 
+    int otaProgress;  // -1 = no update running
+
+    unsigned long messageUntil;  // update() keeps a message up until then
+
+    // Frame buffers:
+    //   back   - the Adafruit buffer, drawn by the caller (main loop)
+    //   front  - last presented frame, handed to the display task
+    //   shadow - what the panel currently shows (display task only)
+    // flush() copies back -> front and wakes the task, which diffs front
+    // against shadow and sends only the changed columns of each page.
+    uint8_t* frontFrame;
+    uint8_t* shadowFrame;
+    bool shadowValid;
+    SemaphoreHandle_t frameMutex;
+    TaskHandle_t taskHandle;
+
+    // Present the back buffer (non-blocking when the task is running)
+    void flush();
+
+    // Display task: waits for a presented frame and sends it
+    static void displayTask(void* parameter);
+
+    // Diff 'frame' against the shadow, update the shadow and record the
+    // changed column span of each page (first > last = clean page)
+    void collectDirty(const uint8_t* frame, uint8_t* first, uint8_t* last);
+
+    // Send the recorded spans from the shadow to the panel
+    void sendDirty(const uint8_t* first, const uint8_t* last);
+
+    // Send columns [firstCol, lastCol] of one page
+    void writePage(uint8_t page, uint8_t firstCol, uint8_t lastCol, const uint8_t* data);
+
+    // Draw OTA progress strip at the bottom of the screen
+    void drawOtaOverlay();
+
     // Draw different screens
     void drawStatusScreen(float waterLevel, float waterLevelPercent,
                          bool pumpOn, const String& pumpMode, int rssi, bool wifiConnected);
@@ -29,6 +29,7 @@
 #define API_DEVICE_CONFIG            "/api/device/config"          // GET/POST device configuration
 #define API_DEVICE_CONTROL           "/api/device/control"         // POST control commands to device
 #define API_DEVICE_TELEMETRY         "/api/device-telemetry"       // POST telemetry data
+#define API_DEVICE_TELEMETRY_BATCH   "/api/device-telemetry/batch" // POST timestamped backlog records
 
 // Firmware Management
 #define API_FIRMWARE_LATEST          "/api/device/firmware/latest"    // GET latest firmware info
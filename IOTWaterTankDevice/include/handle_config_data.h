@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "sync_types.h"
+#include "sync_snapshot.h"
 
 // ============================================================================
 // CONFIG DATA HANDLER
@@ -23,6 +24,7 @@ public:
     SyncBool forceUpdate;
     SyncString ipAddress;
     SyncBool autoUpdate;
+    SyncFloat heartbeatSec;     // Server only: the app never sets it
 
     // Initialize with default values
     void begin();
@@ -37,7 +39,8 @@ public:
                        float api_maxInflow, uint64_t api_maxInflow_ts,
                        bool api_forceUpdate, uint64_t api_forceUpdate_ts,
                        const String& api_ipAddress, uint64_t api_ipAddress_ts,
-                       bool api_autoUpdate, uint64_t api_autoUpdate_ts);
+                       bool api_autoUpdate, uint64_t api_autoUpdate_ts,
+                       float api_heartbeatSec, uint64_t api_heartbeatSec_ts);
 
     // Update from Local source (from app via webserver)
     void updateFromLocal(float local_upperThreshold, uint64_t local_upperThreshold_ts,
@@ -62,6 +65,13 @@ public:
     // Perform 3-way merge - returns true if any value changed
     bool merge();
 
+    // Sanity check for incoming values (server or app) before they reach the
+    // pump logic: finite numbers, thresholds 0-100 with lower < upper, tank
+    // dimensions in (0, MAX_TANK_DIMENSION]
+    static bool isPlausible(float upperThreshold, float lowerThreshold,
+                            float tankHeight, float tankWidth,
+                            float usedTotal, float maxInflow);
+
     // Get current values (after merge)
     float getUpperThreshold() const { return upperThreshold.value; }
     float getLowerThreshold() const { return lowerThreshold.value; }
@@ -73,6 +83,12 @@ public:
     bool getForceUpdate() const { return forceUpdate.value; }
     String getIpAddress() const { return ipAddress.value; }
     bool getAutoUpdate() const { return autoUpdate.value; }
+    float getHeartbeatSec() const { return heartbeatSec.value; }
+
+    // Telemetry heartbeat in ms, heartbeatSec clamped to
+    // TELEMETRY_HEARTBEAT_MIN..MAX (anything unusable: the default)
+    unsigned long getHeartbeatMs() const { return heartbeatIntervalMs(heartbeatSec.value); }
+    static unsigned long heartbeatIntervalMs(float seconds);
 
     // Get timestamps (after merge)
     uint64_t getUpperThresholdTimestamp() const { return upperThreshold.lastModified; }
@@ -85,6 +101,7 @@ public:
     uint64_t getForceUpdateTimestamp() const { return forceUpdate.lastModified; }
     uint64_t getIpAddressTimestamp() const { return ipAddress.lastModified; }
     uint64_t getAutoUpdateTimestamp() const { return autoUpdate.lastModified; }
+    uint64_t getHeartbeatSecTimestamp() const { return heartbeatSec.lastModified; }
 
     // Set all values with priority flag for uploading to server
     void setAllPriority();
@@ -93,6 +110,10 @@ public:
     // Returns true if any field's value differs from its api_value
     bool valuesDifferFromAPI() const;
 
+    // Binary snapshot (full 3-way state incl. timestamps) for NVS persistence
+    void toSnapshot(ConfigSnapshot& snapshot) const;
+    void fromSnapshot(const ConfigSnapshot& snapshot);
+
     // Debug: Print current state
     void printState();
 };
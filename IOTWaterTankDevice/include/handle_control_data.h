@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "sync_types.h"
+#include "sync_snapshot.h"
 
 // ============================================================================
 // CONTROL DATA HANDLER
@@ -45,6 +46,10 @@ public:
     void setPumpSwitchPriority(bool value);
     void setConfigUpdatePriority(bool value);
 
+    // Binary snapshot (full 3-way state incl. timestamps) for NVS persistence
+    void toSnapshot(ControlSnapshot& snapshot) const;
+    void fromSnapshot(const ControlSnapshot& snapshot);
+
     // Debug: Print current state
     void printState();
 };
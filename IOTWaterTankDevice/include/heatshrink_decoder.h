@@ -0,0 +1,78 @@
+#ifndef HEATSHRINK_DECODER_H
+#define HEATSHRINK_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "patch_stream.h"
+
+// ============================================================================
+// STREAMING HEATSHRINK DECODER
+// ============================================================================
+// Decompresses a heatshrink (LZSS) stream as it arrives and passes the output
+// to a PatchSink. No Arduino dependencies.
+//
+// Bit stream, MSB first:
+//   1 + 8 bits                     literal byte
+//   0 + WINDOW bits + LOOKAHEAD bits   back-reference: copy (count + 1) bytes
+//                                      from (index + 1) bytes back
+// Trailing bits of the last byte are padding.
+//
+// Window and lookahead sizes are fixed at build time so RAM use is bounded:
+// one 2^WINDOW history buffer + one HEATSHRINK_OUTPUT_CHUNK output buffer.
+
+#define HEATSHRINK_WINDOW_BITS 10       // 1 KB history (must match the encoder: -w 10)
+#define HEATSHRINK_LOOKAHEAD_BITS 5     // Max match 32 bytes (must match the encoder: -l 5)
+#define HEATSHRINK_OUTPUT_CHUNK 128
+
+class HeatshrinkDecoder {
+public:
+    HeatshrinkDecoder();
+
+    // Reset and attach the decompressed output writer
+    void begin(PatchSink* sink);
+
+    // Feed the next compressed bytes (any chunking). Returns false on error.
+    bool feed(const uint8_t* data, size_t length);
+
+    // Flush buffered output at the end of the stream
+    bool finish();
+
+    // Decompressed bytes produced so far (including unflushed output)
+    uint64_t getOutputSize() const { return outputSize; }
+
+    // Error description (static string) after feed()/finish() returned false
+    const char* getError() const { return error; }
+
+private:
+    enum State {
+        STATE_TAG,
+        STATE_LITERAL,
+        STATE_INDEX,
+        STATE_COUNT,
+        STATE_ERROR
+    };
+
+    PatchSink* sink;
+    State state;
+    const char* error;
+
+    uint32_t bitBuffer;
+    uint8_t bitCount;
+    uint16_t backrefIndex;
+
+    uint64_t outputSize;
+    uint16_t windowHead;
+    uint8_t window[1 << HEATSHRINK_WINDOW_BITS];
+
+    uint8_t outBuffer[HEATSHRINK_OUTPUT_CHUNK];
+    size_t outFill;
+
+    // Take 'count' bits from the bit buffer (caller checks availability)
+    uint16_t takeBits(uint8_t count);
+
+    bool emit(uint8_t value);
+    bool flush();
+    bool fail(const char* message);
+};
+
+#endif // HEATSHRINK_DECODER_H
@@ -0,0 +1,76 @@
+#ifndef LEAK_DETECTOR_H
+#define LEAK_DETECTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// LEAK DETECTOR (night-flow baseline + CUSUM)
+// ============================================================================
+// A leak is a slow, steady volume loss that never stops, while demand comes
+// in bursts. So the detector looks at the lowest steady outflow:
+//
+// 1. Volume is averaged per minute while the pump is off. A window of
+//    LEAK_WINDOW_MINUTES consecutive pump-off minutes gives one outflow
+//    estimate: the median of the minute-to-minute drops. Draws shorter
+//    than half the window don't move the median.
+// 2. Night flow = minimum over the last LEAK_MIN_WINDOWS windows. Any
+//    quiet stretch in that span (overnight, always) brings it down to
+//    the leak + evaporation floor.
+// 3. Baseline = the site's normal night flow, learned from (2): follows
+//    drops quickly and rises only slowly, so a leak isn't learned away
+//    before it is detected. Kept in NVS across reboots.
+// 4. CUSUM: S = max(0, S + nightFlow - baseline - LEAK_CUSUM_K_LPH).
+//    S >= LEAK_CUSUM_H_LPH raises the alarm, S back at 0 clears it.
+//
+// No alarm is raised while the baseline is still being learned.
+
+struct LeakStatus {
+    bool learning;          // Baseline not established yet
+    bool alarm;
+    float nightFlowLph;     // Latest night-flow estimate
+    float baselineLph;      // Learned normal night flow
+    float cusum;            // L/h above baseline + allowance, summed over windows
+};
+
+class LeakDetector {
+public:
+    LeakDetector();
+
+    // Restore the learned baseline from NVS
+    void begin();
+
+    // Feed one reading (loop, every SENSOR_READ_INTERVAL)
+    void addSample(float volumeLiters, int pumpStatus);
+
+    LeakStatus getStatus();
+
+private:
+    portMUX_TYPE mux;
+    LeakStatus status;      // Guarded by mux (read by upload tasks)
+
+    // Minute means (pump off the whole minute)
+    float minuteSum;
+    int minuteReadings;
+    bool minuteValid;
+    unsigned long minuteStart;
+    float minutes[LEAK_WINDOW_MINUTES];
+    int minuteCount;
+
+    // Outflow per window, oldest first once full
+    float windows[LEAK_MIN_WINDOWS];
+    int windowHead;
+    int windowCount;
+
+    uint32_t learnedWindows;
+    uint32_t windowsSinceSave;
+
+    void closeMinute();
+    void closeWindow();
+    void update(float nightFlowLph);
+};
+
+// Global instance
+extern LeakDetector leakDetector;
+
+#endif // LEAK_DETECTOR_H
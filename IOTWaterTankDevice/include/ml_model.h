@@ -0,0 +1,127 @@
+#ifndef ML_MODEL_H
+#define ML_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// QUANTIZED INT8 MLP (model format + interpreter)
+// ============================================================================
+// A model is a stack of fully connected layers with int8 weights and
+// activations (int32 accumulators), run on a window of the level/flow
+// stream. No dynamic allocation at inference time: the weights stay in
+// the loaded file image, activations ping-pong between two static buffers.
+//
+// File layout (little-endian, every section 4-byte aligned):
+//   MLModelHeader
+//   per layer: MLLayerHeader
+//              int8  weights[outputs][inputs]   (padded to 4 bytes)
+//              int32 bias[outputs]              (scale = inputScale * weightScale)
+//   uint32 CRC-32 over everything before it
+//
+// Features: 'window' samples, each the mean over 'strideSec' seconds,
+// oldest first. Per sample the enabled channels in bit order (level %,
+// inflow L/min, pump 0/1), each normalized (x - offset) * scale, then
+// quantized with inputScale / inputZeroPoint.
+//
+// Quantization (real = scale * (q - zeroPoint), weights symmetric):
+//   acc   = bias + sum(w * (x - xZeroPoint))
+//   y     = round(acc * inScale * weightScale / outputScale) + outputZeroPoint
+//   value = outputGain * real(y[0]) + outputOffset
+
+#define ML_MODEL_MAGIC "TMLM"
+#define ML_MODEL_FORMAT 1
+
+enum MLChannel {
+    ML_CHANNEL_LEVEL  = 0x01,   // Water level (%)
+    ML_CHANNEL_INFLOW = 0x02,   // Inflow (L/min)
+    ML_CHANNEL_PUMP   = 0x04    // Pump status (0/1)
+};
+
+#define ML_CHANNEL_COUNT 3
+
+enum MLOutputKind {
+    ML_OUTPUT_SCORE = 0,        // Anomaly / leak score
+    ML_OUTPUT_FORECAST = 1      // Level (%) 'horizonSec' ahead
+};
+
+enum MLActivation {
+    ML_ACTIVATION_NONE = 0,
+    ML_ACTIVATION_RELU = 1
+};
+
+#pragma pack(push, 1)
+struct MLModelHeader {
+    char magic[4];              // ML_MODEL_MAGIC
+    uint8_t format;             // ML_MODEL_FORMAT
+    uint8_t outputKind;         // MLOutputKind
+    uint8_t channels;           // MLChannel mask
+    uint8_t layerCount;
+    uint16_t window;            // Samples per inference
+    uint16_t strideSec;         // Seconds averaged into one sample
+    uint16_t horizonSec;        // Forecast horizon (0 for scores)
+    uint8_t reserved[2];
+    float channelOffset[ML_CHANNEL_COUNT];
+    float channelScale[ML_CHANNEL_COUNT];
+    float inputScale;
+    int8_t inputZeroPoint;
+    uint8_t reserved2[3];
+    float outputGain;
+    float outputOffset;
+};
+
+struct MLLayerHeader {
+    uint16_t inputs;
+    uint16_t outputs;
+    uint8_t activation;         // MLActivation
+    int8_t outputZeroPoint;
+    uint8_t reserved[2];
+    float weightScale;
+    float outputScale;
+};
+#pragma pack(pop)
+
+class MLModel {
+public:
+    MLModel();
+    ~MLModel();
+    MLModel(const MLModel&) = delete;
+    MLModel& operator=(const MLModel&) = delete;
+
+    // Take ownership of a heap buffer holding a model file (freed on
+    // failure too). Checks the CRC, the layer chain and the budgets.
+    bool begin(uint8_t* data, size_t size);
+
+    // Run one inference on inputCount() features. false if not loaded.
+    bool run(const float* features, float& value);
+
+    bool isLoaded() const { return data != nullptr; }
+    const MLModelHeader& header() const { return head; }
+    int inputCount() const;
+    uint32_t macCount() const { return macs; }
+    const char* getError() const { return error; }
+
+private:
+    struct Layer {
+        MLLayerHeader head;
+        const int8_t* weights;
+        const int32_t* bias;    // With the input zero point folded in at load
+        float multiplier;       // inScale * weightScale / outputScale
+    };
+
+    uint8_t* data;
+    size_t size;
+    MLModelHeader head;
+    Layer layers[ML_MAX_LAYERS];
+    uint32_t macs;
+    const char* error;
+
+    bool fail(const char* message);
+    void end();
+
+    // Activation buffers (inference runs on one task at a time), 16-byte
+    // aligned so batchDotS8 takes the vector path on the S3
+    alignas(16) static int8_t activations[2][ML_MAX_LAYER_WIDTH];
+};
+
+#endif // ML_MODEL_H
@@ -0,0 +1,127 @@
+#ifndef ML_RUNTIME_H
+#define ML_RUNTIME_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "mbedtls/sha256.h"
+#include "config.h"
+#include "ml_model.h"
+
+// ============================================================================
+// ML RUNTIME (model updates + inference on the sensor stream)
+// ============================================================================
+// Model updates run in a background task, like firmware OTA:
+// 1. GET API_MLMODEL_LATEST -> {id, version, size, sha256} (404 = none published)
+// 2. GET API_MLMODEL_DOWNLOAD/<id>, streamed to ML_MODEL_DIR/model.tmp
+//    with the SHA-256 checked against the server digest
+// 3. The file is loaded and validated (format, CRC, budgets) before it
+//    replaces the installed model. The installed one is kept as prev.bin
+//    and is used if model.bin ever fails to load at boot.
+//
+// Inference runs on the loop: addSample() is fed every sensor read,
+// averages over the model's stride and runs the model once per stride
+// when the window is full. Budgets: model size ML_MAX_MODEL_SIZE (heap),
+// ML_MAX_MACS per inference, measured latency against ML_LATENCY_BUDGET_US.
+
+enum MLUpdateState {
+    ML_UPDATE_IDLE,
+    ML_UPDATE_CHECKING,      // Fetching model metadata
+    ML_UPDATE_DOWNLOADING,   // Streaming model to LittleFS
+    ML_UPDATE_FAILED
+};
+
+struct MLModelInfo {
+    String id;
+    String version;
+    size_t size;
+    String sha256;           // Lowercase hex digest of the model file
+};
+
+// Latest inference, published with telemetry
+struct MLResult {
+    bool valid;              // A model ran on a full window
+    uint8_t outputKind;      // MLOutputKind
+    uint16_t horizonSec;     // Forecast horizon
+    float value;
+    char version[ML_VERSION_MAX_LENGTH + 1];
+    uint32_t latencyUs;      // Last inference
+    uint32_t maxLatencyUs;   // Worst since the model was loaded
+    uint32_t overruns;       // Inferences above ML_LATENCY_BUDGET_US
+};
+
+class MLRuntime {
+public:
+    MLRuntime();
+
+    // Load the installed model (LittleFS must be mounted)
+    void begin();
+
+    // Start a background model check/download (non-blocking)
+    // Returns false if one is already running or the task can't be created
+    bool startUpdate(const String& deviceToken);
+
+    bool isUpdating();
+    MLUpdateState getState();
+    String getLastError();
+
+    // Feed one sensor reading (loop, every SENSOR_READ_INTERVAL)
+    void addSample(float waterLevel, float currInflow, int pumpStatus);
+
+    // Snapshot of the latest inference
+    MLResult getResult();
+
+private:
+    volatile MLUpdateState state;
+    String lastError;
+    String token;
+    TaskHandle_t taskHandle;
+    SemaphoreHandle_t errorMutex;
+    portMUX_TYPE mux;
+
+    // Installed model (task side)
+    String installedId;
+    String installedVersion;
+
+    // Loop side: the running model and its input window
+    MLModel* active;
+    char activeVersion[ML_VERSION_MAX_LENGTH + 1];
+    float samples[ML_MAX_WINDOW][ML_CHANNEL_COUNT];
+    int sampleHead;          // Next slot
+    int sampleCount;
+    float strideSum[ML_CHANNEL_COUNT];
+    int strideReadings;
+    unsigned long strideStart;
+
+    // Handed over by the update task, picked up by addSample()
+    MLModel* pending;
+    char pendingVersion[ML_VERSION_MAX_LENGTH + 1];
+
+    MLResult result;         // Guarded by mux
+
+    // Background task entry
+    static void updateTask(void* parameter);
+
+    // Check/download/install sequence (runs in the task)
+    bool runUpdate();
+    bool fetchModelInfo(MLModelInfo& info);
+    bool downloadModel(const MLModelInfo& info, const String& path);
+
+    // Swap the verified download in, keeping the old model as prev
+    bool install(const MLModelInfo& info, const String& downloadPath);
+
+    // Read and validate a model file into a new MLModel (nullptr on failure)
+    MLModel* loadFile(const String& path, String& error);
+
+    bool readMeta(const String& path, String& id, String& version);
+    bool writeMeta(const String& path, const MLModelInfo& info);
+
+    // Hand a loaded model to the loop
+    void offer(MLModel* model, const String& version);
+    void adoptPending();
+    void runInference();
+
+    void setError(const String& error);
+};
+
+#endif // ML_RUNTIME_H
@@ -4,40 +4,137 @@
 #include <Arduino.h>
 #include <Update.h>
 #include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "mbedtls/sha256.h"
 #include "config.h"
+#include "delta_patch.h"
+#include "heatshrink_decoder.h"
 
-class OTAUpdater {
+// ============================================================================
+// OTA UPDATER (background task)
+// ============================================================================
+// The whole update runs in its own FreeRTOS task so the main loop (pump
+// control, sensors, display) keeps running during the download.
+//
+// 1. GET API_FIRMWARE_LATEST -> {id, version, size, sha256}
+// 2. GET API_FIRMWARE_DOWNLOAD_ID/<id>, streamed into the OTA partition
+//    - If the server offers a delta patch for the running version, the
+//      patch is downloaded instead and applied against the running
+//      partition (DeltaPatcher). Any patch failure falls back to the full image.
+//    - The full image may be heatshrink-compressed ("encoding": "heatshrink",
+//      plus "transferSize"); it is decompressed on the fly in front of the
+//      flash writer. heatshrink is the only encoding: the server must make
+//      it with -w 10 -l 5 (ota-tool compress). gzip needs a 32 KB window,
+//      so there is no gzip decoder. Patches are always compressed (part of
+//      their format, see delta_patch.h)
+//    - A dropped connection resumes with "Range: bytes=<written>-"
+//      (a server ignoring Range is handled by skipping the bytes already written)
+//    - SHA-256 is computed while streaming and checked against the server
+//      digest before the new image is marked bootable
+// 3. On success a restart is requested; the main loop performs it
+
+enum OTAState {
+    OTA_IDLE,
+    OTA_CHECKING,      // Fetching firmware metadata
+    OTA_DOWNLOADING,   // Streaming image to flash
+    OTA_VERIFYING,     // Checking SHA-256 and finalizing
+    OTA_SUCCESS,       // Image ready - restart pending
+    OTA_FAILED
+};
+
+struct FirmwareInfo {
+    String id;
+    String version;
+    size_t size;
+    String sha256;     // Lowercase hex digest of the image
+    bool compressed;   // Image served heatshrink-compressed
+    size_t transferSize; // Bytes to download (== size unless compressed)
+
+    // Optional delta patch (delta_patch.h) from patchBase to this version
+    String patchId;
+    size_t patchSize;  // Bytes to download
+    String patchBase;
+};
+
+class OTAUpdater : private PatchSink {
 public:
     OTAUpdater();
 
     // Initialize OTA updater
     void begin();
 
-    // Check for firmware update and perform if available
-    // Returns true if update was successful, false otherwise
-    bool checkAndUpdate(const String& deviceToken);
+    // Start a background update check/download (non-blocking)
+    // Returns false if an update is already running or the task can't be created
+    bool startUpdate(const String& deviceToken);
 
     // Get update status
     bool isUpdating();
 
+    // Current state of the update task
+    OTAState getState();
+
     // Get update progress (0-100)
     int getProgress();
 
+    // True once a verified image is installed and the device should restart
+    bool isRestartPending();
+
     // Get last error message
     String getLastError();
 
 private:
-    bool updating;
-    int progress;
+    volatile OTAState state;
+    volatile int progress;
     String lastError;
+    String token;
+    TaskHandle_t taskHandle;
+    SemaphoreHandle_t errorMutex;
+
+    // Image stream state (one download at a time)
+    mbedtls_sha256_context sha;
+    DeltaPatcher patcher;
+    HeatshrinkDecoder decoder;
+    bool deltaMode;
+    bool compressedMode;
+    size_t imageWritten;
+
+    // Background task entry
+    static void updateTask(void* parameter);
+
+    // Full update sequence (runs in the task)
+    bool runUpdate();
+
+    // Fetch and parse firmware metadata
+    bool fetchFirmwareInfo(FirmwareInfo& info);
+
+    // Download full image or delta patch, resuming as needed, and verify SHA-256
+    bool downloadImage(const FirmwareInfo& info, bool delta);
+
+    // Download from offset 'downloaded' to the end (or until the connection drops)
+    // Returns false on a fatal error (no point in resuming)
+    bool downloadFrom(const String& url, size_t totalSize, size_t& downloaded);
+
+    // Route downloaded bytes: to the patcher (delta), or through the decoder
+    // (compressed image) to flash
+    bool consume(const uint8_t* data, size_t length);
+    bool consumeDecoded(const uint8_t* data, size_t length);
 
-    // Download and install firmware
-    bool downloadAndInstall(const String& url, const String& token);
+    // PatchSink: write new image bytes to the OTA partition and hash them
+    bool write(const uint8_t* data, size_t length) override;
 
-    // Callback for update progress
-    static void onProgress(size_t current, size_t total);
+    // Decoder output -> consumeDecoded()
+    class DecodedSink : public PatchSink {
+    public:
+        explicit DecodedSink(OTAUpdater* owner) : owner(owner) {}
+        bool write(const uint8_t* data, size_t length) override {
+            return owner->consumeDecoded(data, length);
+        }
+    private:
+        OTAUpdater* owner;
+    };
+    DecodedSink decodedSink;
 
-    static OTAUpdater* instance; // For static callback
+    void setError(const String& error);
 };
 
 #endif // OTA_UPDATER_H
@@ -0,0 +1,28 @@
+#ifndef PATCH_STREAM_H
+#define PATCH_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// OTA STREAM INTERFACES
+// ============================================================================
+// I/O of the streaming OTA stages (DeltaPatcher, HeatshrinkDecoder), so the
+// stages stay Arduino-free and can be chained or run on the host.
+
+// Random-access reader for the old (running) image
+class PatchSource {
+public:
+    virtual ~PatchSource() {}
+    virtual size_t size() = 0;
+    virtual bool read(size_t offset, uint8_t* buffer, size_t length) = 0;
+};
+
+// Sequential writer for the next stage or the new image
+class PatchSink {
+public:
+    virtual ~PatchSink() {}
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+};
+
+#endif // PATCH_STREAM_H
@@ -0,0 +1,92 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifdef CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+// ============================================================================
+// POWER MANAGEMENT (DFS + automatic light sleep) AND DUTY CYCLE TRACKING
+// ============================================================================
+// The device only has real work for a few ms per second, so between loop
+// passes the CPU drops to POWER_CPU_MIN_MHZ and, when the SDK supports it,
+// enters automatic light sleep (WiFi stays associated via modem sleep).
+//
+// - The loop holds a CPU_FREQ_MAX lock while it runs (active phase) and
+//   releases it before idling until the next scheduled deadline
+// - Subsystems report activity; the share of wall time each one was active
+//   is reported per window (POWER_REPORT_INTERVAL) together with an
+//   estimated average current, so consumption can be compared per release
+//
+// Without CONFIG_PM_ENABLE only the duty cycle tracking is active.
+
+enum PowerSubsystem {
+    POWER_LOOP,       // Main loop active phase (CPU at max clock)
+    POWER_SENSOR,     // Ultrasonic measurement + control update
+    POWER_DISPLAY,    // I2C transfer in the display task
+    POWER_NETWORK,    // Server tasks / OTA in flight (radio busy)
+    POWER_SUBSYSTEM_COUNT
+};
+
+class PowerManager {
+public:
+    PowerManager();
+
+    // Configure DFS / light sleep and create the PM lock
+    void begin();
+
+    // Activity bracket (any task, may nest). POWER_LOOP also holds the
+    // max-frequency lock.
+    void beginActivity(PowerSubsystem subsystem);
+    void endActivity(PowerSubsystem subsystem);
+
+    // Level-style activity (e.g. "any server task running"), polled from loop
+    void setActive(PowerSubsystem subsystem, bool active);
+
+    // Close the report window when due and log it (call in loop)
+    void update();
+
+    // Duty cycle (0-1) of the last completed window
+    float getDutyCycle(PowerSubsystem subsystem);
+
+    // Duty cycle (0-1) since boot
+    float getBootDutyCycle(PowerSubsystem subsystem);
+
+    // Estimated average current (mA) of the last completed window
+    float getEstimatedCurrent();
+
+    bool isLightSleepEnabled() { return lightSleepEnabled; }
+
+    // Report as JSON (last window + since boot)
+    String getReportJson();
+
+    static const char* subsystemName(PowerSubsystem subsystem);
+
+private:
+    bool pmConfigured;
+    bool lightSleepEnabled;
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t cpuLock;   // Held during the loop's active phase
+#endif
+
+    uint8_t depth[POWER_SUBSYSTEM_COUNT];
+    int64_t activeSince[POWER_SUBSYSTEM_COUNT];
+    int64_t windowActive[POWER_SUBSYSTEM_COUNT];    // us in the current window
+    int64_t bootActive[POWER_SUBSYSTEM_COUNT];      // us since boot
+    float lastDuty[POWER_SUBSYSTEM_COUNT];
+
+    int64_t windowStart;
+    int64_t lastWindowLength;
+    int64_t bootStart;
+
+    portMUX_TYPE mux;
+
+    float estimateCurrent(const float* duty);
+};
+
+extern PowerManager powerManager;
+
+#endif // POWER_MANAGER_H
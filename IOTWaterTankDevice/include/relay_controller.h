@@ -11,6 +11,10 @@ enum PumpMode {
     MODE_OVERRIDE   // Hardware override switch (BTN6)
 };
 
+// Called from the loop (auto mode, cloud), the web server task (app) and the
+// button task (BTN2/3/4/6): every state change and check-then-act runs
+// under one mutex. The button task never touches NVS - a mode change is
+// persisted by the next update() in the loop.
 class RelayController {
 public:
     RelayController();
@@ -25,6 +29,10 @@ public:
     void turnOn();
     void turnOff();
 
+    // Button pump command: applied only in MANUAL mode, checked and switched
+    // in one step. Returns false when refused.
+    bool setManualPump(bool state);
+
     // Set pump mode
     void setMode(PumpMode mode);
     PumpMode getMode();
@@ -54,8 +62,14 @@ private:
     bool cloudCommand;        // Last cloud command state
     bool hardwareOverride;    // Hardware override switch state
     bool autoModeEnabled;     // Auto mode hysteresis flag
+    PumpMode savedMode;       // AUTO/MANUAL as stored in NVS (restored after override)
+    bool modeDirty;           // savedMode not written to NVS yet
 
     Preferences preferences;
+    SemaphoreHandle_t mutex;
+
+    void lock();
+    void unlock();
 
     // Apply pump state to relay pin
     void applyPumpState(bool state);
@@ -63,10 +77,13 @@ private:
     // Auto mode logic with hysteresis
     void handleAutoMode(float waterLevel, float upperThreshold, float lowerThreshold);
 
+    // Change mode (caller holds the lock)
+    void changeMode(PumpMode mode);
+
     // Load saved mode from NVS
     void loadMode();
 
-    // Save current mode to NVS
+    // Save savedMode to NVS (loop only)
     void saveMode();
 };
 
@@ -60,12 +60,12 @@ private:
     float currentInflow; // L/min
 
     // Circular buffer for distance smoothing
-    static const int BUFFER_SIZE = 5;
+    static constexpr int BUFFER_SIZE = 5;
     float distanceBuffer[BUFFER_SIZE];
     int bufferIndex;
 
     // Spike detection with consecutive stable reading tracking
-    static const int STABILITY_BUFFER_SIZE = 5;
+    static constexpr int STABILITY_BUFFER_SIZE = 5;
     float stabilityBuffer[STABILITY_BUFFER_SIZE];  // Last 5 raw readings
     int stabilityIndex;
     int stabilityCount;  // Number of consecutive stable readings
@@ -0,0 +1,52 @@
+#ifndef SERVER_URL_H
+#define SERVER_URL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// BACKEND SERVER URL
+// ============================================================================
+// Base URL of every backend request. SERVER_URL is the build default; an
+// override stored in NVS points a device at a staging server or a local
+// mock backend without reflashing. A change applies to the next request,
+// no reboot needed. Overrides must be https:// unless the build defines
+// SERVER_URL_OVERRIDE (config.h), which also adds the web route.
+//
+// Readers (any task) get a copy taken under a spinlock, so a change from
+// the web server never tears a URL in the middle of a request.
+
+class ServerUrl {
+public:
+    ServerUrl();
+
+    // Load the override from NVS (after storageManager.begin())
+    void begin();
+
+    // Current base URL, without a trailing slash
+    String get();
+
+    // Validate and persist an override; "" goes back to SERVER_URL
+    bool set(const String& url);
+
+    bool isOverridden();
+
+    // Increments on every change (lets users of the host/port re-parse)
+    uint32_t getGeneration() { return generation; }
+
+    // Split scheme://host[:port][/path] into host and port
+    static bool parseHostPort(const String& url, String& host, uint16_t& port);
+
+private:
+    char url[SERVER_URL_MAX_LENGTH + 1];
+    bool overridden;
+    volatile uint32_t generation;
+    portMUX_TYPE mux;
+
+    static bool isValid(const String& url);
+    void apply(const String& newUrl, bool override);
+};
+
+extern ServerUrl serverUrl;
+
+#endif // SERVER_URL_H
@@ -0,0 +1,23 @@
+#ifndef SHA256_COMPAT_H
+#define SHA256_COMPAT_H
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/version.h"
+
+// ============================================================================
+// STREAMING SHA-256 (mbedtls 2.x / 3.x)
+// ============================================================================
+// mbedtls 3.x dropped the _ret suffix (Arduino-ESP32 3.x), 2.x still needs it.
+// Used to verify downloads (firmware, ML models) while they stream in.
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+#define SHA256_STARTS(ctx) mbedtls_sha256_starts(ctx, 0)
+#define SHA256_UPDATE(ctx, data, len) mbedtls_sha256_update(ctx, data, len)
+#define SHA256_FINISH(ctx, out) mbedtls_sha256_finish(ctx, out)
+#else
+#define SHA256_STARTS(ctx) mbedtls_sha256_starts_ret(ctx, 0)
+#define SHA256_UPDATE(ctx, data, len) mbedtls_sha256_update_ret(ctx, data, len)
+#define SHA256_FINISH(ctx, out) mbedtls_sha256_finish_ret(ctx, out)
+#endif
+
+#endif // SHA256_COMPAT_H
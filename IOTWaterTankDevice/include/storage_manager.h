@@ -3,6 +3,21 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include "sync_snapshot.h"
+
+class ConfigDataHandler;
+class ControlDataHandler;
+
+// Last good WiFi association, for a directed fast reconnect
+struct WiFiConnectionCache {
+    uint8_t profile;    // WiFi profile slot it belongs to
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;        // DHCP lease (network byte order, as IPAddress stores it)
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
 
 // Storage manager for all NVS operations
 class StorageManager {
@@ -17,6 +32,17 @@ public:
     void saveWiFiCredentials(const String& ssid, const String& password);
     void clearWiFiCredentials();
 
+    // Additional WiFi profiles (slot 1..WIFI_MAX_PROFILES-1, slot 0 is the
+    // primary network stored by saveWiFiCredentials)
+    bool loadWiFiProfile(int slot, String& ssid, String& password);
+    void saveWiFiProfile(int slot, const String& ssid, const String& password);
+    void clearWiFiProfile(int slot);
+
+    // Cached BSSID/channel/lease of the last good connection
+    bool loadWiFiConnectionCache(WiFiConnectionCache& cache);
+    void saveWiFiConnectionCache(const WiFiConnectionCache& cache);
+    void clearWiFiConnectionCache();
+
     // Dashboard credentials
     bool loadDashboardCredentials(String &username, String &password);
     void saveDashboardCredentials(const String& username, const String& password);
@@ -29,6 +55,10 @@ public:
     String getHardwareId();
     void saveHardwareId(const String& hardwareId);
 
+    // Backend URL override ("" = SERVER_URL)
+    String getServerUrl();
+    void saveServerUrl(const String& url);
+
     // Device registration flag
     bool isDeviceRegistered();
     void setDeviceRegistered(bool registered);
@@ -53,21 +83,44 @@ public:
     uint32_t getOverflowCount();
     void saveOverflowCount(uint32_t count);
 
+    float getClockDrift();
+    void saveClockDrift(float driftPpm);
+
+    // Leak detector baseline (L/h) and the number of windows it was learned from
+    bool loadLeakBaseline(float& baselineLph, uint32_t& learnedWindows);
+    void saveLeakBaseline(float baselineLph, uint32_t learnedWindows);
+
     // WiFi configured flag
     bool isWiFiConfigured();
     void setWiFiConfigured(bool configured);
 
-    // Device configuration persistence
-    // Save critical config values so device works offline without server
-    void saveDeviceConfig(float upperThreshold, float lowerThreshold,
-                         float tankHeight, float tankWidth, const String& tankShape);
+    // Legacy device configuration (pre-snapshot firmware), read for migration only
     bool loadDeviceConfig(float& upperThreshold, float& lowerThreshold,
                          float& tankHeight, float& tankWidth, String& tankShape);
     bool hasDeviceConfig();  // Check if config exists in storage
 
+    // Sync state snapshot (full 3-way config + control state in one blob)
+    // Written alternately to two slots (A/B) so a power loss mid-write always
+    // leaves the previous snapshot intact. Identical state is not rewritten.
+    // Safe to call from any task (the web server saves from AsyncTCP).
+    bool saveSyncSnapshot(const ConfigDataHandler& config, const ControlDataHandler& control);
+    bool loadSyncSnapshot(ConfigDataHandler& config, ControlDataHandler& control);
+
 private:
     Preferences prefs;
 
+    // Snapshot slot bookkeeping (valid after first load/save)
+    uint32_t snapshotSequence;
+    uint32_t snapshotCrc;
+    int snapshotSlot;  // Slot holding the newest snapshot (-1 = none)
+    Preferences snapshotPrefs;        // Own handle: other saves may run on other tasks
+    SemaphoreHandle_t snapshotMutex;  // Guards snapshotPrefs, the bookkeeping and the slot write
+
+    void lockSnapshot();
+    void unlockSnapshot();
+    bool readSnapshotSlot(int slot, SyncSnapshot& snapshot);
+    bool writeSyncSnapshot(const ConfigDataHandler& config, const ControlDataHandler& control);  // Caller holds the lock
+
     // Helper to open preferences namespace
     bool openNamespace(const char* ns, bool readOnly);
     void closeNamespace();
@@ -0,0 +1,162 @@
+#ifndef SYNC_SNAPSHOT_H
+#define SYNC_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "sync_types.h"
+
+// ============================================================================
+// SYNC STATE SNAPSHOT (binary persistence layout)
+// ============================================================================
+// Fixed-size mirror of the 3-way sync handlers so the complete
+// API / Local / Self state (values + per-source timestamps) can be written
+// to NVS as a single blob and restored in one read at boot.
+//
+// Layout changes MUST bump SYNC_SNAPSHOT_VERSION. A snapshot with an unknown
+// version or a CRC mismatch is ignored and the device falls back to the
+// legacy per-key config ("devcfg" namespace). Version 1 (no heartbeatSec)
+// is still read; the field starts from its default.
+
+#define SYNC_SNAPSHOT_MAGIC 0x53535457UL  // "WTSS"
+#define SYNC_SNAPSHOT_VERSION 2
+#define SYNC_SNAPSHOT_STRING_LEN 32       // Max stored length (incl. terminator)
+
+#pragma pack(push, 1)
+
+struct SyncBoolRecord {
+    uint8_t api_value;
+    uint64_t api_lastModified;
+    uint8_t local_value;
+    uint64_t local_lastModified;
+    uint8_t value;
+    uint64_t lastModified;
+};
+
+struct SyncFloatRecord {
+    float api_value;
+    uint64_t api_lastModified;
+    float local_value;
+    uint64_t local_lastModified;
+    float value;
+    uint64_t lastModified;
+};
+
+struct SyncStringRecord {
+    char api_value[SYNC_SNAPSHOT_STRING_LEN];
+    uint64_t api_lastModified;
+    char local_value[SYNC_SNAPSHOT_STRING_LEN];
+    uint64_t local_lastModified;
+    char value[SYNC_SNAPSHOT_STRING_LEN];
+    uint64_t lastModified;
+};
+
+// ConfigDataHandler fields, in declaration order
+struct ConfigSnapshot {
+    SyncFloatRecord upperThreshold;
+    SyncFloatRecord lowerThreshold;
+    SyncFloatRecord tankHeight;
+    SyncFloatRecord tankWidth;
+    SyncStringRecord tankShape;
+    SyncFloatRecord usedTotal;
+    SyncFloatRecord maxInflow;
+    SyncBoolRecord forceUpdate;
+    SyncStringRecord ipAddress;
+    SyncBoolRecord autoUpdate;
+    SyncFloatRecord heartbeatSec;     // Version 2
+};
+
+// ControlDataHandler fields, in declaration order
+struct ControlSnapshot {
+    SyncBoolRecord pumpSwitch;
+    SyncBoolRecord configUpdate;
+};
+
+struct SyncSnapshotHeader {
+    uint32_t magic;       // SYNC_SNAPSHOT_MAGIC
+    uint16_t version;     // SYNC_SNAPSHOT_VERSION
+    uint16_t length;      // sizeof(SyncSnapshot)
+    uint32_t sequence;    // Incremented on every write, highest valid slot wins
+    uint32_t crc;         // CRC32 over the config + control payload
+};
+
+// Complete blob as stored in one NVS slot
+struct SyncSnapshot {
+    SyncSnapshotHeader header;
+    ConfigSnapshot config;
+    ControlSnapshot control;
+};
+
+#pragma pack(pop)
+
+// Version 1: the same blob without ConfigSnapshot::heartbeatSec
+#define SYNC_SNAPSHOT_V1_LENGTH (sizeof(SyncSnapshot) - sizeof(SyncFloatRecord))
+
+// ============================================================================
+// RECORD CONVERSION HELPERS
+// ============================================================================
+
+inline void packSyncBool(const SyncBool& src, SyncBoolRecord& dst) {
+    dst.api_value = src.api_value ? 1 : 0;
+    dst.api_lastModified = src.api_lastModified;
+    dst.local_value = src.local_value ? 1 : 0;
+    dst.local_lastModified = src.local_lastModified;
+    dst.value = src.value ? 1 : 0;
+    dst.lastModified = src.lastModified;
+}
+
+inline void unpackSyncBool(const SyncBoolRecord& src, SyncBool& dst) {
+    dst.api_value = src.api_value != 0;
+    dst.api_lastModified = src.api_lastModified;
+    dst.local_value = src.local_value != 0;
+    dst.local_lastModified = src.local_lastModified;
+    dst.value = src.value != 0;
+    dst.lastModified = src.lastModified;
+}
+
+inline void packSyncFloat(const SyncFloat& src, SyncFloatRecord& dst) {
+    dst.api_value = src.api_value;
+    dst.api_lastModified = src.api_lastModified;
+    dst.local_value = src.local_value;
+    dst.local_lastModified = src.local_lastModified;
+    dst.value = src.value;
+    dst.lastModified = src.lastModified;
+}
+
+inline void unpackSyncFloat(const SyncFloatRecord& src, SyncFloat& dst) {
+    dst.api_value = src.api_value;
+    dst.api_lastModified = src.api_lastModified;
+    dst.local_value = src.local_value;
+    dst.local_lastModified = src.local_lastModified;
+    dst.value = src.value;
+    dst.lastModified = src.lastModified;
+}
+
+inline void packSyncString(const SyncString& src, SyncStringRecord& dst) {
+    strlcpy(dst.api_value, src.api_value.c_str(), SYNC_SNAPSHOT_STRING_LEN);
+    dst.api_lastModified = src.api_lastModified;
+    strlcpy(dst.local_value, src.local_value.c_str(), SYNC_SNAPSHOT_STRING_LEN);
+    dst.local_lastModified = src.local_lastModified;
+    strlcpy(dst.value, src.value.c_str(), SYNC_SNAPSHOT_STRING_LEN);
+    dst.lastModified = src.lastModified;
+}
+
+inline void unpackSyncString(const SyncStringRecord& src, SyncString& dst) {
+    // Records are CRC-checked, but never trust a terminator from flash
+    char buf[SYNC_SNAPSHOT_STRING_LEN];
+
+    memcpy(buf, src.api_value, sizeof(buf));
+    buf[sizeof(buf) - 1] = '\0';
+    dst.api_value = buf;
+    dst.api_lastModified = src.api_lastModified;
+
+    memcpy(buf, src.local_value, sizeof(buf));
+    buf[sizeof(buf) - 1] = '\0';
+    dst.local_value = buf;
+    dst.local_lastModified = src.local_lastModified;
+
+    memcpy(buf, src.value, sizeof(buf));
+    buf[sizeof(buf) - 1] = '\0';
+    dst.value = buf;
+    dst.lastModified = src.lastModified;
+}
+
+#endif // SYNC_SNAPSHOT_H
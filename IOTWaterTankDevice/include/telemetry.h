@@ -5,6 +5,9 @@
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "config.h"
+#include "telemetry_queue.h"
+#include "ml_runtime.h"
+#include "leak_detector.h"
 
 // ============================================================================
 // TELEMETRY MANAGER CLASS
@@ -31,11 +34,34 @@ public:
     // Upload telemetry data to server
     // Automatically includes Status field (always 1 for online tracking)
     // Server marks device offline if no telemetry for >60 seconds
-    bool uploadTelemetry(float waterLevel, float currInflow, int pumpStatus);
+    // 'ml' adds the latest model output when it is valid, 'leak' the leak detector state
+    bool uploadTelemetry(float waterLevel, float currInflow, int pumpStatus,
+                         const MLResult* ml = nullptr, const LeakStatus* leak = nullptr);
+
+    // Upload a leak alarm raise/clear right away (full telemetry + event,
+    // flagged high priority). Retries API_RETRY_COUNT times.
+    bool uploadLeakAlarm(float waterLevel, float currInflow, int pumpStatus, const LeakStatus& leak);
+
+    // Upload queued (timestamped) samples recorded while offline
+    // Single attempt - the queue keeps the records until this succeeds
+    bool uploadTelemetryBatch(const TelemetryRecord* records, size_t count);
+
+    // Build telemetry JSON payload (also used by the simulator's fleet mode)
+    // 'event' marks an alarm upload ("priority": "high")
+    String buildTelemetryPayload(float waterLevel, float currInflow, int pumpStatus,
+                                 const MLResult* ml = nullptr, const LeakStatus* leak = nullptr,
+                                 const char* event = nullptr);
+
+    // Build backlog batch JSON payload
+    String buildTelemetryBatchPayload(const TelemetryRecord* records, size_t count);
+
+    // True once since the last call if the server rejected the token (401)
+    bool consumeUnauthorized();
 
 private:
     String deviceToken;
     String hardwareId;
+    volatile bool unauthorized;
 
     // ========================================================================
     // HELPER METHODS
@@ -47,9 +73,6 @@ private:
 
     // Add authorization header to HTTP client
     void addAuthHeader(HTTPClient& http);
-
-    // Build telemetry JSON payload
-    String buildTelemetryPayload(float waterLevel, float currInflow, int pumpStatus);
 };
 
 #endif // TELEMETRY_H
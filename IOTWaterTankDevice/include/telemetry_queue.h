@@ -0,0 +1,86 @@
+#ifndef TELEMETRY_QUEUE_H
+#define TELEMETRY_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// TELEMETRY STORE-AND-FORWARD QUEUE (LittleFS)
+// ============================================================================
+// Bounded append-only log of telemetry samples that could not be uploaded
+// live (device offline, upload failed, task slot busy).
+//
+// On-flash layout (directory TELEMETRY_QUEUE_DIR):
+//   <segment id>.seg  - fixed-size records, appended in order
+//   cursor            - checkpointed read position {segment, record index}
+//
+// - Segments rotate every TELEMETRY_QUEUE_SEGMENT_RECORDS records
+// - When more than TELEMETRY_QUEUE_MAX_SEGMENTS exist, the oldest segment
+//   is evicted (oldest-first, newest data is always kept)
+// - Every record carries its own CRC, a torn write at power loss only
+//   loses that record. Appends after a torn tail start a fresh segment.
+// - The cursor is written to a temp file and renamed, so it is either the
+//   old or the new position, never garbage
+// - Fully drained segments are deleted, so the cursor segment is always
+//   the oldest segment on flash
+
+#pragma pack(push, 1)
+struct TelemetryRecord {
+    uint64_t timestamp;   // Epoch milliseconds when the sample was taken
+    float waterLevel;     // Percent
+    float currInflow;     // L/min
+    uint8_t pumpStatus;   // 0=OFF, 1=ON
+    uint8_t reserved[3];
+    uint32_t crc;         // CRC32 over all preceding fields
+};
+#pragma pack(pop)
+
+class TelemetryQueue {
+public:
+    TelemetryQueue();
+
+    // Mount LittleFS (formatting on first use) and recover queue state
+    bool begin();
+
+    // Append one sample (oldest data is evicted when the queue is full)
+    bool append(uint64_t timestamp, float waterLevel, float currInflow, int pumpStatus);
+
+    // Read up to maxRecords valid records from the cursor without consuming them.
+    // A batch never spans segments. *slotsRead receives the number of record
+    // slots covered (including corrupt ones), to be passed to consume().
+    size_t peek(TelemetryRecord* out, size_t maxRecords, size_t* slotsRead);
+
+    // Advance the cursor past slots returned by peek() and checkpoint it
+    void consume(size_t slots);
+
+    // Approximate number of queued records
+    uint32_t pendingCount();
+    bool isEmpty() { return pendingCount() == 0; }
+
+    // Records lost to eviction since boot
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+private:
+    bool mounted;
+    SemaphoreHandle_t mutex;
+
+    uint32_t headSegment;    // Segment currently appended to
+    uint32_t headCount;      // Records in head segment
+    uint32_t cursorSegment;  // Oldest segment, read position
+    uint32_t cursorIndex;    // Next record to read within cursorSegment
+    uint32_t droppedCount;
+
+    String segmentPath(uint32_t segment);
+    uint32_t segmentRecordCount(uint32_t segment);
+    bool loadCursor();
+    bool saveCursor();
+    void evictOldest();
+    void dropDrainedSegments();
+
+    static uint32_t recordCrc(const TelemetryRecord& record);
+};
+
+// Global telemetry queue instance
+extern TelemetryQueue telemetryQueue;
+
+#endif // TELEMETRY_QUEUE_H
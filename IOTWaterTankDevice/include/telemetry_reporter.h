@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_REPORTER_H
+#define TELEMETRY_REPORTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// TELEMETRY REPORTER (report by exception)
+// ============================================================================
+// Decides when a live sample is worth sending. Values are compared with the
+// last *reported* ones, so a slow drift is reported once it adds up to a
+// deadband:
+// - pump state changed, level moved TELEMETRY_LEVEL_DEADBAND or inflow
+//   moved TELEMETRY_INFLOW_DEADBAND -> report
+// - never two reports within TELEMETRY_MIN_INTERVAL
+// - nothing reported for the heartbeat interval -> heartbeat report
+//   (TELEMETRY_HEARTBEAT_INTERVAL, or the synced device config's
+//   heartbeatSec via setHeartbeatInterval)
+//
+// Inflow is the level derivative between two reads, so it is smoothed
+// before the deadband: median of the last 3 reads (drops single echo
+// glitches), then an EMA (TELEMETRY_INFLOW_SMOOTHING). Raw, sensor noise
+// alone crosses the deadband every few seconds. The caller decides where a due
+// report goes (upload or offline queue).
+
+enum TelemetryReason {
+    TELEMETRY_REPORT_NONE,
+    TELEMETRY_REPORT_PUMP,
+    TELEMETRY_REPORT_LEVEL,
+    TELEMETRY_REPORT_INFLOW,
+    TELEMETRY_REPORT_HEARTBEAT
+};
+
+class TelemetryReporter {
+public:
+    TelemetryReporter();
+
+    // Feed one sensor read (every SENSOR_READ_INTERVAL)
+    void addSample(float waterLevel, float currInflow, int pumpStatus);
+
+    // Why a report is due now (TELEMETRY_REPORT_NONE = not due)
+    TelemetryReason check(unsigned long now) const;
+
+    // Record a report of the current sample (sent or queued)
+    void markReported(unsigned long now);
+
+    // Force a heartbeat report 'delayMs' from now (boot, back online)
+    void scheduleReport(unsigned long now, unsigned long delayMs);
+
+    unsigned long sinceLastReport(unsigned long now) const { return now - reportedAt; }
+
+    // Longest gap between two reports (ConfigDataHandler::getHeartbeatMs)
+    void setHeartbeatInterval(unsigned long ms) { heartbeatMs = ms; }
+    unsigned long getHeartbeatInterval() const { return heartbeatMs; }
+
+    static const char* reasonName(TelemetryReason reason);
+
+private:
+    uint8_t samples;            // Reads so far (saturates at 3)
+    float level;
+    float inflowRecent[3];      // Last raw inflows, for the median
+    float inflowAvg;
+    int pump;
+
+    unsigned long heartbeatMs;
+    unsigned long reportedAt;
+    bool hasReported;           // Values below are valid
+    float reportedLevel;
+    float reportedInflow;       // Smoothed
+    int reportedPump;
+};
+
+#endif // TELEMETRY_REPORTER_H
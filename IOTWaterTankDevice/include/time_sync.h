@@ -0,0 +1,66 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================================================
+// HTTP TIME SYNC (backend API_TIME_SYNC)
+// ============================================================================
+// Fallback time source for networks that block NTP (UDP/123), and an
+// independent cross-check of the NTP clock.
+//
+// Cristian's algorithm over several samples:
+//   t0 = local send time, t1 = local receive time, S = server time in reply
+//   estimate at t1 = S + (t1 - t0) / 2, error bound = (t1 - t0) / 2
+// The sample with the smallest round trip has the tightest bound and wins.
+
+struct HttpTimeSample {
+    uint64_t serverTime;   // Estimated server time at localMillis (epoch ms)
+    uint64_t localMillis;  // Local clock (ms since boot) the estimate refers to
+    uint32_t rtt;          // Round trip of the chosen sample (ms)
+};
+
+// ============================================================================
+// TIME SYNC MANAGER CLASS
+// ============================================================================
+
+class TimeSyncManager {
+public:
+    TimeSyncManager();
+
+    // ========================================================================
+    // INITIALIZATION
+    // ========================================================================
+
+    // Set authentication token for API calls (sent if available)
+    void setToken(const String& token);
+
+    // ========================================================================
+    // TIME OPERATIONS
+    // ========================================================================
+
+    // Take HTTP_TIME_SYNC_SAMPLES samples and return the minimum-RTT one
+    // Blocking (network) - call from a task or at boot only
+    bool fetchServerTime(HttpTimeSample& sample);
+
+    // Local clock used for RTT measurement (ms since boot, 64-bit)
+    static uint64_t localMillis();
+
+private:
+    String deviceToken;
+
+    // ========================================================================
+    // HELPER METHODS
+    // ========================================================================
+
+    // One request/response round trip
+    bool takeSample(HTTPClient& http, HttpTimeSample& sample);
+
+    // Extract server time (ms) from the response body
+    bool parseServerTime(const String& json, uint64_t& serverTime);
+};
+
+#endif // TIME_SYNC_H
@@ -26,8 +26,9 @@ class LevelCalculator;
 
 // Callback function types
 typedef void (*PumpControlCallback)(bool state);
-typedef void (*WiFiSaveCallback)(const String& ssid, const String& password,
-                                 const String& dashUser, const String& dashPass);
+typedef uint32_t (*WiFiSaveCallback)(const String& ssid, const String& password,
+                                     const String& dashUser, const String& dashPass);  // Returns job id, 0 = busy
+typedef void (*ProvisioningStatusCallback)(JsonObject status);  // Fills provisioning job status
 typedef void (*ConfigSyncCallback)();      // Called when config changes and needs immediate sync
 typedef void (*ControlSyncCallback)();     // Called when control changes and needs immediate sync
 typedef void (*TimestampSyncCallback)(uint64_t timestamp);  // Called when timestamp synced from app
@@ -51,9 +52,15 @@ public:
     // Set pump control callback
     void setPumpControlCallback(PumpControlCallback callback);
 
-    // Set WiFi save callback
+    // Set API client (when provisioning leaves AP mode without a restart)
+    void setAPIClient(APIClient* apiCli);
+
+    // Set WiFi save callback (queues a provisioning job, must not block)
     void setWiFiSaveCallback(WiFiSaveCallback callback);
 
+    // Set provisioning status callback (for GET /{device_id}/provisionStatus)
+    void setProvisioningStatusCallback(ProvisioningStatusCallback callback);
+
     // Set config sync callback (called when config changes and needs immediate sync)
     void setConfigSyncCallback(ConfigSyncCallback callback);
 
@@ -95,6 +102,7 @@ private:
     // Callbacks
     PumpControlCallback pumpCallback;
     WiFiSaveCallback wifiSaveCallback;
+    ProvisioningStatusCallback provisioningStatusCallback;
     ConfigSyncCallback configSyncCallback;
     ControlSyncCallback controlSyncCallback;
     TimestampSyncCallback timestampSyncCallback;
@@ -102,6 +110,11 @@ private:
     // Setup routes
     void setupRoutes();
 
+    // Accumulate a POST body that may arrive in several chunks; true once it
+    // is complete. Bodies over WEB_MAX_BODY_SIZE get a 413 and are dropped.
+    bool collectBody(AsyncWebServerRequest* request, String& buffer, uint8_t* data,
+                     size_t len, size_t index, size_t total);
+
     // Route handlers - device endpoints
     void handleGetTelemetry(AsyncWebServerRequest* request);
     void handleGetControl(AsyncWebServerRequest* request);
@@ -116,9 +129,20 @@ private:
 
     // Route handlers - WiFi provisioning endpoints
     void handleProvisioningStatus(AsyncWebServerRequest* request);
+    void handleProvisionJobStatus(AsyncWebServerRequest* request);
     void handleScanWiFi(AsyncWebServerRequest* request);
     void handleSaveCredentials(AsyncWebServerRequest* request, uint8_t* data, size_t len,
                                size_t index, size_t total);
+    void handleGetWiFiProfiles(AsyncWebServerRequest* request);
+    void handlePostWiFiProfile(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                               size_t index, size_t total);
+
+    // Route handlers - backend server URL
+    void handleGetServerUrl(AsyncWebServerRequest* request);
+#ifdef SERVER_URL_OVERRIDE
+    void handlePostServerUrl(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                             size_t index, size_t total);
+#endif
 
     // Route handlers - other
     void handleNotFound(AsyncWebServerRequest* request);
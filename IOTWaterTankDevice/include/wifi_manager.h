@@ -21,6 +21,15 @@ void saveWiFiCredentials(const char* ssid, const char* password);
 // Clear saved WiFi credentials
 void clearWiFiCredentials();
 
+// Add/replace a WiFi profile (slot 0 = primary, lower slots preferred)
+bool setWiFiProfile(int slot, const char* ssid, const char* password);
+
+// Remove an additional WiFi profile (slot 1..WIFI_MAX_PROFILES-1)
+bool removeWiFiProfile(int slot);
+
+// Profiles with connect statistics (JSON array, no passwords)
+String getWiFiProfilesJson();
+
 // Save dashboard credentials
 void saveDashboardCredentials(const char* username, const char* password);
 
@@ -30,12 +39,25 @@ bool getDashboardCredentials(String &username, String &password);
 // Start WiFi client mode (non-blocking)
 bool startWiFiClient();
 
+// Queue a profile change from another task (web server); the loop applies
+// it on its next handleWiFiConnection(). Validated like setWiFiProfile /
+// removeWiFiProfile - false when those would refuse it.
+bool queueWiFiProfileEdit(int slot, const char* ssid, const char* password, bool remove);
+
 // Update WiFi connection status (call in loop)
 bool updateWiFiConnection();
 
+// The connection runs on a reused lease (WIFI_REUSE_DHCP_LEASE) but the
+// backend is unreachable: forget the lease and reconnect with DHCP.
+// Returns true when a reconnect was started.
+bool dropCachedWiFiLease();
+
 // Start WiFi Access Point mode
 void startWiFiAP();
 
+// Stop the setup AP once provisioning is done (station stays connected)
+void stopWiFiAP();
+
 // Handle WiFi connection maintenance
 void handleWiFiConnection();
 
@@ -0,0 +1,242 @@
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch_kernels.h"
+
+// ============================================================================
+// BATCH KERNEL BENCHMARK
+// ============================================================================
+// Times each kernel in batch_kernels.h against the plain loop it replaces
+// (the reference), per array length, and checks that both return the same
+// bits on the same input. A mismatch exits with status 1.
+//
+// The int8 kernels are checked with the operand at every offset from a
+// 16-byte boundary (the vector path needs one aligned operand), and
+// batchKernelsSelfTest() runs first, as at boot. Host numbers: compare
+// lengths and builds, not device timings.
+
+#define BENCH_MIN_NS 20000000LL         // Run each case for at least 20 ms
+#define BENCH_MAX_LENGTH 1024
+
+static const size_t lengths[] = { 8, 16, 32, 64, 128, 256, 512, 1024 };
+
+static volatile int32_t sinkInt;
+static volatile float sinkFloat;
+static int mismatches = 0;
+
+// ----------------------------------------------------------------------------
+// Reference loops (the code the kernels replaced)
+// ----------------------------------------------------------------------------
+
+static int32_t refDotS8(const int8_t* a, const int8_t* b, size_t n) {
+    int32_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        acc += (int32_t)a[i] * b[i];
+    }
+    return acc;
+}
+
+static int32_t refSumS8(const int8_t* x, size_t n) {
+    int32_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        acc += x[i];
+    }
+    return acc;
+}
+
+static void refMinMaxF32(const float* x, size_t n, float* lo, float* hi) {
+    *lo = x[0];
+    *hi = x[0];
+    for (size_t i = 1; i < n; i++) {
+        if (x[i] < *lo) *lo = x[i];
+        if (x[i] > *hi) *hi = x[i];
+    }
+}
+
+// Insertion sort, then the middle
+static float refMedianF32(float* x, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        float value = x[i];
+        size_t j = i;
+        while (j > 0 && x[j - 1] > value) {
+            x[j] = x[j - 1];
+            j--;
+        }
+        x[j] = value;
+    }
+    return (n % 2) ? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2.0f;
+}
+
+// ----------------------------------------------------------------------------
+// Timing
+// ----------------------------------------------------------------------------
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Nanoseconds per call of fn(), repeated for at least BENCH_MIN_NS
+template <typename Fn>
+static double timeNs(Fn fn) {
+    long calls = 0;
+    int64_t start = nowNs();
+    int64_t elapsed;
+    do {
+        for (int i = 0; i < 64; i++) {
+            fn();
+        }
+        calls += 64;
+        elapsed = nowNs() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    return (double)elapsed / calls;
+}
+
+static void check(bool same, const char* kernel, size_t n) {
+    if (!same) {
+        fprintf(stderr, "bench: %s differs from its reference at n=%zu\n", kernel, n);
+        mismatches++;
+    }
+}
+
+static bool sameBits(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static void printRow(const char* kernel, size_t n, double kernelNs, double refNs) {
+    printf("%-14s %6zu %12.1f %12.1f %8.2fx\n", kernel, n, kernelNs, refNs, refNs / kernelNs);
+}
+
+// ----------------------------------------------------------------------------
+// Cases
+// ----------------------------------------------------------------------------
+
+// Level-like samples: a slow ramp with noise and a few repeated values,
+// so the median sees duplicates
+static void fillSamples(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        x[i] = 50.0f + 0.01f * i + (float)(rand() % 200) / 100.0f;
+        if (rand() % 8 == 0 && i > 0) {
+            x[i] = x[i - 1];
+        }
+    }
+}
+
+static void benchLength(size_t n) {
+    alignas(16) int8_t a[BENCH_MAX_LENGTH + 16] = {};
+    alignas(16) int8_t b[BENCH_MAX_LENGTH] = {};
+    float x[BENCH_MAX_LENGTH];
+    float work[BENCH_MAX_LENGTH];
+
+    for (size_t i = 0; i < n + 16; i++) {
+        a[i] = (int8_t)(rand() % 256 - 128);
+    }
+    for (size_t i = 0; i < n; i++) {
+        b[i] = (int8_t)(rand() % 256 - 128);
+    }
+    fillSamples(x, n);
+
+    // Results first, then timing. A model row starts anywhere; the
+    // activations are aligned.
+    for (size_t offset = 0; offset < 16; offset++) {
+        const int8_t* row = a + offset;
+        check(batchDotS8(row, b, n) == refDotS8(row, b, n), "batchDotS8", n);
+        check(batchDotS8(b, row, n) == refDotS8(row, b, n), "batchDotS8", n);
+        check(batchSumS8(row, n) == refSumS8(row, n), "batchSumS8", n);
+    }
+
+    float lo, hi, refLo, refHi;
+    batchMinMaxF32(x, n, &lo, &hi);
+    refMinMaxF32(x, n, &refLo, &refHi);
+    check(sameBits(lo, refLo) && sameBits(hi, refHi), "batchMinMaxF32", n);
+
+    // Every length odd and even: the even case takes the two middles
+    for (size_t m = n > 1 ? n - 1 : n; m <= n; m++) {
+        memcpy(work, x, m * sizeof(float));
+        float median = batchMedianF32(work, m);
+        memcpy(work, x, m * sizeof(float));
+        check(sameBits(median, refMedianF32(work, m)), "batchMedianF32", m);
+    }
+
+    printRow("batchDotS8", n,
+             timeNs([&]() { sinkInt = batchDotS8(a, b, n); }),
+             timeNs([&]() { sinkInt = refDotS8(a, b, n); }));
+    printRow("batchDotS8+1", n,
+             timeNs([&]() { sinkInt = batchDotS8(a + 1, b, n); }),
+             timeNs([&]() { sinkInt = refDotS8(a + 1, b, n); }));
+    printRow("batchSumS8", n,
+             timeNs([&]() { sinkInt = batchSumS8(a, n); }),
+             timeNs([&]() { sinkInt = refSumS8(a, n); }));
+    printRow("batchMinMaxF32", n,
+             timeNs([&]() { batchMinMaxF32(x, n, &lo, &hi); sinkFloat = lo + hi; }),
+             timeNs([&]() { refMinMaxF32(x, n, &lo, &hi); sinkFloat = lo + hi; }));
+
+    // The copy is part of both timings (both reorder their input)
+    printRow("batchMedianF32", n,
+             timeNs([&]() { memcpy(work, x, n * sizeof(float)); sinkFloat = batchMedianF32(work, n); }),
+             timeNs([&]() { memcpy(work, x, n * sizeof(float)); sinkFloat = refMedianF32(work, n); }));
+
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s [options]\n\n"
+           "Times the batch kernels against their reference loops per array length\n"
+           "and checks the results match bit for bit.\n\n"
+           "  --length N       Only this length (up to %d)\n"
+           "  --seed N         Input data seed (default 1)\n"
+           "  --help           This text\n",
+           program, BENCH_MAX_LENGTH);
+}
+
+int main(int argc, char** argv) {
+    enum { OPT_LENGTH = 1, OPT_SEED, OPT_HELP };
+    static const struct option longOptions[] = {
+        { "length", required_argument, nullptr, OPT_LENGTH },
+        { "seed",   required_argument, nullptr, OPT_SEED },
+        { "help",   no_argument,       nullptr, OPT_HELP },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    size_t only = 0;
+    unsigned seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        switch (opt) {
+            case OPT_LENGTH: only = (size_t)strtoul(optarg, nullptr, 10); break;
+            case OPT_SEED:   seed = (unsigned)strtoul(optarg, nullptr, 10); break;
+            case OPT_HELP:   usage(argv[0]); return 0;
+            default:         usage(argv[0]); return 2;
+        }
+    }
+    if (only > BENCH_MAX_LENGTH || (only == 0 && optind < argc)) {
+        usage(argv[0]);
+        return 2;
+    }
+    srand(seed);
+
+    if (!batchKernelsSelfTest()) {
+        fprintf(stderr, "bench: batchKernelsSelfTest failed\n");
+        mismatches++;
+    }
+
+    printf("%-14s %6s %12s %12s %9s\n", "kernel", "n", "kernel ns", "reference ns", "speedup");
+    if (only != 0) {
+        benchLength(only);
+    } else {
+        for (size_t n : lengths) {
+            benchLength(n);
+        }
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "bench: %d mismatches\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,6 @@
+Import("env")
+
+# libFuzzer ships with clang only, and the sanitizer runtimes have to be
+# linked as well as compiled in
+env.Replace(CC="clang", CXX="clang++", LINK="clang++")
+env.Append(LINKFLAGS=["-fsanitize=fuzzer,address,undefined"])
@@ -0,0 +1,346 @@
+#ifdef SIM_FUZZ_STANDALONE
+
+#include <dirent.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <ucontext.h>
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// STANDALONE FUZZ DRIVER
+// ============================================================================
+// main() for the fuzz targets without libFuzzer (env:fuzz-profile, plain
+// gcc): replays corpus files and crash reproducers, and with --profile
+// measures the cost of each input:
+//
+//   time   median over --repeat runs
+//   heap   peak bytes live from operator new during the call (Strings,
+//          ArduinoJson's input copy; StaticJsonDocuments are on the stack)
+//   stack  deepest stack use, from a painted stack the call runs on
+//
+// and prints the worst case per input-size bucket. Host numbers: the
+// ESP32 is several times slower and its stack frames are smaller, so use
+// them to compare sizes and builds, not as device timings.
+
+#define DRIVER_STACK_SIZE (1024 * 1024)
+#define DRIVER_STACK_PAINT 0xA5
+#define DRIVER_DEFAULT_REPEAT 20
+#define DRIVER_MAX_GENERATED 16384
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+const char* fuzzTargetName();
+
+// ----------------------------------------------------------------------------
+// Heap accounting
+// ----------------------------------------------------------------------------
+
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+
+void* operator new(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    heapLive += malloc_usable_size(p);
+    heapPeak = std::max(heapPeak, heapLive);
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        heapLive -= malloc_usable_size(p);
+        free(p);
+    }
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+// ----------------------------------------------------------------------------
+// Running one input on a painted stack
+// ----------------------------------------------------------------------------
+
+struct Input {
+    std::string name;
+    std::string data;
+};
+
+struct Measurement {
+    size_t size;
+    double medianUs;
+    size_t heapBytes;
+    size_t stackBytes;
+};
+
+static ucontext_t driverContext;
+static ucontext_t targetContext;
+static char* targetStack = nullptr;
+static const Input* currentInput = nullptr;
+
+static void targetEntry() {
+    LLVMFuzzerTestOneInput((const uint8_t*)currentInput->data.data(), currentInput->data.size());
+}
+
+static double elapsedUs(const timespec& start, const timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static Measurement measure(const Input& input, int repeat) {
+    Measurement result = { input.data.size(), 0, 0, 0 };
+    std::vector<double> times;
+
+    memset(targetStack, DRIVER_STACK_PAINT, DRIVER_STACK_SIZE);
+    currentInput = &input;
+
+    for (int run = 0; run < repeat; run++) {
+        getcontext(&targetContext);
+        targetContext.uc_stack.ss_sp = targetStack;
+        targetContext.uc_stack.ss_size = DRIVER_STACK_SIZE;
+        targetContext.uc_link = &driverContext;
+        makecontext(&targetContext, targetEntry, 0);
+
+        size_t heapBefore = heapLive;
+        heapPeak = heapLive;
+
+        timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        swapcontext(&driverContext, &targetContext);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        times.push_back(elapsedUs(start, end));
+        result.heapBytes = std::max(result.heapBytes, heapPeak - heapBefore);
+    }
+
+    // The stack grows down: the lowest byte that lost its paint is the deepest
+    size_t untouched = 0;
+    while (untouched < DRIVER_STACK_SIZE && (uint8_t)targetStack[untouched] == DRIVER_STACK_PAINT) {
+        untouched++;
+    }
+    result.stackBytes = DRIVER_STACK_SIZE - untouched;
+
+    std::sort(times.begin(), times.end());
+    result.medianUs = times[times.size() / 2];
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Inputs
+// ----------------------------------------------------------------------------
+
+static bool readFile(const std::string& path, std::string& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    data.clear();
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.append(buffer, n);
+    }
+    fclose(file);
+    return true;
+}
+
+static void addPath(const std::string& path, std::vector<Input>& inputs) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "fuzz: cannot read %s\n", path.c_str());
+        exit(2);
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        Input input;
+        input.name = path;
+        if (!readFile(path, input.data)) {
+            fprintf(stderr, "fuzz: cannot read %s\n", path.c_str());
+            exit(2);
+        }
+        inputs.push_back(input);
+        return;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        addPath(path + "/" + name, inputs);
+    }
+}
+
+// Shapes that drive ArduinoJson's cost, one input per shape and size
+static void addGenerated(std::vector<Input>& inputs) {
+    for (size_t size = 64; size <= DRIVER_MAX_GENERATED; size *= 2) {
+        std::string longString = "{\"value\":\"" + std::string(size - 13, 'a') + "\"}";
+
+        std::string members = "{";
+        for (int i = 0; members.size() + 12 < size; i++) {
+            members += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":1";
+        }
+        members += "}";
+
+        std::string nesting = std::string(size / 2, '[') + std::string(size / 2, ']');
+
+        std::string numbers = "[";
+        while (numbers.size() + 26 < size) {
+            numbers += (numbers.size() > 1 ? "," : "") + std::string("-1.7976931348623157e308");
+        }
+        numbers += "]";
+
+        std::string escapes = "{\"value\":\"";
+        while (escapes.size() + 8 < size) {
+            escapes += "\\u00e9";
+        }
+        escapes += "\"}";
+
+        std::string whitespace = std::string(size - 2, ' ') + "{}";
+
+        const std::pair<const char*, std::string> shapes[] = {
+            { "string", longString }, { "members", members }, { "nesting", nesting },
+            { "numbers", numbers }, { "escapes", escapes }, { "whitespace", whitespace },
+        };
+        for (const auto& shape : shapes) {
+            inputs.push_back({ std::string("generated:") + shape.first + "-" + std::to_string(size),
+                               shape.second });
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Report
+// ----------------------------------------------------------------------------
+
+static void printProfile(const std::vector<Input>& inputs, const std::vector<Measurement>& results) {
+    struct Bucket {
+        int count;
+        Measurement worst;
+        const Input* slowest;
+    };
+    std::map<size_t, Bucket> buckets;   // By upper bound: 64, 128, 256, ...
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Measurement& m = results[i];
+        size_t upper = 64;
+        while (upper < m.size) {
+            upper *= 2;
+        }
+
+        Bucket& bucket = buckets[upper];
+        if (bucket.count++ == 0 || m.medianUs > bucket.worst.medianUs) {
+            bucket.worst.medianUs = m.medianUs;
+            bucket.slowest = &inputs[i];
+        }
+        bucket.worst.heapBytes = std::max(bucket.worst.heapBytes, m.heapBytes);
+        bucket.worst.stackBytes = std::max(bucket.worst.stackBytes, m.stackBytes);
+    }
+
+    printf("target %s, %zu inputs (host build)\n\n", fuzzTargetName(), results.size());
+    printf("%-12s %7s %12s %12s %12s   %s\n", "size", "inputs", "worst us", "peak heap", "peak stack",
+           "slowest input");
+    for (const auto& entry : buckets) {
+        char range[32];
+        snprintf(range, sizeof(range), "%zu-%zu", entry.first == 64 ? 0 : entry.first / 2 + 1, entry.first);
+        const Bucket& bucket = entry.second;
+        printf("%-12s %7d %12.1f %12zu %12zu   %s\n", range, bucket.count, bucket.worst.medianUs,
+               bucket.worst.heapBytes, bucket.worst.stackBytes, bucket.slowest->name.c_str());
+    }
+}
+
+static void usage(const char* program) {
+    printf("Usage: FUZZ_TARGET=NAME %s [options] FILE|DIR...\n\n"
+           "Runs the fuzz target on every input (directories: every file in them).\n\n"
+           "  --profile        Time each input and report the worst case per size bucket\n"
+           "  --repeat N       Runs per input for --profile (default %d)\n"
+           "  --generate       Add synthetic worst-case shapes, 64 B to %d B\n"
+           "  --help           This text\n",
+           program, DRIVER_DEFAULT_REPEAT, DRIVER_MAX_GENERATED);
+}
+
+int main(int argc, char** argv) {
+    enum { OPT_PROFILE = 1, OPT_REPEAT, OPT_GENERATE, OPT_HELP };
+    static const struct option longOptions[] = {
+        { "profile",  no_argument,       nullptr, OPT_PROFILE },
+        { "repeat",   required_argument, nullptr, OPT_REPEAT },
+        { "generate", no_argument,       nullptr, OPT_GENERATE },
+        { "help",     no_argument,       nullptr, OPT_HELP },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    bool profile = false;
+    bool generate = false;
+    int repeat = DRIVER_DEFAULT_REPEAT;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        switch (opt) {
+            case OPT_PROFILE:  profile = true; break;
+            case OPT_REPEAT:   repeat = std::max(1, atoi(optarg)); break;
+            case OPT_GENERATE: generate = true; break;
+            case OPT_HELP:     usage(argv[0]); return 0;
+            default:           usage(argv[0]); return 2;
+        }
+    }
+
+    std::vector<Input> inputs;
+    for (int i = optind; i < argc; i++) {
+        addPath(argv[i], inputs);
+    }
+    if (generate) {
+        addGenerated(inputs);
+    }
+    if (inputs.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    if (!profile) {
+        for (const Input& input : inputs) {
+            LLVMFuzzerTestOneInput((const uint8_t*)input.data.data(), input.data.size());
+        }
+        printf("%s: %zu inputs OK\n", fuzzTargetName(), inputs.size());
+        return 0;
+    }
+
+    targetStack = (char*)malloc(DRIVER_STACK_SIZE);
+    std::vector<Measurement> results;
+    for (const Input& input : inputs) {
+        results.push_back(measure(input, repeat));
+    }
+    printProfile(inputs, results);
+    return 0;
+}
+
+#endif // SIM_FUZZ_STANDALONE
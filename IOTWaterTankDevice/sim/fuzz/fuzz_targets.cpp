@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include "config.h"
+#include "api_client.h"
+#include "device_config.h"
+#include "control_data.h"
+#include "handle_config_data.h"
+#include "handle_control_data.h"
+#include "webserver.h"
+#include "storage_manager.h"
+#include "ml_model.h"
+#include "heatshrink_decoder.h"
+#include "sim.h"
+#include "sim_patch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// ============================================================================
+// FUZZ TARGETS
+// ============================================================================
+// libFuzzer entry points for every parser that is fed from outside the
+// device. FUZZ_TARGET picks the one a process fuzzes:
+//
+//   config         DeviceConfigManager::parseConfig  (backend, both schemas)
+//   control        ControlDataManager::parseControl  (backend)
+//   login          APIClient::parseLoginResponse     (backend)
+//   mlmodel        MLModel::begin + run              (backend model file)
+//   heatshrink     HeatshrinkDecoder                 (compressed OTA image)
+//   web-control    POST /{device_id}/control         (app, over the LAN)
+//   web-config     POST /{device_id}/config
+//   web-timestamp  POST /{device_id}/timestamp
+//   web-save       POST /{device_id}/save
+//   web-profiles   POST /{device_id}/wifiProfiles
+//   web-server     POST /{device_id}/server
+//
+// Web targets go through the real route table. Each input is sent twice,
+// in TCP-segment chunks and in 7-byte chunks, every chunk in a buffer of
+// exactly its size. Apart from sanitizer findings an input fails (abort)
+// when a request is left without an answer or gets an unexpected status,
+// or when it leaves a config the pump logic cannot work with.
+
+#define FUZZ_SMALL_CHUNK 7
+#define FUZZ_MAX_IMAGE 0x640000   // App partition (default.csv)
+
+extern APIClient apiClient;
+extern WebServer webServer;
+extern ConfigDataHandler configHandler;
+extern ControlDataHandler controlHandler;
+
+static DeviceConfigManager configParser;
+static ControlDataManager controlParser;
+
+static void fail(const char* what, const String& input) {
+    fprintf(stderr, "fuzz: %s\n", what);
+    fprintf(stderr, "fuzz: input (%u bytes): %.200s\n", input.length(), input.c_str());
+    abort();
+}
+
+static void fuzzConfig(const String& input) {
+    DeviceConfig config;
+    if (configParser.parseConfig(input, config) &&
+        !ConfigDataHandler::isPlausible(config.upperThreshold, config.lowerThreshold,
+                                        config.tankHeight, config.tankWidth,
+                                        config.usedTotal, config.maxInflow)) {
+        fail("parseConfig accepted an implausible config", input);
+    }
+    unsigned long heartbeatMs = ConfigDataHandler::heartbeatIntervalMs(config.heartbeatSec);
+    if (heartbeatMs < TELEMETRY_HEARTBEAT_MIN || heartbeatMs > TELEMETRY_HEARTBEAT_MAX) {
+        fail("heartbeatSec escaped its clamp", input);
+    }
+}
+
+static void fuzzControl(const String& input) {
+    ControlData control;
+    controlParser.parseControl(input, control);
+}
+
+static void fuzzLogin(const String& input) {
+    String token;
+    unsigned long expiresIn;
+    if (APIClient::parseLoginResponse(input, token, expiresIn) && token.length() == 0) {
+        fail("login accepted without a token", input);
+    }
+}
+
+static void fuzzModel(const String& input) {
+    // The interpreter takes ownership of a heap copy, like a file read from LittleFS
+    size_t size = input.length();
+    uint8_t* data = (uint8_t*)malloc(size > 0 ? size : 1);
+    memcpy(data, input.c_str(), size);
+
+    MLModel model;
+    if (!model.begin(data, size)) {
+        return;
+    }
+    if (model.inputCount() > ML_MAX_LAYER_WIDTH || model.macCount() > ML_MAX_MACS) {
+        fail("model accepted beyond its budget", input);
+    }
+
+    float features[ML_MAX_LAYER_WIDTH];
+    for (int i = 0; i < model.inputCount(); i++) {
+        features[i] = (i % 3) - 1.0f;
+    }
+    float value;
+    model.run(features, value);
+}
+
+// Refuses more than an OTA partition takes, like Update.write()
+class CollectSink : public PatchSink {
+public:
+    std::vector<uint8_t> data;
+    bool write(const uint8_t* bytes, size_t length) override {
+        if (data.size() + length > FUZZ_MAX_IMAGE) {
+            return false;
+        }
+        data.insert(data.end(), bytes, bytes + length);
+        return true;
+    }
+};
+
+static bool decode(const uint8_t* data, size_t size, size_t chunkSize, CollectSink& sink) {
+    HeatshrinkDecoder decoder;
+    decoder.begin(&sink);
+    for (size_t offset = 0; offset < size; offset += chunkSize) {
+        if (!decoder.feed(data + offset, std::min(chunkSize, size - offset))) {
+            return false;
+        }
+    }
+    return decoder.finish();
+}
+
+static void fuzzHeatshrink(const String& input) {
+    // As a compressed stream: never more than 16 output bytes per input byte
+    CollectSink raw;
+    if (decode((const uint8_t*)input.c_str(), input.length(), FUZZ_SMALL_CHUNK, raw) &&
+        raw.data.size() > (size_t)input.length() * 16) {
+        fail("heatshrink output beyond 16x its input", input);
+    }
+
+    // As an image: the reference encoder's output decodes back to it
+    std::vector<uint8_t> image(input.c_str(), input.c_str() + input.length());
+    std::vector<uint8_t> compressed = sim::heatshrinkEncode(image);
+    CollectSink decoded;
+    if (!decode(compressed.data(), compressed.size(), FUZZ_SMALL_CHUNK, decoded) || decoded.data != image) {
+        fail("heatshrink round trip mismatch", input);
+    }
+}
+
+static uint32_t acceptProvisioning(const String& ssid, const String& password,
+                                   const String& dashUser, const String& dashPass) {
+    (void)ssid;
+    (void)password;
+    (void)dashUser;
+    (void)dashPass;
+    return 1;  // Job id; the job itself never runs here
+}
+
+static void post(const char* route, const String& input, size_t chunkSize) {
+    // Each input starts from the defaults, so a crash reproduces from the input alone
+    configHandler.begin();
+    controlHandler.begin();
+
+    std::string path = std::string("/") + DEVICE_ID + route;
+    std::string response;
+    int status = sim::dispatchDeviceRequest("POST", path, input.std(), chunkSize, response);
+
+    if (status != 200 && status != 400 && status != 401 && status != 409 && status != 413) {
+        char what[64];
+        snprintf(what, sizeof(what), "POST %s answered %d", route, status);
+        fail(what, input);
+    }
+    if (!ConfigDataHandler::isPlausible(configHandler.getUpperThreshold(), configHandler.getLowerThreshold(),
+                                        configHandler.getTankHeight(), configHandler.getTankWidth(),
+                                        configHandler.getUsedTotal(), configHandler.getMaxInflow())) {
+        fail("config is implausible after the request", input);
+    }
+}
+
+struct FuzzTarget {
+    const char* name;
+    const char* route;                    // Web targets: POST route
+    void (*parse)(const String& input);   // Parser targets
+};
+
+static const FuzzTarget targets[] = {
+    { "config",        nullptr,         fuzzConfig },
+    { "control",       nullptr,         fuzzControl },
+    { "login",         nullptr,         fuzzLogin },
+    { "mlmodel",       nullptr,         fuzzModel },
+    { "heatshrink",    nullptr,         fuzzHeatshrink },
+    { "web-control",   "/control",      nullptr },
+    { "web-config",    "/config",       nullptr },
+    { "web-timestamp", "/timestamp",    nullptr },
+    { "web-save",      "/save",         nullptr },
+    { "web-profiles",  "/wifiProfiles", nullptr },
+    { "web-server",    "/server",       nullptr },
+};
+
+static const FuzzTarget* target = nullptr;
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    (void)argc;
+    (void)argv;
+
+    const char* name = getenv("FUZZ_TARGET");
+    for (const FuzzTarget& candidate : targets) {
+        if (name != nullptr && strcmp(name, candidate.name) == 0) {
+            target = &candidate;
+        }
+    }
+    if (target == nullptr) {
+        fprintf(stderr, "fuzz: set FUZZ_TARGET to one of:");
+        for (const FuzzTarget& candidate : targets) {
+            fprintf(stderr, " %s", candidate.name);
+        }
+        fprintf(stderr, "\n");
+        exit(1);
+    }
+
+    // Firmware serial output costs more than the parsing (FUZZ_VERBOSE=1 keeps it)
+    sim::options().quiet = getenv("FUZZ_VERBOSE") == nullptr;
+
+    if (target->route != nullptr) {
+        // The login POST /server checks (corpus seeds carry it)
+        storageManager.saveDashboardCredentials("admin", "admin123");
+        webServer.setWiFiSaveCallback(acceptProvisioning);
+        webServer.begin(DEVICE_ID, &apiClient);
+    }
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    String input((const char*)data, (unsigned int)size);
+
+    if (target->route == nullptr) {
+        target->parse(input);
+    } else {
+        post(target->route, input, SIM_TCP_SEGMENT_SIZE);
+        post(target->route, input, FUZZ_SMALL_CHUNK);
+    }
+    return 0;
+}
+
+// Name of the target picked by LLVMFuzzerInitialize (standalone driver)
+const char* fuzzTargetName() {
+    return target ? target->name : "";
+}
@@ -0,0 +1,54 @@
+#ifndef SIM_ADAFRUIT_GFX_H
+#define SIM_ADAFRUIT_GFX_H
+
+#include "Arduino.h"
+
+// ============================================================================
+// Adafruit GFX (host simulator)
+// ============================================================================
+// Primitives draw into the subclass' pixels; text renders each glyph as a
+// pattern derived from the character, so the frame buffer changes whenever
+// the text does (enough for the firmware's dirty-page tracking).
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t w, int16_t h);
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+    void setTextSize(uint8_t size) { textsize = size > 0 ? size : 1; }
+    void setTextColor(uint16_t color) { textcolor = color; textbgcolor = color; }
+    void setTextColor(uint16_t color, uint16_t background) { textcolor = color; textbgcolor = background; }
+    void setTextWrap(bool wrap) { this->wrap = wrap; }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+protected:
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size);
+
+    int16_t _width;
+    int16_t _height;
+    int16_t cursor_x;
+    int16_t cursor_y;
+    uint16_t textcolor;
+    uint16_t textbgcolor;
+    uint8_t textsize;
+    bool wrap;
+};
+
+#endif // SIM_ADAFRUIT_GFX_H
@@ -0,0 +1,150 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// ============================================================================
+// ARDUINO CORE (host simulator)
+// ============================================================================
+// Stand-in for the ESP32 Arduino core when the firmware is built for the
+// native simulator (pio run -e native). Time comes from the simulator's
+// virtual clock, blocking calls yield to the simulated FreeRTOS scheduler and
+// the peripherals are backed by the world model (see sim/README.md).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <cmath>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+
+using std::min;
+using std::max;
+using std::isinf;
+using std::isnan;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ----------------------------------------------------------------------------
+// Time (virtual clock)
+// ----------------------------------------------------------------------------
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// System time is per-boot device time (0 = 1970 until SNTP sets it)
+int sim_gettimeofday(struct timeval* tv, void* tz);
+int sim_settimeofday(const struct timeval* tv, const void* tz);
+#define gettimeofday(tv, tz) sim_gettimeofday((tv), (tz))
+#define settimeofday(tv, tz) sim_settimeofday((tv), (tz))
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ----------------------------------------------------------------------------
+// GPIO (world model)
+// ----------------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// ----------------------------------------------------------------------------
+// Misc
+// ----------------------------------------------------------------------------
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// newlib has strlcpy, older glibc does not
+size_t sim_strlcpy(char* dst, const char* src, size_t size);
+#define strlcpy(dst, src, size) sim_strlcpy((dst), (src), (size))
+
+uint32_t getCpuFrequencyMhz();
+bool setCpuFrequencyMhz(uint32_t mhz);
+
+class EspClass {
+public:
+    [[noreturn]] void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getHeapSize();
+    const char* getChipModel() { return "ESP32-S3 (sim)"; }
+    uint64_t getEfuseMac();
+    const char* getSdkVersion() { return "sim"; }
+};
+
+extern EspClass ESP;
+
+// ----------------------------------------------------------------------------
+// Serial (stdout, prefixed with the virtual time)
+// ----------------------------------------------------------------------------
+
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial() : lineStart(true) {}
+
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override;
+
+private:
+    bool lineStart;
+};
+
+extern HardwareSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,36 @@
+#ifndef SIM_ASYNCDELAY_H
+#define SIM_ASYNCDELAY_H
+
+#include "Arduino.h"
+
+// AsyncDelay (host simulator) - same arithmetic as the library, on the
+// simulated millis()/micros() so it sees the 32-bit wrap too
+class AsyncDelay {
+public:
+    enum units_t { MILLIS, MICROS };
+
+    AsyncDelay() : delay(0), expires(0), unit(MILLIS) {}
+    AsyncDelay(unsigned long d, units_t u) { start(d, u); }
+
+    void start(unsigned long d, units_t u) {
+        delay = d;
+        unit = u;
+        expires = now() + delay;
+    }
+
+    bool isExpired() const { return (long)(now() - expires) >= 0; }
+    void repeat() { expires += delay; }
+    void restart() { expires = now() + delay; }
+    void expire() { expires = now(); }
+    unsigned long getDelay() const { return delay; }
+    unsigned long getExpiry() const { return expires; }
+
+private:
+    unsigned long now() const { return unit == MILLIS ? millis() : micros(); }
+
+    unsigned long delay;
+    unsigned long expires;
+    units_t unit;
+};
+
+#endif // SIM_ASYNCDELAY_H
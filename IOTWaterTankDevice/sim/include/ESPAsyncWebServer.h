@@ -0,0 +1,102 @@
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+#include "Arduino.h"
+#include <functional>
+#include <vector>
+
+// ============================================================================
+// ESPAsyncWebServer (host simulator)
+// ============================================================================
+// Routes are matched like the library (exact URI + method mask). Requests
+// come from the simulated app (sim::deviceRequest) and run on an
+// "async_tcp" task, so handlers block and yield exactly like on the device.
+
+#ifndef HTTP_GET
+#define HTTP_GET 0x01
+#endif
+#ifndef HTTP_POST
+#define HTTP_POST 0x02
+#endif
+#ifndef HTTP_ANY
+#define HTTP_ANY 0xFF
+#endif
+
+#define SIM_TCP_SEGMENT_SIZE 1436  // MSS on the ESP32's lwIP
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String& url)
+        : requestMethod(method), requestUrl(url), requestContentLength(0), responseCode(0) {}
+
+    WebRequestMethodComposite method() const { return requestMethod; }
+    const String& url() const { return requestUrl; }
+    size_t contentLength() const { return requestContentLength; }
+
+    void send(int code, const String& contentType = String(), const String& content = String());
+
+    // Simulator: what the handler answered (0 = no response)
+    int simResponseCode() const { return responseCode; }
+    const String& simResponseBody() const { return responseBody; }
+
+private:
+    friend class AsyncWebServer;
+
+    WebRequestMethodComposite requestMethod;
+    String requestUrl;
+    size_t requestContentLength;
+    int responseCode;
+    String responseBody;
+};
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index,
+                           uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                           size_t index, size_t total)> ArBodyHandlerFunction;
+
+class DefaultHeaders {
+public:
+    static DefaultHeaders& Instance();
+    void addHeader(const String& name, const String& value);
+
+private:
+    std::vector<std::pair<String, String>> headers;
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin();
+    void end() { running = false; }
+
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+    void onNotFound(ArRequestHandlerFunction handler) { notFoundHandler = handler; }
+
+    // Simulator: dispatch one request (runs on the async_tcp task). The body
+    // arrives in chunks of at most chunkSize bytes, each in its own buffer
+    // without a terminating NUL, as AsyncTCP hands over TCP segments.
+    void simHandle(AsyncWebServerRequest* request, const std::string& body,
+                   size_t chunkSize = SIM_TCP_SEGMENT_SIZE);
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction onRequest;
+        ArBodyHandlerFunction onBody;
+    };
+
+    uint16_t port;
+    bool running;
+    std::vector<Route> routes;
+    ArRequestHandlerFunction notFoundHandler;
+};
+
+#endif // SIM_ESPASYNCWEBSERVER_H
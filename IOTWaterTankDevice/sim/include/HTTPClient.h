@@ -0,0 +1,81 @@
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+// ============================================================================
+// HTTPClient (host simulator)
+// ============================================================================
+// Requests go to the in-process backend (sim_backend.cpp) after the
+// simulated network latency. Without a station connection, during a WiFi or
+// backend outage, or when the answer takes longer than setTimeout(), the
+// call fails with the same negative codes as the ESP32 core.
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_PARTIAL_CONTENT = 206,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+class HTTPClient {
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    bool begin(const String& url);
+    void end();
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void setTimeout(uint16_t timeoutMs) { timeout = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { connectTimeout = timeoutMs; }
+    void setReuse(bool reuse) { keepAlive = reuse; }
+
+    int GET();
+    int POST(const String& payload);
+    int POST(uint8_t* payload, size_t size);
+    int PUT(const String& payload);
+    int sendRequest(const char* method, const String& payload);
+
+    int getSize() { return size; }
+    String getString();
+    WiFiClient* getStreamPtr() { return &client; }
+    WiFiClient& getStream() { return client; }
+    bool connected();
+
+    static String errorToString(int error);
+
+private:
+    std::string url;
+    std::string authorization;
+    std::string range;
+    uint16_t timeout;
+    int32_t connectTimeout;
+    bool keepAlive;
+    bool linkOpen;                // Kept-alive TCP connection (no handshake)
+    int size;
+    WiFiClient client;
+};
+
+#endif // SIM_HTTPCLIENT_H
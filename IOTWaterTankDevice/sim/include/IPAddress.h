@@ -0,0 +1,30 @@
+#ifndef SIM_IPADDRESS_H
+#define SIM_IPADDRESS_H
+
+#include <stdint.h>
+#include "WString.h"
+
+// Arduino IPAddress (host build) - raw uint32_t in network byte order
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t raw) : address(raw) {}
+
+    operator uint32_t() const { return address; }
+    uint8_t operator[](int index) const { return (address >> (8 * index)) & 0xFF; }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    bool operator!=(const IPAddress& other) const { return address != other.address; }
+
+    bool fromString(const char* s);
+    bool fromString(const String& s) { return fromString(s.c_str()); }
+    String toString() const;
+
+private:
+    uint32_t address;
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif // SIM_IPADDRESS_H
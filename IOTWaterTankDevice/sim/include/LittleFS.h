@@ -0,0 +1,27 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    LittleFSFS() : mounted(false) {}
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end() { mounted = false; }
+
+private:
+    bool mounted;
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // SIM_LITTLEFS_H
@@ -0,0 +1,64 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+// NVS key/value store (host simulator). Values are typed like NVS: reading a
+// key with a different type returns the default. The store survives
+// simulated reboots (state directory) and read-only opens of a namespace that
+// was never written fail, as on the device.
+class Preferences {
+public:
+    Preferences() : ns(), readOnly(false), open(false) {}
+    ~Preferences() { end(); }
+
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBool(const char* key, bool value);
+    size_t putUChar(const char* key, uint8_t value);
+    size_t putShort(const char* key, int16_t value);
+    size_t putUShort(const char* key, uint16_t value);
+    size_t putInt(const char* key, int32_t value);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t putLong(const char* key, int32_t value);
+    size_t putULong(const char* key, uint32_t value);
+    size_t putLong64(const char* key, int64_t value);
+    size_t putULong64(const char* key, uint64_t value);
+    size_t putFloat(const char* key, float value);
+    size_t putDouble(const char* key, double value);
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value);
+    size_t putBytes(const char* key, const void* value, size_t length);
+
+    bool getBool(const char* key, bool defaultValue = false);
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    int16_t getShort(const char* key, int16_t defaultValue = 0);
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    int32_t getLong(const char* key, int32_t defaultValue = 0);
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0);
+    int64_t getLong64(const char* key, int64_t defaultValue = 0);
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0);
+    float getFloat(const char* key, float defaultValue = NAN);
+    double getDouble(const char* key, double defaultValue = NAN);
+    String getString(const char* key, const String defaultValue = String());
+    size_t getString(const char* key, char* value, size_t maxLen);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t maxLen);
+
+private:
+    String ns;
+    bool readOnly;
+    bool open;
+
+    size_t put(const char* key, char type, const void* value, size_t length);
+    bool get(const char* key, char type, void* value, size_t length);
+};
+
+#endif // SIM_PREFERENCES_H
@@ -0,0 +1,28 @@
+#ifndef SIM_STREAM_H
+#define SIM_STREAM_H
+
+#include "Print.h"
+
+// Arduino Stream (host build) - byte source on top of Print
+class Stream : public Print {
+public:
+    Stream() : timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    unsigned long getTimeout() const { return timeout; }
+
+    // Reads until 'length' bytes arrived or nothing is available
+    // (simulated sources never trickle in during a read)
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    String readString();
+
+protected:
+    unsigned long timeout;
+};
+
+#endif // SIM_STREAM_H
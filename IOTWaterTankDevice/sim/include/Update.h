@@ -0,0 +1,54 @@
+#ifndef SIM_UPDATE_H
+#define SIM_UPDATE_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define UPDATE_ERROR_OK               0
+#define UPDATE_ERROR_WRITE            1
+#define UPDATE_ERROR_ERASE            2
+#define UPDATE_ERROR_READ             3
+#define UPDATE_ERROR_SPACE            4
+#define UPDATE_ERROR_SIZE             5
+#define UPDATE_ERROR_STREAM           6
+#define UPDATE_ERROR_MD5              7
+#define UPDATE_ERROR_MAGIC_BYTE       8
+#define UPDATE_ERROR_ACTIVATE         9
+#define UPDATE_ERROR_NO_PARTITION     10
+#define UPDATE_ERROR_BAD_ARGUMENT     11
+#define UPDATE_ERROR_ABORT            12
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+// Writes into the simulated next OTA partition. end() marks it bootable;
+// the image becomes the running one after the next restart.
+class UpdateClass {
+public:
+    UpdateClass();
+
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = 0, int ledPin = -1, uint8_t ledOn = LOW,
+               const char* label = NULL);
+    size_t write(uint8_t* data, size_t length);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+
+    bool isRunning() const { return running; }
+    bool isFinished() const { return finished; }
+    bool hasError() const { return error != UPDATE_ERROR_OK; }
+    uint8_t getError() const { return error; }
+    const char* errorString() const;
+    size_t size() const { return imageSize; }
+    size_t progress() const { return image.size(); }
+    size_t remaining() const { return imageSize - image.size(); }
+
+private:
+    std::vector<uint8_t> image;
+    size_t imageSize;
+    bool running;
+    bool finished;
+    uint8_t error;
+};
+
+extern UpdateClass Update;
+
+#endif // SIM_UPDATE_H
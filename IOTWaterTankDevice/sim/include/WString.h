@@ -0,0 +1,131 @@
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// ============================================================================
+// Arduino String (host build)
+// ============================================================================
+// Same interface as the ESP32 core's String for the subset the firmware and
+// ArduinoJson use. Backed by std::string but not derived from it, so
+// ArduinoJson picks its ::String adapter rather than the std::string one.
+
+class String {
+public:
+    String() {}
+    String(const char* s) : str(s ? s : "") {}
+    String(const char* s, unsigned int length) : str(s ? std::string(s, length) : std::string()) {}
+    explicit String(const std::string& s) : str(s) {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    explicit String(char c) : str(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* s) { str = s ? s : ""; return *this; }
+
+    unsigned int length() const { return (unsigned int)str.size(); }
+    const char* c_str() const { return str.c_str(); }
+    bool isEmpty() const { return str.empty(); }
+    bool reserve(unsigned int size) { str.reserve(size); return true; }
+
+    // Concatenation
+    bool concat(const String& s) { str += s.str; return true; }
+    bool concat(const char* s) { if (!s) return false; str += s; return true; }
+    bool concat(const char* s, unsigned int length) { if (!s) return false; str.append(s, length); return true; }
+    bool concat(char c) { str += c; return true; }
+    bool concat(unsigned char value) { return concat(String(value)); }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+    bool concat(long long value) { return concat(String(value)); }
+    bool concat(unsigned long long value) { return concat(String(value)); }
+    bool concat(float value) { return concat(String(value)); }
+    bool concat(double value) { return concat(String(value)); }
+
+    template <typename T>
+    String& operator+=(const T& value) { concat(value); return *this; }
+
+    // Comparison
+    int compareTo(const String& s) const { return str.compare(s.str); }
+    bool equals(const String& s) const { return str == s.str; }
+    bool equals(const char* s) const { return str == (s ? s : ""); }
+    bool equalsIgnoreCase(const String& s) const;
+    bool operator==(const String& s) const { return equals(s); }
+    bool operator==(const char* s) const { return equals(s); }
+    bool operator!=(const String& s) const { return !equals(s); }
+    bool operator!=(const char* s) const { return !equals(s); }
+    bool operator<(const String& s) const { return compareTo(s) < 0; }
+    bool operator>(const String& s) const { return compareTo(s) > 0; }
+    bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.size(), prefix.str) == 0; }
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    // Characters
+    char charAt(unsigned int index) const { return index < str.size() ? str[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < str.size()) str[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, bufsize, index);
+    }
+
+    // Search
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int indexOf(const String& s, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char c) const;
+    int lastIndexOf(const String& s) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    // Modification
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // Conversion
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    const std::string& std() const { return str; }
+
+private:
+    std::string str;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, unsigned char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+String operator+(const String& lhs, long long rhs);
+String operator+(const String& lhs, unsigned long long rhs);
+String operator+(const String& lhs, float rhs);
+String operator+(const String& lhs, double rhs);
+
+inline bool operator==(const char* lhs, const String& rhs) { return rhs.equals(lhs); }
+inline bool operator!=(const char* lhs, const String& rhs) { return !rhs.equals(lhs); }
+
+#endif // SIM_WSTRING_H
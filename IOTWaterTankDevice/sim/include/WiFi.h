@@ -0,0 +1,130 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+// ============================================================================
+// WiFi (host simulator)
+// ============================================================================
+// One simulated access point (--ssid/--password/--rssi) plus a couple of
+// foreign networks in scans. Association takes a few virtual seconds (less
+// for a directed connect), a WiFi outage drops the station with
+// WL_CONNECTION_LOST and auto-reconnect is left to the firmware.
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+    WIFI_MODE_MAX
+} wifi_mode_t;
+
+typedef wifi_mode_t WiFiMode_t;
+#define WIFI_OFF    WIFI_MODE_NULL
+#define WIFI_STA    WIFI_MODE_STA
+#define WIFI_AP     WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+    WIFI_AUTH_WPA_WPA2_PSK,
+    WIFI_AUTH_WPA2_ENTERPRISE,
+    WIFI_AUTH_WPA3_PSK
+} wifi_auth_mode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+class WiFiClass {
+public:
+    WiFiClass();
+
+    // Mode
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() { return currentMode; }
+    bool enableSTA(bool enable);
+    bool persistent(bool persistent) { (void)persistent; return true; }
+    bool setAutoReconnect(bool autoReconnect) { (void)autoReconnect; return true; }
+    bool setSleep(bool enabled) { (void)enabled; return true; }
+    bool setSleep(wifi_ps_type_t type) { (void)type; return true; }
+
+    // Station
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = (uint32_t)0, IPAddress dns2 = (uint32_t)0);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status() { return currentStatus; }
+    bool isConnected() { return currentStatus == WL_CONNECTED; }
+
+    String SSID();
+    int8_t RSSI();
+    uint8_t* BSSID();
+    int32_t channel();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t index = 0);
+    String macAddress();
+
+    // Scan
+    int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false,
+                         uint32_t maxMsPerChannel = 300, uint8_t channel = 0);
+    int16_t scanComplete();
+    void scanDelete();
+    String SSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    uint8_t* BSSID(uint8_t index);
+    int32_t channel(uint8_t index);
+    wifi_auth_mode_t encryptionType(uint8_t index);
+
+    // Access point
+    bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1,
+                int ssidHidden = 0, int maxConnection = 4);
+    bool softAPdisconnect(bool wifiOff = false);
+    IPAddress softAPIP();
+    uint8_t softAPgetStationNum() { return 0; }
+
+    // Simulator: the access point went away / came back
+    void simLinkLost();
+
+private:
+    void finishAssociation(uint32_t attempt, wl_status_t result, uint64_t dhcpUs);
+
+    wifi_mode_t currentMode;
+    wl_status_t currentStatus;
+    uint32_t attempt;             // Invalidates pending association events
+    bool apRunning;
+    IPAddress staticIP;
+    IPAddress staticGateway;
+    IPAddress staticSubnet;
+    IPAddress staticDns;
+    IPAddress leaseIP;
+    int scanState;                // WIFI_SCAN_FAILED, WIFI_SCAN_RUNNING or result count
+    uint32_t scanGeneration;
+};
+
+extern WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
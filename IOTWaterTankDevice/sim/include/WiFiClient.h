@@ -0,0 +1,47 @@
+#ifndef SIM_WIFICLIENT_H
+#define SIM_WIFICLIENT_H
+
+#include "Arduino.h"
+
+// ============================================================================
+// WiFiClient (host simulator)
+// ============================================================================
+// A TCP connection to the simulated backend. As an HTTP response stream it
+// delivers the body at the link's throughput on the virtual clock, and stops
+// delivering (connected() == false) when WiFi or the backend goes away.
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient();
+
+    // TCP handshake only (connectivity probe)
+    int connect(const char* host, uint16_t port, int32_t timeoutMs = 3000);
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    // Response body delivery (used by HTTPClient); the connection closes
+    // after 'closeAt' bytes (SIZE_MAX = whole body)
+    void simStartBody(const std::string& body, size_t closeAt = SIZE_MAX);
+    std::string simTakeRemaining();
+
+private:
+    size_t arrived();
+
+    std::string body;
+    size_t position;
+    uint64_t startUs;
+    size_t droppedAt;             // Bytes that had arrived when the link dropped (SIZE_MAX = up)
+    bool open;
+};
+
+#endif // SIM_WIFICLIENT_H
@@ -0,0 +1,43 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+// ============================================================================
+// Wire / I2C (host simulator)
+// ============================================================================
+// Transactions only cost bus time (9 clocks per byte incl. ACK, plus start,
+// address and stop) - there is no device behind them. Like the ESP32 core,
+// a transmission buffers at most I2C_BUFFER_LENGTH bytes; write() takes
+// what fits and returns the count.
+
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire : public Stream {
+public:
+    TwoWire() : clock(100000), pending(0) {}
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool setClock(uint32_t frequency) { clock = frequency; return true; }
+    uint32_t getClock() const { return clock; }
+
+    void beginTransmission(uint16_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+private:
+    uint32_t clock;
+    size_t pending;               // Bytes queued in the current transmission
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,12 @@
+#ifndef SIM_DRIVER_GPIO_H
+#define SIM_DRIVER_GPIO_H
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+// Sleep pin configuration has no effect in the simulator (no light sleep)
+esp_err_t gpio_sleep_sel_dis(gpio_num_t gpio);
+esp_err_t gpio_sleep_sel_en(gpio_num_t gpio);
+
+#endif // SIM_DRIVER_GPIO_H
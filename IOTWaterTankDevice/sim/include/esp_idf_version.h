@@ -0,0 +1,12 @@
+#ifndef SIM_ESP_IDF_VERSION_H
+#define SIM_ESP_IDF_VERSION_H
+
+// The simulator models the IDF 4.4 based Arduino core the firmware ships on
+#define ESP_IDF_VERSION_MAJOR 4
+#define ESP_IDF_VERSION_MINOR 4
+#define ESP_IDF_VERSION_PATCH 0
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(ESP_IDF_VERSION_MAJOR, ESP_IDF_VERSION_MINOR, ESP_IDF_VERSION_PATCH)
+
+#endif // SIM_ESP_IDF_VERSION_H
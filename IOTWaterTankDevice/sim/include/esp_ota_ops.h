@@ -0,0 +1,12 @@
+#ifndef SIM_ESP_OTA_OPS_H
+#define SIM_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+// ota_0 / ota_1 of the default 16 MB layout; the running one holds the
+// simulated current image
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start);
+const esp_partition_t* esp_ota_get_boot_partition();
+
+#endif // SIM_ESP_OTA_OPS_H
@@ -0,0 +1,27 @@
+#ifndef SIM_ESP_PARTITION_H
+#define SIM_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+// Reads the simulated flash image of the partition (see Update.h)
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size);
+
+#endif // SIM_ESP_PARTITION_H
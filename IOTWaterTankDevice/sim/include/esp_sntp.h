@@ -0,0 +1,30 @@
+#ifndef SIM_ESP_SNTP_H
+#define SIM_ESP_SNTP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+// SNTP client (host simulator): configTime() starts it; a sync sets the
+// system time from the world clock after a short round trip, then repeats
+// every sync interval. Unreachable when the simulation runs with --no-ntp.
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+typedef enum {
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_set_sync_interval(uint32_t intervalMs);
+uint32_t sntp_get_sync_interval();
+sntp_sync_status_t sntp_get_sync_status();
+void sntp_restart();
+bool sntp_enabled();
+void sntp_stop();
+
+#define esp_sntp_enabled sntp_enabled
+#define esp_sntp_stop sntp_stop
+
+#endif // SIM_ESP_SNTP_H
@@ -0,0 +1,13 @@
+#ifndef SIM_ESP_SYSTEM_H
+#define SIM_ESP_SYSTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+uint32_t esp_random();
+void esp_fill_random(void* buffer, size_t length);
+[[noreturn]] void esp_restart();
+uint32_t esp_get_free_heap_size();
+
+#endif // SIM_ESP_SYSTEM_H
@@ -0,0 +1,63 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+// ============================================================================
+// FreeRTOS API (host simulator)
+// ============================================================================
+// Tasks are cooperative coroutines on the virtual clock: a task runs until it
+// blocks (delay, queue/semaphore/notification wait). The highest-priority
+// ready task runs next; equal priorities take turns. Critical sections only
+// guard against yielding - there is no preemption to protect against.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE  ((BaseType_t)0)
+#define pdTRUE   ((BaseType_t)1)
+#define pdFAIL   pdFALSE
+#define pdPASS   pdTRUE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL  ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define tskIDLE_PRIORITY 0
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// ----------------------------------------------------------------------------
+// Critical sections
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void sim_enterCritical(portMUX_TYPE* mux);
+void sim_exitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux)     sim_enterCritical(mux)
+#define portEXIT_CRITICAL(mux)      sim_exitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) sim_enterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  sim_exitCritical(mux)
+#define taskENTER_CRITICAL(mux)     sim_enterCritical(mux)
+#define taskEXIT_CRITICAL(mux)      sim_exitCritical(mux)
+#define portYIELD_FROM_ISR(...)     do { } while (0)
+#define portYIELD()                 taskYIELD()
+
+#endif // SIM_FREERTOS_H
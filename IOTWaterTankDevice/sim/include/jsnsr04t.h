@@ -0,0 +1,34 @@
+#ifndef SIM_JSNSR04T_H
+#define SIM_JSNSR04T_H
+
+#include "Arduino.h"
+
+// ============================================================================
+// JSN-SR04T ultrasonic sensor (host simulator)
+// ============================================================================
+// readDistance() returns what the world model's sensor sees (water surface
+// distance with noise, -1 for a lost echo) after the echo round trip time.
+
+#define LOG_LEVEL_SILENT  0
+#define LOG_LEVEL_FATAL   1
+#define LOG_LEVEL_ERROR   2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_NOTICE  4
+#define LOG_LEVEL_TRACE   5
+#define LOG_LEVEL_VERBOSE 6
+
+class JsnSr04T {
+public:
+    JsnSr04T(uint8_t echoPin, uint8_t triggerPin, int logLevel = LOG_LEVEL_SILENT)
+        : echoPin(echoPin), triggerPin(triggerPin), logLevel(logLevel) {}
+
+    void begin(Print& output) { (void)output; pinMode(triggerPin, OUTPUT); pinMode(echoPin, INPUT); }
+    float readDistance();
+
+private:
+    uint8_t echoPin;
+    uint8_t triggerPin;
+    int logLevel;
+};
+
+#endif // SIM_JSNSR04T_H
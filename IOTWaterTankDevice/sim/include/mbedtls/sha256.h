@@ -0,0 +1,27 @@
+#ifndef SIM_MBEDTLS_SHA256_H
+#define SIM_MBEDTLS_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Plain software SHA-256 with the mbedTLS 2.28 interface (both the *_ret
+// functions and the plain names, which 3.x kept)
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[64];
+    size_t buffered;
+    int is224;
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length);
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update_ret(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length);
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context* ctx, unsigned char output[32]);
+int mbedtls_sha256(const unsigned char* input, size_t length, unsigned char output[32], int is224);
+
+#endif // SIM_MBEDTLS_SHA256_H
@@ -0,0 +1,10 @@
+#ifndef SIM_MBEDTLS_VERSION_H
+#define SIM_MBEDTLS_VERSION_H
+
+// mbedTLS shipped with IDF 4.4 (see esp_idf_version.h)
+#define MBEDTLS_VERSION_MAJOR 2
+#define MBEDTLS_VERSION_MINOR 28
+#define MBEDTLS_VERSION_PATCH 0
+#define MBEDTLS_VERSION_NUMBER 0x021C0000
+
+#endif // SIM_MBEDTLS_VERSION_H
@@ -0,0 +1,321 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// SIMULATOR CORE
+// ============================================================================
+// Discrete-event simulation of one device: the firmware's tasks run as
+// coroutines and time only advances when every task is blocked, jumping
+// straight to the next wakeup or world event. A week of operation costs
+// only the CPU time of the firmware's actual work.
+//
+// Two clocks:
+// - device time: what millis()/esp_timer see, per boot, runs at the
+//   oscillator rate (--drift-ppm)
+// - world time: true time since the simulation started, across reboots;
+//   the backend, NTP and the scenario use it
+//
+// A reboot (ESP.restart, --reboot-every) saves NVS, the backend and the
+// plant to the state directory and re-executes the binary, so globals and
+// static state start fresh exactly like on the device.
+
+namespace sim {
+
+// A time window on the world clock (outages, scenario events)
+struct Window {
+    uint64_t startUs;
+    uint64_t durationUs;
+
+    bool contains(uint64_t worldUs) const {
+        return worldUs >= startUs && worldUs < startUs + durationUs;
+    }
+};
+
+// A backend fault active during a window (value: percent or ms)
+struct Fault {
+    Window window;
+    uint32_t value;
+};
+
+struct ButtonPress {
+    uint8_t button;      // 1-6 (BTN1..BTN6)
+    uint64_t atUs;       // world time
+    uint64_t holdUs;
+};
+
+struct Options {
+    uint64_t seed;
+    uint64_t durationUs;          // World time to simulate
+    std::string stateDir;
+    bool quiet;                   // Hide firmware serial output
+    bool resume;                  // Internal: continuing after a reboot
+
+    uint64_t startEpochMs;        // Wall clock at world time 0
+    uint32_t millisOffset;        // millis() at boot (test wraparound)
+    double driftPpm;              // Device oscillator error (+ = fast)
+    uint64_t rebootEveryUs;       // Power cycle interval (0 = never)
+
+    // Network
+    bool provisioned;             // Preload WiFi + dashboard credentials
+    std::string ssid;
+    std::string password;
+    int rssi;
+    std::string dashUser;
+    std::string dashPass;
+    bool ntp;                     // SNTP reachable
+    uint32_t latencyMs;           // Backend round trip (median)
+    std::vector<Window> wifiOutages;
+    std::vector<Window> backendOutages;
+
+    // Backend behaviour
+    std::vector<Fault> slowResponses;     // Extra server time (ms)
+    std::vector<Fault> errorBursts;       // Share of requests answered 5xx (%)
+    std::vector<Fault> truncations;       // Share of bodies cut short (%)
+    uint64_t tokenLifetimeUs;
+    std::vector<uint64_t> tokenRevocations;  // World times all tokens are dropped
+    uint32_t heartbeatSec;                // Device config "heartbeatSec" (0 = not sent)
+    uint16_t servePort;                   // Serve the backend over HTTP (0 = simulate a device)
+
+    // Fleet load generator (--fleet): many devices against a real backend
+    uint32_t fleetSize;                   // Devices (0 = simulate one device)
+    std::string fleetTarget;              // Backend base URL
+    std::string fleetDevices;             // "deviceId [hardwareId]" per line (empty = generated)
+    uint64_t fleetRampUs;                 // Boots spread over this
+    std::vector<Fault> fleetStorms;       // Link lost for PCT% of devices, all reconnect at the end
+    double fleetEditsPerDay;              // Local pump/threshold changes per device
+    uint64_t fleetReportUs;               // Progress line interval
+
+    // Scenario
+    std::vector<ButtonPress> presses;
+    uint64_t otaAtUs;             // Publish a firmware update (0 = never)
+    std::string otaVersion;
+    uint32_t otaSize;
+    uint64_t mlModelAtUs;         // Publish the demo ML model (0 = never)
+    std::string mlModelVersion;
+    float levelPercent;           // Initial water level
+
+    // Plant (tank geometry and thresholds are also the backend's defaults)
+    double tankHeight;            // cm
+    double tankWidth;             // cm, diameter or side
+    std::string tankShape;        // "Cylindrical" / "Rectangular"
+    double upperThreshold;        // %
+    double lowerThreshold;        // %
+    double pumpLpm;               // Nominal pump flow
+    double demandScale;           // Multiplier on the draw event rate
+    double leakLph;               // Constant leak
+    uint64_t leakAtUs;            // Leak start (0 = from the beginning)
+    double sensorNoiseCm;
+    std::string scoreFile;        // Control score JSON (empty = none)
+};
+
+Options& options();
+
+// ----------------------------------------------------------------------------
+// Clocks
+// ----------------------------------------------------------------------------
+
+uint64_t now();              // Device us since boot
+uint64_t worldUs();          // True us since simulation start
+uint64_t wallMs();           // True Unix time (ms)
+uint64_t toDeviceUs(uint64_t worldUs);  // World instant -> device time (this boot)
+uint32_t bootCount();
+
+// ----------------------------------------------------------------------------
+// Scheduler
+// ----------------------------------------------------------------------------
+
+typedef std::function<void()> Event;
+
+// Run 'event' at a device time, outside any task (like hardware / an ISR).
+// Events must not block.
+void at(uint64_t deviceUs, Event event);
+void after(uint64_t us, Event event);
+void atWorld(uint64_t worldUs, Event event);
+
+// Block the calling task for 'us' of device time
+void sleep(uint64_t us);
+
+bool inTask();
+bool inIsr();
+void setIsr(bool active);
+const char* currentTaskName();
+
+// Create the Arduino loop task and run until the duration is reached
+void runScheduler();
+
+// Serve mode: no firmware runs and real time drives the clock
+void setClock(uint64_t deviceUs);
+
+// ----------------------------------------------------------------------------
+// Randomness (world only - seeded per boot from --seed)
+// ----------------------------------------------------------------------------
+
+uint64_t random();
+double uniform();                 // [0, 1)
+double gaussian();                // N(0, 1)
+
+// ----------------------------------------------------------------------------
+// Logging / state
+// ----------------------------------------------------------------------------
+
+// Simulator event line ("[SIM] ..."), shown even with --quiet
+void log(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Formats a world time as "d+hh:mm:ss.mmm"
+std::string formatWorld(uint64_t worldUs);
+
+// Persistent state (key/value lines, hex for binary) - each subsystem
+// registers a saver/loader pair under a section name
+typedef std::function<void(std::vector<std::pair<std::string, std::string>>&)> StateSaver;
+typedef std::function<void(const std::string& key, const std::string& value)> StateLoader;
+void registerState(const char* section, StateSaver saver, StateLoader loader);
+void saveState();
+void loadState();
+
+std::string toHex(const void* data, size_t length);
+std::vector<uint8_t> fromHex(const std::string& hex);
+
+[[noreturn]] void restart(const char* reason);
+[[noreturn]] void finish();
+
+// ----------------------------------------------------------------------------
+// World hooks
+// ----------------------------------------------------------------------------
+
+// GPIO driven from outside (buttons) - fires attached interrupts
+void setInputPin(uint8_t pin, int level);
+int outputPin(uint8_t pin);
+
+bool wifiAvailable();       // Access point reachable right now
+bool backendAvailable();    // Backend answering right now
+bool stationConnected();    // Device's station interface is associated
+
+// Output pin changed level (relay)
+void outputChanged(uint8_t pin, int level);
+
+// Distance (cm) the ultrasonic sensor sees now, <= 0 for no echo
+float sensorDistance();
+
+// Run counters, kept across reboots and printed at the end
+struct Stats {
+    uint32_t boots;
+    uint32_t restarts;            // Firmware-requested (ESP.restart)
+    uint32_t powerCycles;         // --reboot-every
+    uint64_t httpRequests;
+    uint64_t httpFailures;        // Connection/timeout errors seen by the device
+    uint32_t logins;
+    uint32_t configFetches;
+    uint32_t configUploads;
+    uint32_t controlFetches;
+    uint32_t controlUploads;
+    uint64_t telemetry;
+    uint64_t telemetryBatched;    // Backlog records
+    uint32_t timeSyncs;           // HTTP time requests
+    uint32_t ntpSyncs;
+    uint32_t otaChecks;
+    uint32_t otaDownloads;
+    uint32_t otaInstalls;
+    uint32_t mlChecks;
+    uint32_t mlDownloads;
+    uint64_t mlTelemetry;         // Live uploads carrying a model output
+    uint32_t leakAlarms;          // High-priority leak alarm uploads (raised)
+    uint32_t leakClears;          // ... and clears
+    uint32_t wifiConnects;
+    uint32_t wifiDrops;
+    uint32_t buttonPresses;
+    uint32_t pumpSwitches;
+    uint64_t pumpOnUs;            // World time with the relay energized
+    uint32_t faultErrors;         // Injected 5xx answers
+    uint32_t faultTruncations;    // Injected short bodies
+    uint32_t faultSlow;           // Requests slowed by --slow
+    uint32_t unauthorized;        // 401 answers (expired/revoked/missing token)
+};
+
+Stats& stats();
+
+// NVS preload (scenario setup)
+void nvsPutString(const char* ns, const char* key, const char* value);
+void nvsPutBool(const char* ns, const char* key, bool value);
+
+// Simulated firmware images: header with the version + deterministic body,
+// so the backend can publish them and Update can tell what was installed
+std::vector<uint8_t> firmwareImage(const std::string& version);
+std::string firmwareVersionOf(const std::vector<uint8_t>& image);
+const std::string& runningFirmwareVersion();
+
+// Demo ML model (level forecast, format of ml_model.h) the backend publishes
+std::vector<uint8_t> mlModelImage(const std::string& version);
+
+// ----------------------------------------------------------------------------
+// Backend (in-process, answers the device's HTTPClient requests)
+// ----------------------------------------------------------------------------
+
+struct HttpRequest {
+    std::string method;
+    std::string path;             // Without the query string
+    std::string query;
+    std::string authorization;
+    std::string range;
+    std::string body;
+};
+
+struct HttpResponse {
+    int status;
+    std::string body;
+    uint64_t serverUs;            // Processing time on top of the network latency
+    size_t truncateAt;            // Body bytes sent before the connection closes (SIZE_MAX = all)
+};
+
+HttpResponse backendRequest(const HttpRequest& request);
+
+// Change a config/control field as the dashboard would (value as JSON text)
+void backendEdit(const char* field, const std::string& json);
+
+// Numeric config field currently held by the backend
+double backendConfigNumber(const char* field, double fallback);
+
+// Request to the device's own web server (the app), answered by the
+// firmware's AsyncWebServer handlers on the async_tcp task
+void deviceRequest(const std::string& method, const std::string& path, const std::string& body,
+                   std::function<void(int status, const std::string& body)> done);
+
+// The same request handled at once in the caller's context, body split into
+// chunks of chunkSize bytes (fuzz targets). Returns the status, 0 = no answer.
+int dispatchDeviceRequest(const std::string& method, const std::string& path, const std::string& body,
+                          size_t chunkSize, std::string& response);
+
+// Module setup: *Begin() registers state (before loadState),
+// scenarioBegin() schedules the events still ahead (after loadState)
+void storageBegin();
+void backendBegin();
+void plantBegin();
+void scenarioBegin();
+void printSummary();
+
+// Serve the backend on a TCP port in real time (--serve), until SIGINT
+[[noreturn]] void serveBackend(uint16_t port);
+
+// Drive --fleet devices against --target in real time, then print request
+// rates and latency percentiles
+[[noreturn]] void runFleet();
+
+// ----------------------------------------------------------------------------
+// Plant (tank, pump, demand, ultrasonic sensor)
+// ----------------------------------------------------------------------------
+
+void plantPowerOn();        // Relay dropped out over a reboot
+float waterLevelPercent();  // True tank level
+
+// Control quality over the run: overshoot, pump cycles, time outside the
+// threshold band - printed after the summary and optionally as JSON
+void printScore();
+void writeScore(const std::string& path);
+
+} // namespace sim
+
+#endif // SIM_H
@@ -0,0 +1,30 @@
+#ifndef SIM_PATCH_H
+#define SIM_PATCH_H
+
+#include <stdint.h>
+#include <vector>
+
+// ============================================================================
+// OTA PAYLOAD GENERATORS (host side)
+// ============================================================================
+// The server half of the firmware's streaming OTA stages: what the
+// simulated backend serves and what sim/tools/ota_tool.cpp writes for a real
+// one. Pure C++, no Arduino types.
+
+namespace sim {
+
+// Reference heatshrink encoder with the firmware decoder's parameters
+// (HEATSHRINK_WINDOW_BITS / HEATSHRINK_LOOKAHEAD_BITS): greedy longest match
+// within the window, back-references from 2 bytes, zero-padded last byte
+std::vector<uint8_t> heatshrinkEncode(const std::vector<uint8_t>& data);
+
+// Delta patch turning oldImage into newImage, in the DeltaPatcher format
+// (delta_patch.h). Matching follows bsdiff: suffix array of the old image,
+// approximate matches extended forwards and backwards, differences stored
+// as bytewise deltas. newImage must not be empty.
+std::vector<uint8_t> makeDeltaPatch(const std::vector<uint8_t>& oldImage,
+                                    const std::vector<uint8_t>& newImage);
+
+} // namespace sim
+
+#endif // SIM_PATCH_H
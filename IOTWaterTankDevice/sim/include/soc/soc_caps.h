@@ -0,0 +1,8 @@
+#ifndef SIM_SOC_CAPS_H
+#define SIM_SOC_CAPS_H
+
+// ESP32-S3 capabilities the firmware checks
+#define SOC_GPIO_SUPPORT_SLP_SWITCH 1
+#define SOC_GPIO_PIN_COUNT 49
+
+#endif // SIM_SOC_CAPS_H
@@ -0,0 +1,5 @@
+Import("env")
+
+# build_flags only reach the compiler; the 32-bit target has to be linked
+# with the matching crt/libstdc++ as well
+env.Append(LINKFLAGS=["-m32"])
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Control score over several seeds: runs the simulator once per seed with
+# the given options and prints the mean of every score field.
+#
+#   sim/score.sh [-n SEEDS] [-b BINARY] [simulator options...]
+#   sim/score.sh -n 20 --duration 7d --upper 90 --lower 30
+#
+# Demand is identical for the same seed across builds, so comparing the
+# output of two firmware builds isolates the effect of the control change.
+
+seeds=10
+binary=.pio/build/native/program
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -n) seeds=$2; shift 2 ;;
+        -b) binary=$2; shift 2 ;;
+        *) break ;;
+    esac
+done
+
+if [ ! -x "$binary" ]; then
+    echo "score.sh: $binary not found (pio run -e native)" >&2
+    exit 1
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+seed=1
+while [ "$seed" -le "$seeds" ]; do
+    if ! "$binary" --quiet --seed "$seed" --state-dir "$work/state" \
+            --score "$work/score-$seed.json" "$@" > "$work/log-$seed.txt" 2>&1; then
+        echo "score.sh: seed $seed failed, see below" >&2
+        tail -20 "$work/log-$seed.txt" >&2
+        exit 1
+    fi
+    seed=$((seed + 1))
+done
+
+cat "$work"/score-*.json | awk '
+{
+    gsub(/[{}"]/, "")
+    n = split($0, pairs, ",")
+    for (i = 1; i <= n; i++) {
+        split(pairs[i], kv, ":")
+        if (kv[1] == "seed") continue
+        if (!(kv[1] in sum)) order[++fields] = kv[1]
+        sum[kv[1]] += kv[2]
+        if (!(kv[1] in max) || kv[2] > max[kv[1]]) max[kv[1]] = kv[2]
+    }
+    runs++
+}
+END {
+    printf "%-16s %12s %12s   (%d seeds)\n", "field", "mean", "max", runs
+    for (i = 1; i <= fields; i++) {
+        f = order[i]
+        printf "%-16s %12.4f %12.4f\n", f, sum[f] / runs, max[f]
+    }
+}'
@@ -0,0 +1,774 @@
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include "driver/gpio.h"
+#include "sim.h"
+
+#include <ctype.h>
+#include <random>
+
+// ============================================================================
+// STRING
+// ============================================================================
+
+static std::string formatInteger(unsigned long long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    char buffer[72];
+    int pos = sizeof(buffer) - 1;
+    buffer[pos] = 0;
+    do {
+        int digit = (int)(value % base);
+        buffer[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value > 0);
+    if (negative) {
+        buffer[--pos] = '-';
+    }
+    return std::string(buffer + pos);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    // Arduino prints negative numbers in other bases as two's complement
+    if (base != 10) {
+        return formatInteger((unsigned long)value, base, false);
+    }
+    bool negative = value < 0;
+    unsigned long long magnitude = negative ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    return formatInteger(magnitude, base, negative);
+}
+
+static std::string formatFloat(double value, unsigned int decimals) {
+    if (std::isnan(value)) {
+        return "nan";
+    }
+    if (std::isinf(value)) {
+        return "inf";
+    }
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    return buffer;
+}
+
+String::String(unsigned char value, unsigned char base) : str(formatInteger(value, base, false)) {}
+String::String(int value, unsigned char base) : str(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : str(formatInteger(value, base, false)) {}
+String::String(long value, unsigned char base) : str(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : str(formatInteger(value, base, false)) {}
+String::String(long long value, unsigned char base) : str(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : str(formatInteger(value, base, false)) {}
+String::String(float value, unsigned int decimalPlaces) : str(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : str(formatFloat(value, decimalPlaces)) {}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    if (str.size() != s.str.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < str.size(); i++) {
+        if (tolower((unsigned char)str[i]) != tolower((unsigned char)s.str[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > str.size()) {
+        return false;
+    }
+    return str.compare(offset, prefix.str.size(), prefix.str) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.str.size() > str.size()) {
+        return false;
+    }
+    return str.compare(str.size() - suffix.str.size(), suffix.str.size(), suffix.str) == 0;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= str.size()) {
+        dummy = 0;
+        return dummy;
+    }
+    return str[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (buf == nullptr || bufsize == 0) {
+        return;
+    }
+    if (index >= str.size()) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = std::min((unsigned int)(str.size() - index), bufsize - 1);
+    memcpy(buf, str.data() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+    size_t pos = str.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& s, unsigned int fromIndex) const {
+    size_t pos = str.find(s.str, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t pos = str.rfind(c);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String& s) const {
+    size_t pos = str.rfind(s.str);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, (unsigned int)str.size());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        std::swap(beginIndex, endIndex);
+    }
+    if (beginIndex >= str.size()) {
+        return String();
+    }
+    if (endIndex > str.size()) {
+        endIndex = (unsigned int)str.size();
+    }
+    return String(str.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replacement) {
+    for (char& c : str) {
+        if (c == find) {
+            c = replacement;
+        }
+    }
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find.str.empty()) {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = str.find(find.str, pos)) != std::string::npos) {
+        str.replace(pos, find.str.size(), replacement.str);
+        pos += replacement.str.size();
+    }
+}
+
+void String::remove(unsigned int index) {
+    if (index < str.size()) {
+        str.erase(index);
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < str.size()) {
+        str.erase(index, count);
+    }
+}
+
+void String::toLowerCase() {
+    for (char& c : str) {
+        c = (char)tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase() {
+    for (char& c : str) {
+        c = (char)toupper((unsigned char)c);
+    }
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < str.size() && isspace((unsigned char)str[begin])) {
+        begin++;
+    }
+    size_t end = str.size();
+    while (end > begin && isspace((unsigned char)str[end - 1])) {
+        end--;
+    }
+    str = str.substr(begin, end - begin);
+}
+
+long String::toInt() const {
+    return strtol(str.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+    return strtof(str.c_str(), nullptr);
+}
+
+double String::toDouble() const {
+    return strtod(str.c_str(), nullptr);
+}
+
+String operator+(const String& lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, const char* rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char* lhs, const String& rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, long long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, unsigned long long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, float rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String& lhs, double rhs) { String s(lhs); s.concat(rhs); return s; }
+
+// ============================================================================
+// PRINT / STREAM / IPADDRESS
+// ============================================================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char small[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length < sizeof(small)) {
+        return write((const uint8_t*)small, length);
+    }
+
+    std::vector<char> big(length + 1);
+    va_start(args, format);
+    vsnprintf(big.data(), big.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)big.data(), length);
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = read();
+        if (c < 0) {
+            break;
+        }
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String result;
+    int c;
+    while ((c = read()) >= 0) {
+        result += (char)c;
+    }
+    return result;
+}
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char* s) {
+    unsigned int parts[4];
+    char extra;
+    if (s == nullptr || sscanf(s, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &extra) != 4) {
+        return false;
+    }
+    for (unsigned int part : parts) {
+        if (part > 255) {
+            return false;
+        }
+    }
+    *this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+}
+
+// ============================================================================
+// SERIAL
+// ============================================================================
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+// Each line gets the world time; --quiet drops firmware output entirely
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (sim::options().quiet) {
+        return size;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (buffer[i] == '\r') {
+            continue;
+        }
+        if (lineStart) {
+            fprintf(stdout, "[%s] ", sim::formatWorld(sim::worldUs()).c_str());
+            lineStart = false;
+        }
+        fputc(buffer[i], stdout);
+        if (buffer[i] == '\n') {
+            lineStart = true;
+        }
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+// ============================================================================
+// TIME
+// ============================================================================
+// millis()/micros() are 32-bit on the device; --millis-offset starts them
+// close to the wrap. esp_timer is not offset (64-bit, never wraps).
+
+extern void sim_noteClockPoll();
+
+unsigned long millis() {
+    sim_noteClockPoll();
+    return (uint32_t)(sim::options().millisOffset + sim::now() / 1000);
+}
+
+unsigned long micros() {
+    sim_noteClockPoll();
+    return (uint32_t)((uint64_t)sim::options().millisOffset * 1000 + sim::now());
+}
+
+int64_t esp_timer_get_time() {
+    sim_noteClockPoll();
+    return (int64_t)sim::now();
+}
+
+void delay(uint32_t ms) {
+    sim::sleep((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim::sleep(us);
+}
+
+void yield() {
+    taskYIELD();
+}
+
+// System time (settimeofday/SNTP) = base + device time since boot
+static int64_t systemTimeBaseUs = 0;
+
+int sim_gettimeofday(struct timeval* tv, void* tz) {
+    (void)tz;
+    if (tv != nullptr) {
+        int64_t t = systemTimeBaseUs + (int64_t)sim::now();
+        tv->tv_sec = (time_t)(t / 1000000);
+        tv->tv_usec = (suseconds_t)(t % 1000000);
+    }
+    return 0;
+}
+
+int sim_settimeofday(const struct timeval* tv, const void* tz) {
+    (void)tz;
+    if (tv != nullptr) {
+        systemTimeBaseUs = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - (int64_t)sim::now();
+    }
+    return 0;
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    uint32_t start = millis();
+    for (;;) {
+        struct timeval tv;
+        sim_gettimeofday(&tv, nullptr);
+        time_t now = tv.tv_sec;
+        localtime_r(&now, info);
+        if (info->tm_year > (2016 - 1900)) {
+            return true;
+        }
+        if (millis() - start >= ms) {
+            return false;
+        }
+        delay(10);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SNTP
+// ----------------------------------------------------------------------------
+
+#define SNTP_RETRY_MS 15000       // lwIP retry after an unanswered request
+#define SNTP_MIN_INTERVAL 15000
+
+static sntp_sync_time_cb_t sntpCallback = nullptr;
+static uint32_t sntpInterval = 3600000;
+static bool sntpRunning = false;
+static uint32_t sntpGeneration = 0;    // Invalidates scheduled polls on restart/stop
+static sntp_sync_status_t sntpStatus = SNTP_SYNC_STATUS_RESET;
+
+static void sntpPoll(uint32_t generation);
+
+static void sntpSchedule(uint64_t delayUs) {
+    uint32_t generation = sntpGeneration;
+    sim::after(delayUs, [generation]() { sntpPoll(generation); });
+}
+
+static void sntpPoll(uint32_t generation) {
+    if (!sntpRunning || generation != sntpGeneration) {
+        return;
+    }
+
+    if (!sim::options().ntp || !sim::wifiAvailable() || !sim::stationConnected()) {
+        sntpSchedule((uint64_t)SNTP_RETRY_MS * 1000);
+        return;
+    }
+
+    // Round trip on the world clock, a few ms of asymmetry error
+    uint64_t rttUs = 20000 + (uint64_t)(sim::uniform() * 60000);
+    int64_t errorUs = (int64_t)(sim::gaussian() * 5000);
+    int64_t trueUs = (int64_t)sim::wallMs() * 1000 + (int64_t)(rttUs / 2) + errorUs;
+
+    sim::after(rttUs, [generation, trueUs, rttUs]() {
+        if (!sntpRunning || generation != sntpGeneration) {
+            return;
+        }
+        struct timeval tv;
+        int64_t t = trueUs + (int64_t)(rttUs / 2);
+        tv.tv_sec = (time_t)(t / 1000000);
+        tv.tv_usec = (suseconds_t)(t % 1000000);
+        sim_settimeofday(&tv, nullptr);
+        sntpStatus = SNTP_SYNC_STATUS_COMPLETED;
+        sim::stats().ntpSyncs++;
+        if (sntpCallback != nullptr) {
+            sntpCallback(&tv);
+        }
+        sntpSchedule((uint64_t)sntpInterval * 1000);
+    });
+}
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffset_sec;
+    (void)daylightOffset_sec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+
+    sntpRunning = true;
+    sntpGeneration++;
+    sntpStatus = SNTP_SYNC_STATUS_RESET;
+    sntpSchedule(200000);
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    sntpCallback = callback;
+}
+
+void sntp_set_sync_interval(uint32_t intervalMs) {
+    sntpInterval = intervalMs < SNTP_MIN_INTERVAL ? SNTP_MIN_INTERVAL : intervalMs;
+}
+
+uint32_t sntp_get_sync_interval() {
+    return sntpInterval;
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+    return sntpStatus;
+}
+
+void sntp_restart() {
+    if (sntpRunning) {
+        sntpGeneration++;
+        sntpSchedule(200000);
+    }
+}
+
+bool sntp_enabled() {
+    return sntpRunning;
+}
+
+void sntp_stop() {
+    sntpRunning = false;
+    sntpGeneration++;
+}
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+#define SIM_PIN_COUNT 64
+
+struct SimPin {
+    uint8_t mode;
+    uint8_t output;
+    int external;                 // Level driven from outside, -1 = floating
+    void (*handler)(void*);
+    void (*plainHandler)(void);
+    void* arg;
+    int interruptMode;
+};
+
+static SimPin pins[SIM_PIN_COUNT] = {};
+static bool pinsInitialized = false;
+
+static void initPins() {
+    if (pinsInitialized) {
+        return;
+    }
+    for (SimPin& pin : pins) {
+        pin.external = -1;
+    }
+    pinsInitialized = true;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    initPins();
+    if (pin < SIM_PIN_COUNT) {
+        pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    initPins();
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    uint8_t level = value ? HIGH : LOW;
+    bool changed = pins[pin].output != level;
+    pins[pin].output = level;
+    if (changed) {
+        sim::outputChanged(pin, level);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    initPins();
+    if (pin >= SIM_PIN_COUNT) {
+        return LOW;
+    }
+    const SimPin& p = pins[pin];
+    if (p.mode == OUTPUT) {
+        return p.output;
+    }
+    if (p.external >= 0) {
+        return p.external;
+    }
+    if ((p.mode & PULLUP) != 0) {
+        return HIGH;
+    }
+    return LOW;
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+    (void)pin;
+    (void)state;
+    sim::sleep(timeout);
+    return 0;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    initPins();
+    if (pin < SIM_PIN_COUNT) {
+        pins[pin].handler = handler;
+        pins[pin].plainHandler = nullptr;
+        pins[pin].arg = arg;
+        pins[pin].interruptMode = mode;
+    }
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    initPins();
+    if (pin < SIM_PIN_COUNT) {
+        pins[pin].handler = nullptr;
+        pins[pin].plainHandler = handler;
+        pins[pin].arg = nullptr;
+        pins[pin].interruptMode = mode;
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < SIM_PIN_COUNT) {
+        pins[pin].handler = nullptr;
+        pins[pin].plainHandler = nullptr;
+    }
+}
+
+esp_err_t gpio_sleep_sel_dis(gpio_num_t gpio) {
+    (void)gpio;
+    return ESP_OK;
+}
+
+esp_err_t gpio_sleep_sel_en(gpio_num_t gpio) {
+    (void)gpio;
+    return ESP_OK;
+}
+
+namespace sim {
+
+void setInputPin(uint8_t pin, int level) {
+    initPins();
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    int before = digitalRead(pin);
+    pins[pin].external = level;
+    int after = digitalRead(pin);
+    if (before == after) {
+        return;
+    }
+
+    SimPin& p = pins[pin];
+    bool fire = p.interruptMode == CHANGE ||
+                (p.interruptMode == RISING && after == HIGH) ||
+                (p.interruptMode == FALLING && after == LOW);
+    if (!fire) {
+        return;
+    }
+
+    setIsr(true);
+    if (p.handler != nullptr) {
+        p.handler(p.arg);
+    } else if (p.plainHandler != nullptr) {
+        p.plainHandler();
+    }
+    setIsr(false);
+}
+
+int outputPin(uint8_t pin) {
+    initPins();
+    return pin < SIM_PIN_COUNT ? pins[pin].output : LOW;
+}
+
+} // namespace sim
+
+// ============================================================================
+// SYSTEM
+// ============================================================================
+
+EspClass ESP;
+
+// Device-side randomness: independent of the world stream so firmware
+// changes that draw more random numbers don't shift the scenario
+static std::mt19937 deviceRandom;
+static bool deviceRandomSeeded = false;
+
+uint32_t esp_random() {
+    if (!deviceRandomSeeded) {
+        deviceRandom.seed((uint32_t)(sim::options().seed * 2654435761ULL + sim::bootCount()));
+        deviceRandomSeeded = true;
+    }
+    return deviceRandom();
+}
+
+void esp_fill_random(void* buffer, size_t length) {
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    for (size_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)esp_random();
+    }
+}
+
+long random(long max) {
+    if (max <= 0) {
+        return 0;
+    }
+    return (long)(esp_random() % (uint32_t)max);
+}
+
+long random(long min, long max) {
+    if (min >= max) {
+        return min;
+    }
+    return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    (void)seed;  // esp_random() is a hardware RNG - seeding has no effect on the device either
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    if (in_max == in_min) {
+        return out_min;
+    }
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+size_t sim_strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t copy = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return length;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return 240;
+}
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+    (void)mhz;
+    return true;
+}
+
+void EspClass::restart() {
+    sim::stats().restarts++;
+    sim::restart("ESP.restart()");
+}
+
+void esp_restart() {
+    ESP.restart();
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return 240000;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return 200000;
+}
+
+uint32_t EspClass::getHeapSize() {
+    return 320000;
+}
+
+uint64_t EspClass::getEfuseMac() {
+    return 0x0000F412FA5A3C10ULL;
+}
+
+uint32_t esp_get_free_heap_size() {
+    return ESP.getFreeHeap();
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        default: return "UNKNOWN ERROR";
+    }
+}
@@ -0,0 +1,639 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "mbedtls/sha256.h"
+#include "config.h"
+#include "endpoints.h"
+#include "crc32.h"
+#include "ml_model.h"
+#include "sim.h"
+#include "sim_patch.h"
+
+#include <map>
+
+// ============================================================================
+// SIMULATED BACKEND
+// ============================================================================
+// Enough of the server for a device to run its normal sync cycle: device
+// login with JWT-like tokens, per-field {value, lastModified} config and
+// control with "lastModified = 0 wins" merging, telemetry (live + batched
+// backlog), HTTP time sync, firmware publishing with Range downloads (full
+// images and delta patches from the reporting version) and ML model
+// publishing.
+// Values are kept as JSON text so every field type round-trips unchanged.
+//
+// Scripted faults wrap every answer: 5xx bursts, slow responses, bodies
+// cut short, and tokens that expire (--token-lifetime) or are revoked.
+
+struct Field {
+    std::string json;             // Serialized value
+    uint64_t lastModified;        // Server wall clock (ms)
+};
+
+static std::map<std::string, Field> deviceConfig;
+static std::map<std::string, Field> controlData;
+struct Token {
+    uint64_t issuedUs;            // World time
+    uint64_t expiresUs;
+};
+
+static std::map<std::string, Token> tokens;
+static uint32_t tokenCounter = 0;
+
+static void setDefaults() {
+    char number[32];
+    auto put = [](std::map<std::string, Field>& fields, const char* key, const std::string& json) {
+        fields[key] = { json, 0 };
+    };
+
+    // The device adopts the tank the plant model simulates
+    const sim::Options& opts = sim::options();
+    snprintf(number, sizeof(number), "%g", opts.upperThreshold);
+    put(deviceConfig, "upperThreshold", number);
+    snprintf(number, sizeof(number), "%g", opts.lowerThreshold);
+    put(deviceConfig, "lowerThreshold", number);
+    snprintf(number, sizeof(number), "%g", opts.tankHeight);
+    put(deviceConfig, "tankHeight", number);
+    snprintf(number, sizeof(number), "%g", opts.tankWidth);
+    put(deviceConfig, "tankWidth", number);
+    put(deviceConfig, "tankShape", "\"" + opts.tankShape + "\"");
+    put(deviceConfig, "UsedTotal", "0");
+    put(deviceConfig, "maxInflow", "0");
+    put(deviceConfig, "force_update", "false");
+    put(deviceConfig, "ip_address", "\"\"");
+    put(deviceConfig, "auto_update", "true");
+    if (opts.heartbeatSec > 0) {
+        put(deviceConfig, "heartbeatSec", std::to_string(opts.heartbeatSec));
+    }
+
+    put(controlData, "pumpSwitch", "false");
+    put(controlData, "config_update", "false");
+}
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+
+static sim::HttpResponse reply(int status, const std::string& body) {
+    sim::HttpResponse response;
+    response.status = status;
+    response.body = body;
+    response.serverUs = 5000 + (uint64_t)(sim::uniform() * 35000);
+    response.truncateAt = SIZE_MAX;
+    return response;
+}
+
+static std::string fieldsJson(const std::map<std::string, Field>& fields) {
+    std::string json = "{";
+    bool first = true;
+    for (const auto& entry : fields) {
+        if (!first) {
+            json += ",";
+        }
+        first = false;
+        json += "\"" + entry.first + "\":{\"key\":\"" + entry.first + "\",\"value\":" + entry.second.json +
+                ",\"lastModified\":" + std::to_string(entry.second.lastModified) + "}";
+    }
+    return json + "}";
+}
+
+// Device writes: lastModified 0 = priority (always wins), otherwise the
+// newer timestamp wins. Accepts {value, lastModified} objects and plain values.
+static int mergeFields(std::map<std::string, Field>& fields, JsonObject updates) {
+    int changed = 0;
+    for (JsonPair pair : updates) {
+        auto existing = fields.find(pair.key().c_str());
+        if (existing == fields.end()) {
+            continue;
+        }
+
+        JsonVariant value = pair.value();
+        uint64_t lastModified = 0;
+        std::string json;
+        if (value.is<JsonObject>() && value.containsKey("value")) {
+            lastModified = value["lastModified"] | (uint64_t)0;
+            serializeJson(value["value"], json);
+        } else {
+            serializeJson(value, json);
+        }
+        if (lastModified != 0 && lastModified <= existing->second.lastModified) {
+            continue;
+        }
+
+        existing->second.json = json;
+        existing->second.lastModified = lastModified != 0 ? lastModified : sim::wallMs();
+        changed++;
+    }
+    return changed;
+}
+
+static bool authorized(const sim::HttpRequest& request) {
+    const std::string prefix = "Bearer ";
+    if (request.authorization.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    auto token = tokens.find(request.authorization.substr(prefix.size()));
+    if (token == tokens.end()) {
+        return false;
+    }
+
+    uint64_t now = sim::worldUs();
+    if (now >= token->second.expiresUs) {
+        return false;
+    }
+    for (uint64_t revoked : sim::options().tokenRevocations) {
+        if (token->second.issuedUs < revoked && revoked <= now) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string issueToken() {
+    char token[48];
+    snprintf(token, sizeof(token), "sim.%08x.%u", (uint32_t)sim::options().seed, ++tokenCounter);
+    tokens[token] = { sim::worldUs(), sim::worldUs() + sim::options().tokenLifetimeUs };
+    return token;
+}
+
+static std::string tokenReply() {
+    return "{\"success\":true,\"deviceToken\":\"" + issueToken() + "\",\"expiresIn\":" +
+           std::to_string(sim::options().tokenLifetimeUs / 1000000) + "}";
+}
+
+// Value of the fault covering a world time (0 = none)
+static uint32_t activeFault(const std::vector<sim::Fault>& faults, uint64_t world) {
+    for (const sim::Fault& fault : faults) {
+        if (fault.window.contains(world)) {
+            return fault.value;
+        }
+    }
+    return 0;
+}
+
+struct PublishedImage {
+    std::vector<uint8_t> data;
+    std::string sha256;
+};
+
+// Images are regenerated per version only once (checks run every few minutes)
+static const PublishedImage& publishedImage(const std::string& version) {
+    static std::map<std::string, PublishedImage> cache;
+    auto found = cache.find(version);
+    if (found != cache.end()) {
+        return found->second;
+    }
+
+    PublishedImage& image = cache[version];
+    image.data = sim::firmwareImage(version);
+    unsigned char digest[32];
+    mbedtls_sha256(image.data.data(), image.data.size(), digest, 0);
+    image.sha256 = sim::toHex(digest, sizeof(digest));
+    return image;
+}
+
+// Delta patch from one published version to another, made on first request
+static const std::vector<uint8_t>& publishedPatch(const std::string& base, const std::string& version) {
+    static std::map<std::string, std::vector<uint8_t>> cache;
+    std::vector<uint8_t>& patch = cache[base + "-" + version];
+    if (patch.empty()) {
+        patch = sim::makeDeltaPatch(publishedImage(base).data, publishedImage(version).data);
+    }
+    return patch;
+}
+
+static std::string queryParam(const std::string& query, const std::string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        if (query.compare(start, name.size() + 1, name + "=") == 0) {
+            return query.substr(start + name.size() + 1, end - start - name.size() - 1);
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+// ----------------------------------------------------------------------------
+// Firmware
+// ----------------------------------------------------------------------------
+
+// The simulated binary can't change its own FIRMWARE_VERSION, so once the
+// published image is what runs, the build's version is reported as latest
+static std::string latestVersion() {
+    const sim::Options& opts = sim::options();
+    if (opts.otaAtUs == 0 || sim::worldUs() < opts.otaAtUs) {
+        return FIRMWARE_VERSION;
+    }
+    if (sim::runningFirmwareVersion() == opts.otaVersion) {
+        return FIRMWARE_VERSION;
+    }
+    return opts.otaVersion;
+}
+
+static sim::HttpResponse firmwareLatest(const sim::HttpRequest& request) {
+    sim::stats().otaChecks++;
+
+    std::string version = latestVersion();
+    const PublishedImage& image = publishedImage(version);
+
+    DynamicJsonDocument doc(512);
+    JsonObject fw = doc.createNestedObject("firmware");
+    fw["id"] = "fw-" + version;
+    fw["version"] = version;
+    fw["size"] = image.data.size();
+    fw["sha256"] = image.sha256;
+
+    // Patch against the version the device says it runs
+    std::string current = queryParam(request.query, "currentVersion");
+    if (!current.empty() && current != version) {
+        JsonObject patch = fw.createNestedObject("patch");
+        patch["id"] = "patch-" + current + "-" + version;
+        patch["size"] = publishedPatch(current, version).size();
+        patch["baseVersion"] = current;
+    }
+
+    std::string body;
+    serializeJson(doc, body);
+    return reply(200, body);
+}
+
+static sim::HttpResponse firmwareDownload(const sim::HttpRequest& request, const std::string& id) {
+    const std::vector<uint8_t>* payload;
+    size_t dash = id.find('-', 6);
+    if (id.compare(0, 3, "fw-") == 0) {
+        payload = &publishedImage(id.substr(3)).data;
+    } else if (id.compare(0, 6, "patch-") == 0 && dash != std::string::npos) {
+        payload = &publishedPatch(id.substr(6, dash - 6), id.substr(dash + 1));
+    } else {
+        return reply(404, "{\"success\":false,\"error\":\"NOT_FOUND\"}");
+    }
+    const std::vector<uint8_t>& image = *payload;
+
+    size_t offset = 0;
+    unsigned long long start = 0;
+    if (sscanf(request.range.c_str(), "bytes=%llu-", &start) == 1 && start < image.size()) {
+        offset = (size_t)start;
+    }
+    if (offset == 0) {
+        sim::stats().otaDownloads++;
+    }
+
+    return reply(offset > 0 ? 206 : 200, std::string(image.begin() + offset, image.end()));
+}
+
+// ----------------------------------------------------------------------------
+// ML models
+// ----------------------------------------------------------------------------
+
+static const PublishedImage& publishedModel() {
+    static PublishedImage model;
+    if (model.data.empty()) {
+        model.data = sim::mlModelImage(sim::options().mlModelVersion);
+        unsigned char digest[32];
+        mbedtls_sha256(model.data.data(), model.data.size(), digest, 0);
+        model.sha256 = sim::toHex(digest, sizeof(digest));
+    }
+    return model;
+}
+
+static bool modelPublished() {
+    const sim::Options& opts = sim::options();
+    return opts.mlModelAtUs != 0 && sim::worldUs() >= opts.mlModelAtUs;
+}
+
+static sim::HttpResponse mlModelLatest() {
+    sim::stats().mlChecks++;
+    if (!modelPublished()) {
+        return reply(404, "{\"success\":false,\"error\":\"NO_MODEL\"}");
+    }
+
+    const PublishedImage& model = publishedModel();
+    DynamicJsonDocument doc(512);
+    JsonObject info = doc.createNestedObject("model");
+    info["id"] = "ml-" + sim::options().mlModelVersion;
+    info["version"] = sim::options().mlModelVersion;
+    info["size"] = model.data.size();
+    info["sha256"] = model.sha256;
+
+    std::string body;
+    serializeJson(doc, body);
+    return reply(200, body);
+}
+
+static sim::HttpResponse mlModelDownload(const std::string& id) {
+    if (!modelPublished() || id != "ml-" + sim::options().mlModelVersion) {
+        return reply(404, "{\"success\":false,\"error\":\"NOT_FOUND\"}");
+    }
+    sim::stats().mlDownloads++;
+    const std::vector<uint8_t>& data = publishedModel().data;
+    return reply(200, std::string(data.begin(), data.end()));
+}
+
+// ----------------------------------------------------------------------------
+// Dispatch
+// ----------------------------------------------------------------------------
+
+static sim::HttpResponse handleRequest(const sim::HttpRequest& request) {
+    using namespace sim;
+    const std::string& path = request.path;
+    bool post = request.method == "POST";
+
+    if (path == API_DEVICE_LOGIN && post) {
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, request.body)) {
+            return reply(400, "{\"success\":false,\"error\":\"INVALID_JSON\"}");
+        }
+        const char* username = doc["username"] | "";
+        const char* password = doc["password"] | "";
+        if (options().dashUser != username || options().dashPass != password) {
+            return reply(401, "{\"success\":false,\"error\":\"INVALID_CREDENTIALS\"}");
+        }
+        stats().logins++;
+        return reply(200, tokenReply());
+    }
+
+    if (path == API_TIME_SYNC) {
+        stats().timeSyncs++;
+        HttpResponse response = reply(200, "");
+        // Stamped when the server answers: half the round trip before arrival
+        response.body = "{\"success\":true,\"serverTime\":" +
+                        std::to_string(wallMs() + response.serverUs / 1000) + "}";
+        return response;
+    }
+
+    if (!authorized(request)) {
+        return reply(401, "{\"success\":false,\"error\":\"UNAUTHORIZED\"}");
+    }
+
+    if (path == API_DEVICE_REFRESH && post) {
+        std::string old = request.authorization.substr(7);
+        tokens.erase(old);
+        return reply(200, tokenReply());
+    }
+
+    if (path == API_DEVICE_HEARTBEAT || path == API_DEVICE_VERIFY) {
+        return reply(200, "{\"success\":true}");
+    }
+
+    if (path == API_DEVICE_CONFIG) {
+        if (!post) {
+            stats().configFetches++;
+            return reply(200, "{\"success\":true,\"deviceConfig\":" + fieldsJson(deviceConfig) + "}");
+        }
+        DynamicJsonDocument doc(4096);
+        if (deserializeJson(doc, request.body)) {
+            return reply(400, "{\"success\":false,\"error\":\"INVALID_JSON\"}");
+        }
+        stats().configUploads++;
+        mergeFields(deviceConfig, doc["configUpdates"].as<JsonObject>());
+        return reply(200, "{\"success\":true}");
+    }
+
+    if (path == API_DEVICE_CONTROL) {
+        if (!post) {
+            stats().controlFetches++;
+            return reply(200, "{\"success\":true,\"controlData\":" + fieldsJson(controlData) + "}");
+        }
+        DynamicJsonDocument doc(2048);
+        if (deserializeJson(doc, request.body)) {
+            return reply(400, "{\"success\":false,\"error\":\"INVALID_JSON\"}");
+        }
+        stats().controlUploads++;
+        mergeFields(controlData, doc.as<JsonObject>());
+        return reply(200, "{\"success\":true}");
+    }
+
+    if (path == API_DEVICE_TELEMETRY && post) {
+        stats().telemetry++;
+        if (request.body.find("\"mlModel\"") != std::string::npos) {
+            stats().mlTelemetry++;
+        }
+        if (request.body.find("\"event\":\"leakAlarm\"") != std::string::npos) {
+            stats().leakAlarms++;
+            log("Backend: leak alarm received");
+        } else if (request.body.find("\"event\":\"leakCleared\"") != std::string::npos) {
+            stats().leakClears++;
+            log("Backend: leak alarm cleared");
+        }
+        return reply(200, "{\"success\":true}");
+    }
+
+    if (path == API_DEVICE_TELEMETRY_BATCH && post) {
+        DynamicJsonDocument doc(4096);
+        if (deserializeJson(doc, request.body)) {
+            return reply(400, "{\"success\":false,\"error\":\"INVALID_JSON\"}");
+        }
+        stats().telemetryBatched += doc["records"].size();
+        return reply(200, "{\"success\":true}");
+    }
+
+    if (path == API_FIRMWARE_LATEST) {
+        return firmwareLatest(request);
+    }
+
+    const std::string download = std::string(API_FIRMWARE_DOWNLOAD_ID) + "/";
+    if (path.compare(0, download.size(), download) == 0) {
+        return firmwareDownload(request, path.substr(download.size()));
+    }
+
+    if (path == API_MLMODEL_LATEST) {
+        return mlModelLatest();
+    }
+
+    const std::string modelDownload = std::string(API_MLMODEL_DOWNLOAD) + "/";
+    if (path.compare(0, modelDownload.size(), modelDownload) == 0) {
+        return mlModelDownload(path.substr(modelDownload.size()));
+    }
+
+    return reply(404, "{\"success\":false,\"error\":\"NOT_FOUND\"}");
+}
+
+namespace sim {
+
+// Faults are decided per request; the random draws only happen inside an
+// active window, so runs without faults keep their random sequence
+HttpResponse backendRequest(const HttpRequest& request) {
+    const Options& opts = options();
+    uint64_t now = worldUs();
+
+    uint32_t errorPercent = activeFault(opts.errorBursts, now);
+    if (errorPercent > 0 && uniform() * 100 < errorPercent) {
+        static const int STATUSES[4] = { 500, 502, 503, 504 };
+        stats().faultErrors++;
+        return reply(STATUSES[random() % 4], "{\"success\":false,\"error\":\"SERVICE_UNAVAILABLE\"}");
+    }
+
+    HttpResponse response = handleRequest(request);
+    if (response.status == 401) {
+        stats().unauthorized++;
+    }
+
+    uint32_t slowMs = activeFault(opts.slowResponses, now);
+    if (slowMs > 0) {
+        stats().faultSlow++;
+        response.serverUs += (uint64_t)slowMs * 1000;
+    }
+
+    uint32_t truncatePercent = activeFault(opts.truncations, now);
+    if (truncatePercent > 0 && response.body.size() > 1 && uniform() * 100 < truncatePercent) {
+        stats().faultTruncations++;
+        response.truncateAt = (size_t)(uniform() * response.body.size());
+    }
+    return response;
+}
+
+// Dashboard/app edit: stamped with the server clock so it beats older
+// device values on the next sync
+void backendEdit(const char* field, const std::string& json) {
+    for (std::map<std::string, Field>* fields : { &deviceConfig, &controlData }) {
+        auto existing = fields->find(field);
+        if (existing != fields->end()) {
+            existing->second = { json, wallMs() };
+            log("Backend: %s = %s", field, json.c_str());
+            return;
+        }
+    }
+}
+
+// Header (magic + version) and a body derived from the version, so a
+// delta between two versions shares most of its bytes
+std::vector<uint8_t> firmwareImage(const std::string& version) {
+    static const char MAGIC[8] = { 'S', 'I', 'M', 'F', 'W', '0', '1', 0 };
+    std::vector<uint8_t> image(std::max<size_t>(options().otaSize, 64));
+    memcpy(image.data(), MAGIC, sizeof(MAGIC));
+    strncpy((char*)image.data() + 8, version.c_str(), 31);
+    image[39] = 0;
+
+    uint32_t base = 0x9E3779B9;
+    uint32_t variant = 2166136261u;
+    for (char c : version) {
+        variant = (variant ^ (uint8_t)c) * 16777619u;
+    }
+    for (size_t i = 40; i < image.size(); i++) {
+        base ^= base << 13;
+        base ^= base >> 17;
+        base ^= base << 5;
+        // Every 64 KB block, one 256-byte region differs between versions
+        bool patched = ((i >> 8) & 0xFF) == (variant & 0xFF);
+        image[i] = (uint8_t)(patched ? base ^ variant : base);
+    }
+    return image;
+}
+
+std::string firmwareVersionOf(const std::vector<uint8_t>& image) {
+    if (image.size() < 40 || memcmp(image.data(), "SIMFW01", 8) != 0) {
+        return "";
+    }
+    return std::string((const char*)image.data() + 8, strnlen((const char*)image.data() + 8, 31));
+}
+
+// Linear extrapolation of the level 10 minutes ahead from the last 8
+// one-minute means, written as a 2-layer MLP: hidden = relu(+z), relu(-z)
+// and output = h0 - h1 = z, with z = x7 + 10 * (x7 - x0) / 7 on the level
+// normalized to [-1, 1]. Exercises both layers, ReLU and requantization.
+std::vector<uint8_t> mlModelImage(const std::string& version) {
+    (void)version;
+    const int window = 8;
+    const float slope = 10.0f / 7.0f;
+
+    MLModelHeader head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, ML_MODEL_MAGIC, sizeof(head.magic));
+    head.format = ML_MODEL_FORMAT;
+    head.outputKind = ML_OUTPUT_FORECAST;
+    head.channels = ML_CHANNEL_LEVEL;
+    head.layerCount = 2;
+    head.window = window;
+    head.strideSec = 60;
+    head.horizonSec = 600;
+    head.channelOffset[0] = 50.0f;
+    head.channelScale[0] = 1.0f / 50.0f;
+    head.inputScale = 1.0f / 127;
+    head.inputZeroPoint = 0;
+    head.outputGain = 50.0f;
+    head.outputOffset = 50.0f;
+
+    std::vector<uint8_t> image((const uint8_t*)&head, (const uint8_t*)&head + sizeof(head));
+    auto append = [&image](const void* data, size_t length) {
+        image.insert(image.end(), (const uint8_t*)data, (const uint8_t*)data + length);
+    };
+
+    // Hidden layer: weights in units of (1 + slope) / 127
+    MLLayerHeader hidden = { window, 2, ML_ACTIVATION_RELU, 0, { 0, 0 }, (1 + slope) / 127, 4.0f / 127 };
+    int8_t w1[2 * window] = {};
+    w1[0] = (int8_t)lroundf(-slope / hidden.weightScale);
+    w1[window - 1] = 127;
+    for (int i = 0; i < window; i++) {
+        w1[window + i] = (int8_t)-w1[i];
+    }
+    int32_t b1[2] = { 0, 0 };
+    append(&hidden, sizeof(hidden));
+    append(w1, sizeof(w1));
+    append(b1, sizeof(b1));
+
+    MLLayerHeader output = { 2, 1, ML_ACTIVATION_NONE, 0, { 0, 0 }, 1.0f / 127, 4.0f / 127 };
+    int8_t w2[4] = { 127, -127, 0, 0 };   // Padded to 4 bytes
+    int32_t b2[1] = { 0 };
+    append(&output, sizeof(output));
+    append(w2, sizeof(w2));
+    append(b2, sizeof(b2));
+
+    uint32_t crc = crc32Compute(image.data(), image.size());
+    append(&crc, sizeof(crc));
+    return image;
+}
+
+// Current config value as the dashboard sees it (the device syncs its
+// own edits here), used to score against the thresholds actually in force
+double backendConfigNumber(const char* field, double fallback) {
+    auto existing = deviceConfig.find(field);
+    if (existing == deviceConfig.end()) {
+        return fallback;
+    }
+    char* end;
+    double value = strtod(existing->second.json.c_str(), &end);
+    return end != existing->second.json.c_str() ? value : fallback;
+}
+
+void backendBegin() {
+    setDefaults();
+
+    registerState("backend",
+        [](std::vector<std::pair<std::string, std::string>>& out) {
+            for (const auto& entry : deviceConfig) {
+                out.push_back({ "config." + entry.first, std::to_string(entry.second.lastModified) + " " + entry.second.json });
+            }
+            for (const auto& entry : controlData) {
+                out.push_back({ "control." + entry.first, std::to_string(entry.second.lastModified) + " " + entry.second.json });
+            }
+            for (const auto& entry : tokens) {
+                out.push_back({ "token." + entry.first,
+                                std::to_string(entry.second.issuedUs) + " " + std::to_string(entry.second.expiresUs) });
+            }
+            out.push_back({ "tokenCounter", std::to_string(tokenCounter) });
+        },
+        [](const std::string& key, const std::string& value) {
+            auto loadField = [&value](std::map<std::string, Field>& fields, const std::string& name) {
+                size_t space = value.find(' ');
+                if (space != std::string::npos) {
+                    fields[name] = { value.substr(space + 1), strtoull(value.c_str(), nullptr, 10) };
+                }
+            };
+            if (key.compare(0, 7, "config.") == 0) {
+                loadField(deviceConfig, key.substr(7));
+            } else if (key.compare(0, 8, "control.") == 0) {
+                loadField(controlData, key.substr(8));
+            } else if (key.compare(0, 6, "token.") == 0) {
+                char* rest;
+                uint64_t issued = strtoull(value.c_str(), &rest, 10);
+                tokens[key.substr(6)] = { issued, strtoull(rest, nullptr, 10) };
+            } else if (key == "tokenCounter") {
+                tokenCounter = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+            }
+        });
+}
+
+} // namespace sim
@@ -0,0 +1,255 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <jsnsr04t.h>
+#include "sim.h"
+
+// ============================================================================
+// I2C
+// ============================================================================
+
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    if (frequency != 0) {
+        clock = frequency;
+    }
+    return true;
+}
+
+void TwoWire::beginTransmission(uint16_t address) {
+    (void)address;
+    pending = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+    (void)c;
+    if (pending >= I2C_BUFFER_LENGTH) {
+        return 0;
+    }
+    pending++;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* buffer, size_t size) {
+    (void)buffer;
+    size = std::min(size, (size_t)I2C_BUFFER_LENGTH - pending);
+    pending += size;
+    return size;
+}
+
+// Start + address + data, 9 clocks per byte, + stop
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    uint64_t bits = 1 + 9 * (pending + 1) + 1;
+    sim::sleep(bits * 1000000 / (clock > 0 ? clock : 100000));
+    pending = 0;
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop) {
+    (void)address;
+    (void)size;
+    (void)sendStop;
+    return 0;
+}
+
+// ============================================================================
+// GFX
+// ============================================================================
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+    : _width(w), _height(h), cursor_x(0), cursor_y(0), textcolor(1), textbgcolor(1), textsize(1), wrap(true) {
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    for (;;) {
+        drawPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    for (int16_t i = 0; i < w; i++) {
+        drawPixel(x + i, y, color);
+    }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    for (int16_t i = 0; i < h; i++) {
+        drawPixel(x, y + i, color);
+    }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t i = 0; i < h; i++) {
+        drawFastHLine(x, y + i, w, color);
+    }
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    for (int16_t y = -r; y <= r; y++) {
+        for (int16_t x = -r; x <= r; x++) {
+            int d = x * x + y * y;
+            if (d <= r * r && d > (r - 1) * (r - 1)) {
+                drawPixel(x0 + x, y0 + y, color);
+            }
+        }
+    }
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    for (int16_t y = -r; y <= r; y++) {
+        for (int16_t x = -r; x <= r; x++) {
+            if (x * x + y * y <= r * r) {
+                drawPixel(x0 + x, y0 + y, color);
+            }
+        }
+    }
+}
+
+// 5x7 cell with a pattern from the character code (not a real font)
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size) {
+    for (int8_t col = 0; col < 6; col++) {
+        uint8_t line = col < 5 ? (uint8_t)((c * (col + 3)) ^ (c >> col)) & 0x7F : 0;
+        for (int8_t row = 0; row < 8; row++, line >>= 1) {
+            uint16_t pixelColor = (line & 1) ? color : bg;
+            if (!(line & 1) && bg == color) {
+                continue;  // Transparent background
+            }
+            if (size == 1) {
+                drawPixel(x + col, y + row, pixelColor);
+            } else {
+                fillRect(x + col * size, y + row * size, size, size, pixelColor);
+            }
+        }
+    }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+    if (c == '\n') {
+        cursor_x = 0;
+        cursor_y += textsize * 8;
+    } else if (c != '\r') {
+        if (wrap && cursor_x + textsize * 6 > _width) {
+            cursor_x = 0;
+            cursor_y += textsize * 8;
+        }
+        drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+        cursor_x += textsize * 6;
+    }
+    return 1;
+}
+
+// ============================================================================
+// SSD1306
+// ============================================================================
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi, int8_t rst_pin,
+                                   uint32_t clkDuring, uint32_t clkAfter)
+    : Adafruit_GFX(w, h), wire(twi), address(0x3C), buffer(nullptr) {
+    (void)rst_pin;
+    (void)clkDuring;
+    (void)clkAfter;
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() {
+    free(buffer);
+}
+
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t i2caddr, bool reset, bool periphBegin) {
+    (void)switchvcc;
+    (void)reset;
+    if (buffer == nullptr) {
+        buffer = (uint8_t*)malloc(_width * ((_height + 7) / 8));
+        if (buffer == nullptr) {
+            return false;
+        }
+    }
+    clearDisplay();
+    if (i2caddr != 0) {
+        address = i2caddr;
+    }
+    if (periphBegin) {
+        wire->begin();
+    }
+    transfer(25);   // Init command sequence
+    return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+    if (buffer != nullptr) {
+        memset(buffer, 0, _width * ((_height + 7) / 8));
+    }
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (buffer == nullptr || x < 0 || y < 0 || x >= _width || y >= _height) {
+        return;
+    }
+    uint8_t* byte = &buffer[x + (y / 8) * _width];
+    uint8_t bit = 1 << (y & 7);
+    switch (color) {
+        case SSD1306_WHITE: *byte |= bit; break;
+        case SSD1306_BLACK: *byte &= ~bit; break;
+        case SSD1306_INVERSE: *byte ^= bit; break;
+    }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) {
+    if (buffer == nullptr || x < 0 || y < 0 || x >= _width || y >= _height) {
+        return false;
+    }
+    return (buffer[x + (y / 8) * _width] & (1 << (y & 7))) != 0;
+}
+
+void Adafruit_SSD1306::display() {
+    transfer(6 + _width * ((_height + 7) / 8));
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
+    (void)c;
+    transfer(1);
+}
+
+void Adafruit_SSD1306::transfer(size_t bytes) {
+    wire->beginTransmission(address);
+    wire->write((uint8_t)0x00);
+    for (size_t i = 0; i < bytes; i++) {
+        wire->write((uint8_t)0);
+    }
+    wire->endTransmission();
+}
+
+// ============================================================================
+// ULTRASONIC SENSOR
+// ============================================================================
+
+// Trigger pulse + echo: sound travels the distance twice at ~343 m/s.
+// A lost echo waits for the sensor's ~38 ms timeout.
+float JsnSr04T::readDistance() {
+    float distance = sim::sensorDistance();
+    uint64_t echoUs = distance > 0 ? (uint64_t)(distance * 2 / 0.0343f) : 38000;
+    sim::sleep(10 + echoUs);
+    return distance > 0 ? distance : -1;
+}
@@ -0,0 +1,1051 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "sim.h"
+#include "config.h"
+#include "endpoints.h"
+#include "server_url.h"
+#include "device_config.h"
+#include "control_data.h"
+#include "telemetry.h"
+#include "telemetry_reporter.h"
+#include "handle_config_data.h"
+#include "heatshrink_decoder.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// FLEET LOAD GENERATOR (--fleet)
+// ============================================================================
+// N devices against a real backend (or a --serve instance) on the wall
+// clock. Bodies come from the firmware's own builders (TelemetryManager,
+// DeviceConfigManager, ControlDataManager), so they match what a device
+// sends byte for byte apart from the device id. Timing follows main.cpp:
+// - boot: WiFi connect, login, config fetch, then telemetry after 5 s and
+//   control after 10 s (the loop's "came online" transition)
+// - a sample every FLEET_SAMPLE_INTERVAL, uploaded when TelemetryReporter
+//   says so (pump change, deadband, heartbeat); control and OTA check every
+//   CONTROL_FETCH_INTERVAL / OTA_CHECK_INTERVAL, HTTP time cross-check
+//   (HTTP_TIME_SYNC_SAMPLES requests) every HTTP_TIME_SYNC_INTERVAL
+// - failed telemetry is queued and backfilled in batches of
+//   TELEMETRY_BACKLOG_BATCH_SIZE every TELEMETRY_BACKLOG_INTERVAL while the
+//   device has nothing else in flight
+// - config/control requests retry API_RETRY_COUNT times; a 401 drops the
+//   session and re-login backs off from RELOGIN_RETRY_MIN_MS to _MAX_MS
+//
+// Every device clock runs a few ppm off and every timer fires a little late
+// (loop latency), so a fleet that boots together drifts apart the way real
+// devices do. --storm takes the link away from part of the fleet and gives
+// it back at once: a reconnect storm plus the backlog it queued.
+//
+// One TCP connection per request like HTTPClient begin()/end(); single
+// thread, non-blocking sockets.
+
+#define FLEET_DRIFT_PPM 20.0                  // Oscillator error (sigma)
+#define FLEET_SAMPLE_INTERVAL 30000ULL        // Level model step (ms)
+#define FLEET_LOOP_LAG_US 20000ULL            // Timers fire up to this late
+#define FLEET_WIFI_CONNECT_US 2000000ULL      // Association + DHCP, plus up to as much again
+#define FLEET_RECONNECT_SPREAD_US 5000000ULL  // Storm: reconnects spread over this
+#define FLEET_POLL_MS 10
+#define FLEET_RESPONSE_MAX (256 * 1024)
+#define FLEET_QUEUE_CAPACITY (TELEMETRY_QUEUE_SEGMENT_RECORDS * TELEMETRY_QUEUE_MAX_SEGMENTS)
+
+enum RequestKind {
+    REQ_LOGIN,
+    REQ_CONFIG_GET,
+    REQ_CONFIG_POST,
+    REQ_CONTROL_GET,
+    REQ_CONTROL_POST,
+    REQ_TELEMETRY,
+    REQ_BACKLOG,
+    REQ_TIME,
+    REQ_OTA_CHECK,
+    REQ_KINDS
+};
+
+static const char* const kindNames[REQ_KINDS] = {
+    "login", "config GET", "config POST", "control GET", "control POST",
+    "telemetry", "backlog batch", "time", "OTA check"
+};
+
+struct KindStats {
+    uint64_t requests;            // Attempts, retries included
+    uint64_t status2xx;
+    uint64_t status4xx;
+    uint64_t status5xx;
+    uint64_t errors;              // No HTTP status (connect, timeout, closed early)
+    std::vector<uint32_t> latencyUs;  // Answered requests, connect to last byte
+};
+
+struct FleetDevice {
+    std::string deviceId;
+    std::string hardwareId;
+    std::string token;            // Empty = not authenticated
+    double rate;                  // Device clock speed (1 + drift)
+    bool poweredOn;
+    bool linkUp;
+    bool booted;                  // Boot login + config fetch done
+    uint64_t powerOnUs;
+    uint64_t linkUpAtUs;          // Boot or storm reconnect
+    uint64_t nextSampleUs;
+    uint64_t nextControlUs;
+    uint64_t nextOtaUs;
+    uint64_t nextTimeUs;
+    uint64_t nextBacklogUs;
+    uint64_t nextLoginUs;
+    uint64_t nextEditUs;
+    uint64_t reloginBackoffUs;
+    uint32_t busy;                // Bit per RequestKind in flight
+    uint32_t backlog;             // Queued samples
+    uint32_t timeSamplesLeft;
+    float level;
+    bool pump;
+    TelemetryReporter reporter;
+    DeviceConfig config;
+};
+
+struct FleetRequest {
+    uint32_t device;
+    RequestKind kind;
+    std::string method;
+    std::string target;           // Path and query
+    std::string body;
+    int attempt;
+    int retries;
+    uint32_t batch;               // Backlog records carried
+    uint64_t startAtUs;           // Held until (retry delay)
+    int fd;                       // -1 = not started
+    bool connected;
+    bool done;
+    std::string out;
+    std::string in;
+    uint64_t beganUs;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+static uint64_t startRealUs = 0;
+
+static struct sockaddr_storage targetAddress;
+static socklen_t targetAddressLength = 0;
+static std::string targetHost;    // Host header
+static std::string basePath;      // Path part of --target
+
+static std::vector<FleetDevice> devices;
+static std::vector<FleetRequest> requests;   // Waiting or in flight
+static std::vector<FleetRequest> queued;     // Added during this pass
+static KindStats kindStats[REQ_KINDS];
+
+static uint64_t errorsConnect = 0;
+static uint64_t errorsTimeout = 0;
+static uint64_t errorsClosed = 0;
+static uint64_t samplesQueued = 0;
+static uint64_t samplesUploaded = 0;
+static uint64_t samplesDropped = 0;
+static size_t peakInFlight = 0;
+
+// Progress line (since the last one)
+static uint64_t intervalRequests = 0;
+static uint64_t intervalErrors = 0;
+static std::vector<uint32_t> intervalLatencyUs;
+
+// The firmware's payload builders
+static TelemetryManager telemetryBuilder;
+static DeviceConfigManager configBuilder;
+static ControlDataManager controlBuilder;
+
+static uint64_t realUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t wallClockMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// A device timer period in real time: its clock error plus loop latency
+static uint64_t period(const FleetDevice& device, uint64_t ms) {
+    return (uint64_t)(ms * 1000.0 / device.rate) + (uint64_t)(sim::uniform() * FLEET_LOOP_LAG_US);
+}
+
+// The builders stamp DEVICE_ID - swap in this device's id
+static std::string withDeviceId(const String& payload, const FleetDevice& device) {
+    std::string text(payload.c_str());
+    std::string from = std::string("\"deviceId\":\"") + DEVICE_ID + "\"";
+    size_t at = text.find(from);
+    if (at != std::string::npos) {
+        text.replace(at, from.size(), "\"deviceId\":\"" + device.deviceId + "\"");
+    }
+    return text;
+}
+
+static std::string deviceQuery(const FleetDevice& device) {
+    return "?deviceId=" + device.deviceId;
+}
+
+// ----------------------------------------------------------------------------
+// Requests
+// ----------------------------------------------------------------------------
+
+static void queueRequest(uint32_t index, RequestKind kind, const char* method, const std::string& target,
+                         const std::string& body, int retries, uint32_t batch = 0) {
+    FleetRequest request;
+    request.device = index;
+    request.kind = kind;
+    request.method = method;
+    request.target = target;
+    request.body = body;
+    request.attempt = 1;
+    request.retries = retries;
+    request.batch = batch;
+    request.startAtUs = sim::now();
+    request.fd = -1;
+    request.connected = false;
+    request.done = false;
+    request.beganUs = 0;
+    queued.push_back(request);
+    devices[index].busy |= 1u << kind;
+}
+
+static void queueSamples(FleetDevice& device, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (device.backlog >= FLEET_QUEUE_CAPACITY) {
+            samplesDropped++;   // Oldest segment recycled on the device
+        } else {
+            device.backlog++;
+        }
+        samplesQueued++;
+    }
+}
+
+static void sendLogin(uint32_t index) {
+    FleetDevice& device = devices[index];
+    StaticJsonDocument<512> doc;
+    doc["username"] = sim::options().dashUser.c_str();
+    doc["password"] = sim::options().dashPass.c_str();
+    doc["deviceId"] = device.deviceId.c_str();
+    doc["hardwareId"] = device.hardwareId.c_str();
+    doc["deviceName"] = DEVICE_NAME;
+    String payload;
+    serializeJson(doc, payload);
+    device.nextLoginUs = UINT64_MAX;
+    queueRequest(index, REQ_LOGIN, "POST", API_DEVICE_LOGIN, payload.c_str(), API_RETRY_COUNT);
+}
+
+static float inflowOf(const FleetDevice& device) {
+    return device.pump ? 12.5f : 0.0f;
+}
+
+static void sendTelemetry(uint32_t index) {
+    FleetDevice& device = devices[index];
+    String payload = telemetryBuilder.buildTelemetryPayload(device.level, inflowOf(device),
+                                                            device.pump ? 1 : 0);
+    queueRequest(index, REQ_TELEMETRY, "POST", API_DEVICE_TELEMETRY, withDeviceId(payload, device), 1);
+}
+
+static void sendBacklog(uint32_t index) {
+    FleetDevice& device = devices[index];
+    uint32_t count = std::min<uint32_t>(device.backlog, TELEMETRY_BACKLOG_BATCH_SIZE);
+    TelemetryRecord records[TELEMETRY_BACKLOG_BATCH_SIZE];
+    uint64_t nowMs = wallClockMs();
+    for (uint32_t i = 0; i < count; i++) {
+        memset(&records[i], 0, sizeof(records[i]));
+        records[i].timestamp = nowMs - (uint64_t)(device.backlog - i) * FLEET_SAMPLE_INTERVAL;
+        records[i].waterLevel = device.level;
+        records[i].currInflow = 0;
+        records[i].pumpStatus = device.pump ? 1 : 0;
+    }
+    String payload = telemetryBuilder.buildTelemetryBatchPayload(records, count);
+    queueRequest(index, REQ_BACKLOG, "POST", API_DEVICE_TELEMETRY_BATCH, withDeviceId(payload, device), 1, count);
+}
+
+static void sendTimeSample(uint32_t index) {
+    FleetDevice& device = devices[index];
+    device.timeSamplesLeft--;
+    queueRequest(index, REQ_TIME, "GET", std::string(API_TIME_SYNC) + deviceQuery(device), "", 1);
+}
+
+static void sendOtaCheck(uint32_t index) {
+    FleetDevice& device = devices[index];
+    char query[160];
+    snprintf(query, sizeof(query), "&currentVersion=%s&accept=heatshrink&hsWindow=%d&hsLookahead=%d",
+             FIRMWARE_VERSION, HEATSHRINK_WINDOW_BITS, HEATSHRINK_LOOKAHEAD_BITS);
+    queueRequest(index, REQ_OTA_CHECK, "GET", std::string(API_FIRMWARE_LATEST) + deviceQuery(device) + query, "", 1);
+}
+
+// A local change on the device: pump switch (control) or threshold (config)
+static void sendEdit(uint32_t index) {
+    FleetDevice& device = devices[index];
+    if (sim::uniform() < 0.5) {
+        if (device.busy & (1u << REQ_CONTROL_POST)) {
+            return;
+        }
+        ControlData control;
+        control.pumpSwitch = !device.pump;
+        control.pumpSwitchLastModified = wallClockMs();
+        String payload = controlBuilder.buildControlPayload(control);
+        queueRequest(index, REQ_CONTROL_POST, "POST", std::string(API_DEVICE_CONTROL) + deviceQuery(device),
+                     payload.c_str(), API_RETRY_COUNT);
+    } else {
+        if (device.busy & (1u << REQ_CONFIG_POST)) {
+            return;
+        }
+        device.config.upperThreshold = 80 + (float)(sim::uniform() * 10);
+        device.config.upperThresholdLastModified = wallClockMs();
+        String payload = configBuilder.buildConfigPayload(device.config, true);
+        queueRequest(index, REQ_CONFIG_POST, "POST", API_DEVICE_CONFIG, payload.c_str(), API_RETRY_COUNT);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Device behaviour
+// ----------------------------------------------------------------------------
+
+// main.cpp's "Device transitioned to ONLINE": telemetry in 5 s, control in 10 s
+static void cameOnline(FleetDevice& device, uint64_t t) {
+    device.nextSampleUs = t;
+    device.reporter.scheduleReport(t / 1000, 5000);
+    device.nextControlUs = t + 10000000;
+    device.nextBacklogUs = t + period(device, TELEMETRY_BACKLOG_INTERVAL);
+}
+
+static void dropSession(FleetDevice& device, uint64_t t) {
+    if (device.token.empty()) {
+        return;
+    }
+    device.token.clear();
+    device.nextLoginUs = t;
+}
+
+// Link lost (storm): in-flight requests die with it
+static void linkDown(uint32_t index, uint64_t reconnectUs) {
+    FleetDevice& device = devices[index];
+    device.linkUp = false;
+    device.linkUpAtUs = reconnectUs;
+    device.busy = 0;
+    device.timeSamplesLeft = 0;
+    for (FleetRequest& request : requests) {
+        if (request.device == index) {
+            request.done = true;
+        }
+    }
+    queued.erase(std::remove_if(queued.begin(), queued.end(),
+                                [index](const FleetRequest& request) { return request.device == index; }),
+                 queued.end());
+}
+
+static void tick(uint32_t index, uint64_t t) {
+    FleetDevice& device = devices[index];
+    if (!device.poweredOn) {
+        if (t < device.powerOnUs) {
+            return;
+        }
+        device.poweredOn = true;
+        device.linkUpAtUs = t + FLEET_WIFI_CONNECT_US + (uint64_t)(sim::uniform() * FLEET_WIFI_CONNECT_US);
+        device.nextOtaUs = t + period(device, OTA_CHECK_INTERVAL);
+        device.nextTimeUs = t + period(device, HTTP_TIME_SYNC_INTERVAL);
+        double editsPerDay = sim::options().fleetEditsPerDay;
+        device.nextEditUs = editsPerDay > 0 ? t + (uint64_t)(-log(1 - sim::uniform()) * 86400e6 / editsPerDay)
+                                            : UINT64_MAX;
+    }
+
+    // Reporting goes on while the link is down - into the queue
+    if (t >= device.nextSampleUs) {
+        device.nextSampleUs = t + period(device, FLEET_SAMPLE_INTERVAL);
+        device.level = std::max(0.0f, std::min(100.0f, device.level + (float)(sim::gaussian() * 0.5)));
+        if (device.level < device.config.lowerThreshold) {
+            device.pump = true;
+        } else if (device.level > device.config.upperThreshold) {
+            device.pump = false;
+        }
+        device.level += device.pump ? 0.8f : -0.3f;
+        device.reporter.addSample(device.level, inflowOf(device), device.pump ? 1 : 0);
+    }
+    uint64_t nowMs = t / 1000;
+    if (device.nextSampleUs != UINT64_MAX &&
+        device.reporter.check(nowMs) != TELEMETRY_REPORT_NONE) {
+        device.reporter.markReported(nowMs);
+        if (!device.linkUp || device.token.empty() || (device.busy & (1u << REQ_TELEMETRY))) {
+            queueSamples(device, 1);
+        } else {
+            sendTelemetry(index);
+        }
+    }
+
+    if (!device.linkUp) {
+        if (t < device.linkUpAtUs) {
+            return;
+        }
+        device.linkUp = true;
+        if (device.booted) {
+            cameOnline(device, t);
+        } else if (device.token.empty()) {
+            sendLogin(index);
+        } else {
+            queueRequest(index, REQ_CONFIG_GET, "GET", std::string(API_DEVICE_CONFIG) + deviceQuery(device), "",
+                         API_RETRY_COUNT);
+        }
+        return;
+    }
+
+    if (!device.booted) {
+        return;   // Boot login / config fetch still running
+    }
+
+    bool authenticated = !device.token.empty();
+
+    if (!authenticated && t >= device.nextLoginUs && !(device.busy & (1u << REQ_LOGIN))) {
+        sendLogin(index);
+    }
+
+    if (t >= device.nextControlUs) {
+        device.nextControlUs = t + period(device, CONTROL_FETCH_INTERVAL);
+        if (authenticated && !(device.busy & (1u << REQ_CONTROL_GET))) {
+            queueRequest(index, REQ_CONTROL_GET, "GET", std::string(API_DEVICE_CONTROL) + deviceQuery(device), "",
+                         API_RETRY_COUNT);
+        }
+    }
+
+    if (t >= device.nextOtaUs) {
+        device.nextOtaUs = t + period(device, OTA_CHECK_INTERVAL);
+        if (authenticated && !(device.busy & (1u << REQ_OTA_CHECK))) {
+            sendOtaCheck(index);
+        }
+    }
+
+    if (t >= device.nextTimeUs) {
+        device.nextTimeUs = t + period(device, HTTP_TIME_SYNC_INTERVAL);
+        if (!(device.busy & (1u << REQ_TIME))) {
+            device.timeSamplesLeft = HTTP_TIME_SYNC_SAMPLES;
+            sendTimeSample(index);
+        }
+    }
+
+    if (t >= device.nextEditUs) {
+        double editsPerDay = sim::options().fleetEditsPerDay;
+        device.nextEditUs = t + (uint64_t)(-log(1 - sim::uniform()) * 86400e6 / editsPerDay);
+        if (authenticated) {
+            sendEdit(index);
+        }
+    }
+
+    // Backfill: only when idle and not right before a heartbeat
+    if (device.backlog > 0 && t >= device.nextBacklogUs) {
+        device.nextBacklogUs = t + period(device, TELEMETRY_BACKLOG_INTERVAL);
+        if (authenticated && device.busy == 0 &&
+            device.reporter.sinceLastReport(t / 1000) + TELEMETRY_BACKLOG_LIVE_GUARD <
+                device.reporter.getHeartbeatInterval()) {
+            sendBacklog(index);
+        }
+    }
+}
+
+// An answered (status > 0) or failed (status 0) request
+static void complete(FleetRequest& request, int status, const std::string& body) {
+    KindStats& stats = kindStats[request.kind];
+    uint64_t t = sim::now();
+    stats.requests++;
+    intervalRequests++;
+    if (status == 0) {
+        stats.errors++;
+        intervalErrors++;
+    } else {
+        uint32_t latency = (uint32_t)std::min<uint64_t>(t - request.beganUs, UINT32_MAX);
+        stats.latencyUs.push_back(latency);
+        intervalLatencyUs.push_back(latency);
+        if (status >= 200 && status < 300) {
+            stats.status2xx++;
+        } else if (status >= 400 && status < 500) {
+            stats.status4xx++;
+        } else if (status >= 500) {
+            stats.status5xx++;
+        }
+    }
+
+    FleetDevice& device = devices[request.device];
+    bool ok = status >= 200 && status < 300;
+
+    if (status == 401 && request.kind != REQ_LOGIN) {
+        dropSession(device, t);
+    } else if (!ok && status != 401 && request.attempt < request.retries) {
+        // Same request again after API_RETRY_DELAY_MS x attempt
+        FleetRequest retry = request;
+        retry.startAtUs = t + (uint64_t)API_RETRY_DELAY_MS * 1000 * request.attempt;
+        retry.attempt++;
+        retry.fd = -1;
+        retry.connected = false;
+        retry.done = false;
+        retry.out.clear();
+        retry.in.clear();
+        queued.push_back(retry);
+        return;
+    }
+
+    device.busy &= ~(1u << request.kind);
+
+    switch (request.kind) {
+        case REQ_LOGIN: {
+            StaticJsonDocument<1024> doc;
+            const char* token = nullptr;
+            if (ok && !deserializeJson(doc, body) && (doc["success"] | false)) {
+                token = doc["deviceToken"];
+                if (!token) {
+                    token = doc["token"];
+                }
+            }
+            if (token) {
+                device.token = token;
+                device.reloginBackoffUs = RELOGIN_RETRY_MIN_MS * 1000ULL;
+            } else {
+                device.nextLoginUs = t + device.reloginBackoffUs;
+                device.reloginBackoffUs = std::min<uint64_t>(device.reloginBackoffUs * 2,
+                                                             RELOGIN_RETRY_MAX_MS * 1000ULL);
+            }
+            if (!device.booted) {
+                if (token) {
+                    queueRequest(request.device, REQ_CONFIG_GET, "GET",
+                                 std::string(API_DEVICE_CONFIG) + deviceQuery(device), "", API_RETRY_COUNT);
+                } else {
+                    device.booted = true;   // Local mode, re-login from the loop
+                    cameOnline(device, t);
+                }
+            }
+            break;
+        }
+        case REQ_CONFIG_GET: {
+            // Only the heartbeat matters here; the device merges it like any
+            // other server-delivered field
+            DynamicJsonDocument doc(4096);
+            if (ok && !deserializeJson(doc, body)) {
+                JsonVariant heartbeat = doc["deviceConfig"]["heartbeatSec"];
+                if (heartbeat.isNull()) {
+                    heartbeat = doc["data"]["deviceConfig"]["heartbeatSec"];
+                }
+                float seconds = heartbeat.containsKey("value") ? (heartbeat["value"] | 0.0f) : (heartbeat | 0.0f);
+                device.reporter.setHeartbeatInterval(ConfigDataHandler::heartbeatIntervalMs(seconds));
+            }
+            if (!device.booted) {
+                device.booted = true;
+                cameOnline(device, t);
+            }
+            break;
+        }
+        case REQ_CONTROL_GET: {
+            StaticJsonDocument<1024> doc;
+            if (ok && !deserializeJson(doc, body) && (doc["controlData"]["config_update"]["value"] | false) &&
+                !(device.busy & (1u << REQ_CONFIG_GET))) {
+                queueRequest(request.device, REQ_CONFIG_GET, "GET",
+                             std::string(API_DEVICE_CONFIG) + deviceQuery(device), "", API_RETRY_COUNT);
+            }
+            break;
+        }
+        case REQ_TELEMETRY:
+            if (!ok) {
+                queueSamples(device, 1);
+            }
+            break;
+        case REQ_BACKLOG:
+            if (ok) {
+                uint32_t count = std::min(request.batch, device.backlog);
+                device.backlog -= count;
+                samplesUploaded += count;
+            }
+            break;
+        case REQ_TIME:
+            if (device.timeSamplesLeft > 0) {
+                sendTimeSample(request.device);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Status and body once the response is complete (or the server closed)
+static bool parseResponse(const std::string& in, bool closed, int& status, std::string& body) {
+    size_t headerEnd = in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return false;
+    }
+    size_t space = in.find(' ');
+    status = space < headerEnd ? atoi(in.c_str() + space + 1) : 0;
+
+    long contentLength = -1;
+    bool chunked = false;
+    size_t position = in.find("\r\n") + 2;
+    while (position < headerEnd) {
+        size_t end = in.find("\r\n", position);
+        std::string line = in.substr(position, end - position);
+        position = end + 2;
+        for (char& c : line) {
+            c = (char)tolower((unsigned char)c);
+        }
+        if (line.compare(0, 15, "content-length:") == 0) {
+            contentLength = atol(line.c_str() + 15);
+        } else if (line.compare(0, 18, "transfer-encoding:") == 0 && line.find("chunked") != std::string::npos) {
+            chunked = true;
+        }
+    }
+
+    std::string raw = in.substr(headerEnd + 4);
+    if (contentLength >= 0) {
+        if (raw.size() < (size_t)contentLength) {
+            return false;
+        }
+        body = raw.substr(0, contentLength);
+        return true;
+    }
+    if (chunked) {
+        if (!closed && raw.find("\r\n0\r\n\r\n") == std::string::npos && raw.compare(0, 5, "0\r\n\r\n") != 0) {
+            return false;
+        }
+        body.clear();
+        size_t at = 0;
+        for (;;) {
+            size_t lineEnd = raw.find("\r\n", at);
+            if (lineEnd == std::string::npos) {
+                break;
+            }
+            size_t size = strtoul(raw.c_str() + at, nullptr, 16);
+            if (size == 0 || lineEnd + 2 + size > raw.size()) {
+                break;
+            }
+            body.append(raw, lineEnd + 2, size);
+            at = lineEnd + 2 + size + 2;
+        }
+        return true;
+    }
+    if (!closed) {
+        return false;
+    }
+    body = raw;
+    return true;
+}
+
+static void startRequest(FleetRequest& request) {
+    const FleetDevice& device = devices[request.device];
+    request.beganUs = sim::now();
+    request.fd = socket(targetAddress.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (request.fd < 0 ||
+        (connect(request.fd, (struct sockaddr*)&targetAddress, targetAddressLength) != 0 && errno != EINPROGRESS)) {
+        errorsConnect++;
+        complete(request, 0, "");
+        request.done = true;
+        return;
+    }
+
+    // Headers as HTTPClient sends them
+    request.out = request.method + " " + basePath + request.target + " HTTP/1.1\r\n"
+                  "Host: " + targetHost + "\r\n"
+                  "User-Agent: ESP32HTTPClient\r\n"
+                  "Connection: close\r\n"
+                  "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";
+    if (request.kind != REQ_TIME && request.kind != REQ_OTA_CHECK) {
+        request.out += "Content-Type: application/json\r\n";
+    }
+    if (!device.token.empty() && request.kind != REQ_LOGIN) {
+        request.out += "Authorization: Bearer " + device.token + "\r\n";
+    }
+    if (request.method == "POST") {
+        request.out += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+    }
+    request.out += "\r\n" + request.body;
+}
+
+// Handles poll events; true once the request is finished
+static bool advance(FleetRequest& request, short revents) {
+    if (!request.connected && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(request.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            errorsConnect++;
+            complete(request, 0, "");
+            return true;
+        }
+        request.connected = true;
+    }
+
+    while (request.connected && !request.out.empty()) {
+        ssize_t n = send(request.fd, request.out.data(), request.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            request.out.erase(0, (size_t)n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return false;
+        } else {
+            errorsClosed++;
+            complete(request, 0, "");
+            return true;
+        }
+    }
+
+    if (!request.connected || !(revents & (POLLIN | POLLHUP | POLLERR))) {
+        return false;
+    }
+
+    bool closed = false;
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = recv(request.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            request.in.append(buffer, (size_t)n);
+            if (request.in.size() > FLEET_RESPONSE_MAX) {
+                closed = true;
+                break;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        }
+        closed = true;
+        break;
+    }
+
+    int status;
+    std::string body;
+    if (parseResponse(request.in, closed, status, body)) {
+        complete(request, status, body);
+        return true;
+    }
+    if (closed) {
+        errorsClosed++;   // Reset, or the body ended short of Content-Length
+        complete(request, 0, "");
+        return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// Setup
+// ----------------------------------------------------------------------------
+
+static void resolveTarget(const std::string& url) {
+    String host;
+    uint16_t port;
+    if (url.compare(0, 7, "http://") != 0 || !ServerUrl::parseHostPort(String(url.c_str()), host, port)) {
+        fprintf(stderr, "sim: --target must be http://host[:port][/path] (no TLS)\n");
+        exit(2);
+    }
+    size_t pathStart = url.find('/', 7);
+    basePath = pathStart == std::string::npos ? "" : url.substr(pathStart);
+    while (!basePath.empty() && basePath.back() == '/') {
+        basePath.pop_back();
+    }
+    targetHost = host.c_str();
+    if (port != 80) {
+        targetHost += ":" + std::to_string(port);
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    int error = getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
+    if (error != 0 || result == nullptr) {
+        fprintf(stderr, "sim: cannot resolve %s: %s\n", host.c_str(), gai_strerror(error));
+        exit(2);
+    }
+    memcpy(&targetAddress, result->ai_addr, result->ai_addrlen);
+    targetAddressLength = result->ai_addrlen;
+    freeaddrinfo(result);
+}
+
+static void createDevices() {
+    const sim::Options& opts = sim::options();
+    std::vector<std::pair<std::string, std::string>> ids;
+
+    if (!opts.fleetDevices.empty()) {
+        std::ifstream file(opts.fleetDevices);
+        if (!file) {
+            fprintf(stderr, "sim: cannot read %s\n", opts.fleetDevices.c_str());
+            exit(2);
+        }
+        std::string line;
+        while (std::getline(file, line) && ids.size() < opts.fleetSize) {
+            char deviceId[128], hardwareId[128];
+            int fields = sscanf(line.c_str(), "%127s %127s", deviceId, hardwareId);
+            if (fields < 1 || deviceId[0] == '#') {
+                continue;
+            }
+            ids.push_back({ deviceId, fields == 2 ? hardwareId : "" });
+        }
+        if (ids.size() < opts.fleetSize) {
+            fprintf(stderr, "sim: %s lists %zu devices, --fleet wants %u\n", opts.fleetDevices.c_str(),
+                    ids.size(), opts.fleetSize);
+            exit(2);
+        }
+    }
+
+    devices.resize(opts.fleetSize);
+    for (uint32_t i = 0; i < opts.fleetSize; i++) {
+        FleetDevice& device = devices[i];
+        char generated[48];
+        if (ids.empty()) {
+            snprintf(generated, sizeof(generated), "%s-SIM-%05u", PROJECT_ID, i + 1);
+            device.deviceId = generated;
+        } else {
+            device.deviceId = ids[i].first;
+        }
+        if (ids.empty() || ids[i].second.empty()) {
+            snprintf(generated, sizeof(generated), "FLEET%06X", i + 1);
+            device.hardwareId = generated;
+        } else {
+            device.hardwareId = ids[i].second;
+        }
+        device.rate = 1 + sim::gaussian() * FLEET_DRIFT_PPM * 1e-6;
+        device.poweredOn = false;
+        device.linkUp = false;
+        device.booted = false;
+        device.powerOnUs = (uint64_t)(sim::uniform() * opts.fleetRampUs);
+        device.linkUpAtUs = UINT64_MAX;
+        device.nextSampleUs = UINT64_MAX;
+        device.nextControlUs = UINT64_MAX;
+        device.nextOtaUs = UINT64_MAX;
+        device.nextTimeUs = UINT64_MAX;
+        device.nextBacklogUs = UINT64_MAX;
+        device.nextLoginUs = UINT64_MAX;
+        device.nextEditUs = UINT64_MAX;
+        device.reloginBackoffUs = RELOGIN_RETRY_MIN_MS * 1000ULL;
+        device.busy = 0;
+        device.backlog = 0;
+        device.timeSamplesLeft = 0;
+        device.level = (float)(30 + sim::uniform() * 50);
+        device.pump = false;
+        device.config.upperThreshold = DEFAULT_UPPER_THRESHOLD;
+        device.config.lowerThreshold = DEFAULT_LOWER_THRESHOLD;
+        device.config.tankHeight = DEFAULT_TANK_HEIGHT;
+        device.config.tankWidth = DEFAULT_TANK_WIDTH;
+        device.config.tankShape = "Cylindrical";
+    }
+}
+
+// One descriptor per in-flight request
+static void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Reporting
+// ----------------------------------------------------------------------------
+
+// Nearest-rank percentile of sorted samples, in ms
+static double percentileMs(const std::vector<uint32_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)ceil(q * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)] / 1000.0;
+}
+
+static void printProgress(uint64_t intervalUs) {
+    uint32_t online = 0;
+    for (const FleetDevice& device : devices) {
+        if (device.linkUp && !device.token.empty()) {
+            online++;
+        }
+    }
+    size_t inFlight = 0;
+    for (const FleetRequest& request : requests) {
+        if (request.fd >= 0) {
+            inFlight++;
+        }
+    }
+    std::sort(intervalLatencyUs.begin(), intervalLatencyUs.end());
+    sim::log("Fleet: %u/%zu online, %zu in flight, %.1f req/s, p50 %.1f ms, p99 %.1f ms, %llu errors",
+             online, devices.size(), inFlight, intervalRequests * 1e6 / std::max<uint64_t>(intervalUs, 1),
+             percentileMs(intervalLatencyUs, 0.5), percentileMs(intervalLatencyUs, 0.99),
+             (unsigned long long)intervalErrors);
+    intervalRequests = 0;
+    intervalErrors = 0;
+    intervalLatencyUs.clear();
+}
+
+static void printFleetSummary() {
+    double seconds = std::max<double>(sim::now() / 1e6, 1e-3);
+    fprintf(stdout,
+            "\n"
+            "=== Fleet summary (%zu devices, %s) ===\n"
+            "%-14s %9s %8s %8s %7s %7s %7s %8s %8s %8s %8s\n",
+            devices.size(), sim::formatWorld(sim::now()).c_str(),
+            "Request", "Count", "Rate/s", "2xx", "4xx", "5xx", "Errors", "p50 ms", "p90 ms", "p99 ms", "Max ms");
+
+    KindStats total = KindStats();
+    for (int kind = 0; kind < REQ_KINDS; kind++) {
+        KindStats& stats = kindStats[kind];
+        std::sort(stats.latencyUs.begin(), stats.latencyUs.end());
+        total.requests += stats.requests;
+        total.status2xx += stats.status2xx;
+        total.status4xx += stats.status4xx;
+        total.status5xx += stats.status5xx;
+        total.errors += stats.errors;
+        total.latencyUs.insert(total.latencyUs.end(), stats.latencyUs.begin(), stats.latencyUs.end());
+    }
+    std::sort(total.latencyUs.begin(), total.latencyUs.end());
+
+    for (int kind = 0; kind <= REQ_KINDS; kind++) {
+        const KindStats& stats = kind < REQ_KINDS ? kindStats[kind] : total;
+        if (stats.requests == 0 && kind < REQ_KINDS) {
+            continue;
+        }
+        fprintf(stdout, "%-14s %9llu %8.2f %8llu %7llu %7llu %7llu %8.1f %8.1f %8.1f %8.1f\n",
+                kind < REQ_KINDS ? kindNames[kind] : "total",
+                (unsigned long long)stats.requests, stats.requests / seconds,
+                (unsigned long long)stats.status2xx, (unsigned long long)stats.status4xx,
+                (unsigned long long)stats.status5xx, (unsigned long long)stats.errors,
+                percentileMs(stats.latencyUs, 0.5), percentileMs(stats.latencyUs, 0.9),
+                percentileMs(stats.latencyUs, 0.99),
+                stats.latencyUs.empty() ? 0.0 : stats.latencyUs.back() / 1000.0);
+    }
+
+    uint64_t backlog = 0;
+    for (const FleetDevice& device : devices) {
+        backlog += device.backlog;
+    }
+    fprintf(stdout,
+            "\n"
+            "Errors:          %llu connect, %llu timeout, %llu closed early\n"
+            "Peak in flight:  %zu\n"
+            "Backlog:         %llu samples queued, %llu uploaded, %llu dropped, %llu left\n",
+            (unsigned long long)errorsConnect, (unsigned long long)errorsTimeout,
+            (unsigned long long)errorsClosed, peakInFlight,
+            (unsigned long long)samplesQueued, (unsigned long long)samplesUploaded,
+            (unsigned long long)samplesDropped, (unsigned long long)backlog);
+    fflush(stdout);
+}
+
+namespace sim {
+
+void runFleet() {
+    Options& opts = options();
+    resolveTarget(opts.fleetTarget);
+    createDevices();
+    raiseFileLimit();
+
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGTERM, [](int) { stopRequested = 1; });
+    signal(SIGPIPE, SIG_IGN);
+
+    startRealUs = realUs();
+    log("Fleet of %zu devices against %s for %s (boots over %s)", devices.size(), opts.fleetTarget.c_str(),
+        formatWorld(opts.durationUs).c_str(), formatWorld(opts.fleetRampUs).c_str());
+
+    std::vector<bool> stormStarted(opts.fleetStorms.size(), false);
+    uint64_t lastReportUs = 0;
+
+    while (!stopRequested && now() < opts.durationUs) {
+        setClock(realUs() - startRealUs);
+        uint64_t t = now();
+
+        for (size_t i = 0; i < opts.fleetStorms.size(); i++) {
+            const Fault& storm = opts.fleetStorms[i];
+            if (stormStarted[i] || t < storm.window.startUs) {
+                continue;
+            }
+            stormStarted[i] = true;
+            uint64_t endUs = storm.window.startUs + storm.window.durationUs;
+            uint32_t affected = 0;
+            for (uint32_t index = 0; index < devices.size(); index++) {
+                if (devices[index].poweredOn && uniform() * 100 < storm.value) {
+                    linkDown(index, endUs + (uint64_t)(uniform() * FLEET_RECONNECT_SPREAD_US));
+                    affected++;
+                }
+            }
+            log("Storm: %u devices lose the link for %s", affected, formatWorld(storm.window.durationUs).c_str());
+        }
+
+        for (uint32_t index = 0; index < devices.size(); index++) {
+            tick(index, t);
+        }
+
+        // Start what is due
+        requests.insert(requests.end(), queued.begin(), queued.end());
+        queued.clear();
+        for (FleetRequest& request : requests) {
+            if (!request.done && request.fd < 0 && request.startAtUs <= t) {
+                startRequest(request);
+            }
+        }
+
+        std::vector<struct pollfd> fds;
+        std::vector<size_t> owners;
+        for (size_t i = 0; i < requests.size(); i++) {
+            const FleetRequest& request = requests[i];
+            if (request.done || request.fd < 0) {
+                continue;
+            }
+            short events = request.connected && request.out.empty() ? POLLIN : POLLOUT;
+            fds.push_back({ request.fd, events, 0 });
+            owners.push_back(i);
+        }
+        peakInFlight = std::max(peakInFlight, fds.size());
+
+        if (poll(fds.data(), fds.size(), FLEET_POLL_MS) < 0 && errno != EINTR) {
+            break;
+        }
+        setClock(realUs() - startRealUs);
+        t = now();
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            FleetRequest& request = requests[owners[i]];
+            if (request.done) {
+                continue;   // Link dropped by a storm this pass
+            }
+            if (fds[i].revents != 0 && advance(request, fds[i].revents)) {
+                request.done = true;
+            } else if (t - request.beganUs > HTTP_TIMEOUT * 1000ULL) {
+                errorsTimeout++;
+                complete(request, 0, "");
+                request.done = true;
+            }
+        }
+
+        std::vector<FleetRequest> open;
+        open.reserve(requests.size());
+        for (FleetRequest& request : requests) {
+            if (request.done) {
+                if (request.fd >= 0) {
+                    close(request.fd);
+                }
+            } else {
+                open.push_back(std::move(request));
+            }
+        }
+        requests.swap(open);
+
+        if (t - lastReportUs >= opts.fleetReportUs) {
+            printProgress(t - lastReportUs);
+            lastReportUs = t;
+        }
+    }
+
+    for (const FleetRequest& request : requests) {
+        if (request.fd >= 0) {
+            close(request.fd);
+        }
+    }
+
+    log("Fleet stopped");
+    printFleetSummary();
+    exit(0);
+}
+
+} // namespace sim
@@ -0,0 +1,814 @@
+#include <Arduino.h>
+#include "config.h"
+#include "sim.h"
+
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <map>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// SIMULATOR ENTRY POINT
+// ============================================================================
+// Parses the scenario from the command line, restores the state of the
+// previous boot (if this process was re-executed by a reboot) and hands
+// over to the scheduler, which runs setup()/loop() until the world clock
+// reaches --duration. Same arguments + same seed = same run.
+
+#define SIM_DEFAULT_STATE_DIR ".sim-state"
+#define SIM_DEFAULT_EPOCH_MS 1767225600000ULL   // 2026-01-01 00:00:00 UTC
+#define SIM_BOOT_TIME_US 800000ULL              // Power-on to setup() after a reset
+#define SIM_DEFAULT_HOLD_US 200000ULL
+#define SIM_DEFAULT_FLEET_DURATION_US (5ULL * 60 * 1000000)
+
+static sim::Options opts;
+static sim::Stats runStats;
+static uint64_t bootWorldUs = 0;       // World time at which this boot started
+static uint64_t nextBootWorldUs = 0;   // Set by restart() for the saved state
+static uint64_t rngState = 0;
+static char** savedArgv = nullptr;
+
+struct StateSection {
+    std::string name;
+    sim::StateSaver saver;
+    sim::StateLoader loader;
+};
+
+static std::vector<StateSection> sections;
+
+namespace sim {
+
+Options& options() {
+    return opts;
+}
+
+Stats& stats() {
+    return runStats;
+}
+
+// ----------------------------------------------------------------------------
+// Clocks
+// ----------------------------------------------------------------------------
+
+static double rateFactor() {
+    return 1.0 + opts.driftPpm / 1e6;
+}
+
+uint64_t worldUs() {
+    return bootWorldUs + (uint64_t)floor((double)now() / rateFactor());
+}
+
+uint64_t wallMs() {
+    return opts.startEpochMs + worldUs() / 1000;
+}
+
+// Rounded up so worldUs() at that device instant is never before 'world'
+uint64_t toDeviceUs(uint64_t world) {
+    if (world <= bootWorldUs) {
+        return 0;
+    }
+    return (uint64_t)ceil((double)(world - bootWorldUs) * rateFactor());
+}
+
+uint32_t bootCount() {
+    return runStats.boots;
+}
+
+// ----------------------------------------------------------------------------
+// Randomness (splitmix64)
+// ----------------------------------------------------------------------------
+
+uint64_t random() {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double uniform() {
+    return (double)(random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double gaussian() {
+    double u1 = uniform();
+    double u2 = uniform();
+    if (u1 < 1e-300) {
+        u1 = 1e-300;
+    }
+    return sqrt(-2.0 * std::log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// ----------------------------------------------------------------------------
+// Logging
+// ----------------------------------------------------------------------------
+
+void log(const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    fprintf(stdout, "[%s] [SIM] %s\n", formatWorld(worldUs()).c_str(), buffer);
+    fflush(stdout);
+}
+
+std::string formatWorld(uint64_t us) {
+    uint64_t ms = us / 1000;
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%llu+%02u:%02u:%02u.%03u",
+             (unsigned long long)(ms / 86400000),
+             (unsigned)(ms / 3600000 % 24), (unsigned)(ms / 60000 % 60),
+             (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+    return buffer;
+}
+
+// ----------------------------------------------------------------------------
+// Persistent state
+// ----------------------------------------------------------------------------
+// One text file: "[section]" headers followed by "key=value" lines. Keys
+// never contain '=', values are single-line (JSON text or hex).
+
+static std::string statePath() {
+    return opts.stateDir + "/state.txt";
+}
+
+void registerState(const char* section, StateSaver saver, StateLoader loader) {
+    sections.push_back({ section, std::move(saver), std::move(loader) });
+}
+
+void saveState() {
+    std::string path = statePath();
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "sim: cannot write %s: %s\n", temp.c_str(), strerror(errno));
+        exit(2);
+    }
+    for (const StateSection& section : sections) {
+        std::vector<std::pair<std::string, std::string>> entries;
+        section.saver(entries);
+        fprintf(file, "[%s]\n", section.name.c_str());
+        for (const auto& entry : entries) {
+            fprintf(file, "%s=%s\n", entry.first.c_str(), entry.second.c_str());
+        }
+    }
+    fclose(file);
+    rename(temp.c_str(), path.c_str());
+}
+
+void loadState() {
+    FILE* file = fopen(statePath().c_str(), "r");
+    if (file == nullptr) {
+        fprintf(stderr, "sim: no saved state in %s\n", opts.stateDir.c_str());
+        exit(2);
+    }
+
+    const StateSection* section = nullptr;
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        std::string text(line, line[length - 1] == '\n' ? length - 1 : length);
+        if (text.size() >= 2 && text.front() == '[' && text.back() == ']') {
+            std::string name = text.substr(1, text.size() - 2);
+            section = nullptr;
+            for (const StateSection& candidate : sections) {
+                if (candidate.name == name) {
+                    section = &candidate;
+                }
+            }
+            continue;
+        }
+        size_t equals = text.find('=');
+        if (section != nullptr && equals != std::string::npos) {
+            section->loader(text.substr(0, equals), text.substr(equals + 1));
+        }
+    }
+    free(line);
+    fclose(file);
+}
+
+std::string toHex(const void* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::string hex;
+    hex.reserve(length * 2);
+    for (size_t i = 0; i < length; i++) {
+        hex += digits[bytes[i] >> 4];
+        hex += digits[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+std::vector<uint8_t> fromHex(const std::string& hex) {
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = (uint8_t)strtoul(hex.substr(i * 2, 2).c_str(), nullptr, 16);
+    }
+    return bytes;
+}
+
+// ----------------------------------------------------------------------------
+// Reboot / end of run
+// ----------------------------------------------------------------------------
+
+// The next boot starts after the reset + ROM boot time; re-executing gives
+// the firmware fresh globals, statics and tasks
+void restart(const char* reason) {
+    log("Reboot (%s) after %s of uptime", reason, formatWorld(worldUs() - bootWorldUs).c_str());
+    // Savers still see the clock at the reset; only the saved boot time moves
+    nextBootWorldUs = worldUs() + SIM_BOOT_TIME_US;
+    saveState();
+    fflush(stdout);
+
+    std::vector<char*> args;
+    for (char** arg = savedArgv; *arg != nullptr; arg++) {
+        if (strcmp(*arg, "--resume") != 0) {
+            args.push_back(*arg);
+        }
+    }
+    args.push_back(const_cast<char*>("--resume"));
+    args.push_back(nullptr);
+    execv("/proc/self/exe", args.data());
+
+    fprintf(stderr, "sim: re-exec failed: %s\n", strerror(errno));
+    exit(2);
+}
+
+void finish() {
+    log("End of simulation");
+    saveState();
+    printSummary();
+    printScore();
+    if (!opts.scoreFile.empty()) {
+        writeScore(opts.scoreFile);
+    }
+    fflush(stdout);
+    exit(0);
+}
+
+void printSummary() {
+    const Stats& s = runStats;
+    uint64_t pumpUs = s.pumpOnUs;
+    fprintf(stdout,
+            "\n"
+            "=== Simulation summary (seed %llu, %s) ===\n"
+            "Boots:           %u (%u firmware restarts, %u power cycles)\n"
+            "Firmware:        %s\n"
+            "HTTP:            %llu requests, %llu failures\n"
+            "Logins:          %u\n"
+            "Config:          %u fetches, %u uploads\n"
+            "Control:         %u fetches, %u uploads\n"
+            "Telemetry:       %llu live, %llu from backlog\n"
+            "Time:            %u NTP syncs, %u HTTP syncs\n"
+            "OTA:             %u checks, %u downloads, %u installs\n"
+            "ML model:        %u checks, %u downloads, %llu uploads with model output\n"
+            "Leak alarms:     %u raised, %u cleared\n"
+            "Faults:          %u 5xx, %u truncated, %u slowed, %u unauthorized\n"
+            "WiFi:            %u connects, %u drops\n"
+            "Buttons:         %u presses\n"
+            "Pump:            %u starts, on for %s\n"
+            "Tank level:      %.1f%%\n",
+            (unsigned long long)opts.seed, formatWorld(opts.durationUs).c_str(),
+            s.boots, s.restarts, s.powerCycles,
+            runningFirmwareVersion().c_str(),
+            (unsigned long long)s.httpRequests, (unsigned long long)s.httpFailures,
+            s.logins,
+            s.configFetches, s.configUploads,
+            s.controlFetches, s.controlUploads,
+            (unsigned long long)s.telemetry, (unsigned long long)s.telemetryBatched,
+            s.ntpSyncs, s.timeSyncs,
+            s.otaChecks, s.otaDownloads, s.otaInstalls,
+            s.mlChecks, s.mlDownloads, (unsigned long long)s.mlTelemetry,
+            s.leakAlarms, s.leakClears,
+            s.faultErrors, s.faultTruncations, s.faultSlow, s.unauthorized,
+            s.wifiConnects, s.wifiDrops,
+            s.buttonPresses,
+            s.pumpSwitches, formatWorld(pumpUs).c_str(),
+            waterLevelPercent());
+}
+
+} // namespace sim
+
+// ============================================================================
+// RUN STATE ("sim" section)
+// ============================================================================
+
+#define STAT_FIELDS(X) \
+    X(boots) X(restarts) X(powerCycles) X(httpRequests) X(httpFailures) \
+    X(logins) X(configFetches) X(configUploads) X(controlFetches) \
+    X(controlUploads) X(telemetry) X(telemetryBatched) X(timeSyncs) \
+    X(ntpSyncs) X(otaChecks) X(otaDownloads) X(otaInstalls) X(mlChecks) \
+    X(mlDownloads) X(mlTelemetry) X(leakAlarms) X(leakClears) X(wifiConnects) X(wifiDrops) X(buttonPresses) \
+    X(pumpSwitches) X(pumpOnUs) X(faultErrors) X(faultTruncations) X(faultSlow) \
+    X(unauthorized)
+
+static void registerRunState() {
+    sim::registerState("sim",
+        [](std::vector<std::pair<std::string, std::string>>& out) {
+            out.push_back({ "bootWorldUs", std::to_string(nextBootWorldUs != 0 ? nextBootWorldUs : bootWorldUs) });
+#define SAVE_STAT(name) out.push_back({ #name, std::to_string(runStats.name) });
+            STAT_FIELDS(SAVE_STAT)
+#undef SAVE_STAT
+        },
+        [](const std::string& key, const std::string& value) {
+            if (key == "bootWorldUs") {
+                bootWorldUs = strtoull(value.c_str(), nullptr, 10);
+            }
+#define LOAD_STAT(name) \
+            else if (key == #name) { runStats.name = (decltype(runStats.name))strtoull(value.c_str(), nullptr, 10); }
+            STAT_FIELDS(LOAD_STAT)
+#undef LOAD_STAT
+        });
+}
+
+// ============================================================================
+// COMMAND LINE
+// ============================================================================
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "\n"
+        "Run:\n"
+        "  --seed N                 Random seed (default 1)\n"
+        "  --duration T             World time to simulate (default 1d)\n"
+        "  --state-dir DIR          NVS/LittleFS/backend state (default " SIM_DEFAULT_STATE_DIR ")\n"
+        "  --quiet                  Only simulator events and the summary\n"
+        "\n"
+        "Device:\n"
+        "  --start-epoch MS         Wall clock at start, Unix ms (default 2026-01-01)\n"
+        "  --millis-offset MS       millis() at boot; -T starts T before the 32-bit wrap\n"
+        "  --drift-ppm PPM          Oscillator error, + = fast (default 0)\n"
+        "  --reboot-every T         Power cycle interval\n"
+        "  --level PERCENT          Initial tank level (default 50)\n"
+        "\n"
+        "Network:\n"
+        "  --unprovisioned          Start without WiFi/dashboard credentials\n"
+        "  --ssid S / --password P  Access point (default SimNet / simpass123)\n"
+        "  --rssi DBM               Mean signal (default -60)\n"
+        "  --no-ntp                 SNTP unreachable\n"
+        "  --latency MS             Backend round trip median (default 80)\n"
+        "  --wifi-outage T+D        Access point gone at T for D (repeatable)\n"
+        "  --backend-outage T+D     Backend down at T for D (repeatable)\n"
+        "  --dash-user U / --dash-pass P  Dashboard login (default admin / admin123)\n"
+        "\n"
+        "Backend faults (repeatable, T+D = from T for D):\n"
+        "  --slow T+D:MS            Answers take MS longer\n"
+        "  --http-errors T+D[:PCT]  PCT%% of requests get a 5xx (default 100)\n"
+        "  --truncate T+D[:PCT]     PCT%% of bodies are cut short (default 100)\n"
+        "  --token-lifetime T       Device token validity (default 7d)\n"
+        "  --revoke-tokens T        Invalidate every token issued before T\n"
+        "  --heartbeat-sec N        Device config delivers heartbeatSec N (default: not sent)\n"
+        "  --serve PORT             Serve the backend over HTTP in real time for a\n"
+        "                           real device (faults apply; no firmware runs)\n"
+        "\n"
+        "Fleet load generator (real time, --duration defaults to 5m):\n"
+        "  --fleet N                Run N devices against --target instead of the simulation\n"
+        "  --target URL             Backend base URL, http only (default SERVER_URL)\n"
+        "  --devices FILE           Device ids, one \"deviceId [hardwareId]\" per line\n"
+        "  --ramp T                 Boots spread over T (default 30s)\n"
+        "  --storm T+D[:PCT]        PCT%% of devices lose the link at T for D (default 100)\n"
+        "  --edits-per-day X        Local pump/threshold changes per device (default 2)\n"
+        "  --report-every T         Progress line interval (default 10s)\n"
+        "\n"
+        "Scenario:\n"
+        "  --press B@T[:HOLD]       Press button B (1-6) at T (repeatable)\n"
+        "  --ota VERSION@T          Publish firmware VERSION at T\n"
+        "  --ota-size BYTES         Published image size (default 1048576)\n"
+        "  --ml-model VERSION@T     Publish the demo ML model (level forecast) at T\n"
+        "\n"
+        "Plant:\n"
+        "  --tank-height CM         Tank height (default 100)\n"
+        "  --tank-width CM          Diameter or side (default 50)\n"
+        "  --tank-shape S           Cylindrical or Rectangular (default Cylindrical)\n"
+        "  --upper PERCENT          Upper threshold (default 85)\n"
+        "  --lower PERCENT          Lower threshold (default 20)\n"
+        "  --pump-lpm L             Nominal pump flow, L/min (default 20)\n"
+        "  --demand-scale X         Draw event rate multiplier (default 1)\n"
+        "  --leak-lph L[@T]         Constant leak, L/h, starting at T (default 0)\n"
+        "  --sensor-noise CM        Ultrasonic noise sigma (default 0.3)\n"
+        "  --score FILE             Write the control score as JSON\n"
+        "\n"
+        "Times: 1500ms, 30s, 5m, 2h, 7d or a combination (1d12h).\n",
+        program);
+    exit(2);
+}
+
+// "1d12h30m", "1500ms", "45" (seconds)
+static bool parseDuration(const char* text, uint64_t& us) {
+    us = 0;
+    const char* p = text;
+    if (*p == '\0') {
+        return false;
+    }
+    while (*p != '\0') {
+        char* end;
+        double value = strtod(p, &end);
+        if (end == p || value < 0) {
+            return false;
+        }
+        p = end;
+        double unit = 1e6;
+        if (strncmp(p, "ms", 2) == 0) {
+            unit = 1e3;
+            p += 2;
+        } else if (*p == 's') {
+            p++;
+        } else if (*p == 'm') {
+            unit = 60e6;
+            p++;
+        } else if (*p == 'h') {
+            unit = 3600e6;
+            p++;
+        } else if (*p == 'd') {
+            unit = 86400e6;
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+        us += (uint64_t)llround(value * unit);
+    }
+    return true;
+}
+
+static bool parseWindow(const char* text, sim::Window& window) {
+    const char* plus = strchr(text, '+');
+    if (plus == nullptr) {
+        return false;
+    }
+    std::string start(text, plus - text);
+    return parseDuration(start.c_str(), window.startUs) && parseDuration(plus + 1, window.durationUs);
+}
+
+// T+D[:VALUE] - value defaults to 'fallback' (0 = required)
+static bool parseFault(const char* text, sim::Fault& fault, uint32_t fallback, uint32_t max) {
+    std::string window(text);
+    fault.value = fallback;
+    size_t colon = window.find(':');
+    if (colon != std::string::npos) {
+        char* end;
+        unsigned long value = strtoul(window.c_str() + colon + 1, &end, 10);
+        if (*end != '\0' || value == 0 || value > max) {
+            return false;
+        }
+        fault.value = (uint32_t)value;
+        window.resize(colon);
+    }
+    return fault.value > 0 && parseWindow(window.c_str(), fault.window);
+}
+
+static bool parsePress(const char* text, sim::ButtonPress& press) {
+    const char* at = strchr(text, '@');
+    if (at == nullptr) {
+        return false;
+    }
+    press.button = (uint8_t)atoi(text);
+    press.holdUs = SIM_DEFAULT_HOLD_US;
+    std::string when(at + 1);
+    size_t colon = when.find(':');
+    if (colon != std::string::npos) {
+        if (!parseDuration(when.c_str() + colon + 1, press.holdUs)) {
+            return false;
+        }
+        when.resize(colon);
+    }
+    return press.button >= 1 && press.button <= 6 && parseDuration(when.c_str(), press.atUs);
+}
+
+static void parseOptions(int argc, char** argv) {
+    opts.seed = 1;
+    opts.durationUs = 86400ULL * 1000000;
+    opts.stateDir = SIM_DEFAULT_STATE_DIR;
+    opts.quiet = false;
+    opts.resume = false;
+    opts.startEpochMs = SIM_DEFAULT_EPOCH_MS;
+    opts.millisOffset = 0;
+    opts.driftPpm = 0;
+    opts.rebootEveryUs = 0;
+    opts.provisioned = true;
+    opts.ssid = "SimNet";
+    opts.password = "simpass123";
+    opts.rssi = -60;
+    opts.dashUser = "admin";
+    opts.dashPass = "admin123";
+    opts.ntp = true;
+    opts.latencyMs = 80;
+    opts.tokenLifetimeUs = 7ULL * 86400 * 1000000;
+    opts.heartbeatSec = 0;
+    opts.servePort = 0;
+    opts.fleetSize = 0;
+    opts.fleetTarget = SERVER_URL;
+    opts.fleetRampUs = 30ULL * 1000000;
+    opts.fleetEditsPerDay = 2;
+    opts.fleetReportUs = 10ULL * 1000000;
+    opts.otaAtUs = 0;
+    opts.otaSize = 1048576;
+    opts.mlModelAtUs = 0;
+    opts.levelPercent = 50;
+    opts.tankHeight = DEFAULT_TANK_HEIGHT;
+    opts.tankWidth = DEFAULT_TANK_WIDTH;
+    opts.tankShape = "Cylindrical";
+    opts.upperThreshold = DEFAULT_UPPER_THRESHOLD;
+    opts.lowerThreshold = DEFAULT_LOWER_THRESHOLD;
+    opts.pumpLpm = 20;
+    opts.demandScale = 1;
+    opts.leakLph = 0;
+    opts.leakAtUs = 0;
+    opts.sensorNoiseCm = 0.3;
+
+    enum {
+        OPT_SEED = 256, OPT_DURATION, OPT_STATE_DIR, OPT_QUIET, OPT_RESUME,
+        OPT_START_EPOCH, OPT_MILLIS_OFFSET, OPT_DRIFT, OPT_REBOOT_EVERY, OPT_LEVEL,
+        OPT_UNPROVISIONED, OPT_SSID, OPT_PASSWORD, OPT_RSSI, OPT_NO_NTP, OPT_LATENCY,
+        OPT_WIFI_OUTAGE, OPT_BACKEND_OUTAGE, OPT_SLOW, OPT_HTTP_ERRORS, OPT_TRUNCATE,
+        OPT_TOKEN_LIFETIME, OPT_REVOKE_TOKENS, OPT_DASH_USER, OPT_DASH_PASS, OPT_SERVE,
+        OPT_HEARTBEAT,
+        OPT_FLEET, OPT_TARGET, OPT_DEVICES, OPT_RAMP, OPT_STORM, OPT_EDITS_PER_DAY, OPT_REPORT_EVERY,
+        OPT_PRESS, OPT_OTA, OPT_OTA_SIZE, OPT_ML_MODEL,
+        OPT_TANK_HEIGHT, OPT_TANK_WIDTH, OPT_TANK_SHAPE, OPT_UPPER, OPT_LOWER, OPT_PUMP_LPM,
+        OPT_DEMAND_SCALE, OPT_LEAK_LPH, OPT_SENSOR_NOISE, OPT_SCORE, OPT_HELP
+    };
+    static const struct option longOptions[] = {
+        { "seed", required_argument, nullptr, OPT_SEED },
+        { "duration", required_argument, nullptr, OPT_DURATION },
+        { "state-dir", required_argument, nullptr, OPT_STATE_DIR },
+        { "quiet", no_argument, nullptr, OPT_QUIET },
+        { "resume", no_argument, nullptr, OPT_RESUME },
+        { "start-epoch", required_argument, nullptr, OPT_START_EPOCH },
+        { "millis-offset", required_argument, nullptr, OPT_MILLIS_OFFSET },
+        { "drift-ppm", required_argument, nullptr, OPT_DRIFT },
+        { "reboot-every", required_argument, nullptr, OPT_REBOOT_EVERY },
+        { "level", required_argument, nullptr, OPT_LEVEL },
+        { "unprovisioned", no_argument, nullptr, OPT_UNPROVISIONED },
+        { "ssid", required_argument, nullptr, OPT_SSID },
+        { "password", required_argument, nullptr, OPT_PASSWORD },
+        { "rssi", required_argument, nullptr, OPT_RSSI },
+        { "no-ntp", no_argument, nullptr, OPT_NO_NTP },
+        { "latency", required_argument, nullptr, OPT_LATENCY },
+        { "wifi-outage", required_argument, nullptr, OPT_WIFI_OUTAGE },
+        { "backend-outage", required_argument, nullptr, OPT_BACKEND_OUTAGE },
+        { "slow", required_argument, nullptr, OPT_SLOW },
+        { "http-errors", required_argument, nullptr, OPT_HTTP_ERRORS },
+        { "truncate", required_argument, nullptr, OPT_TRUNCATE },
+        { "token-lifetime", required_argument, nullptr, OPT_TOKEN_LIFETIME },
+        { "revoke-tokens", required_argument, nullptr, OPT_REVOKE_TOKENS },
+        { "heartbeat-sec", required_argument, nullptr, OPT_HEARTBEAT },
+        { "dash-user", required_argument, nullptr, OPT_DASH_USER },
+        { "dash-pass", required_argument, nullptr, OPT_DASH_PASS },
+        { "serve", required_argument, nullptr, OPT_SERVE },
+        { "fleet", required_argument, nullptr, OPT_FLEET },
+        { "target", required_argument, nullptr, OPT_TARGET },
+        { "devices", required_argument, nullptr, OPT_DEVICES },
+        { "ramp", required_argument, nullptr, OPT_RAMP },
+        { "storm", required_argument, nullptr, OPT_STORM },
+        { "edits-per-day", required_argument, nullptr, OPT_EDITS_PER_DAY },
+        { "report-every", required_argument, nullptr, OPT_REPORT_EVERY },
+        { "press", required_argument, nullptr, OPT_PRESS },
+        { "ota", required_argument, nullptr, OPT_OTA },
+        { "ota-size", required_argument, nullptr, OPT_OTA_SIZE },
+        { "ml-model", required_argument, nullptr, OPT_ML_MODEL },
+        { "tank-height", required_argument, nullptr, OPT_TANK_HEIGHT },
+        { "tank-width", required_argument, nullptr, OPT_TANK_WIDTH },
+        { "tank-shape", required_argument, nullptr, OPT_TANK_SHAPE },
+        { "upper", required_argument, nullptr, OPT_UPPER },
+        { "lower", required_argument, nullptr, OPT_LOWER },
+        { "pump-lpm", required_argument, nullptr, OPT_PUMP_LPM },
+        { "demand-scale", required_argument, nullptr, OPT_DEMAND_SCALE },
+        { "leak-lph", required_argument, nullptr, OPT_LEAK_LPH },
+        { "sensor-noise", required_argument, nullptr, OPT_SENSOR_NOISE },
+        { "score", required_argument, nullptr, OPT_SCORE },
+        { "help", no_argument, nullptr, OPT_HELP },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    bool durationGiven = false;
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        bool ok = true;
+        switch (option) {
+            case OPT_SEED:          opts.seed = strtoull(optarg, nullptr, 0); break;
+            case OPT_DURATION:      ok = parseDuration(optarg, opts.durationUs); durationGiven = true; break;
+            case OPT_STATE_DIR:     opts.stateDir = optarg; break;
+            case OPT_QUIET:         opts.quiet = true; break;
+            case OPT_RESUME:        opts.resume = true; break;
+            case OPT_START_EPOCH:   opts.startEpochMs = strtoull(optarg, nullptr, 10); break;
+            case OPT_MILLIS_OFFSET: {
+                if (optarg[0] == '-') {
+                    uint64_t beforeWrap;
+                    ok = parseDuration(optarg + 1, beforeWrap) && beforeWrap / 1000 <= UINT32_MAX;
+                    opts.millisOffset = (uint32_t)(0x100000000ULL - beforeWrap / 1000);
+                } else {
+                    opts.millisOffset = (uint32_t)strtoul(optarg, nullptr, 10);
+                }
+                break;
+            }
+            case OPT_DRIFT:         opts.driftPpm = strtod(optarg, nullptr); break;
+            case OPT_REBOOT_EVERY:  ok = parseDuration(optarg, opts.rebootEveryUs); break;
+            case OPT_LEVEL:         opts.levelPercent = strtof(optarg, nullptr); break;
+            case OPT_UNPROVISIONED: opts.provisioned = false; break;
+            case OPT_SSID:          opts.ssid = optarg; break;
+            case OPT_PASSWORD:      opts.password = optarg; break;
+            case OPT_RSSI:          opts.rssi = atoi(optarg); break;
+            case OPT_NO_NTP:        opts.ntp = false; break;
+            case OPT_LATENCY:       opts.latencyMs = (uint32_t)strtoul(optarg, nullptr, 10); break;
+            case OPT_WIFI_OUTAGE: {
+                sim::Window window;
+                ok = parseWindow(optarg, window);
+                opts.wifiOutages.push_back(window);
+                break;
+            }
+            case OPT_BACKEND_OUTAGE: {
+                sim::Window window;
+                ok = parseWindow(optarg, window);
+                opts.backendOutages.push_back(window);
+                break;
+            }
+            case OPT_SLOW: {
+                sim::Fault fault;
+                ok = parseFault(optarg, fault, 0, 600000);
+                opts.slowResponses.push_back(fault);
+                break;
+            }
+            case OPT_HTTP_ERRORS: {
+                sim::Fault fault;
+                ok = parseFault(optarg, fault, 100, 100);
+                opts.errorBursts.push_back(fault);
+                break;
+            }
+            case OPT_TRUNCATE: {
+                sim::Fault fault;
+                ok = parseFault(optarg, fault, 100, 100);
+                opts.truncations.push_back(fault);
+                break;
+            }
+            case OPT_TOKEN_LIFETIME: ok = parseDuration(optarg, opts.tokenLifetimeUs) && opts.tokenLifetimeUs > 0; break;
+            case OPT_REVOKE_TOKENS: {
+                uint64_t at;
+                ok = parseDuration(optarg, at);
+                opts.tokenRevocations.push_back(at);
+                break;
+            }
+            case OPT_HEARTBEAT:     opts.heartbeatSec = (uint32_t)strtoul(optarg, nullptr, 10); break;
+            case OPT_DASH_USER:     opts.dashUser = optarg; break;
+            case OPT_DASH_PASS:     opts.dashPass = optarg; break;
+            case OPT_SERVE: {
+                unsigned long port = strtoul(optarg, nullptr, 10);
+                ok = port > 0 && port <= 65535;
+                opts.servePort = (uint16_t)port;
+                break;
+            }
+            case OPT_FLEET: {
+                unsigned long size = strtoul(optarg, nullptr, 10);
+                ok = size > 0 && size <= 100000;
+                opts.fleetSize = (uint32_t)size;
+                break;
+            }
+            case OPT_TARGET:        opts.fleetTarget = optarg; break;
+            case OPT_DEVICES:       opts.fleetDevices = optarg; break;
+            case OPT_RAMP:          ok = parseDuration(optarg, opts.fleetRampUs); break;
+            case OPT_STORM: {
+                sim::Fault fault;
+                ok = parseFault(optarg, fault, 100, 100);
+                opts.fleetStorms.push_back(fault);
+                break;
+            }
+            case OPT_EDITS_PER_DAY: opts.fleetEditsPerDay = strtod(optarg, nullptr); ok = opts.fleetEditsPerDay >= 0; break;
+            case OPT_REPORT_EVERY:  ok = parseDuration(optarg, opts.fleetReportUs) && opts.fleetReportUs > 0; break;
+            case OPT_PRESS: {
+                sim::ButtonPress press;
+                ok = parsePress(optarg, press);
+                opts.presses.push_back(press);
+                break;
+            }
+            case OPT_OTA: {
+                const char* at = strchr(optarg, '@');
+                ok = at != nullptr && at != optarg && parseDuration(at + 1, opts.otaAtUs) && opts.otaAtUs > 0;
+                if (ok) {
+                    opts.otaVersion.assign(optarg, at - optarg);
+                }
+                break;
+            }
+            case OPT_OTA_SIZE:      opts.otaSize = (uint32_t)strtoul(optarg, nullptr, 10); break;
+            case OPT_ML_MODEL: {
+                const char* at = strchr(optarg, '@');
+                ok = at != nullptr && at != optarg && parseDuration(at + 1, opts.mlModelAtUs) && opts.mlModelAtUs > 0;
+                if (ok) {
+                    opts.mlModelVersion.assign(optarg, at - optarg);
+                }
+                break;
+            }
+            case OPT_TANK_HEIGHT:   opts.tankHeight = strtod(optarg, nullptr); ok = opts.tankHeight > 0; break;
+            case OPT_TANK_WIDTH:    opts.tankWidth = strtod(optarg, nullptr); ok = opts.tankWidth > 0; break;
+            case OPT_TANK_SHAPE: {
+                opts.tankShape = optarg;
+                ok = opts.tankShape == "Cylindrical" || opts.tankShape == "Rectangular";
+                break;
+            }
+            case OPT_UPPER:         opts.upperThreshold = strtod(optarg, nullptr); break;
+            case OPT_LOWER:         opts.lowerThreshold = strtod(optarg, nullptr); break;
+            case OPT_PUMP_LPM:      opts.pumpLpm = strtod(optarg, nullptr); break;
+            case OPT_DEMAND_SCALE:  opts.demandScale = strtod(optarg, nullptr); break;
+            case OPT_LEAK_LPH: {
+                const char* at = strchr(optarg, '@');
+                opts.leakLph = strtod(optarg, nullptr);
+                ok = at == nullptr || parseDuration(at + 1, opts.leakAtUs);
+                break;
+            }
+            case OPT_SENSOR_NOISE:  opts.sensorNoiseCm = strtod(optarg, nullptr); break;
+            case OPT_SCORE:         opts.scoreFile = optarg; break;
+            default:                usage(argv[0]);
+        }
+        if (!ok) {
+            fprintf(stderr, "sim: invalid value '%s'\n", optarg);
+            usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        usage(argv[0]);
+    }
+    if (opts.fleetSize > 0 && !durationGiven) {
+        opts.durationUs = SIM_DEFAULT_FLEET_DURATION_US;
+    }
+}
+
+// ============================================================================
+// STATE DIRECTORY
+// ============================================================================
+
+static int removeEntry(const char* path, const struct stat* info, int flag, struct FTW* ftw) {
+    (void)info;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+// A fresh run starts from an erased device and an empty backend
+static void resetStateDir() {
+    nftw(opts.stateDir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    if (mkdir(opts.stateDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "sim: cannot create %s: %s\n", opts.stateDir.c_str(), strerror(errno));
+        exit(2);
+    }
+}
+
+// Fuzz builds link the fuzzer's (or sim/fuzz's) main instead
+#ifndef SIM_FUZZ
+int main(int argc, char** argv) {
+    savedArgv = argv;
+    parseOptions(argc, argv);
+
+    if (!opts.resume) {
+        resetStateDir();
+    }
+
+    registerRunState();
+
+    if (opts.servePort != 0) {
+        rngState = opts.seed;
+        sim::backendBegin();
+        sim::serveBackend(opts.servePort);
+    }
+
+    // Fleet: the firmware's builders run here, their serial output is noise
+    if (opts.fleetSize != 0) {
+        rngState = opts.seed;
+        opts.quiet = true;
+        sim::runFleet();
+    }
+
+    sim::storageBegin();
+    sim::backendBegin();
+    sim::plantBegin();
+
+    if (opts.resume) {
+        sim::loadState();
+    } else if (opts.provisioned) {
+        sim::nvsPutString("wificfg", "ssid", opts.ssid.c_str());
+        sim::nvsPutString("wificfg", "password", opts.password.c_str());
+        sim::nvsPutString("wificfg", "dash_user", opts.dashUser.c_str());
+        sim::nvsPutString("wificfg", "dash_pass", opts.dashPass.c_str());
+    }
+
+    runStats.boots++;
+    rngState = opts.seed ^ ((uint64_t)runStats.boots * 0xD1B54A32D192ED03ULL);
+
+    if (sim::bootCount() == 1) {
+        sim::log("Simulating %s (seed %llu, firmware %s)", sim::formatWorld(opts.durationUs).c_str(),
+                 (unsigned long long)opts.seed, sim::runningFirmwareVersion().c_str());
+    } else {
+        sim::log("Boot #%u (firmware %s)", sim::bootCount(), sim::runningFirmwareVersion().c_str());
+    }
+
+    // On an LP64 host unsigned long is 64-bit, so firmware arithmetic like
+    // millis() - last does not wrap the way it does on the ESP32
+    if (sizeof(unsigned long) != 4 && opts.millisOffset != 0 && sim::bootCount() == 1) {
+        sim::log("Warning: 64-bit build - millis() wrap behaves differently than on the device (build with -m32)");
+    }
+
+    sim::scenarioBegin();
+    sim::runScheduler();
+}
+#endif // SIM_FUZZ
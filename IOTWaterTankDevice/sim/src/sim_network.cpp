@@ -0,0 +1,722 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ESPAsyncWebServer.h>
+#include "sim.h"
+
+#include <deque>
+
+// ============================================================================
+// RADIO ENVIRONMENT
+// ============================================================================
+
+#define SIM_AP_CHANNEL 6
+#define SIM_THROUGHPUT_BYTES_PER_S 120000   // Backend download rate
+#define SIM_FIRST_SEGMENT 1460              // Arrives with the response headers
+
+struct ScanEntry {
+    std::string ssid;
+    int32_t rssi;
+    uint8_t bssid[6];
+    int32_t channel;
+    wifi_auth_mode_t auth;
+};
+
+static const uint8_t AP_BSSID[6] = { 0x24, 0x4B, 0xFE, 0x12, 0x34, 0x56 };
+static std::vector<ScanEntry> scanResults;
+
+// Slow fading around --rssi (no randomness - RSSI is polled a lot)
+static int32_t currentRssi() {
+    double hours = (double)sim::worldUs() / 3600e6;
+    return sim::options().rssi + (int32_t)lround(3 * sin(hours * 0.7) + 2 * sin(hours * 5.3));
+}
+
+static uint64_t roundTripUs() {
+    double ms = sim::options().latencyMs * exp(0.25 * sim::gaussian());
+    return (uint64_t)(ms * 1000);
+}
+
+static bool linkUp() {
+    return sim::stationConnected() && sim::wifiAvailable() && sim::backendAvailable();
+}
+
+// ============================================================================
+// WIFI
+// ============================================================================
+
+WiFiClass WiFi;
+
+WiFiClass::WiFiClass()
+    : currentMode(WIFI_MODE_NULL), currentStatus(WL_NO_SHIELD), attempt(0), apRunning(false),
+      scanState(WIFI_SCAN_FAILED), scanGeneration(0) {
+}
+
+bool WiFiClass::mode(wifi_mode_t newMode) {
+    bool hadSta = (currentMode & WIFI_MODE_STA) != 0;
+    bool hasSta = (newMode & WIFI_MODE_STA) != 0;
+
+    if (hadSta && !hasSta) {
+        attempt++;
+        if (currentStatus == WL_CONNECTED) {
+            sim::log("WiFi station stopped");
+        }
+        currentStatus = WL_NO_SHIELD;
+    } else if (!hadSta && hasSta) {
+        currentStatus = WL_DISCONNECTED;
+    }
+    if ((newMode & WIFI_MODE_AP) == 0) {
+        apRunning = false;
+    }
+
+    currentMode = newMode;
+    return true;
+}
+
+bool WiFiClass::enableSTA(bool enable) {
+    return mode((wifi_mode_t)(enable ? (currentMode | WIFI_MODE_STA) : (currentMode & ~WIFI_MODE_STA)));
+}
+
+// The outcome is decided when the association would complete, so an outage
+// starting mid-connect is seen. Directed connects skip the channel scan,
+// a static/cached IP skips DHCP.
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    if ((currentMode & WIFI_MODE_STA) == 0) {
+        enableSTA(true);
+    }
+    attempt++;
+    currentStatus = WL_DISCONNECTED;
+    if (!connect) {
+        return currentStatus;
+    }
+
+    std::string wantSsid = ssid ? ssid : "";
+    std::string wantPass = passphrase ? passphrase : "";
+    bool directed = bssid != nullptr;
+    bool rightAp = !directed || (memcmp(bssid, AP_BSSID, 6) == 0 && (channel == 0 || channel == SIM_AP_CHANNEL));
+
+    uint64_t associateUs = directed ? 250000 + (uint64_t)(sim::uniform() * 400000)
+                                    : 1800000 + (uint64_t)(sim::uniform() * 1500000);
+    uint64_t dhcpUs = (uint32_t)staticIP != 0 ? 0 : 300000 + (uint64_t)(sim::uniform() * 1200000);
+    uint32_t thisAttempt = attempt;
+
+    sim::after(associateUs, [this, thisAttempt, wantSsid, wantPass, rightAp, dhcpUs]() {
+        if (thisAttempt != attempt) {
+            return;
+        }
+        if (!sim::wifiAvailable() || wantSsid != sim::options().ssid || !rightAp) {
+            finishAssociation(thisAttempt, WL_NO_SSID_AVAIL, 0);
+        } else if (wantPass != sim::options().password) {
+            finishAssociation(thisAttempt, WL_CONNECT_FAILED, 0);
+        } else {
+            finishAssociation(thisAttempt, WL_CONNECTED, dhcpUs);
+        }
+    });
+
+    return currentStatus;
+}
+
+void WiFiClass::finishAssociation(uint32_t thisAttempt, wl_status_t result, uint64_t dhcpUs) {
+    if (result != WL_CONNECTED) {
+        currentStatus = result;
+        return;
+    }
+
+    sim::after(dhcpUs, [this, thisAttempt]() {
+        if (thisAttempt != attempt) {
+            return;
+        }
+        if (!sim::wifiAvailable()) {
+            currentStatus = WL_CONNECTION_LOST;
+            return;
+        }
+        leaseIP = (uint32_t)staticIP != 0 ? staticIP : IPAddress(192, 168, 1, 77);
+        currentStatus = WL_CONNECTED;
+        sim::stats().wifiConnects++;
+    });
+}
+
+bool WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    (void)dns2;
+    staticIP = localIP;
+    staticGateway = gateway;
+    staticSubnet = subnet;
+    staticDns = dns1;
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)eraseAp;
+    attempt++;
+    if ((currentMode & WIFI_MODE_STA) != 0) {
+        currentStatus = WL_DISCONNECTED;
+    }
+    if (wifiOff) {
+        enableSTA(false);
+    }
+    return true;
+}
+
+void WiFiClass::simLinkLost() {
+    if (currentStatus != WL_CONNECTED) {
+        return;
+    }
+    attempt++;
+    currentStatus = WL_CONNECTION_LOST;
+    sim::stats().wifiDrops++;
+    sim::log("WiFi link lost");
+}
+
+String WiFiClass::SSID() {
+    return currentStatus == WL_CONNECTED ? String(sim::options().ssid.c_str()) : String();
+}
+
+int8_t WiFiClass::RSSI() {
+    return currentStatus == WL_CONNECTED ? (int8_t)currentRssi() : 0;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    static uint8_t bssid[6];
+    if (currentStatus != WL_CONNECTED) {
+        return nullptr;
+    }
+    memcpy(bssid, AP_BSSID, sizeof(bssid));
+    return bssid;
+}
+
+int32_t WiFiClass::channel() {
+    return currentStatus == WL_CONNECTED ? SIM_AP_CHANNEL : 0;
+}
+
+IPAddress WiFiClass::localIP() {
+    return currentStatus == WL_CONNECTED ? leaseIP : IPAddress();
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    if (currentStatus != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return (uint32_t)staticGateway != 0 ? staticGateway : IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+    if (currentStatus != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return (uint32_t)staticSubnet != 0 ? staticSubnet : IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index) {
+    if (currentStatus != WL_CONNECTED || index > 1) {
+        return IPAddress();
+    }
+    return (uint32_t)staticDns != 0 ? staticDns : IPAddress(192, 168, 1, 1);
+}
+
+String WiFiClass::macAddress() {
+    return String("F4:12:FA:5A:3C:10");
+}
+
+// Our AP (when in range) and two foreign networks
+static void fillScanResults() {
+    scanResults.clear();
+    if (sim::wifiAvailable()) {
+        ScanEntry own = { sim::options().ssid, currentRssi(), {}, SIM_AP_CHANNEL, WIFI_AUTH_WPA2_PSK };
+        memcpy(own.bssid, AP_BSSID, 6);
+        scanResults.push_back(own);
+    }
+    scanResults.push_back({ "Neighbour-2G", -78 + (int32_t)(sim::gaussian() * 3),
+                            { 0x3C, 0x84, 0x6A, 0x01, 0x02, 0x03 }, 1, WIFI_AUTH_WPA2_PSK });
+    scanResults.push_back({ "DIRECT-Printer", -86 + (int32_t)(sim::gaussian() * 3),
+                            { 0x9E, 0x5C, 0x8E, 0x44, 0x55, 0x66 }, 11, WIFI_AUTH_WPA2_PSK });
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden, bool passive, uint32_t maxMsPerChannel, uint8_t channel) {
+    (void)showHidden;
+    (void)passive;
+    if ((currentMode & WIFI_MODE_STA) == 0) {
+        enableSTA(true);
+    }
+
+    uint32_t channels = channel == 0 ? 13 : 1;
+    uint64_t durationUs = (uint64_t)channels * maxMsPerChannel * 800;
+    scanGeneration++;
+    scanState = WIFI_SCAN_RUNNING;
+
+    if (!async) {
+        sim::sleep(durationUs);
+        fillScanResults();
+        scanState = (int)scanResults.size();
+        return (int16_t)scanState;
+    }
+
+    uint32_t generation = scanGeneration;
+    sim::after(durationUs, [this, generation]() {
+        if (generation != scanGeneration) {
+            return;
+        }
+        fillScanResults();
+        scanState = (int)scanResults.size();
+    });
+    return WIFI_SCAN_RUNNING;
+}
+
+int16_t WiFiClass::scanComplete() {
+    return (int16_t)scanState;
+}
+
+void WiFiClass::scanDelete() {
+    scanGeneration++;
+    scanResults.clear();
+    scanState = WIFI_SCAN_FAILED;
+}
+
+String WiFiClass::SSID(uint8_t index) {
+    return index < scanResults.size() ? String(scanResults[index].ssid.c_str()) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) {
+    return index < scanResults.size() ? scanResults[index].rssi : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t index) {
+    return index < scanResults.size() ? scanResults[index].bssid : nullptr;
+}
+
+int32_t WiFiClass::channel(uint8_t index) {
+    return index < scanResults.size() ? scanResults[index].channel : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t index) {
+    return index < scanResults.size() ? scanResults[index].auth : WIFI_AUTH_OPEN;
+}
+
+bool WiFiClass::softAP(const char* ssid, const char* passphrase, int channel, int ssidHidden, int maxConnection) {
+    (void)ssid;
+    (void)passphrase;
+    (void)channel;
+    (void)ssidHidden;
+    (void)maxConnection;
+    if ((currentMode & WIFI_MODE_AP) == 0) {
+        mode((wifi_mode_t)(currentMode | WIFI_MODE_AP));
+    }
+    apRunning = true;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifiOff) {
+    apRunning = false;
+    if (wifiOff) {
+        mode((wifi_mode_t)(currentMode & ~WIFI_MODE_AP));
+    }
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP() {
+    return apRunning ? IPAddress(192, 168, 4, 1) : IPAddress();
+}
+
+namespace sim {
+
+bool stationConnected() {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+} // namespace sim
+
+// ============================================================================
+// WIFI CLIENT
+// ============================================================================
+
+WiFiClient::WiFiClient() : position(0), startUs(0), droppedAt(SIZE_MAX), open(false) {
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    (void)host;
+    (void)port;
+    stop();
+    if (!linkUp()) {
+        sim::sleep((uint64_t)timeoutMs * 1000);
+        return 0;
+    }
+    uint64_t rtt = roundTripUs();
+    if (rtt > (uint64_t)timeoutMs * 1000) {
+        sim::sleep((uint64_t)timeoutMs * 1000);
+        return 0;
+    }
+    sim::sleep(rtt);
+    open = true;
+    return 1;
+}
+
+void WiFiClient::stop() {
+    open = false;
+    body.clear();
+    position = 0;
+    droppedAt = SIZE_MAX;
+}
+
+void WiFiClient::simStartBody(const std::string& content, size_t closeAt) {
+    body = content;
+    position = 0;
+    startUs = sim::now();
+    droppedAt = closeAt;
+    open = true;
+}
+
+// Bytes received so far; frozen when the link drops
+size_t WiFiClient::arrived() {
+    if (!open) {
+        return position;
+    }
+    uint64_t elapsed = sim::now() - startUs;
+    size_t n = (size_t)std::min<uint64_t>(body.size(),
+                                          SIM_FIRST_SEGMENT + elapsed * SIM_THROUGHPUT_BYTES_PER_S / 1000000);
+    if (droppedAt == SIZE_MAX && n < body.size() && !linkUp()) {
+        droppedAt = n;
+    }
+    return droppedAt == SIZE_MAX ? n : std::min(n, droppedAt);
+}
+
+uint8_t WiFiClient::connected() {
+    arrived();
+    return open && droppedAt == SIZE_MAX;
+}
+
+int WiFiClient::available() {
+    return (int)(arrived() - position);
+}
+
+int WiFiClient::read() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return (uint8_t)body[position++];
+}
+
+int WiFiClient::peek() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return (uint8_t)body[position];
+}
+
+size_t WiFiClient::readBytes(char* buffer, size_t length) {
+    size_t n = std::min(length, (size_t)std::max(available(), 0));
+    memcpy(buffer, body.data() + position, n);
+    position += n;
+    return n;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    (void)c;
+    return open ? 1 : 0;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    (void)buffer;
+    return open ? size : 0;
+}
+
+// Waits for the rest of the body (getString)
+std::string WiFiClient::simTakeRemaining() {
+    while (open && droppedAt == SIZE_MAX && arrived() < body.size()) {
+        uint64_t missing = body.size() - arrived();
+        sim::sleep(missing * 1000000 / SIM_THROUGHPUT_BYTES_PER_S + 1);
+    }
+    size_t end = arrived();
+    std::string rest = body.substr(position, end - position);
+    position = end;
+    return rest;
+}
+
+// ============================================================================
+// HTTP CLIENT
+// ============================================================================
+
+HTTPClient::HTTPClient()
+    : timeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT), connectTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT),
+      keepAlive(false), linkOpen(false), size(-1) {
+}
+
+HTTPClient::~HTTPClient() {
+    client.stop();
+}
+
+bool HTTPClient::begin(const String& target) {
+    url = target.std();
+    authorization.clear();
+    range.clear();
+    size = -1;
+    return true;
+}
+
+void HTTPClient::end() {
+    client.stop();
+    if (!keepAlive) {
+        linkOpen = false;
+    }
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    (void)first;
+    (void)replace;
+    if (name.equalsIgnoreCase("Authorization")) {
+        authorization = value.std();
+    } else if (name.equalsIgnoreCase("Range")) {
+        range = value.std();
+    }
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET", String());
+}
+
+int HTTPClient::POST(const String& payload) {
+    return sendRequest("POST", payload);
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t length) {
+    return sendRequest("POST", String((const char*)payload, (unsigned int)length));
+}
+
+int HTTPClient::PUT(const String& payload) {
+    return sendRequest("PUT", payload);
+}
+
+int HTTPClient::sendRequest(const char* method, const String& payload) {
+    sim::stats().httpRequests++;
+    client.stop();
+
+    if (!sim::stationConnected()) {
+        sim::sleep(1000);
+        sim::stats().httpFailures++;
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    // TCP handshake unless a kept-alive connection is still up
+    if (!linkOpen || !linkUp()) {
+        linkOpen = false;
+        if (!linkUp()) {
+            sim::sleep((uint64_t)connectTimeout * 1000);
+            sim::stats().httpFailures++;
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        sim::sleep(roundTripUs());
+        linkOpen = true;
+    }
+
+    // Split "http://host[:port]/path?query"
+    std::string target = url;
+    size_t scheme = target.find("://");
+    if (scheme != std::string::npos) {
+        size_t slash = target.find('/', scheme + 3);
+        target = slash == std::string::npos ? "/" : target.substr(slash);
+    }
+
+    sim::HttpRequest request;
+    request.method = method;
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query = question == std::string::npos ? "" : target.substr(question + 1);
+    request.authorization = authorization;
+    request.range = range;
+    request.body = payload.std();
+
+    sim::HttpResponse response = sim::backendRequest(request);
+
+    uint64_t totalUs = roundTripUs() + response.serverUs;
+    uint64_t timeoutUs = (uint64_t)timeout * 1000;
+    if (totalUs > timeoutUs) {
+        sim::sleep(timeoutUs);
+        linkOpen = false;
+        sim::stats().httpFailures++;
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+
+    sim::sleep(totalUs);
+    if (!linkUp()) {
+        // Went away while waiting for the answer
+        sim::sleep(timeoutUs - totalUs);
+        linkOpen = false;
+        sim::stats().httpFailures++;
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+
+    // A short body still announces its full Content-Length, then the
+    // server closes the connection
+    client.simStartBody(response.body, response.truncateAt);
+    size = (int)response.body.size();
+    if (response.truncateAt != SIZE_MAX) {
+        linkOpen = false;
+    }
+    return response.status;
+}
+
+String HTTPClient::getString() {
+    return String(client.simTakeRemaining());
+}
+
+bool HTTPClient::connected() {
+    return client.connected();
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return String("send header failed");
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return String("send payload failed");
+        case HTTPC_ERROR_NOT_CONNECTED: return String("not connected");
+        case HTTPC_ERROR_CONNECTION_LOST: return String("connection lost");
+        case HTTPC_ERROR_NO_STREAM: return String("no stream");
+        case HTTPC_ERROR_NO_HTTP_SERVER: return String("no HTTP server");
+        case HTTPC_ERROR_TOO_LESS_RAM: return String("too less ram");
+        case HTTPC_ERROR_ENCODING: return String("Transfer-Encoding not supported");
+        case HTTPC_ERROR_STREAM_WRITE: return String("Stream write error");
+        case HTTPC_ERROR_READ_TIMEOUT: return String("read Timeout");
+        default: return String();
+    }
+}
+
+// ============================================================================
+// ASYNC WEB SERVER
+// ============================================================================
+
+struct PendingRequest {
+    std::string method;
+    std::string path;
+    std::string body;
+    std::function<void(int, const std::string&)> done;
+};
+
+// Never destroyed: the firmware's global WebServer unregisters itself from
+// its destructor, which may run after this file's statics are gone
+static std::vector<AsyncWebServer*>& servers = *new std::vector<AsyncWebServer*>();
+static std::deque<PendingRequest> pendingRequests;
+static TaskHandle_t asyncTcpTask = nullptr;
+
+static void asyncTcpLoop(void* parameter) {
+    (void)parameter;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (!pendingRequests.empty()) {
+            PendingRequest pending = pendingRequests.front();
+            pendingRequests.pop_front();
+
+            std::string response;
+            int status = sim::dispatchDeviceRequest(pending.method, pending.path, pending.body,
+                                                    SIM_TCP_SEGMENT_SIZE, response);
+            if (pending.done) {
+                pending.done(status, response);
+            }
+        }
+    }
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+    (void)contentType;
+    if (responseCode != 0) {
+        return;  // The library ignores a second response
+    }
+    responseCode = code;
+    responseBody = content;
+}
+
+DefaultHeaders& DefaultHeaders::Instance() {
+    static DefaultHeaders instance;
+    return instance;
+}
+
+void DefaultHeaders::addHeader(const String& name, const String& value) {
+    headers.push_back(std::make_pair(name, value));
+}
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : port(port), running(false) {
+}
+
+AsyncWebServer::~AsyncWebServer() {
+    servers.erase(std::remove(servers.begin(), servers.end(), this), servers.end());
+}
+
+void AsyncWebServer::begin() {
+    if (running) {
+        return;
+    }
+    running = true;
+    servers.push_back(this);
+    if (asyncTcpTask == nullptr) {
+        xTaskCreatePinnedToCore(asyncTcpLoop, "async_tcp", 8192, nullptr, 3, &asyncTcpTask, 1);
+    }
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    on(uri, method, onRequest, nullptr, nullptr);
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                        ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    (void)onUpload;
+    routes.push_back({ String(uri), method, onRequest, onBody });
+}
+
+// Body first, chunk by chunk, then the request handler
+void AsyncWebServer::simHandle(AsyncWebServerRequest* request, const std::string& body,
+                               size_t chunkSize) {
+    if (!running || request->simResponseCode() != 0) {
+        return;
+    }
+
+    for (const Route& route : routes) {
+        if (route.uri != request->url() || (route.method & request->method()) == 0) {
+            continue;
+        }
+        request->requestContentLength = body.size();
+        if (route.onBody && !body.empty()) {
+            if (chunkSize == 0) {
+                chunkSize = body.size();
+            }
+            for (size_t index = 0; index < body.size(); index += chunkSize) {
+                size_t len = std::min(chunkSize, body.size() - index);
+                // Exactly len bytes, so reading past the chunk is caught by ASan
+                std::vector<uint8_t> data(body.begin() + index, body.begin() + index + len);
+                route.onBody(request, data.data(), len, index, body.size());
+            }
+        }
+        if (route.onRequest) {
+            route.onRequest(request);
+        }
+        return;
+    }
+
+    if (notFoundHandler) {
+        notFoundHandler(request);
+    }
+}
+
+namespace sim {
+
+void deviceRequest(const std::string& method, const std::string& path, const std::string& body,
+                   std::function<void(int status, const std::string& body)> done) {
+    if (asyncTcpTask == nullptr || !(stationConnected() || WiFi.softAPIP() != IPAddress())) {
+        if (done) {
+            done(0, "");  // Device not reachable on the LAN
+        }
+        return;
+    }
+    pendingRequests.push_back({ method, path, body, done });
+    vTaskNotifyGiveFromISR(asyncTcpTask, nullptr);
+}
+
+int dispatchDeviceRequest(const std::string& method, const std::string& path, const std::string& body,
+                          size_t chunkSize, std::string& response) {
+    WebRequestMethodComposite requestMethod = method == "POST" ? HTTP_POST : HTTP_GET;
+    AsyncWebServerRequest request(requestMethod, String(path.c_str()));
+    for (AsyncWebServer* server : servers) {
+        server->simHandle(&request, body, chunkSize);
+    }
+    response = request.simResponseBody().std();
+    return request.simResponseCode();
+}
+
+} // namespace sim
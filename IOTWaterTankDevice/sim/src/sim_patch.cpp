@@ -0,0 +1,318 @@
+#include "sim_patch.h"
+#include "delta_patch.h"
+#include "heatshrink_decoder.h"
+
+#include <algorithm>
+#include <string.h>
+
+// ============================================================================
+// HEATSHRINK ENCODER
+// ============================================================================
+// The bit stream heatshrink_decoder.h documents. Candidates come from hash
+// chains on the next two bytes (a 2-byte match already beats two literals:
+// 16 bits against 18), searched newest first over the whole window.
+
+#define HS_WINDOW (1u << HEATSHRINK_WINDOW_BITS)
+#define HS_MAX_MATCH (1u << HEATSHRINK_LOOKAHEAD_BITS)
+#define HS_MIN_MATCH 2
+
+namespace {
+
+class BitWriter {
+public:
+    void put(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            current = (uint8_t)((current << 1) | ((value >> i) & 1));
+            if (++used == 8) {
+                out.push_back(current);
+                current = 0;
+                used = 0;
+            }
+        }
+    }
+
+    // Pad the last byte with zeros
+    std::vector<uint8_t> finish() {
+        if (used > 0) {
+            out.push_back((uint8_t)(current << (8 - used)));
+            used = 0;
+            current = 0;
+        }
+        return out;
+    }
+
+private:
+    std::vector<uint8_t> out;
+    uint8_t current = 0;
+    int used = 0;
+};
+
+} // namespace
+
+namespace sim {
+
+std::vector<uint8_t> heatshrinkEncode(const std::vector<uint8_t>& data) {
+    const size_t n = data.size();
+    std::vector<int32_t> head(1 << 16, -1);
+    std::vector<int32_t> previous(n, -1);
+    BitWriter bits;
+
+    auto key = [&data](size_t i) { return (data[i] << 8) | data[i + 1]; };
+    auto insert = [&](size_t i) {
+        if (i + 1 < n) {
+            previous[i] = head[key(i)];
+            head[key(i)] = (int32_t)i;
+        }
+    };
+
+    size_t i = 0;
+    while (i < n) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+
+        if (i + 1 < n) {
+            size_t limit = std::min<size_t>(HS_MAX_MATCH, n - i);
+            for (int32_t candidate = head[key(i)];
+                 candidate >= 0 && i - (size_t)candidate <= HS_WINDOW;
+                 candidate = previous[candidate]) {
+                // The decoder copies byte by byte, so a match may run into
+                // the bytes it produces (distance < length)
+                size_t length = 0;
+                while (length < limit && data[candidate + length] == data[i + length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = i - (size_t)candidate;
+                    if (length == limit) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (bestLength >= HS_MIN_MATCH) {
+            bits.put(0, 1);
+            bits.put((uint32_t)(bestDistance - 1), HEATSHRINK_WINDOW_BITS);
+            bits.put((uint32_t)(bestLength - 1), HEATSHRINK_LOOKAHEAD_BITS);
+        } else {
+            bestLength = 1;
+            bits.put(1, 1);
+            bits.put(data[i], 8);
+        }
+
+        for (size_t k = 0; k < bestLength; k++) {
+            insert(i + k);
+        }
+        i += bestLength;
+    }
+
+    return bits.finish();
+}
+
+} // namespace sim
+
+// ============================================================================
+// DELTA PATCH GENERATOR
+// ============================================================================
+
+namespace {
+
+// Suffix array by prefix doubling, with the empty suffix first (as in
+// bsdiff, so search() can treat every slot alike)
+std::vector<int64_t> suffixArray(const std::vector<uint8_t>& data) {
+    const int64_t n = (int64_t)data.size();
+    std::vector<int64_t> order(n);
+    std::vector<int64_t> rank(n);
+    std::vector<int64_t> next(n);
+
+    for (int64_t i = 0; i < n; i++) {
+        order[i] = i;
+        rank[i] = data[i];
+    }
+
+    for (int64_t k = 1; n > 0; k *= 2) {
+        auto rankAfter = [&](int64_t i) { return i + k < n ? rank[i + k] : -1; };
+        auto less = [&](int64_t a, int64_t b) {
+            if (rank[a] != rank[b]) {
+                return rank[a] < rank[b];
+            }
+            return rankAfter(a) < rankAfter(b);
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        next[order[0]] = 0;
+        for (int64_t i = 1; i < n; i++) {
+            next[order[i]] = next[order[i - 1]] + (less(order[i - 1], order[i]) ? 1 : 0);
+        }
+        rank.swap(next);
+        if (rank[order[n - 1]] == n - 1) {
+            break;  // All suffixes distinct
+        }
+    }
+
+    std::vector<int64_t> result;
+    result.reserve(n + 1);
+    result.push_back(n);
+    result.insert(result.end(), order.begin(), order.end());
+    return result;
+}
+
+int64_t matchLength(const uint8_t* a, int64_t aSize, const uint8_t* b, int64_t bSize) {
+    int64_t i = 0;
+    while (i < aSize && i < bSize && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Longest match of target[] in old[] among suffixes sa[start..end]
+int64_t search(const std::vector<int64_t>& sa, const uint8_t* old, int64_t oldSize,
+               const uint8_t* target, int64_t targetSize, int64_t start, int64_t end, int64_t* pos) {
+    while (end - start >= 2) {
+        int64_t middle = start + (end - start) / 2;
+        if (memcmp(old + sa[middle], target, (size_t)std::min(oldSize - sa[middle], targetSize)) < 0) {
+            start = middle;
+        } else {
+            end = middle;
+        }
+    }
+
+    int64_t x = matchLength(old + sa[start], oldSize - sa[start], target, targetSize);
+    int64_t y = matchLength(old + sa[end], oldSize - sa[end], target, targetSize);
+    if (x > y) {
+        *pos = sa[start];
+        return x;
+    }
+    *pos = sa[end];
+    return y;
+}
+
+void putOfftin(std::vector<uint8_t>& out, int64_t value) {
+    uint64_t magnitude = value < 0 ? (uint64_t)(-value) : (uint64_t)value;
+    for (int i = 0; i < 8; i++) {
+        out.push_back((uint8_t)(magnitude >> (8 * i)));
+    }
+    if (value < 0) {
+        out.back() |= 0x80;
+    }
+}
+
+} // namespace
+
+namespace sim {
+
+std::vector<uint8_t> makeDeltaPatch(const std::vector<uint8_t>& oldImage,
+                                    const std::vector<uint8_t>& newImage) {
+    const uint8_t* old = oldImage.data();
+    const uint8_t* target = newImage.data();
+    const int64_t oldSize = (int64_t)oldImage.size();
+    const int64_t newSize = (int64_t)newImage.size();
+    std::vector<int64_t> sa = suffixArray(oldImage);
+
+    // Blocks: control (add, copy, seek), diff[add], extra[copy]
+    std::vector<uint8_t> body;
+    int64_t scan = 0, length = 0, pos = 0;
+    int64_t lastScan = 0, lastPos = 0, lastOffset = 0;
+
+    while (scan < newSize) {
+        int64_t oldScore = 0;
+        int64_t scoreScan = scan += length;
+
+        // Next exact match that isn't just the current alignment continued
+        for (; scan < newSize; scan++) {
+            length = search(sa, old, oldSize, target + scan, newSize - scan, 0, oldSize, &pos);
+            for (; scoreScan < scan + length; scoreScan++) {
+                if (scoreScan + lastOffset < oldSize && old[scoreScan + lastOffset] == target[scoreScan]) {
+                    oldScore++;
+                }
+            }
+            if ((length == oldScore && length != 0) || length > oldScore + 8) {
+                break;
+            }
+            if (scan + lastOffset < oldSize && old[scan + lastOffset] == target[scan]) {
+                oldScore--;
+            }
+        }
+
+        if (length == oldScore && scan != newSize) {
+            continue;
+        }
+
+        // Extend the previous match forwards while at least half the bytes agree
+        int64_t score = 0, bestScore = 0, forward = 0;
+        for (int64_t i = 0; lastScan + i < scan && lastPos + i < oldSize;) {
+            if (old[lastPos + i] == target[lastScan + i]) {
+                score++;
+            }
+            i++;
+            if (score * 2 - i > bestScore * 2 - forward) {
+                bestScore = score;
+                forward = i;
+            }
+        }
+
+        // ... and the new match backwards
+        int64_t backward = 0;
+        if (scan < newSize) {
+            score = 0;
+            bestScore = 0;
+            for (int64_t i = 1; scan >= lastScan + i && pos >= i; i++) {
+                if (old[pos - i] == target[scan - i]) {
+                    score++;
+                }
+                if (score * 2 - i > bestScore * 2 - backward) {
+                    bestScore = score;
+                    backward = i;
+                }
+            }
+        }
+
+        // Overlapping extensions: split where the forward one stops paying off
+        if (lastScan + forward > scan - backward) {
+            int64_t overlap = (lastScan + forward) - (scan - backward);
+            int64_t split = 0;
+            score = 0;
+            bestScore = 0;
+            for (int64_t i = 0; i < overlap; i++) {
+                if (target[lastScan + forward - overlap + i] == old[lastPos + forward - overlap + i]) {
+                    score++;
+                }
+                if (target[scan - backward + i] == old[pos - backward + i]) {
+                    score--;
+                }
+                if (score > bestScore) {
+                    bestScore = score;
+                    split = i + 1;
+                }
+            }
+            forward += split - overlap;
+            backward -= split;
+        }
+
+        int64_t extra = (scan - backward) - (lastScan + forward);
+        putOfftin(body, forward);
+        putOfftin(body, extra);
+        putOfftin(body, (pos - backward) - (lastPos + forward));
+        for (int64_t i = 0; i < forward; i++) {
+            body.push_back((uint8_t)(target[lastScan + i] - old[lastPos + i]));
+        }
+        body.insert(body.end(), target + lastScan + forward, target + lastScan + forward + extra);
+
+        lastScan = scan - backward;
+        lastPos = pos - backward;
+        lastOffset = pos - scan;
+    }
+
+    std::vector<uint8_t> patch(DELTA_PATCH_MAGIC, DELTA_PATCH_MAGIC + DELTA_PATCH_MAGIC_LEN);
+    putOfftin(patch, newSize);
+    patch.push_back(HEATSHRINK_WINDOW_BITS);
+    patch.push_back(HEATSHRINK_LOOKAHEAD_BITS);
+    patch.resize(DELTA_PATCH_HEADER_LEN, 0);
+
+    std::vector<uint8_t> compressed = heatshrinkEncode(body);
+    patch.insert(patch.end(), compressed.begin(), compressed.end());
+    return patch;
+}
+
+} // namespace sim
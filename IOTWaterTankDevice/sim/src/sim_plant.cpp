@@ -0,0 +1,480 @@
+#include <Arduino.h>
+#include "config.h"
+#include "sim.h"
+
+// ============================================================================
+// PLANT MODEL (tank, pump, demand, sensor) AND CONTROL SCORE
+// ============================================================================
+// The physical tank matches the geometry the backend publishes (--tank-*).
+// Volumes are integrated in segments of piecewise-constant flow:
+//
+// - Pump: water reaches the tank PUMP_PRIME_US after the relay closes, then
+//   ramps up with PUMP_RAMP_TAU_US; the supply pressure wanders slowly
+//   around the nominal flow (--pump-lpm)
+// - Demand: draw events (taps, showers) arrive as a Poisson process with a
+//   daily rate profile (--demand-scale), each with its own flow and a
+//   log-normal duration, plus a constant leak (--leak-lph, from an optional
+//   start time on)
+// - Sensor: gaussian noise, extra surface ripple while filling, lost
+//   echoes and multipath spikes
+//
+// Demand and supply come from their own random stream seeded only by
+// --seed, so two firmware builds see exactly the same water usage and
+// their control scores can be compared run for run.
+
+#define PLANT_MAX_STEP_US 10000000ULL      // Segment length while flows are steady
+#define PLANT_RAMP_STEP_US 1000000ULL      // Segment length during the pump ramp
+#define PUMP_PRIME_US 8000000ULL           // Pipe fill before water arrives
+#define PUMP_RAMP_TAU_US 3000000ULL
+#define SUPPLY_VARIATION 0.08              // +- share of nominal flow
+#define SUPPLY_PERIOD_US 600000000ULL      // Supply pressure correlation time (10 min)
+
+#define DRAW_FLOW_MIN_LPM 3.0
+#define DRAW_FLOW_MAX_LPM 9.0
+#define DRAW_MEDIAN_S 90.0
+#define DRAW_SIGMA 0.8                     // Log-normal spread of draw durations
+#define DRAW_MAX_S 1200.0
+
+#define SENSOR_RIPPLE_CM 0.8               // Extra noise while the inlet splashes
+#define SENSOR_DROPOUT 0.005               // Share of readings without echo
+#define SENSOR_SPIKE 0.002                 // Share of multipath readings
+
+struct Draw {
+    uint64_t endUs;
+    double lpm;
+};
+
+// Control quality, accumulated over the whole run (world time)
+struct Score {
+    uint64_t totalUs;
+    uint64_t aboveUs;          // Level above the upper threshold
+    uint64_t belowUs;          // Level below the lower threshold
+    uint64_t dryUs;            // Tank empty with demand unmet
+    double pumpedL;
+    double demandL;
+    double unmetL;
+    double spilledL;
+    double minPercent;
+    double maxPercent;
+
+    uint32_t overshoots;       // Completed fill cycles (peak after pump OFF)
+    double overshootSum;       // Percentage points above the upper threshold
+    double overshootMax;
+    uint32_t undershoots;      // Completed drain cycles (trough after pump ON)
+    double undershootSum;      // Percentage points below the lower threshold
+    double undershootMax;
+};
+
+static double heightCm = 0;
+static double areaCm2 = 0;
+static double levelCm = 0;
+static uint64_t levelUpdatedUs = 0;        // World time of levelCm
+
+static bool pumpOn = false;
+static uint64_t pumpOnSinceUs = 0;
+static std::vector<Draw> draws;
+static uint64_t nextDrawUs = 0;
+static uint64_t plantRng = 0;
+
+static Score score;
+static double peakCm = -1;                 // Since pump OFF (-1 = not tracking)
+static double troughCm = -1;               // Since pump ON
+
+// ----------------------------------------------------------------------------
+// Plant randomness (independent of the firmware)
+// ----------------------------------------------------------------------------
+
+static uint64_t plantRandom() {
+    uint64_t z = (plantRng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double plantUniform() {
+    return (double)(plantRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double plantGaussian() {
+    double u1 = std::max(plantUniform(), 1e-300);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * plantUniform());
+}
+
+// Smooth noise in [-1, 1]: hashed values on a fixed grid, interpolated
+static double smoothNoise(uint64_t world) {
+    auto grid = [](uint64_t index) {
+        uint64_t z = sim::options().seed * 0xD6E8FEB86659FD93ULL + index * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 32)) * 0xD6E8FEB86659FD93ULL;
+        z ^= z >> 32;
+        return (double)(z >> 11) / 4503599627370496.0 - 1.0;
+    };
+    uint64_t index = world / SUPPLY_PERIOD_US;
+    double t = (double)(world % SUPPLY_PERIOD_US) / SUPPLY_PERIOD_US;
+    t = t * t * (3 - 2 * t);
+    return grid(index) * (1 - t) + grid(index + 1) * t;
+}
+
+// ----------------------------------------------------------------------------
+// Flows
+// ----------------------------------------------------------------------------
+
+// Draw events per hour at a world time (wall clock hour of day, UTC):
+// night trickle, morning and evening peaks
+static double drawRatePerHour(uint64_t world) {
+    double hour = fmod((double)(sim::options().startEpochMs / 1000 + world / 1000000) / 3600.0, 24.0);
+    double morning = 5.0 * exp(-pow((hour - 7.0) / 1.2, 2));
+    double evening = 4.0 * exp(-pow((hour - 19.5) / 1.5, 2));
+    return sim::options().demandScale * (0.3 + morning + evening);
+}
+
+static double maxDrawRatePerHour() {
+    return sim::options().demandScale * 9.3;
+}
+
+// Thinning: candidates at the peak rate, accepted by the rate at that time
+static void scheduleNextDraw(uint64_t from) {
+    double peak = maxDrawRatePerHour();
+    if (peak <= 0) {
+        nextDrawUs = UINT64_MAX;
+        return;
+    }
+    uint64_t candidate = from;
+    for (;;) {
+        double gapHours = -log(std::max(plantUniform(), 1e-300)) / peak;
+        candidate += (uint64_t)(gapHours * 3600e6);
+        if (plantUniform() * peak <= drawRatePerHour(candidate)) {
+            nextDrawUs = candidate;
+            return;
+        }
+    }
+}
+
+static void startDraw(uint64_t world) {
+    double lpm = DRAW_FLOW_MIN_LPM + plantUniform() * (DRAW_FLOW_MAX_LPM - DRAW_FLOW_MIN_LPM);
+    double seconds = std::min(DRAW_MAX_S, DRAW_MEDIAN_S * exp(DRAW_SIGMA * plantGaussian()));
+    draws.push_back({ world + (uint64_t)(seconds * 1e6), lpm });
+}
+
+static double pumpLpm(uint64_t world) {
+    if (!pumpOn || world < pumpOnSinceUs + PUMP_PRIME_US) {
+        return 0;
+    }
+    double since = (double)(world - pumpOnSinceUs - PUMP_PRIME_US);
+    double ramp = 1.0 - exp(-since / PUMP_RAMP_TAU_US);
+    return sim::options().pumpLpm * (1.0 + SUPPLY_VARIATION * smoothNoise(world)) * ramp;
+}
+
+static double demandLpm(uint64_t world) {
+    const sim::Options& opts = sim::options();
+    double lpm = world >= opts.leakAtUs ? opts.leakLph / 60.0 : 0;
+    for (const Draw& draw : draws) {
+        lpm += draw.lpm;
+    }
+    return lpm;
+}
+
+// ----------------------------------------------------------------------------
+// Score
+// ----------------------------------------------------------------------------
+
+static double thresholdCm(const char* field, double fallbackPercent) {
+    return sim::backendConfigNumber(field, fallbackPercent) * heightCm / 100.0;
+}
+
+static double toPercent(double cm) {
+    return cm * 100.0 / heightCm;
+}
+
+// Time a linear level ramp a -> b over 'us' spends above 'limit'
+static uint64_t timeAbove(double a, double b, uint64_t us, double limit) {
+    if (a > limit && b > limit) {
+        return us;
+    }
+    if (a <= limit && b <= limit) {
+        return 0;
+    }
+    double crossing = (limit - a) / (b - a) * us;
+    return a > limit ? (uint64_t)crossing : us - (uint64_t)crossing;
+}
+
+static void scoreSegment(double from, double to, uint64_t us) {
+    double upper = thresholdCm("upperThreshold", sim::options().upperThreshold);
+    double lower = thresholdCm("lowerThreshold", sim::options().lowerThreshold);
+
+    score.totalUs += us;
+    score.aboveUs += timeAbove(from, to, us, upper);
+    score.belowUs += timeAbove(-from, -to, us, -lower);
+    score.maxPercent = std::max(score.maxPercent, toPercent(std::max(from, to)));
+    score.minPercent = std::min(score.minPercent, toPercent(std::min(from, to)));
+
+    if (peakCm >= 0) {
+        peakCm = std::max(peakCm, std::max(from, to));
+    }
+    if (troughCm >= 0) {
+        troughCm = std::min(troughCm, std::min(from, to));
+    }
+}
+
+// A pump switch closes the previous cycle: the peak after OFF (or trough
+// after ON) is final once the pump switches the other way
+static void closeCycle(bool turningOn) {
+    if (turningOn && peakCm >= 0) {
+        double over = std::max(0.0, toPercent(peakCm) - sim::backendConfigNumber("upperThreshold", sim::options().upperThreshold));
+        score.overshoots++;
+        score.overshootSum += over;
+        score.overshootMax = std::max(score.overshootMax, over);
+    }
+    if (!turningOn && troughCm >= 0) {
+        double under = std::max(0.0, sim::backendConfigNumber("lowerThreshold", sim::options().lowerThreshold) - toPercent(troughCm));
+        score.undershoots++;
+        score.undershootSum += under;
+        score.undershootMax = std::max(score.undershootMax, under);
+    }
+    peakCm = turningOn ? -1 : levelCm;
+    troughCm = turningOn ? levelCm : -1;
+}
+
+// ----------------------------------------------------------------------------
+// Integration
+// ----------------------------------------------------------------------------
+
+static void integrate() {
+    uint64_t target = sim::worldUs();
+    while (levelUpdatedUs < target) {
+        uint64_t now = levelUpdatedUs;
+
+        // Segment ends at the next change of flow
+        bool ramping = pumpOn && now < pumpOnSinceUs + PUMP_PRIME_US + 5 * PUMP_RAMP_TAU_US;
+        uint64_t end = std::min<uint64_t>(target, now + (ramping ? PLANT_RAMP_STEP_US : PLANT_MAX_STEP_US));
+        if (pumpOn && now < pumpOnSinceUs + PUMP_PRIME_US) {
+            end = std::min<uint64_t>(end, pumpOnSinceUs + PUMP_PRIME_US);
+        }
+        end = std::min(end, std::max(nextDrawUs, now + 1));
+        if (now < sim::options().leakAtUs) {
+            end = std::min(end, sim::options().leakAtUs);
+        }
+        for (const Draw& draw : draws) {
+            end = std::min(end, std::max(draw.endUs, now + 1));
+        }
+
+        uint64_t us = end - now;
+        double minutes = us / 60e6;
+        double inL = pumpLpm(now + us / 2) * minutes;
+        double outL = demandLpm(now) * minutes;
+        double cmPerL = 1000.0 / areaCm2;
+
+        double from = levelCm;
+        double to = from + (inL - outL) * cmPerL;
+        score.pumpedL += inL;
+        score.demandL += outL;
+        if (to < 0) {
+            // Empty part-way: the rest of the demand is not served
+            uint64_t wet = from > 0 ? (uint64_t)(us * from / (from - to)) : 0;
+            score.dryUs += us - wet;
+            score.unmetL += -to / cmPerL;
+            to = 0;
+        } else if (to > heightCm) {
+            score.spilledL += (to - heightCm) / cmPerL;
+            to = heightCm;
+        }
+        scoreSegment(from, to, us);
+        levelCm = to;
+        levelUpdatedUs = end;
+
+        for (size_t i = 0; i < draws.size();) {
+            if (draws[i].endUs <= end) {
+                draws.erase(draws.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        while (nextDrawUs <= end) {
+            startDraw(nextDrawUs);
+            scheduleNextDraw(nextDrawUs);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Persistence
+// ----------------------------------------------------------------------------
+
+#define SCORE_FIELDS(X) \
+    X(totalUs) X(aboveUs) X(belowUs) X(dryUs) X(pumpedL) X(demandL) X(unmetL) \
+    X(spilledL) X(minPercent) X(maxPercent) X(overshoots) X(overshootSum) \
+    X(overshootMax) X(undershoots) X(undershootSum) X(undershootMax)
+
+static std::string number(double value) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+namespace sim {
+
+void plantBegin() {
+    const Options& opts = options();
+    heightCm = opts.tankHeight;
+    areaCm2 = opts.tankShape == "Rectangular" ? opts.tankWidth * opts.tankWidth
+                                              : M_PI * opts.tankWidth * opts.tankWidth / 4.0;
+    levelCm = heightCm * opts.levelPercent / 100.0;
+    levelUpdatedUs = 0;
+    plantRng = opts.seed ^ 0x5DEECE66DULL;
+    memset(&score, 0, sizeof(score));
+    score.minPercent = 100;
+    scheduleNextDraw(0);
+
+    registerState("plant",
+        [](std::vector<std::pair<std::string, std::string>>& out) {
+            integrate();
+            out.push_back({ "levelCm", number(levelCm) });
+            out.push_back({ "levelUpdatedUs", std::to_string(levelUpdatedUs) });
+            out.push_back({ "pumpOn", pumpOn ? "1" : "0" });
+            out.push_back({ "pumpOnSinceUs", std::to_string(pumpOnSinceUs) });
+            out.push_back({ "nextDrawUs", std::to_string(nextDrawUs) });
+            out.push_back({ "rng", std::to_string(plantRng) });
+            out.push_back({ "peakCm", number(peakCm) });
+            out.push_back({ "troughCm", number(troughCm) });
+            for (const Draw& draw : draws) {
+                out.push_back({ "draw", std::to_string(draw.endUs) + " " + number(draw.lpm) });
+            }
+#define SAVE_SCORE(name) out.push_back({ "score." #name, number(score.name) });
+            SCORE_FIELDS(SAVE_SCORE)
+#undef SAVE_SCORE
+        },
+        [](const std::string& key, const std::string& value) {
+            const char* text = value.c_str();
+            if (key == "levelCm") {
+                levelCm = strtod(text, nullptr);
+            } else if (key == "levelUpdatedUs") {
+                levelUpdatedUs = strtoull(text, nullptr, 10);
+            } else if (key == "pumpOn") {
+                pumpOn = value == "1";
+            } else if (key == "pumpOnSinceUs") {
+                pumpOnSinceUs = strtoull(text, nullptr, 10);
+            } else if (key == "nextDrawUs") {
+                nextDrawUs = strtoull(text, nullptr, 10);
+            } else if (key == "rng") {
+                plantRng = strtoull(text, nullptr, 10);
+            } else if (key == "peakCm") {
+                peakCm = strtod(text, nullptr);
+            } else if (key == "troughCm") {
+                troughCm = strtod(text, nullptr);
+            } else if (key == "draw") {
+                char* rest;
+                uint64_t endUs = strtoull(text, &rest, 10);
+                draws.push_back({ endUs, strtod(rest, nullptr) });
+            }
+#define LOAD_SCORE(name) \
+            else if (key == "score." #name) { score.name = (decltype(score.name))strtod(text, nullptr); }
+            SCORE_FIELDS(LOAD_SCORE)
+#undef LOAD_SCORE
+        });
+}
+
+// The relay drops out over a reboot
+void plantPowerOn() {
+    integrate();
+    if (pumpOn) {
+        stats().pumpOnUs += worldUs() - pumpOnSinceUs;
+        closeCycle(false);
+        pumpOn = false;
+    }
+}
+
+void outputChanged(uint8_t pin, int level) {
+    if (pin != RELAY_PIN) {
+        return;
+    }
+    integrate();
+    bool on = level == HIGH;
+    if (on == pumpOn) {
+        return;
+    }
+    if (on) {
+        stats().pumpSwitches++;
+        pumpOnSinceUs = worldUs();
+    } else {
+        stats().pumpOnUs += worldUs() - pumpOnSinceUs;
+    }
+    closeCycle(on);
+    pumpOn = on;
+    log("Pump %s (level %.1f%%)", on ? "ON" : "OFF", toPercent(levelCm));
+}
+
+// Distance from the sensor (at the full mark) to the surface
+float sensorDistance() {
+    integrate();
+    double u = uniform();
+    if (u < SENSOR_DROPOUT) {
+        return -1;
+    }
+    if (u < SENSOR_DROPOUT + SENSOR_SPIKE) {
+        return (float)(20.0 + uniform() * heightCm);
+    }
+    double noise = options().sensorNoiseCm;
+    if (pumpLpm(worldUs()) > 0) {
+        noise = sqrt(noise * noise + SENSOR_RIPPLE_CM * SENSOR_RIPPLE_CM);
+    }
+    return (float)std::max(2.0, heightCm - levelCm + gaussian() * noise);
+}
+
+float waterLevelPercent() {
+    integrate();
+    return (float)toPercent(levelCm);
+}
+
+void printScore() {
+    integrate();
+    double days = score.totalUs / 86400e6;
+    double hours = score.totalUs / 3600e6;
+    fprintf(stdout,
+            "\n"
+            "=== Control score ===\n"
+            "Pump cycles/day: %.2f\n"
+            "Overshoot:       %.2f pp mean, %.2f pp max (%u cycles)\n"
+            "Undershoot:      %.2f pp mean, %.2f pp max (%u cycles)\n"
+            "Outside band:    %.2f%% of time (%.2f%% above, %.2f%% below)\n"
+            "Level range:     %.1f%% .. %.1f%%\n"
+            "Dry:             %.1f min, %.1f L unmet\n"
+            "Spilled:         %.1f L\n"
+            "Water:           %.1f L pumped, %.1f L/day demand\n",
+            days > 0 ? stats().pumpSwitches / days : 0.0,
+            score.overshoots ? score.overshootSum / score.overshoots : 0.0, score.overshootMax, score.overshoots,
+            score.undershoots ? score.undershootSum / score.undershoots : 0.0, score.undershootMax, score.undershoots,
+            hours > 0 ? 100.0 * (score.aboveUs + score.belowUs) / score.totalUs : 0.0,
+            hours > 0 ? 100.0 * score.aboveUs / score.totalUs : 0.0,
+            hours > 0 ? 100.0 * score.belowUs / score.totalUs : 0.0,
+            score.minPercent, score.maxPercent,
+            score.dryUs / 60e6, score.unmetL,
+            score.spilledL,
+            score.pumpedL, days > 0 ? score.demandL / days : 0.0);
+}
+
+// One JSON object per run, for comparing builds over many seeds (score.sh)
+void writeScore(const std::string& path) {
+    integrate();
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "sim: cannot write %s: %s\n", path.c_str(), strerror(errno));
+        return;
+    }
+    double days = score.totalUs / 86400e6;
+    double total = score.totalUs > 0 ? (double)score.totalUs : 1.0;
+    fprintf(file,
+            "{\"seed\":%llu,\"days\":%.4f,\"cyclesPerDay\":%.4f,"
+            "\"overshootMean\":%.4f,\"overshootMax\":%.4f,"
+            "\"undershootMean\":%.4f,\"undershootMax\":%.4f,"
+            "\"outsideBand\":%.6f,\"above\":%.6f,\"below\":%.6f,"
+            "\"dryMinutes\":%.3f,\"unmetL\":%.3f,\"spilledL\":%.3f,"
+            "\"pumpedL\":%.3f,\"demandL\":%.3f}\n",
+            (unsigned long long)options().seed, days, days > 0 ? stats().pumpSwitches / days : 0.0,
+            score.overshoots ? score.overshootSum / score.overshoots : 0.0, score.overshootMax,
+            score.undershoots ? score.undershootSum / score.undershoots : 0.0, score.undershootMax,
+            (score.aboveUs + score.belowUs) / total, score.aboveUs / total, score.belowUs / total,
+            score.dryUs / 60e6, score.unmetL, score.spilledL,
+            score.pumpedL, score.demandL);
+    fclose(file);
+}
+
+} // namespace sim
@@ -0,0 +1,702 @@
+#include <Arduino.h>
+#include "sim.h"
+
+#include <ucontext.h>
+#include <map>
+#include <deque>
+
+// ============================================================================
+// COOPERATIVE SCHEDULER + FREERTOS API
+// ============================================================================
+// Each task is a ucontext coroutine with its own heap stack. The scheduler
+// context picks the highest-priority ready task (FIFO among equals) and
+// switches to it; the task switches back when it blocks. With nothing ready,
+// the clock jumps to the earliest task timeout or world event.
+
+// Host code needs far more stack than the device budgets (no -Os, glibc
+// printf, sanitizers), so requested sizes are only recorded
+#define SIM_TASK_STACK (512 * 1024)
+
+// A task that polls millis() this often without blocking is spinning
+// (busy wait) - charge it a tick so the clock can move
+#define SIM_SPIN_LIMIT 10000
+
+enum SimTaskState {
+    TASK_READY,
+    TASK_BLOCKED,
+    TASK_DONE
+};
+
+struct SimTask {
+    uint32_t id;
+    std::string name;
+    UBaseType_t priority;
+    uint32_t requestedStack;
+    TaskFunction_t function;
+    void* parameter;
+
+    ucontext_t context;
+    char* stack;
+
+    SimTaskState state;
+    uint64_t readySeq;       // FIFO order among equal priorities
+    uint64_t wakeAt;         // Timeout (device us), UINT64_MAX = none
+    const void* waitingOn;   // Queue / notification the task sleeps on
+    uint32_t notifyCount;
+    uint32_t criticalDepth;
+};
+
+struct SimQueue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+
+    // Semaphores keep a count instead of items
+    bool semaphore;
+    bool mutex;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    SimTask* holder;
+    UBaseType_t recursion;
+};
+
+static std::vector<SimTask*> tasks;
+static SimTask* current = nullptr;
+static ucontext_t schedulerContext;
+static uint64_t clockUs = 0;
+static uint64_t readyCounter = 0;
+static uint64_t eventCounter = 0;
+static uint32_t nextTaskId = 1;
+static std::multimap<std::pair<uint64_t, uint64_t>, sim::Event> events;
+static bool isrActive = false;
+static uint32_t spinCount = 0;
+static uint64_t endDeviceUs = UINT64_MAX;
+
+namespace sim {
+
+uint64_t now() {
+    return clockUs;
+}
+
+bool inTask() {
+    return current != nullptr;
+}
+
+bool inIsr() {
+    return isrActive;
+}
+
+void setIsr(bool active) {
+    isrActive = active;
+}
+
+const char* currentTaskName() {
+    return current ? current->name.c_str() : "world";
+}
+
+void at(uint64_t deviceUs, Event event) {
+    if (deviceUs < clockUs) {
+        deviceUs = clockUs;
+    }
+    events.emplace(std::make_pair(deviceUs, eventCounter++), std::move(event));
+}
+
+void after(uint64_t us, Event event) {
+    at(clockUs + us, std::move(event));
+}
+
+void atWorld(uint64_t world, Event event) {
+    at(toDeviceUs(world), std::move(event));
+}
+
+} // namespace sim
+
+// ----------------------------------------------------------------------------
+// Switching
+// ----------------------------------------------------------------------------
+
+static void makeReady(SimTask* task) {
+    if (task->state == TASK_BLOCKED) {
+        task->state = TASK_READY;
+        task->readySeq = readyCounter++;
+        task->wakeAt = UINT64_MAX;
+        task->waitingOn = nullptr;
+    }
+}
+
+// Wake every task blocked on 'object' - they re-check their condition
+static void wakeWaiters(const void* object) {
+    for (SimTask* task : tasks) {
+        if (task->state == TASK_BLOCKED && task->waitingOn == object) {
+            makeReady(task);
+        }
+    }
+}
+
+// Switch from the current task back to the scheduler
+static void switchOut() {
+    SimTask* self = current;
+    spinCount = 0;
+    swapcontext(&self->context, &schedulerContext);
+}
+
+// Block the current task until woken via 'object' or until 'deadline'
+static void blockOn(const void* object, uint64_t deadline) {
+    if (current == nullptr) {
+        return;  // Called before the scheduler runs - nothing to wait for
+    }
+    current->state = TASK_BLOCKED;
+    current->waitingOn = object;
+    current->wakeAt = deadline;
+    switchOut();
+}
+
+static uint64_t deadlineFor(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        return UINT64_MAX;
+    }
+    return clockUs + (uint64_t)ticks * (1000000ULL / configTICK_RATE_HZ);
+}
+
+static void taskEntry() {
+    SimTask* self = current;
+    self->function(self->parameter);
+
+    // Returning from a task function is a bug on FreeRTOS (it must delete itself)
+    sim::log("task '%s' returned without vTaskDelete - deleting it", self->name.c_str());
+    vTaskDelete(NULL);
+}
+
+static SimTask* pickNext() {
+    SimTask* best = nullptr;
+    for (SimTask* task : tasks) {
+        if (task->state != TASK_READY) {
+            continue;
+        }
+        if (best == nullptr || task->priority > best->priority ||
+            (task->priority == best->priority && task->readySeq < best->readySeq)) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+static void reapDone() {
+    for (size_t i = 0; i < tasks.size();) {
+        SimTask* task = tasks[i];
+        if (task->state == TASK_DONE && task != current) {
+            free(task->stack);
+            delete task;
+            tasks.erase(tasks.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// Advance the clock to the next timeout/event and fire what is due
+static bool advanceClock() {
+    uint64_t next = UINT64_MAX;
+    for (SimTask* task : tasks) {
+        if (task->state == TASK_BLOCKED && task->wakeAt < next) {
+            next = task->wakeAt;
+        }
+    }
+    if (!events.empty() && events.begin()->first.first < next) {
+        next = events.begin()->first.first;
+    }
+
+    if (next == UINT64_MAX || next >= endDeviceUs) {
+        return false;
+    }
+    if (next > clockUs) {
+        clockUs = next;
+    }
+
+    // Events first (hardware/world changes), then timeouts
+    while (!events.empty() && events.begin()->first.first <= clockUs) {
+        sim::Event event = std::move(events.begin()->second);
+        events.erase(events.begin());
+        event();
+    }
+
+    for (SimTask* task : tasks) {
+        if (task->state == TASK_BLOCKED && task->wakeAt <= clockUs) {
+            makeReady(task);
+        }
+    }
+    return true;
+}
+
+// Arduino sketch entry points (src/main.cpp)
+void setup();
+void loop();
+
+namespace sim {
+
+void sleep(uint64_t us) {
+    if (current == nullptr || isrActive) {
+        clockUs += us;  // Outside a task (early init) the time just passes
+        return;
+    }
+    blockOn(nullptr, clockUs + us);
+}
+
+void runScheduler() {
+    uint64_t endWorld = options().durationUs;
+    endDeviceUs = worldUs() >= endWorld ? clockUs : toDeviceUs(endWorld);
+
+    xTaskCreatePinnedToCore([](void*) {
+        setup();
+        for (;;) {
+            loop();
+        }
+    }, "loopTask", 8192, NULL, 1, NULL, 1);
+
+    for (;;) {
+        SimTask* task = pickNext();
+        if (task == nullptr) {
+            reapDone();
+            if (!advanceClock()) {
+                clockUs = endDeviceUs;
+                finish();
+            }
+            continue;
+        }
+
+        current = task;
+        swapcontext(&schedulerContext, &task->context);
+        current = nullptr;
+    }
+}
+
+void setClock(uint64_t deviceUs) {
+    if (deviceUs > clockUs) {
+        clockUs = deviceUs;
+    }
+}
+
+} // namespace sim
+
+// Called from millis()/micros(): a task spinning on the clock gets charged
+// one tick and yields so the rest of the system (and time) can move
+void sim_noteClockPoll() {
+    if (current == nullptr || isrActive || current->criticalDepth > 0) {
+        return;
+    }
+    if (++spinCount >= SIM_SPIN_LIMIT) {
+        sim::sleep(1000);
+    }
+}
+
+// ============================================================================
+// CRITICAL SECTIONS
+// ============================================================================
+
+void sim_enterCritical(portMUX_TYPE* mux) {
+    mux->count++;
+    if (current != nullptr) {
+        current->criticalDepth++;
+    }
+}
+
+void sim_exitCritical(portMUX_TYPE* mux) {
+    if (mux->count > 0) {
+        mux->count--;
+    }
+    if (current != nullptr && current->criticalDepth > 0) {
+        current->criticalDepth--;
+    }
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    (void)core;
+
+    SimTask* task = new SimTask();
+    task->id = nextTaskId++;
+    task->name = name ? name : "task";
+    task->priority = priority < configMAX_PRIORITIES ? priority : configMAX_PRIORITIES - 1;
+    task->requestedStack = stackDepth;
+    task->function = function;
+    task->parameter = parameter;
+    task->stack = (char*)malloc(SIM_TASK_STACK);
+    task->state = TASK_READY;
+    task->readySeq = readyCounter++;
+    task->wakeAt = UINT64_MAX;
+    task->waitingOn = nullptr;
+    task->notifyCount = 0;
+    task->criticalDepth = 0;
+
+    if (task->stack == nullptr) {
+        delete task;
+        return pdFAIL;
+    }
+
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = SIM_TASK_STACK;
+    task->context.uc_link = nullptr;
+    makecontext(&task->context, taskEntry, 0);
+
+    tasks.push_back(task);
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current;
+    }
+    if (task == nullptr) {
+        return;
+    }
+
+    task->state = TASK_DONE;
+    task->waitingOn = nullptr;
+
+    if (task == current) {
+        switchOut();  // Never resumed - the stack is freed by the scheduler
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim::sleep((uint64_t)ticks * (1000000ULL / configTICK_RATE_HZ));
+}
+
+void taskYIELD() {
+    if (current == nullptr) {
+        return;
+    }
+    current->readySeq = readyCounter++;  // Back of the line among equals
+    switchOut();
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(clockUs / (1000000ULL / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current;
+    }
+    return task ? task->name.c_str() : "world";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current;
+    }
+    return task ? task->requestedStack / 2 : 0;  // Not measurable on the host
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current;
+    }
+    return task ? task->priority : 0;
+}
+
+BaseType_t xPortGetCoreID() {
+    return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Notifications
+// ----------------------------------------------------------------------------
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (task == nullptr || task->state == TASK_DONE) {
+        return pdPASS;
+    }
+    task->notifyCount++;
+    if (task->state == TASK_BLOCKED && task->waitingOn == &task->notifyCount) {
+        makeReady(task);
+    }
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    SimTask* self = current;
+    if (self == nullptr) {
+        return 0;
+    }
+
+    uint64_t deadline = deadlineFor(ticksToWait);
+    while (self->notifyCount == 0 && clockUs < deadline && ticksToWait != 0) {
+        blockOn(&self->notifyCount, deadline);
+    }
+
+    uint32_t value = self->notifyCount;
+    if (value > 0) {
+        self->notifyCount = clearCountOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+// ============================================================================
+// QUEUES
+// ============================================================================
+
+static SimQueue* newQueue(UBaseType_t length, UBaseType_t itemSize, bool semaphore) {
+    SimQueue* queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->semaphore = semaphore;
+    queue->mutex = false;
+    queue->count = 0;
+    queue->maxCount = length;
+    queue->holder = nullptr;
+    queue->recursion = 0;
+    return queue;
+}
+
+static bool queueFull(SimQueue* queue) {
+    return queue->semaphore ? queue->count >= queue->maxCount : queue->items.size() >= queue->length;
+}
+
+static bool queueEmpty(SimQueue* queue) {
+    return queue->semaphore ? queue->count == 0 : queue->items.empty();
+}
+
+static bool pushItem(SimQueue* queue, const void* item, bool front) {
+    if (queueFull(queue)) {
+        return false;
+    }
+    if (queue->semaphore) {
+        queue->count++;
+    } else {
+        const uint8_t* bytes = static_cast<const uint8_t*>(item);
+        std::vector<uint8_t> copy(bytes, bytes + queue->itemSize);
+        if (front) {
+            queue->items.push_front(std::move(copy));
+        } else {
+            queue->items.push_back(std::move(copy));
+        }
+    }
+    wakeWaiters(queue);
+    return true;
+}
+
+static BaseType_t sendItem(QueueHandle_t queue, const void* item, TickType_t ticksToWait, bool front) {
+    if (queue == nullptr) {
+        return errQUEUE_FULL;
+    }
+
+    uint64_t deadline = deadlineFor(ticksToWait);
+    while (!pushItem(queue, item, front)) {
+        if (ticksToWait == 0 || clockUs >= deadline || current == nullptr || isrActive) {
+            return errQUEUE_FULL;
+        }
+        blockOn(queue, deadline);
+    }
+    return pdPASS;
+}
+
+static BaseType_t receiveItem(QueueHandle_t queue, void* buffer, TickType_t ticksToWait, bool peek) {
+    if (queue == nullptr) {
+        return pdFALSE;
+    }
+
+    uint64_t deadline = deadlineFor(ticksToWait);
+    while (queueEmpty(queue)) {
+        if (ticksToWait == 0 || clockUs >= deadline || current == nullptr || isrActive) {
+            return pdFALSE;
+        }
+        blockOn(queue, deadline);
+    }
+
+    if (queue->semaphore) {
+        if (!peek) {
+            queue->count--;
+        }
+    } else {
+        if (buffer != nullptr) {
+            memcpy(buffer, queue->items.front().data(), queue->itemSize);
+        }
+        if (!peek) {
+            queue->items.pop_front();
+        }
+    }
+    if (!peek) {
+        wakeWaiters(queue);  // Senders waiting for space
+    }
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) {
+        return NULL;
+    }
+    return newQueue(length, itemSize, false);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == nullptr) {
+        return;
+    }
+    wakeWaiters(queue);
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return sendItem(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return sendItem(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    if (queue == nullptr) {
+        return pdFAIL;
+    }
+    queue->items.clear();
+    return sendItem(queue, item, 0, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higherPriorityTaskWoken) {
+    BaseType_t result = sendItem(queue, item, 0, false);
+    if (result == pdPASS && higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+    return result;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return receiveItem(queue, buffer, ticksToWait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return receiveItem(queue, buffer, ticksToWait, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    if (queue != nullptr) {
+        queue->items.clear();
+        if (queue->semaphore && !queue->mutex) {
+            queue->count = 0;
+        }
+        wakeWaiters(queue);
+    }
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    if (queue == nullptr) {
+        return 0;
+    }
+    return queue->semaphore ? queue->count : (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    if (queue == nullptr) {
+        return 0;
+    }
+    return queue->semaphore ? queue->maxCount - queue->count : queue->length - (UBaseType_t)queue->items.size();
+}
+
+// ============================================================================
+// SEMAPHORES
+// ============================================================================
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SimQueue* queue = newQueue(1, 0, true);
+    queue->mutex = true;
+    queue->count = 1;
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return xSemaphoreCreateMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return newQueue(1, 0, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    SimQueue* queue = newQueue(maxCount, 0, true);
+    queue->count = initialCount;
+    return queue;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    vQueueDelete(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    BaseType_t result = receiveItem(semaphore, nullptr, ticksToWait, false);
+    if (result == pdTRUE && semaphore->mutex) {
+        semaphore->holder = current;
+    }
+    return result;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (semaphore == nullptr) {
+        return pdFALSE;
+    }
+    if (semaphore->mutex) {
+        if (semaphore->count > 0) {
+            return pdFALSE;  // Not taken
+        }
+        semaphore->holder = nullptr;
+    }
+    return pushItem(semaphore, nullptr, false) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    if (semaphore != nullptr && semaphore->holder == current && current != nullptr) {
+        semaphore->recursion++;
+        return pdTRUE;
+    }
+    return xSemaphoreTake(semaphore, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    if (semaphore != nullptr && semaphore->recursion > 0) {
+        semaphore->recursion--;
+        return pdTRUE;
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken) {
+    BaseType_t result = xSemaphoreGive(semaphore);
+    if (result == pdTRUE && higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+    return result;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    return uxQueueMessagesWaiting(semaphore);
+}
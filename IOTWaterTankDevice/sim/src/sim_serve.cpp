@@ -0,0 +1,406 @@
+#include <Arduino.h>
+#include "sim.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// BACKEND OVER HTTP (--serve)
+// ============================================================================
+// The simulated backend answering a real device on the LAN. Point the
+// device at it with POST /{id}/server {"url":"http://<host>:<port>",...}.
+// World time is real time since the start, so scripted faults (--slow,
+// --http-errors, --truncate, --backend-outage, token expiry and
+// revocation) play out on the wall clock.
+//
+// Single thread, non-blocking sockets. An answer is held for its server
+// time (plus --slow) before it is written; a truncated answer announces
+// the full Content-Length and closes early; during an outage the
+// connection is closed without an answer.
+
+#define SERVE_MAX_CONNECTIONS 1000     // Stays under the default 1024 descriptors
+#define SERVE_MAX_REQUEST (64 * 1024)
+#define SERVE_IDLE_TIMEOUT_US 30000000ULL
+
+struct Connection {
+    int fd;
+    std::string in;               // Received, not yet parsed
+    std::string out;              // Answer being written
+    uint64_t sendAtUs;            // Answer held until (device clock)
+    bool answering;
+    bool closeAfter;
+    uint64_t lastActiveUs;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+static uint64_t startRealUs = 0;
+
+static uint64_t realUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void updateClock() {
+    sim::setClock(realUs() - startRealUs);
+}
+
+static const char* statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 206: return "Partial Content";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default: return "Unknown";
+    }
+}
+
+static std::string lower(std::string text) {
+    for (char& c : text) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return text;
+}
+
+// ----------------------------------------------------------------------------
+// Request parsing
+// ----------------------------------------------------------------------------
+
+enum ParseResult { PARSE_INCOMPLETE, PARSE_OK, PARSE_BAD };
+
+// One request off the front of 'in'
+static ParseResult parseRequest(std::string& in, sim::HttpRequest& request, bool& keepAlive) {
+    size_t headerEnd = in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return in.size() > SERVE_MAX_REQUEST ? PARSE_BAD : PARSE_INCOMPLETE;
+    }
+
+    size_t lineEnd = in.find("\r\n");
+    std::string requestLine = in.substr(0, lineEnd);
+    size_t space1 = requestLine.find(' ');
+    size_t space2 = requestLine.rfind(' ');
+    if (space1 == std::string::npos || space2 == space1) {
+        return PARSE_BAD;
+    }
+    std::string target = requestLine.substr(space1 + 1, space2 - space1 - 1);
+    std::string version = requestLine.substr(space2 + 1);
+
+    request = sim::HttpRequest();
+    request.method = requestLine.substr(0, space1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query = question == std::string::npos ? "" : target.substr(question + 1);
+
+    keepAlive = version == "HTTP/1.1";
+    size_t contentLength = 0;
+    size_t position = lineEnd + 2;
+    while (position < headerEnd) {
+        size_t end = in.find("\r\n", position);
+        std::string line = in.substr(position, end - position);
+        position = end + 2;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = lower(line.substr(0, colon));
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(' '));
+
+        if (name == "authorization") {
+            request.authorization = value;
+        } else if (name == "range") {
+            request.range = value;
+        } else if (name == "content-length") {
+            contentLength = strtoul(value.c_str(), nullptr, 10);
+        } else if (name == "connection") {
+            keepAlive = lower(value) != "close";
+        }
+    }
+
+    if (contentLength > SERVE_MAX_REQUEST) {
+        return PARSE_BAD;
+    }
+    if (in.size() < headerEnd + 4 + contentLength) {
+        return PARSE_INCOMPLETE;
+    }
+    request.body = in.substr(headerEnd + 4, contentLength);
+    in.erase(0, headerEnd + 4 + contentLength);
+    return PARSE_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Connections
+// ----------------------------------------------------------------------------
+
+static void answer(Connection& connection, const sim::HttpRequest& request, bool keepAlive) {
+    sim::stats().httpRequests++;
+
+    // Outage: the connection just goes away
+    if (!sim::backendAvailable()) {
+        sim::log("%s %s -> connection dropped (outage)", request.method.c_str(), request.path.c_str());
+        connection.closeAfter = true;
+        connection.answering = true;
+        connection.sendAtUs = sim::now();
+        return;
+    }
+
+    sim::HttpResponse response = sim::backendRequest(request);
+    bool truncated = response.truncateAt != SIZE_MAX;
+
+    char header[256];
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %d %s\r\n"
+             "Content-Type: application/json\r\n"
+             "Content-Length: %zu\r\n"
+             "Connection: %s\r\n"
+             "\r\n",
+             response.status, statusText(response.status), response.body.size(),
+             keepAlive && !truncated ? "keep-alive" : "close");
+
+    connection.out = header;
+    connection.out += truncated ? response.body.substr(0, response.truncateAt) : response.body;
+    connection.sendAtUs = sim::now() + response.serverUs;
+    connection.closeAfter = !keepAlive || truncated;
+    connection.answering = true;
+
+    if (!sim::options().quiet) {
+        sim::log("%s %s -> %d (%zu bytes%s, %llu ms)", request.method.c_str(), request.path.c_str(),
+                 response.status, response.body.size(), truncated ? ", truncated" : "",
+                 (unsigned long long)(response.serverUs / 1000));
+    }
+}
+
+// Reads what arrived and starts the next answer; false = close
+static bool readFrom(Connection& connection) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            connection.in.append(buffer, (size_t)n);
+            connection.lastActiveUs = sim::now();
+            continue;
+        }
+        if (n == 0) {
+            return false;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        return errno == EINTR;
+    }
+
+    if (connection.answering) {
+        return true;
+    }
+
+    sim::HttpRequest request;
+    bool keepAlive;
+    switch (parseRequest(connection.in, request, keepAlive)) {
+        case PARSE_INCOMPLETE:
+            return true;
+        case PARSE_BAD:
+            return false;
+        case PARSE_OK:
+            answer(connection, request, keepAlive);
+            return true;
+    }
+    return true;
+}
+
+// Writes a due answer; false = close
+static bool writeTo(Connection& connection) {
+    if (!connection.answering || sim::now() < connection.sendAtUs) {
+        return true;
+    }
+
+    while (!connection.out.empty()) {
+        ssize_t n = send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            connection.out.erase(0, (size_t)n);
+            connection.lastActiveUs = sim::now();
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+
+    connection.answering = false;
+    if (connection.closeAfter) {
+        return false;
+    }
+
+    // A pipelined request may already be waiting
+    sim::HttpRequest request;
+    bool keepAlive;
+    ParseResult result = parseRequest(connection.in, request, keepAlive);
+    if (result == PARSE_BAD) {
+        return false;
+    }
+    if (result == PARSE_OK) {
+        answer(connection, request, keepAlive);
+    }
+    return true;
+}
+
+static int listenOn(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void printServeSummary() {
+    const sim::Stats& s = sim::stats();
+    fprintf(stdout,
+            "\n"
+            "=== Backend summary (served %s) ===\n"
+            "HTTP:            %llu requests\n"
+            "Logins:          %u\n"
+            "Config:          %u fetches, %u uploads\n"
+            "Control:         %u fetches, %u uploads\n"
+            "Telemetry:       %llu live, %llu from backlog\n"
+            "Time:            %u HTTP syncs\n"
+            "OTA:             %u checks, %u downloads\n"
+            "Faults:          %u 5xx, %u truncated, %u slowed, %u unauthorized\n",
+            sim::formatWorld(sim::worldUs()).c_str(),
+            (unsigned long long)s.httpRequests,
+            s.logins,
+            s.configFetches, s.configUploads,
+            s.controlFetches, s.controlUploads,
+            (unsigned long long)s.telemetry, (unsigned long long)s.telemetryBatched,
+            s.timeSyncs,
+            s.otaChecks, s.otaDownloads,
+            s.faultErrors, s.faultTruncations, s.faultSlow, s.unauthorized);
+    fflush(stdout);
+}
+
+namespace sim {
+
+void serveBackend(uint16_t port) {
+    // The device cross-checks this against NTP, so it must be real time
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    options().startEpochMs = (uint64_t)wall.tv_sec * 1000 + wall.tv_nsec / 1000000;
+    startRealUs = realUs();
+
+    int listener = listenOn(port);
+    if (listener < 0) {
+        fprintf(stderr, "sim: cannot listen on port %u: %s\n", port, strerror(errno));
+        exit(2);
+    }
+
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGTERM, [](int) { stopRequested = 1; });
+    signal(SIGPIPE, SIG_IGN);
+
+    log("Backend listening on port %u (Ctrl-C to stop)", port);
+
+    std::vector<Connection> connections;
+    while (!stopRequested) {
+        updateClock();
+
+        // Sleep until something arrives or the next held answer is due
+        int timeoutMs = 1000;
+        std::vector<struct pollfd> fds;
+        fds.push_back({ listener, POLLIN, 0 });
+        for (const Connection& connection : connections) {
+            short events = POLLIN;
+            if (connection.answering) {
+                if (now() >= connection.sendAtUs) {
+                    events |= POLLOUT;
+                } else {
+                    timeoutMs = std::min<int>(timeoutMs, (int)((connection.sendAtUs - now()) / 1000) + 1);
+                }
+            }
+            fds.push_back({ connection.fd, events, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR) {
+            break;
+        }
+        updateClock();
+
+        std::vector<Connection> open;
+        for (size_t i = 0; i < connections.size(); i++) {
+            Connection& connection = connections[i];
+            bool keep = true;
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                keep = readFrom(connection);
+            }
+            if (keep) {
+                keep = writeTo(connection);
+            }
+            if (keep && !connection.answering && now() - connection.lastActiveUs > SERVE_IDLE_TIMEOUT_US) {
+                keep = false;
+            }
+            if (keep) {
+                open.push_back(connection);
+            } else {
+                close(connection.fd);
+            }
+        }
+        connections.swap(open);
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+                if (connections.size() >= SERVE_MAX_CONNECTIONS) {
+                    close(fd);
+                    continue;
+                }
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                Connection connection;
+                connection.fd = fd;
+                connection.sendAtUs = 0;
+                connection.answering = false;
+                connection.closeAfter = false;
+                connection.lastActiveUs = now();
+                connections.push_back(connection);
+            }
+        }
+    }
+
+    for (const Connection& connection : connections) {
+        close(connection.fd);
+    }
+    close(listener);
+
+    log("Backend stopped");
+    saveState();
+    printServeSummary();
+    exit(0);
+}
+
+} // namespace sim
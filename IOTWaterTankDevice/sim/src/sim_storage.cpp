@@ -0,0 +1,796 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <Update.h>
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+#include "config.h"
+#include "sim.h"
+
+#include <errno.h>
+#include <map>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// NVS (Preferences)
+// ============================================================================
+// Type tags follow the NVS entry types so a type mismatch reads the default
+
+#define NVS_U8     'c'
+#define NVS_I16    'h'
+#define NVS_U16    'H'
+#define NVS_I32    'i'
+#define NVS_U32    'I'
+#define NVS_I64    'l'
+#define NVS_U64    'L'
+#define NVS_STRING 's'
+#define NVS_BLOB   'x'
+
+struct NvsEntry {
+    char type;
+    std::vector<uint8_t> data;
+};
+
+typedef std::map<std::string, std::map<std::string, NvsEntry>> NvsStore;
+static NvsStore nvs;
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+    (void)partitionLabel;
+    if (open) {
+        return false;
+    }
+    if (name == nullptr || strlen(name) > 15) {
+        return false;
+    }
+    // nvs_open(READONLY) fails for a namespace that was never written
+    if (readOnly && nvs.find(name) == nvs.end()) {
+        return false;
+    }
+    ns = name;
+    this->readOnly = readOnly;
+    open = true;
+    return true;
+}
+
+void Preferences::end() {
+    open = false;
+}
+
+bool Preferences::clear() {
+    if (!open || readOnly) {
+        return false;
+    }
+    nvs[ns.c_str()].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!open || readOnly) {
+        return false;
+    }
+    return nvs[ns.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!open) {
+        return false;
+    }
+    auto space = nvs.find(ns.c_str());
+    return space != nvs.end() && space->second.count(key) > 0;
+}
+
+size_t Preferences::put(const char* key, char type, const void* value, size_t length) {
+    if (!open || readOnly || key == nullptr || strlen(key) > 15) {
+        return 0;
+    }
+    NvsEntry& entry = nvs[ns.c_str()][key];
+    entry.type = type;
+    entry.data.assign((const uint8_t*)value, (const uint8_t*)value + length);
+    return length;
+}
+
+bool Preferences::get(const char* key, char type, void* value, size_t length) {
+    if (!open || key == nullptr) {
+        return false;
+    }
+    auto space = nvs.find(ns.c_str());
+    if (space == nvs.end()) {
+        return false;
+    }
+    auto entry = space->second.find(key);
+    if (entry == space->second.end() || entry->second.type != type || entry->second.data.size() != length) {
+        return false;
+    }
+    memcpy(value, entry->second.data.data(), length);
+    return true;
+}
+
+#define NVS_SCALAR(Name, Type, Tag)                                         \
+    size_t Preferences::put##Name(const char* key, Type value) {            \
+        return put(key, Tag, &value, sizeof(value));                        \
+    }                                                                       \
+    Type Preferences::get##Name(const char* key, Type defaultValue) {       \
+        Type value;                                                         \
+        return get(key, Tag, &value, sizeof(value)) ? value : defaultValue; \
+    }
+
+NVS_SCALAR(UChar, uint8_t, NVS_U8)
+NVS_SCALAR(Short, int16_t, NVS_I16)
+NVS_SCALAR(UShort, uint16_t, NVS_U16)
+NVS_SCALAR(Int, int32_t, NVS_I32)
+NVS_SCALAR(UInt, uint32_t, NVS_U32)
+NVS_SCALAR(Long, int32_t, NVS_I32)
+NVS_SCALAR(ULong, uint32_t, NVS_U32)
+NVS_SCALAR(Long64, int64_t, NVS_I64)
+NVS_SCALAR(ULong64, uint64_t, NVS_U64)
+NVS_SCALAR(Float, float, NVS_BLOB)
+NVS_SCALAR(Double, double, NVS_BLOB)
+
+// Preferences stores bools as uint8_t
+size_t Preferences::putBool(const char* key, bool value) {
+    return putUChar(key, value ? 1 : 0);
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (value == nullptr) {
+        return 0;
+    }
+    return put(key, NVS_STRING, value, strlen(value) + 1) > 0 ? strlen(value) : 0;
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+    return putString(key, value.c_str());
+}
+
+String Preferences::getString(const char* key, const String defaultValue) {
+    if (!open || key == nullptr) {
+        return defaultValue;
+    }
+    auto space = nvs.find(ns.c_str());
+    if (space == nvs.end()) {
+        return defaultValue;
+    }
+    auto entry = space->second.find(key);
+    if (entry == space->second.end() || entry->second.type != NVS_STRING) {
+        return defaultValue;
+    }
+    return String((const char*)entry->second.data.data());
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    String s = getString(key, String());
+    if (value == nullptr || maxLen == 0 || s.length() + 1 > maxLen) {
+        return 0;
+    }
+    memcpy(value, s.c_str(), s.length() + 1);
+    return s.length() + 1;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (value == nullptr || length == 0) {
+        return 0;
+    }
+    return put(key, NVS_BLOB, value, length);
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!open || key == nullptr) {
+        return 0;
+    }
+    auto space = nvs.find(ns.c_str());
+    if (space == nvs.end()) {
+        return 0;
+    }
+    auto entry = space->second.find(key);
+    if (entry == space->second.end() || entry->second.type != NVS_BLOB) {
+        return 0;
+    }
+    return entry->second.data.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLen) {
+    size_t length = getBytesLength(key);
+    if (length == 0 || buffer == nullptr || length > maxLen) {
+        return 0;
+    }
+    memcpy(buffer, nvs[ns.c_str()][key].data.data(), length);
+    return length;
+}
+
+namespace sim {
+
+void nvsPutString(const char* space, const char* key, const char* value) {
+    NvsEntry& entry = nvs[space][key];
+    entry.type = NVS_STRING;
+    entry.data.assign(value, value + strlen(value) + 1);
+}
+
+void nvsPutBool(const char* space, const char* key, bool value) {
+    NvsEntry& entry = nvs[space][key];
+    entry.type = NVS_U8;
+    entry.data.assign(1, value ? 1 : 0);
+}
+
+} // namespace sim
+
+// ============================================================================
+// LITTLEFS (host directory)
+// ============================================================================
+
+fs::LittleFSFS LittleFS;
+
+static std::string fsRoot() {
+    return sim::options().stateDir + "/fs";
+}
+
+static std::string hostPath(const char* path) {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') {
+        p = "/" + p;
+    }
+    return fsRoot() + p;
+}
+
+namespace fs {
+
+class FileImpl {
+public:
+    FileImpl(const std::string& path, FILE* file, bool directory)
+        : path(path), file(file), directory(directory), dir(nullptr) {
+        size_t slash = path.find_last_of('/');
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+        if (directory) {
+            dir = opendir(hostPath(path.c_str()).c_str());
+        }
+    }
+
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+        if (dir) {
+            closedir(dir);
+            dir = nullptr;
+        }
+        directory = false;
+    }
+
+    std::string path;
+    std::string name;
+    FILE* file;
+    bool directory;
+    DIR* dir;
+};
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!impl || !impl->file) {
+        return 0;
+    }
+    return fwrite(buffer, 1, size, impl->file);
+}
+
+int File::available() {
+    if (!impl || !impl->file) {
+        return 0;
+    }
+    return (int)(size() - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!impl || !impl->file) {
+        return -1;
+    }
+    int c = fgetc(impl->file);
+    if (c != EOF) {
+        ungetc(c, impl->file);
+    }
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (impl && impl->file) {
+        fflush(impl->file);
+    }
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!impl || !impl->file) {
+        return 0;
+    }
+    return fread(buffer, 1, size, impl->file);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl || !impl->file) {
+        return false;
+    }
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    if (fseek(impl->file, pos, whence) != 0) {
+        return false;
+    }
+    // LittleFS refuses seeking past the end
+    return position() <= size();
+}
+
+size_t File::position() const {
+    if (!impl || !impl->file) {
+        return 0;
+    }
+    return (size_t)ftell(impl->file);
+}
+
+size_t File::size() const {
+    if (!impl || !impl->file) {
+        return 0;
+    }
+    fflush(impl->file);
+    struct stat st;
+    return fstat(fileno(impl->file), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    if (impl) {
+        impl->close();
+        impl.reset();
+    }
+}
+
+File::operator bool() const {
+    return impl && (impl->file != nullptr || impl->directory);
+}
+
+const char* File::path() const {
+    return impl ? impl->path.c_str() : "";
+}
+
+const char* File::name() const {
+    return impl ? impl->name.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return impl && impl->directory;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!impl || !impl->dir) {
+        return File();
+    }
+    struct dirent* entry;
+    while ((entry = readdir(impl->dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        std::string child = impl->path;
+        if (child.empty() || child.back() != '/') {
+            child += "/";
+        }
+        child += entry->d_name;
+        return LittleFS.open(child.c_str(), mode);
+    }
+    return File();
+}
+
+void File::rewindDirectory() {
+    if (impl && impl->dir) {
+        rewinddir(impl->dir);
+    }
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    (void)create;
+    std::string host = hostPath(path);
+    struct stat st;
+
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        return File(std::make_shared<FileImpl>(path, nullptr, true));
+    }
+
+    const char* hostMode = "rb";
+    if (strcmp(mode, "w") == 0) {
+        hostMode = "w+b";
+    } else if (strcmp(mode, "a") == 0) {
+        hostMode = "a+b";
+    } else if (strcmp(mode, "r+") == 0) {
+        hostMode = "r+b";
+    }
+
+    FILE* file = fopen(host.c_str(), hostMode);
+    if (file == nullptr) {
+        return File();
+    }
+    return File(std::make_shared<FileImpl>(path, file, false));
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool FS::rmdir(const char* path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    ::mkdir(fsRoot().c_str(), 0755);
+    mounted = true;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    std::string command = "rm -rf '" + fsRoot() + "' && mkdir -p '" + fsRoot() + "'";
+    return system(command.c_str()) == 0;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return 1536 * 1024;  // littlefs partition of the default layout
+}
+
+size_t LittleFSFS::usedBytes() {
+    return 0;
+}
+
+} // namespace fs
+
+// ============================================================================
+// OTA PARTITIONS + UPDATE
+// ============================================================================
+
+#define SIM_APP_PARTITION_SIZE 0x640000   // default.csv, 16 MB flash
+
+static esp_partition_t otaPartitions[2] = {
+    { ESP_PARTITION_TYPE_APP, 0x10, 0x10000, SIM_APP_PARTITION_SIZE, "app0", false },
+    { ESP_PARTITION_TYPE_APP, 0x11, 0x650000, SIM_APP_PARTITION_SIZE, "app1", false },
+};
+
+static int runningSlot = 0;
+static std::string runningVersion;       // Image the running partition holds
+static std::string pendingVersion;       // Written + marked bootable, not booted yet
+static std::vector<uint8_t> runningImage;
+
+static void loadRunningImage() {
+    if (runningImage.empty()) {
+        runningImage = sim::firmwareImage(runningVersion);
+    }
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return &otaPartitions[runningSlot];
+}
+
+const esp_partition_t* esp_ota_get_boot_partition() {
+    return &otaPartitions[pendingVersion.empty() ? runningSlot : 1 - runningSlot];
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start) {
+    (void)start;
+    return &otaPartitions[1 - runningSlot];
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size) {
+    if (partition == nullptr || srcOffset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (partition != &otaPartitions[runningSlot]) {
+        memset(dst, 0xFF, size);
+        return ESP_OK;
+    }
+
+    loadRunningImage();
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    for (size_t i = 0; i < size; i++) {
+        size_t offset = srcOffset + i;
+        out[i] = offset < runningImage.size() ? runningImage[offset] : 0xFF;  // Erased flash
+    }
+    return ESP_OK;
+}
+
+UpdateClass Update;
+
+UpdateClass::UpdateClass() : imageSize(0), running(false), finished(false), error(UPDATE_ERROR_OK) {
+}
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char* label) {
+    (void)command;
+    (void)ledPin;
+    (void)ledOn;
+    (void)label;
+
+    if (running) {
+        error = UPDATE_ERROR_BAD_ARGUMENT;
+        return false;
+    }
+    if (size == 0 || (size != UPDATE_SIZE_UNKNOWN && size > SIM_APP_PARTITION_SIZE)) {
+        error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+
+    image.clear();
+    imageSize = size;
+    running = true;
+    finished = false;
+    error = UPDATE_ERROR_OK;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t length) {
+    if (!running || error != UPDATE_ERROR_OK) {
+        return 0;
+    }
+    if (imageSize != UPDATE_SIZE_UNKNOWN && image.size() + length > imageSize) {
+        error = UPDATE_ERROR_SPACE;
+        return 0;
+    }
+    image.insert(image.end(), data, data + length);
+
+    // Flash erase + program: ~45 ms per 4 KB sector
+    sim::sleep((uint64_t)length * 45000 / 4096);
+    return length;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (!running) {
+        error = UPDATE_ERROR_ABORT;
+        return false;
+    }
+    if (!evenIfRemaining && imageSize != UPDATE_SIZE_UNKNOWN && image.size() != imageSize) {
+        error = UPDATE_ERROR_SIZE;
+        running = false;
+        return false;
+    }
+
+    std::string version = sim::firmwareVersionOf(image);
+    if (version.empty()) {
+        error = UPDATE_ERROR_MAGIC_BYTE;  // Not an image the backend published
+        running = false;
+        return false;
+    }
+
+    pendingVersion = version;
+    running = false;
+    finished = true;
+    sim::log("OTA image %s written (%u bytes) - boots after restart", version.c_str(), (unsigned)image.size());
+    sim::stats().otaInstalls++;
+    return true;
+}
+
+void UpdateClass::abort() {
+    running = false;
+    finished = false;
+    image.clear();
+    error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() const {
+    static const char* names[] = {
+        "No Error", "Flash Write Failed", "Flash Erase Failed", "Flash Read Failed", "Not Enough Space",
+        "Bad Size Given", "Stream Read Timeout", "MD5 Check Failed", "Wrong Magic Byte",
+        "Could Not Activate The Firmware", "Partition Could Not be Found", "Bad Argument", "Aborted"
+    };
+    return error < sizeof(names) / sizeof(names[0]) ? names[error] : "Unknown";
+}
+
+namespace sim {
+
+const std::string& runningFirmwareVersion() {
+    return runningVersion;
+}
+
+} // namespace sim
+
+// ============================================================================
+// SHA-256 (FIPS 180-4)
+// ============================================================================
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256Block(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+    static const uint32_t init256[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    static const uint32_t init224[8] = {
+        0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+    };
+    memcpy(ctx->state, is224 ? init224 : init256, sizeof(ctx->state));
+    ctx->length = 0;
+    ctx->buffered = 0;
+    ctx->is224 = is224;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length) {
+    ctx->length += length;
+    while (length > 0) {
+        size_t take = 64 - ctx->buffered;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(ctx->buffer + ctx->buffered, input, take);
+        ctx->buffered += take;
+        input += take;
+        length -= take;
+        if (ctx->buffered == 64) {
+            sha256Block(ctx->state, ctx->buffer);
+            ctx->buffered = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad = 0x80;
+    mbedtls_sha256_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->buffered != 56) {
+        mbedtls_sha256_update(ctx, &pad, 1);
+    }
+    uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; i++) {
+        lengthBytes[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    mbedtls_sha256_update(ctx, lengthBytes, 8);
+
+    int words = ctx->is224 ? 7 : 8;
+    for (int i = 0; i < words; i++) {
+        output[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        output[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        output[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        output[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+    return 0;
+}
+
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context* ctx, int is224) {
+    return mbedtls_sha256_starts(ctx, is224);
+}
+
+int mbedtls_sha256_update_ret(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length) {
+    return mbedtls_sha256_update(ctx, input, length);
+}
+
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    return mbedtls_sha256_finish(ctx, output);
+}
+
+int mbedtls_sha256(const unsigned char* input, size_t length, unsigned char output[32], int is224) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, is224);
+    mbedtls_sha256_update(&ctx, input, length);
+    mbedtls_sha256_finish(&ctx, output);
+    mbedtls_sha256_free(&ctx);
+    return 0;
+}
+
+// ============================================================================
+// PERSISTENCE
+// ============================================================================
+
+namespace sim {
+
+void storageBegin() {
+    registerState("nvs",
+        [](std::vector<std::pair<std::string, std::string>>& out) {
+            for (const auto& space : nvs) {
+                for (const auto& entry : space.second) {
+                    out.emplace_back(space.first + "/" + entry.first,
+                                     std::string(1, entry.second.type) + ":" +
+                                     toHex(entry.second.data.data(), entry.second.data.size()));
+                }
+            }
+        },
+        [](const std::string& key, const std::string& value) {
+            size_t slash = key.find('/');
+            if (slash == std::string::npos || value.size() < 2) {
+                return;
+            }
+            NvsEntry& entry = nvs[key.substr(0, slash)][key.substr(slash + 1)];
+            entry.type = value[0];
+            entry.data = fromHex(value.substr(2));
+        });
+
+    registerState("flash",
+        [](std::vector<std::pair<std::string, std::string>>& out) {
+            // A marked image boots from the other slot after the restart
+            if (!pendingVersion.empty()) {
+                out.emplace_back("slot", std::to_string(1 - runningSlot));
+                out.emplace_back("version", pendingVersion);
+            } else {
+                out.emplace_back("slot", std::to_string(runningSlot));
+                out.emplace_back("version", runningVersion);
+            }
+        },
+        [](const std::string& key, const std::string& value) {
+            if (key == "slot") {
+                runningSlot = atoi(value.c_str()) ? 1 : 0;
+            } else if (key == "version") {
+                runningVersion = value;
+            }
+        });
+
+    if (runningVersion.empty()) {
+        runningVersion = FIRMWARE_VERSION;
+    }
+}
+
+} // namespace sim
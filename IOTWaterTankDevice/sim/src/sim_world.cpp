@@ -0,0 +1,126 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "sim.h"
+
+// ============================================================================
+// WORLD MODEL
+// ============================================================================
+// Scenario events (button presses, outages, OTA publication, power cycles)
+// are scheduled on the world clock after each boot for whatever lies ahead.
+// The tank itself lives in sim_plant.cpp.
+
+#define BOUNCE_MAX 3                   // Contact bounces per button edge
+
+static const uint8_t buttonPins[6] = { BTN1_PIN, BTN2_PIN, BTN3_PIN, BTN4_PIN, BTN5_PIN, BTN6_PIN };
+
+// A few contact bounces, then the final level
+static void driveButton(uint8_t pin, int level) {
+    int bounces = (int)(sim::uniform() * (BOUNCE_MAX + 1));
+    uint64_t offset = 0;
+    for (int i = 0; i < bounces; i++) {
+        offset += 150 + (uint64_t)(sim::uniform() * 600);
+        int bounceLevel = (i % 2 == 0) ? !level : level;
+        sim::after(offset, [pin, bounceLevel]() { sim::setInputPin(pin, bounceLevel); });
+    }
+    sim::setInputPin(pin, bounces % 2 == 0 ? level : !level);
+    if (bounces % 2 != 0) {
+        sim::after(offset + 200, [pin, level]() { sim::setInputPin(pin, level); });
+    }
+}
+
+namespace sim {
+
+bool wifiAvailable() {
+    uint64_t now = worldUs();
+    for (const Window& outage : options().wifiOutages) {
+        if (outage.contains(now)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool backendAvailable() {
+    uint64_t now = worldUs();
+    for (const Window& outage : options().backendOutages) {
+        if (outage.contains(now)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void scenarioBegin() {
+    const Options& opts = options();
+    uint64_t now = worldUs();
+
+    plantPowerOn();
+
+    for (const ButtonPress& press : opts.presses) {
+        if (press.atUs < now || press.button < 1 || press.button > 6) {
+            continue;
+        }
+        uint8_t pin = buttonPins[press.button - 1];
+        uint8_t button = press.button;
+        uint64_t hold = press.holdUs;
+        atWorld(press.atUs, [pin, button, hold]() {
+            log("Button %u pressed (%llu ms)", button, (unsigned long long)(hold / 1000));
+            stats().buttonPresses++;
+            driveButton(pin, LOW);
+            after(hold, [pin]() { driveButton(pin, HIGH); });
+        });
+    }
+
+    for (const Window& outage : opts.wifiOutages) {
+        if (outage.startUs >= now) {
+            atWorld(outage.startUs, [outage]() {
+                log("WiFi outage for %s", formatWorld(outage.durationUs).c_str());
+                WiFi.simLinkLost();
+            });
+        }
+        if (outage.startUs + outage.durationUs >= now) {
+            atWorld(outage.startUs + outage.durationUs, []() { log("WiFi back"); });
+        }
+    }
+
+    for (const Window& outage : opts.backendOutages) {
+        if (outage.startUs >= now) {
+            atWorld(outage.startUs, [outage]() {
+                log("Backend outage for %s", formatWorld(outage.durationUs).c_str());
+            });
+        }
+        if (outage.startUs + outage.durationUs >= now) {
+            atWorld(outage.startUs + outage.durationUs, []() { log("Backend back"); });
+        }
+    }
+
+    if (opts.otaAtUs > 0 && opts.otaAtUs >= now) {
+        atWorld(opts.otaAtUs, []() {
+            log("Firmware %s published", options().otaVersion.c_str());
+            backendEdit("force_update", "true");
+        });
+    }
+
+    if (opts.leakLph > 0 && opts.leakAtUs > 0 && opts.leakAtUs >= now) {
+        atWorld(opts.leakAtUs, []() {
+            log("Leak of %.1f L/h starts", options().leakLph);
+        });
+    }
+
+    if (opts.mlModelAtUs > 0 && opts.mlModelAtUs >= now) {
+        atWorld(opts.mlModelAtUs, []() {
+            log("ML model %s published", options().mlModelVersion.c_str());
+        });
+    }
+
+    if (opts.rebootEveryUs > 0) {
+        uint64_t next = (now / opts.rebootEveryUs + 1) * opts.rebootEveryUs;
+        atWorld(next, []() {
+            stats().powerCycles++;
+            restart("power cycle");
+        });
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,437 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "delta_patch.h"
+#include "heatshrink_decoder.h"
+#include "sim_patch.h"
+
+// ============================================================================
+// OTA PAYLOAD TOOL
+// ============================================================================
+// Makes what the backend serves for an OTA update and checks it with the
+// firmware's own streaming stages:
+//
+//   compress IN OUT       heatshrink full image (-w 10 -l 5, the decoder's)
+//   decompress IN OUT     decode with HeatshrinkDecoder into OUT
+//   diff OLD NEW PATCH    delta patch (delta_patch.h) from OLD to NEW
+//   apply OLD PATCH NEW   apply a patch with DeltaPatcher
+//   test [--seed N]       round trips on generated images; exits 1 on a
+//                         mismatch
+//
+// Patches are made against the exact image the device runs: the server
+// offers one only for the matching baseVersion.
+
+#define TOOL_MAX_CHUNK 4096   // Largest feed() in the tests (OTA_BUFFER_SIZE order)
+
+static int failures = 0;
+
+// ----------------------------------------------------------------------------
+// Files and in-memory stages
+// ----------------------------------------------------------------------------
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "ota-tool: can't open %s\n", path);
+        return false;
+    }
+    data.clear();
+    uint8_t buffer[65536];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr || fwrite(data.data(), 1, data.size(), file) != data.size()) {
+        fprintf(stderr, "ota-tool: can't write %s\n", path);
+        if (file != nullptr) {
+            fclose(file);
+        }
+        return false;
+    }
+    return fclose(file) == 0;
+}
+
+class VectorSource : public PatchSource {
+public:
+    explicit VectorSource(const std::vector<uint8_t>& data) : data(data) {}
+    size_t size() override { return data.size(); }
+    bool read(size_t offset, uint8_t* buffer, size_t length) override {
+        if (offset + length > data.size()) {
+            return false;
+        }
+        memcpy(buffer, data.data() + offset, length);
+        return true;
+    }
+private:
+    const std::vector<uint8_t>& data;
+};
+
+class VectorSink : public PatchSink {
+public:
+    std::vector<uint8_t> data;
+    bool write(const uint8_t* bytes, size_t length) override {
+        data.insert(data.end(), bytes, bytes + length);
+        return true;
+    }
+};
+
+// The Update calls OTAUpdater makes, on a file: begin() with the image
+// size, write() per decoded chunk, end() fails unless exactly that many
+// bytes arrived
+class FileUpdate : public PatchSink {
+public:
+    FileUpdate() : file(nullptr), imageSize(0), written(0) {}
+    ~FileUpdate() { close(); }
+
+    bool begin(FILE* target, size_t size) {
+        file = target;
+        imageSize = size;
+        written = 0;
+        return file != nullptr;
+    }
+    bool write(const uint8_t* bytes, size_t length) override {
+        if (file == nullptr || written + length > imageSize ||
+            fwrite(bytes, 1, length, file) != length) {
+            return false;
+        }
+        written += length;
+        return true;
+    }
+    bool end() {
+        return file != nullptr && written == imageSize && fflush(file) == 0;
+    }
+    void close() {
+        if (file != nullptr) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+    FILE* handle() const { return file; }
+
+private:
+    FILE* file;
+    size_t imageSize;
+    size_t written;
+};
+
+// Decode a compressed image of 'size' bytes into an Update on 'target'
+static bool decompress(const std::vector<uint8_t>& compressed, size_t size, size_t maxChunk,
+                       FileUpdate& update, FILE* target, const char** error) {
+    HeatshrinkDecoder decoder;
+    *error = "";
+    if (!update.begin(target, size)) {
+        *error = "Update begin failed";
+        return false;
+    }
+    decoder.begin(&update);
+
+    bool ok = true;
+    for (size_t offset = 0; ok && offset < compressed.size();) {
+        size_t length = maxChunk > 1 ? 1 + (size_t)rand() % maxChunk : 1;
+        if (length > compressed.size() - offset) {
+            length = compressed.size() - offset;
+        }
+        ok = decoder.feed(compressed.data() + offset, length);
+        offset += length;
+    }
+    ok = ok && decoder.finish();
+    if (!ok) {
+        *error = decoder.getError();
+        return false;
+    }
+    if (!update.end()) {
+        *error = "Update end failed: size mismatch";
+        return false;
+    }
+    return true;
+}
+
+// Feed in chunks of 1..maxChunk bytes (as the network delivers them)
+static bool applyPatch(const std::vector<uint8_t>& oldImage, const std::vector<uint8_t>& patch,
+                       size_t maxChunk, std::vector<uint8_t>& newImage, const char** error) {
+    VectorSource source(oldImage);
+    VectorSink sink;
+    DeltaPatcher patcher;
+    patcher.begin(&source, &sink);
+
+    bool ok = true;
+    for (size_t offset = 0; ok && offset < patch.size();) {
+        size_t length = maxChunk > 1 ? 1 + (size_t)rand() % maxChunk : 1;
+        if (length > patch.size() - offset) {
+            length = patch.size() - offset;
+        }
+        ok = patcher.feed(patch.data() + offset, length);
+        offset += length;
+    }
+    ok = ok && patcher.finish();
+
+    *error = ok ? "" : patcher.getError();
+    newImage.swap(sink.data);
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// Test images
+// ----------------------------------------------------------------------------
+
+// Firmware-like bytes: code-ish runs from a small alphabet, string tables,
+// and 0xFF padding between sections
+static std::vector<uint8_t> makeImage(size_t size) {
+    std::vector<uint8_t> image;
+    image.reserve(size);
+    while (image.size() < size) {
+        switch (rand() % 4) {
+            case 0:
+                image.insert(image.end(), 16 + rand() % 256, 0xFF);
+                break;
+            case 1:
+                for (int n = 8 + rand() % 64; n > 0; n--) {
+                    image.push_back((uint8_t)('a' + rand() % 26));
+                }
+                image.push_back(0);
+                break;
+            default:
+                for (int n = 64 + rand() % 2048; n > 0; n--) {
+                    image.push_back((uint8_t)(rand() % 40 * 3));
+                }
+                break;
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+// A new build of 'image': changed bytes, and code inserted and removed so
+// everything after moves
+static std::vector<uint8_t> mutate(const std::vector<uint8_t>& image, int edits) {
+    std::vector<uint8_t> result = image;
+    for (int e = 0; e < edits && !result.empty(); e++) {
+        size_t at = (size_t)rand() % result.size();
+        switch (rand() % 3) {
+            case 0:
+                for (size_t n = 1 + rand() % 64; n > 0 && at < result.size(); n--, at++) {
+                    result[at] = (uint8_t)(result[at] + 1 + rand() % 255);
+                }
+                break;
+            case 1: {
+                std::vector<uint8_t> code = makeImage(1 + rand() % 512);
+                result.insert(result.begin() + at, code.begin(), code.end());
+                break;
+            }
+            default: {
+                size_t n = std::min<size_t>(1 + rand() % 512, result.size() - at);
+                result.erase(result.begin() + at, result.begin() + at + n);
+                break;
+            }
+        }
+    }
+    return result.empty() ? std::vector<uint8_t>(1, 0) : result;
+}
+
+static void check(bool same, const char* what, const char* name) {
+    if (!same) {
+        fprintf(stderr, "ota-tool: %s failed for %s\n", what, name);
+        failures++;
+    }
+}
+
+static void testDelta(const char* name, const std::vector<uint8_t>& oldImage,
+                      const std::vector<uint8_t>& newImage) {
+    std::vector<uint8_t> patch = sim::makeDeltaPatch(oldImage, newImage);
+
+    std::vector<uint8_t> result;
+    const char* error;
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)TOOL_MAX_CHUNK }) {
+        bool ok = applyPatch(oldImage, patch, chunk, result, &error);
+        check(ok && result == newImage, "patch round trip", name);
+    }
+
+    // A cut patch must not pass as complete
+    if (patch.size() > DELTA_PATCH_HEADER_LEN + 1) {
+        std::vector<uint8_t> cut(patch.begin(), patch.end() - 1 - rand() % (patch.size() - DELTA_PATCH_HEADER_LEN - 1));
+        check(!applyPatch(oldImage, cut, TOOL_MAX_CHUNK, result, &error), "truncated patch rejection", name);
+    }
+
+    // Nor one for another image
+    std::vector<uint8_t> other = patch;
+    other[0] ^= 0x20;
+    check(!applyPatch(oldImage, other, TOOL_MAX_CHUNK, result, &error), "bad magic rejection", name);
+
+    printf("%-22s %9zu %9zu %9zu %7.1f%%\n", name, oldImage.size(), newImage.size(), patch.size(),
+           100.0 * patch.size() / newImage.size());
+}
+
+// Full image through the reference encoder and back through the decoder
+// into a file-backed Update
+static void testCompress(const char* name, const std::vector<uint8_t>& image) {
+    std::vector<uint8_t> compressed = sim::heatshrinkEncode(image);
+
+    for (size_t chunk : { (size_t)1, (size_t)TOOL_MAX_CHUNK }) {
+        FileUpdate update;
+        const char* error;
+        bool ok = decompress(compressed, image.size(), chunk, update, tmpfile(), &error);
+
+        std::vector<uint8_t> result(image.size() + 1);
+        if (ok) {
+            rewind(update.handle());
+            ok = fread(result.data(), 1, result.size(), update.handle()) == image.size();
+            result.resize(image.size());
+        }
+        check(ok && result == image, "heatshrink round trip", name);
+    }
+
+    // One byte less than announced must fail at end()
+    if (!image.empty()) {
+        FileUpdate update;
+        const char* error;
+        check(!decompress(compressed, image.size() + 1, TOOL_MAX_CHUNK, update, tmpfile(), &error),
+              "short image rejection", name);
+    }
+
+    printf("%-22s %9s %9zu %9zu %7.1f%%\n", name, "-", image.size(), compressed.size(),
+           image.empty() ? 0.0 : 100.0 * compressed.size() / image.size());
+}
+
+static int runTests(unsigned seed) {
+    srand(seed);
+    printf("%-22s %9s %9s %9s %8s\n", "case", "old", "new", "payload", "of new");
+
+    testCompress("compress image", makeImage(256 * 1024));
+    testCompress("compress zeros", std::vector<uint8_t>(100000, 0));
+    testCompress("compress one byte", std::vector<uint8_t>(1, 0x5A));
+    std::vector<uint8_t> noise(65536);
+    for (uint8_t& byte : noise) {
+        byte = (uint8_t)rand();
+    }
+    testCompress("compress noise", noise);
+
+    std::vector<uint8_t> base = makeImage(256 * 1024);
+    testDelta("identical", base, base);
+    testDelta("few edits", base, mutate(base, 4));
+    testDelta("many edits", base, mutate(base, 200));
+    testDelta("unrelated", base, makeImage(64 * 1024));
+    testDelta("from empty", std::vector<uint8_t>(), makeImage(4096));
+    testDelta("one byte", std::vector<uint8_t>(1, 7), std::vector<uint8_t>(1, 9));
+    for (int i = 0; i < 20; i++) {
+        std::vector<uint8_t> small = makeImage(1 + rand() % 3000);
+        testDelta("small random", small, mutate(small, 1 + rand() % 10));
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "ota-tool: %d failures\n", failures);
+        return 1;
+    }
+    printf("All round trips OK\n");
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Commands
+// ----------------------------------------------------------------------------
+
+static void usage(const char* program) {
+    printf("Usage: %s COMMAND ...\n\n"
+           "  compress IN OUT        Heatshrink IN for a compressed full-image download\n"
+           "  decompress IN OUT      Decode IN with the firmware's HeatshrinkDecoder\n"
+           "  diff OLD NEW PATCH     Delta patch from image OLD to image NEW\n"
+           "  apply OLD PATCH NEW    Apply PATCH to OLD with the firmware's DeltaPatcher\n"
+           "  test [--seed N]        Round trips on generated images (exit 1 on mismatch)\n",
+           program);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    std::string command = argv[1];
+
+    if (command == "compress" && argc == 4) {
+        std::vector<uint8_t> image;
+        if (!readFile(argv[2], image)) {
+            return 1;
+        }
+        std::vector<uint8_t> compressed = sim::heatshrinkEncode(image);
+        printf("%s: %zu bytes (transferSize), image %zu bytes (size)\n", argv[3],
+               compressed.size(), image.size());
+        return writeFile(argv[3], compressed) ? 0 : 1;
+    }
+
+    if (command == "decompress" && argc == 4) {
+        std::vector<uint8_t> compressed;
+        if (!readFile(argv[2], compressed)) {
+            return 1;
+        }
+        // Size unknown here: decode once to count, then into the Update
+        HeatshrinkDecoder counter;
+        VectorSink discard;
+        counter.begin(&discard);
+        if (!counter.feed(compressed.data(), compressed.size()) || !counter.finish()) {
+            fprintf(stderr, "ota-tool: %s\n", counter.getError());
+            return 1;
+        }
+        FileUpdate update;
+        const char* error;
+        if (!decompress(compressed, discard.data.size(), TOOL_MAX_CHUNK, update, fopen(argv[3], "wb"), &error)) {
+            fprintf(stderr, "ota-tool: %s\n", error);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (command == "diff" && argc == 5) {
+        std::vector<uint8_t> oldImage, newImage;
+        if (!readFile(argv[2], oldImage) || !readFile(argv[3], newImage)) {
+            return 1;
+        }
+        if (newImage.empty()) {
+            fprintf(stderr, "ota-tool: %s is empty\n", argv[3]);
+            return 1;
+        }
+        std::vector<uint8_t> patch = sim::makeDeltaPatch(oldImage, newImage);
+        printf("%s: %zu bytes (%.1f%% of %zu)\n", argv[4], patch.size(),
+               100.0 * patch.size() / newImage.size(), newImage.size());
+        return writeFile(argv[4], patch) ? 0 : 1;
+    }
+
+    if (command == "apply" && argc == 5) {
+        std::vector<uint8_t> oldImage, patch, newImage;
+        if (!readFile(argv[2], oldImage) || !readFile(argv[3], patch)) {
+            return 1;
+        }
+        const char* error;
+        if (!applyPatch(oldImage, patch, TOOL_MAX_CHUNK, newImage, &error)) {
+            fprintf(stderr, "ota-tool: %s\n", error);
+            return 1;
+        }
+        return writeFile(argv[4], newImage) ? 0 : 1;
+    }
+
+    if (command == "test") {
+        unsigned seed = 1;
+        if (argc == 4 && strcmp(argv[2], "--seed") == 0) {
+            seed = (unsigned)strtoul(argv[3], nullptr, 10);
+        } else if (argc != 2) {
+            usage(argv[0]);
+            return 2;
+        }
+        return runTests(seed);
+    }
+
+    if (command == "--help") {
+        usage(argv[0]);
+        return 0;
+    }
+    usage(argv[0]);
+    return 2;
+}
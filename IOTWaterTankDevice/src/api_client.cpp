@@ -1,9 +1,12 @@
 #include "api_client.h"
 #include "storage_manager.h"
+#include "server_url.h"
 #include "handle_control_data.h"
 #include "handle_config_data.h"
 #include "handle_telemetry_data.h"
 #include <time.h>
+#include <sys/time.h>
+#include "esp_sntp.h"
 
 // External handler instances (defined in main.cpp)
 extern ControlDataHandler controlHandler;
@@ -13,6 +16,15 @@ extern TelemetryDataHandler telemetryHandler;
 // Initialize static instance pointer
 APIClient* APIClient::instance = nullptr;
 
+// SNTP state
+bool APIClient::sntpStarted = false;
+volatile bool APIClient::timeSyncPending = false;
+uint64_t APIClient::timeSyncEventTimestamp = 0;
+unsigned long APIClient::timeSyncEventMillis = 0;
+bool APIClient::ntpEverSynced = false;
+portMUX_TYPE APIClient::timeSyncMux = portMUX_INITIALIZER_UNLOCKED;
+SemaphoreHandle_t APIClient::timeSyncSemaphore = NULL;
+
 // ============================================================================
 // CONFIGURATION SYNC IMPLEMENTATION
 // ============================================================================
@@ -36,7 +48,7 @@ APIClient* APIClient::instance = nullptr;
 // CONSTRUCTOR & INITIALIZATION
 // ============================================================================
 
-APIClient::APIClient() : authenticated(false) {
+APIClient::APIClient() : authenticated(false), lastTimeOffset(0) {
     // Set instance pointer for callbacks
     instance = this;
 }
@@ -84,6 +96,7 @@ bool APIClient::loadToken() {
 void APIClient::saveToken(const String& token) {
     storageManager.saveDeviceToken(token);
     deviceToken = token;
+    updateManagerTokens();
     Serial.println("[API] Device token saved");
 }
 
@@ -100,6 +113,23 @@ bool APIClient::isAuthenticated() {
     return authenticated;
 }
 
+void APIClient::invalidateSession() {
+    if (authenticated) {
+        Serial.println("[API] Session invalidated - will log in again");
+    }
+    authenticated = false;
+}
+
+void APIClient::checkSession() {
+    // Consume all three flags so a stale 401 doesn't drop the next session
+    bool rejected = deviceConfigManager.consumeUnauthorized();
+    rejected = telemetryManager.consumeUnauthorized() || rejected;
+    rejected = controlDataManager.consumeUnauthorized() || rejected;
+    if (rejected) {
+        invalidateSession();
+    }
+}
+
 String APIClient::getToken() {
     return deviceToken;
 }
@@ -108,7 +138,6 @@ void APIClient::setToken(const String& token) {
     deviceToken = token;
     authenticated = true;
     saveToken(token);
-    updateManagerTokens();
 }
 
 bool APIClient::loginDevice(const String& username, const String& password) {
@@ -151,7 +180,31 @@ bool APIClient::loginDevice(const String& username, const String& password) {
         return false;
     }
 
-    // Parse response
+    String token;
+    unsigned long expiresIn;
+    if (!parseLoginResponse(response, token, expiresIn)) {
+        return false;
+    }
+
+    // Save token and set registered flag
+    saveToken(token);
+    authenticated = true;
+    storageManager.setDeviceRegistered(true);
+
+    // Log token expiration info
+    if (expiresIn > 0) {
+        // Backend returns expiresIn in seconds, not milliseconds
+        unsigned long expiresInDays = expiresIn / (60 * 60 * 24);
+        Serial.println("[API] Token expires in " + String(expiresInDays) + " days (" + String(expiresIn) + " seconds)");
+    }
+
+    Serial.println("[API] Device logged in successfully");
+    return true;
+}
+
+bool APIClient::parseLoginResponse(const String& response, String& token, unsigned long& expiresIn) {
+    expiresIn = 0;
+
     StaticJsonDocument<2048> responseDoc;
     DeserializationError error = deserializeJson(responseDoc, response);
 
@@ -176,20 +229,20 @@ bool APIClient::loginDevice(const String& username, const String& password) {
     }
 
     // Extract token from response (backend uses "deviceToken" field)
-    const char* token = responseDoc["deviceToken"];
+    const char* found = responseDoc["deviceToken"];
 
     // Fallback: try other possible token field names
-    if (!token) {
-        token = responseDoc["token"];
+    if (!found) {
+        found = responseDoc["token"];
     }
-    if (!token) {
-        token = responseDoc["data"]["deviceToken"];
+    if (!found) {
+        found = responseDoc["data"]["deviceToken"];
     }
-    if (!token) {
-        token = responseDoc["data"]["token"];
+    if (!found) {
+        found = responseDoc["data"]["token"];
     }
 
-    if (!token) {
+    if (!found || found[0] == '\0') {
         Serial.println("[API] No deviceToken found in login response");
         Serial.println("[API] Response structure:");
         serializeJson(responseDoc, Serial);
@@ -197,20 +250,8 @@ bool APIClient::loginDevice(const String& username, const String& password) {
         return false;
     }
 
-    // Save token and set registered flag
-    saveToken(String(token));
-    authenticated = true;
-    storageManager.setDeviceRegistered(true);
-
-    // Log token expiration info
-    unsigned long expiresIn = responseDoc["expiresIn"] | 0;
-    if (expiresIn > 0) {
-        // Backend returns expiresIn in seconds, not milliseconds
-        unsigned long expiresInDays = expiresIn / (60 * 60 * 24);
-        Serial.println("[API] Token expires in " + String(expiresInDays) + " days (" + String(expiresIn) + " seconds)");
-    }
-
-    Serial.println("[API] Device logged in successfully");
+    token = found;
+    expiresIn = responseDoc["expiresIn"] | 0UL;
     return true;
 }
 
@@ -285,7 +326,7 @@ bool APIClient::httpRequest(const String& method, const String& endpoint,
     while (attempt < retries) {
         attempt++;
 
-        String url = String(SERVER_URL) + endpoint;
+        String url = serverUrl.get() + endpoint;
         http.begin(url);
         http.addHeader("Content-Type", "application/json");
         http.setTimeout(HTTP_TIMEOUT);
@@ -389,6 +430,7 @@ bool APIClient::fetchAndApplyServerConfig(DeviceConfig& config, bool* changed, b
     // Fetch config from server
     DeviceConfig apiConfig;
     bool result = deviceConfigManager.fetchAndApplyServerConfig(apiConfig);
+    checkSession();
 
     if (!result) {
         return false;
@@ -407,6 +449,7 @@ bool APIClient::fetchAndApplyServerConfig(DeviceConfig& config, bool* changed, b
         if (apiConfig.forceUpdateLastModified == 0) apiConfig.forceUpdateLastModified = currentTime;
         if (apiConfig.ipAddressLastModified == 0) apiConfig.ipAddressLastModified = currentTime;
         if (apiConfig.autoUpdateLastModified == 0) apiConfig.autoUpdateLastModified = currentTime;
+        if (apiConfig.heartbeatSecLastModified == 0) apiConfig.heartbeatSecLastModified = currentTime;
     }
 
     // Update handler with API values
@@ -420,7 +463,8 @@ bool APIClient::fetchAndApplyServerConfig(DeviceConfig& config, bool* changed, b
         apiConfig.maxInflow, apiConfig.maxInflowLastModified,
         apiConfig.force_update, apiConfig.forceUpdateLastModified,
         apiConfig.ipAddress, apiConfig.ipAddressLastModified,
-        apiConfig.auto_update, apiConfig.autoUpdateLastModified
+        apiConfig.auto_update, apiConfig.autoUpdateLastModified,
+        apiConfig.heartbeatSec, apiConfig.heartbeatSecLastModified
     );
 
     // Perform 3-way merge
@@ -458,6 +502,8 @@ bool APIClient::fetchAndApplyServerConfig(DeviceConfig& config, bool* changed, b
     config.ipAddressLastModified = configHandler.getIpAddressTimestamp();
     config.auto_update = configHandler.getAutoUpdate();
     config.autoUpdateLastModified = configHandler.getAutoUpdateTimestamp();
+    config.heartbeatSec = configHandler.getHeartbeatSec();
+    config.heartbeatSecLastModified = configHandler.getHeartbeatSecTimestamp();
 
     if (valuesChanged) {
         Serial.println("[API] Config values changed after 3-way merge");
@@ -477,6 +523,7 @@ bool APIClient::sendConfigWithPriority(DeviceConfig& config) {
 
     // Delegate to device config manager
     bool success = deviceConfigManager.sendConfigWithPriority(config);
+    checkSession();
 
     if (success) {
         // Mark as synced in ConnectionSyncManager
@@ -504,6 +551,7 @@ bool APIClient::fetchControl(ControlData& control) {
     // Fetch control data from server
     ControlData apiControl;
     bool result = controlDataManager.fetchControl(apiControl);
+    checkSession();
 
     if (!result) {
         return false;
@@ -549,7 +597,9 @@ bool APIClient::uploadControl(const ControlData& control) {
     }
 
     // Delegate to control data manager
-    return controlDataManager.uploadControl(control);
+    bool success = controlDataManager.uploadControl(control);
+    checkSession();
+    return success;
 }
 
 bool APIClient::uploadControlWithPayload(const String& payload) {
@@ -559,7 +609,9 @@ bool APIClient::uploadControlWithPayload(const String& payload) {
     }
 
     // Delegate to control data manager with pre-built payload
-    return controlDataManager.uploadControlWithPayload(payload);
+    bool success = controlDataManager.uploadControlWithPayload(payload);
+    checkSession();
+    return success;
 }
 
 String APIClient::buildControlPayload(const ControlData& control) {
@@ -567,68 +619,137 @@ String APIClient::buildControlPayload(const ControlData& control) {
     return controlDataManager.buildControlPayload(control);
 }
 
-bool APIClient::uploadTelemetry(float waterLevel, float currInflow, int pumpStatus) {
+bool APIClient::uploadTelemetry(float waterLevel, float currInflow, int pumpStatus,
+                                const MLResult* ml, const LeakStatus* leak) {
     if (!authenticated) {
         Serial.println("[API] Not authenticated, cannot upload telemetry");
         return false;
     }
 
     // Delegate to telemetry manager
-    return telemetryManager.uploadTelemetry(waterLevel, currInflow, pumpStatus);
+    bool success = telemetryManager.uploadTelemetry(waterLevel, currInflow, pumpStatus, ml, leak);
+    checkSession();
+    return success;
+}
+
+bool APIClient::uploadLeakAlarm(float waterLevel, float currInflow, int pumpStatus, const LeakStatus& leak) {
+    if (!authenticated) {
+        Serial.println("[API] Not authenticated, cannot upload leak alarm");
+        return false;
+    }
+
+    bool success = telemetryManager.uploadLeakAlarm(waterLevel, currInflow, pumpStatus, leak);
+    checkSession();
+    return success;
+}
+
+bool APIClient::uploadTelemetryBatch(const TelemetryRecord* records, size_t count) {
+    if (!authenticated) {
+        Serial.println("[API] Not authenticated, cannot upload telemetry backlog");
+        return false;
+    }
+
+    bool success = telemetryManager.uploadTelemetryBatch(records, count);
+    checkSession();
+    return success;
 }
 
 // ============================================================================
 // TIME SYNCHRONIZATION
 // ============================================================================
 
-bool APIClient::syncTimeWithServer() {
-    Serial.println("[API] Syncing time via NTP...");
-
-    // Configure NTP - Use multiple reliable servers
-    // Google NTP is usually more reliable and less likely to be blocked
-    const char* ntpServer1 = "time.google.com";
-    const char* ntpServer2 = "pool.ntp.org";
-    const char* ntpServer3 = "time.nist.gov";
-    const long gmtOffset_sec = 0;       // UTC timezone
-    const int daylightOffset_sec = 0;   // No daylight saving
-
-    // Configure time sync with NTP servers
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer1, ntpServer2, ntpServer3);
-
-    // Wait for time to sync (max 10 seconds)
-    Serial.println("[API] Waiting for NTP time sync...");
-    struct tm timeinfo;
-    int retries = 0;
-    const int maxRetries = 20;  // 20 x 500ms = 10 seconds max wait
-
-    while (!getLocalTime(&timeinfo) && retries < maxRetries) {
-        Serial.print(".");
-        delay(500);
-        retries++;
+void APIClient::startTimeSync() {
+    if (sntpStarted) {
+        return;
     }
-    Serial.println();
 
-    if (retries >= maxRetries) {
-        Serial.println("[API] Failed to sync time via NTP - timeout");
+    Serial.println("[API] Starting SNTP (background)...");
+
+    if (timeSyncSemaphore == NULL) {
+        timeSyncSemaphore = xSemaphoreCreateBinary();
+    }
+
+    // Register completion callback before starting, so the first sync is reported
+    sntp_set_time_sync_notification_cb(onSntpTimeSync);
+
+    // Periodic resync feeds the clock discipline (drift estimate + slew)
+    sntp_set_sync_interval(CLOCK_RESYNC_INTERVAL);
+
+    // UTC, no daylight saving
+    configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2, NTP_SERVER_3);
+    sntpStarted = true;
+}
+
+void APIClient::onSntpTimeSync(struct timeval* tv) {
+    uint64_t timestamp = (uint64_t)tv->tv_sec * 1000ULL + (uint64_t)(tv->tv_usec / 1000);
+
+    portENTER_CRITICAL(&timeSyncMux);
+    timeSyncEventTimestamp = timestamp;
+    timeSyncEventMillis = millis();
+    timeSyncPending = true;
+    ntpEverSynced = true;
+    portEXIT_CRITICAL(&timeSyncMux);
+
+    if (timeSyncSemaphore != NULL) {
+        xSemaphoreGive(timeSyncSemaphore);
+    }
+}
+
+bool APIClient::consumeTimeSyncEvent(uint64_t& timestamp) {
+    if (!timeSyncPending) {
         return false;
     }
 
-    // Get current time in Unix timestamp (seconds since epoch)
-    time_t now;
-    time(&now);
+    portENTER_CRITICAL(&timeSyncMux);
+    uint64_t eventTimestamp = timeSyncEventTimestamp;
+    unsigned long eventMillis = timeSyncEventMillis;
+    timeSyncPending = false;
+    portEXIT_CRITICAL(&timeSyncMux);
 
-    // Convert to milliseconds (backend expects milliseconds)
-    uint64_t ntpTimestamp = (uint64_t)now * 1000ULL;
+    // Account for time spent between the callback and this call
+    timestamp = eventTimestamp + (unsigned long)(millis() - eventMillis);
 
-    // Save sync information via ConnectionSyncManager
-    connSyncManager.setTimestamp(ntpTimestamp);
+    Serial.printf("[API] SNTP sync completed: %llu ms\n", timestamp);
+    return true;
+}
+
+bool APIClient::waitForTimeSync(uint32_t timeoutMs) {
+    startTimeSync();
+
+    if (timeSyncPending) {
+        return true;
+    }
+
+    Serial.printf("[API] Waiting up to %u ms for SNTP sync...\n", timeoutMs);
+    return xSemaphoreTake(timeSyncSemaphore, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+bool APIClient::readSystemTime(uint64_t& timestamp) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    uint64_t now = (uint64_t)tv.tv_sec * 1000ULL + (uint64_t)(tv.tv_usec / 1000);
+    if (now < MIN_VALID_TIMESTAMP) {
+        return false;  // Clock never set (still counting from 1970)
+    }
+
+    timestamp = now;
+    return true;
+}
+
+bool APIClient::syncTimeWithServer() {
+    startTimeSync();
+
+    uint64_t ntpTimestamp = 0;
+    if (!readSystemTime(ntpTimestamp)) {
+        Serial.println("[API] NTP time not available yet");
+        return false;
+    }
 
-    Serial.println("[API] Time synced successfully via NTP");
-    Serial.printf("  NTP Timestamp: %llu ms\n", ntpTimestamp);
-    Serial.printf("  Date/Time: %04d-%02d-%02d %02d:%02d:%02d UTC\n",
-                 timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+    // Discipline clock via ConnectionSyncManager
+    connSyncManager.applyTimeSample(ntpTimestamp);
 
+    Serial.printf("[API] Time synced from system clock (NTP): %llu ms\n", ntpTimestamp);
     return true;
 }
 
@@ -641,10 +762,72 @@ void APIClient::setTimestamp(uint64_t timestamp) {
     connSyncManager.setTimestamp(timestamp);
 }
 
+void APIClient::applyTimeSample(uint64_t referenceTime) {
+    connSyncManager.applyTimeSample(referenceTime);
+}
+
+bool APIClient::isNtpFresh() {
+    if (!ntpEverSynced) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&timeSyncMux);
+    unsigned long eventMillis = timeSyncEventMillis;
+    portEXIT_CRITICAL(&timeSyncMux);
+
+    return millis() - eventMillis < 2UL * CLOCK_RESYNC_INTERVAL;
+}
+
+bool APIClient::syncTimeWithBackend() {
+    Serial.println("[API] Syncing time via HTTP (backend)...");
+
+    HttpTimeSample sample;
+    if (!timeSyncManager.fetchServerTime(sample)) {
+        return false;
+    }
+
+    // Carry the estimate forward to now
+    uint64_t serverTime = sample.serverTime + (TimeSyncManager::localMillis() - sample.localMillis);
+
+    if (connSyncManager.isTimeSynced()) {
+        lastTimeOffset = (int64_t)(serverTime - connSyncManager.getCurrentTimestamp());
+    }
+
+    connSyncManager.applyTimeSample(serverTime);
+
+    Serial.printf("[API] Time synced via HTTP: %llu ms (RTT %u ms)\n", serverTime, sample.rtt);
+    return true;
+}
+
+bool APIClient::crossCheckTime() {
+    HttpTimeSample sample;
+    if (!timeSyncManager.fetchServerTime(sample)) {
+        return false;
+    }
+
+    uint64_t serverTime = sample.serverTime + (TimeSyncManager::localMillis() - sample.localMillis);
+    int64_t offset = (int64_t)(serverTime - connSyncManager.getCurrentTimestamp());
+    lastTimeOffset = offset;
+
+    int64_t tolerance = (int64_t)(sample.rtt / 2) + HTTP_TIME_SYNC_TOLERANCE;
+    if (offset > tolerance || offset < -tolerance) {
+        Serial.printf("[API] WARNING: Clock disagrees with server by %lld ms (tolerance %lld ms)\n",
+                     offset, tolerance);
+        return false;
+    }
+
+    Serial.printf("[API] Time cross-check OK: offset %lld ms (RTT %u ms)\n", offset, sample.rtt);
+    return true;
+}
+
 bool APIClient::isTimeSynced() {
     return connSyncManager.isTimeSynced();
 }
 
+bool APIClient::hasReferenceTime() {
+    return connSyncManager.hasReferenceTime();
+}
+
 // ============================================================================
 // SYNC STATUS MANAGEMENT
 // ============================================================================
@@ -694,5 +877,7 @@ void APIClient::updateManagerTokens() {
     controlDataManager.setToken(deviceToken);
     controlDataManager.setHardwareId(hardwareId);
 
+    timeSyncManager.setToken(deviceToken);
+
     DEBUG_PRINTLN("[API] Updated tokens for all specialized managers");
 }
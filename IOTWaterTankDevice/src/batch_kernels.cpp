@@ -0,0 +1,257 @@
+#include "batch_kernels.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// ESP32-S3 vector unit (PIE): 16 int8 lanes per multiply-accumulate into
+// the 40-bit ACCX accumulator, exact for every n the int32 result allows
+#ifdef CONFIG_IDF_TARGET_ESP32S3
+#define BATCH_KERNELS_PIE
+#include "freertos/FreeRTOS.h"
+#define BATCH_PIE_CHUNK_BLOCKS 16   // Blocks per critical section (256 bytes)
+#endif
+
+#define BATCH_CHECK_LENGTH 320  // Longest case of batchKernelsSelfTest() (> one PIE chunk)
+
+// ============================================================================
+// INTEGER
+// ============================================================================
+
+// Four independent accumulators: lets the compiler keep the multiplies in
+// flight (and vectorize on hosts) - integer sums don't depend on the order
+static int32_t dotS8Scalar(const int8_t* a, const int8_t* b, size_t n) {
+    int32_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += (int32_t)a[i] * b[i];
+        acc1 += (int32_t)a[i + 1] * b[i + 1];
+        acc2 += (int32_t)a[i + 2] * b[i + 2];
+        acc3 += (int32_t)a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        acc0 += (int32_t)a[i] * b[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+static int32_t sumS8Scalar(const int8_t* x, size_t n) {
+    int32_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += x[i];
+        acc1 += x[i + 1];
+        acc2 += x[i + 2];
+        acc3 += x[i + 3];
+    }
+    for (; i < n; i++) {
+        acc0 += x[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+static bool aligned16(const void* p) {
+    return ((uintptr_t)p & 15) == 0;
+}
+
+// Cleared by batchKernelsSelfTest() if the vector path disagrees
+static bool vectorEnabled = true;
+
+// Lane-wise sum over whole 16-byte blocks: a may have any alignment, b is
+// 16-byte aligned and advances bStep (16, or 0 to reuse one block)
+#ifdef BATCH_KERNELS_PIE
+static portMUX_TYPE vectorMux = portMUX_INITIALIZER_UNLOCKED;
+
+static int32_t dotS8Blocks(const int8_t* a, const int8_t* b, int32_t bStep, size_t blocks) {
+    int32_t total = 0;
+    while (blocks > 0) {
+        // The asm advances a and b; count runs down to 0
+        size_t count = blocks < BATCH_PIE_CHUNK_BLOCKS ? blocks : BATCH_PIE_CHUNK_BLOCKS;
+        blocks -= count;
+        int32_t acc;
+
+        // No task switch while ACCX and q0-q3 hold state
+        portENTER_CRITICAL(&vectorMux);
+        if (aligned16(a)) {
+            asm volatile(
+                "ee.zero.accx\n"
+                "1:\n"
+                "ee.vld.128.ip q0, %[a], 16\n"
+                "ee.vld.128.xp q1, %[b], %[step]\n"
+                "ee.vmulas.s8.accx q0, q1\n"
+                "addi %[count], %[count], -1\n"
+                "bnez %[count], 1b\n"
+                "rur.accx_0 %[acc]\n"
+                : [a] "+r"(a), [b] "+r"(b), [count] "+r"(count), [acc] "=&r"(acc)
+                : [step] "r"(bStep)
+                : "memory");
+        } else {
+            // Aligned loads of a, each block shifted into place from the two
+            // that hold it (SAR_BYTE = a & 15). Never reads past the aligned
+            // block holding the last byte used.
+            asm volatile(
+                "ee.zero.accx\n"
+                "ee.ld.128.usar.ip q0, %[a], 16\n"
+                "1:\n"
+                "ee.ld.128.usar.ip q1, %[a], 16\n"
+                "ee.vld.128.xp q3, %[b], %[step]\n"
+                "ee.src.q.qup q2, q0, q1\n"
+                "ee.vmulas.s8.accx q2, q3\n"
+                "addi %[count], %[count], -1\n"
+                "bnez %[count], 1b\n"
+                "rur.accx_0 %[acc]\n"
+                : [a] "+r"(a), [b] "+r"(b), [count] "+r"(count), [acc] "=&r"(acc)
+                : [step] "r"(bStep)
+                : "memory");
+            a -= 16;  // One block loaded ahead
+        }
+        portEXIT_CRITICAL(&vectorMux);
+        total += acc;
+    }
+    return total;
+}
+#else
+// Same split as the vector unit (one 16-lane multiply-accumulate per block)
+static int32_t dotS8Blocks(const int8_t* a, const int8_t* b, int32_t bStep, size_t blocks) {
+    int32_t acc = 0;
+    for (size_t k = 0; k < blocks; k++) {
+        for (int lane = 0; lane < 16; lane++) {
+            acc += (int32_t)a[lane] * b[lane];
+        }
+        a += 16;
+        b += bStep;
+    }
+    return acc;
+}
+#endif
+
+int32_t batchDotS8(const int8_t* a, const int8_t* b, size_t n) {
+    // The vector loads need one aligned operand; the product is symmetric
+    if (!aligned16(b) && aligned16(a)) {
+        const int8_t* t = a;
+        a = b;
+        b = t;
+    }
+    size_t blocks = n / 16;
+    if (!vectorEnabled || blocks == 0 || !aligned16(b)) {
+        return dotS8Scalar(a, b, n);
+    }
+    size_t done = blocks * 16;
+    return dotS8Blocks(a, b, 16, blocks) + dotS8Scalar(a + done, b + done, n - done);
+}
+
+int32_t batchSumS8(const int8_t* x, size_t n) {
+    alignas(16) static const int8_t ones[16] = {
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+    };
+    size_t blocks = n / 16;
+    if (!vectorEnabled || blocks == 0) {
+        return sumS8Scalar(x, n);
+    }
+    size_t done = blocks * 16;
+    return dotS8Blocks(x, ones, 0, blocks) + sumS8Scalar(x + done, n - done);
+}
+
+// Every offset of a against an aligned b (and the swapped pair), every
+// length up to 64, then sparser up to BATCH_CHECK_LENGTH: block counts,
+// tails and alignment shifts all differ between cases, and the longest
+// span more than one critical section. -128s cover the accumulator.
+bool batchKernelsSelfTest() {
+    alignas(16) int8_t a[BATCH_CHECK_LENGTH + 16];
+    alignas(16) int8_t b[BATCH_CHECK_LENGTH + 16];
+    uint32_t seed = 1;
+    for (size_t i = 0; i < sizeof(a); i++) {
+        seed = seed * 1103515245u + 12345u;
+        a[i] = (int8_t)(seed >> 24);
+        b[i] = (i % 5 == 0) ? -128 : (int8_t)(seed >> 16);
+    }
+
+    bool same = true;
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t n = 1; n <= BATCH_CHECK_LENGTH; n += n < 64 ? 1 : 37) {
+            const int8_t* x = a + offset;
+            int32_t dot = dotS8Scalar(x, b, n);
+            same = same && batchDotS8(x, b, n) == dot && batchDotS8(b, x, n) == dot;
+            same = same && batchSumS8(x, n) == sumS8Scalar(x, n);
+        }
+    }
+    if (!same) {
+        vectorEnabled = false;
+    }
+    return same;
+}
+
+// ============================================================================
+// COMPARISONS
+// ============================================================================
+
+void batchMinMaxF32(const float* x, size_t n, float* lo, float* hi) {
+    float lo0 = x[0], lo1 = x[0], hi0 = x[0], hi1 = x[0];
+    size_t i = 1;
+    for (; i + 2 <= n; i += 2) {
+        lo0 = x[i] < lo0 ? x[i] : lo0;
+        hi0 = x[i] > hi0 ? x[i] : hi0;
+        lo1 = x[i + 1] < lo1 ? x[i + 1] : lo1;
+        hi1 = x[i + 1] > hi1 ? x[i + 1] : hi1;
+    }
+    if (i < n) {
+        lo0 = x[i] < lo0 ? x[i] : lo0;
+        hi0 = x[i] > hi0 ? x[i] : hi0;
+    }
+    *lo = lo1 < lo0 ? lo1 : lo0;
+    *hi = hi1 > hi0 ? hi1 : hi0;
+}
+
+// k-th smallest (0-based) by quickselect. On return everything before k
+// is <= x[k] and everything after it is >= x[k].
+static float selectKth(float* x, int n, int k) {
+    int lo = 0;
+    int hi = n - 1;
+
+    while (hi > lo) {
+        // Median of three as pivot - sorted or reversed input stays O(n)
+        int mid = lo + (hi - lo) / 2;
+        float t;
+        if (x[mid] < x[lo]) { t = x[mid]; x[mid] = x[lo]; x[lo] = t; }
+        if (x[hi] < x[lo]) { t = x[hi]; x[hi] = x[lo]; x[lo] = t; }
+        if (x[hi] < x[mid]) { t = x[hi]; x[hi] = x[mid]; x[mid] = t; }
+        float pivot = x[mid];
+
+        int i = lo;
+        int j = hi;
+        while (i <= j) {
+            while (x[i] < pivot) i++;
+            while (x[j] > pivot) j--;
+            if (i <= j) {
+                t = x[i]; x[i] = x[j]; x[j] = t;
+                i++;
+                j--;
+            }
+        }
+
+        // [lo..j] <= pivot, (j..i) == pivot, [i..hi] >= pivot
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+    return x[k];
+}
+
+float batchMedianF32(float* x, size_t n) {
+    int half = (int)(n / 2);
+    if (n % 2) {
+        return selectKth(x, (int)n, half);
+    }
+
+    // Lower middle, then the smallest value above it
+    float lower = selectKth(x, (int)n, half - 1);
+    float upper = x[half];
+    for (size_t i = half + 1; i < n; i++) {
+        upper = x[i] < upper ? x[i] : upper;
+    }
+    return (lower + upper) / 2.0f;
+}
@@ -1,26 +1,133 @@
 #include "button_handler.h"
+#include "power_manager.h"
+#include "esp_timer.h"
+#ifdef CONFIG_PM_ENABLE
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+#endif
 
-ButtonHandler::ButtonHandler() : pendingEvent(BTN_NONE) {
+// ISR argument: edge queue + button index
+struct ButtonIsrArg {
+    QueueHandle_t queue;
+    uint8_t index;
+    uint8_t pin;
+    bool level;            // Level interrupt doubling as light-sleep wakeup
+};
+
+static ButtonIsrArg isrArgs[6];
+
+static const char* eventName(ButtonEvent event) {
+    switch (event) {
+        case BTN1_PRESSED: return "BTN1 pressed - Cycle screen";
+        case BTN1_DOUBLE_CLICK: return "BTN1 double click - Status screen";
+        case BTN2_PRESSED: return "BTN2 pressed - Pump ON";
+        case BTN3_PRESSED: return "BTN3 pressed - Toggle mode";
+        case BTN4_PRESSED: return "BTN4 pressed - Pump OFF";
+        case BTN5_SHORT_PRESS: return "BTN5 short press";
+        case BTN5_LONG_PRESS: return "BTN5 long press - WiFi reset";
+        case BTN6_PRESSED: return "BTN6 pressed - Hardware override";
+        default: return "none";
+    }
+}
+
+ButtonHandler::ButtonHandler()
+    : edgeQueue(NULL),
+      eventQueue(NULL),
+      taskHandle(NULL),
+      eventCallback(nullptr) {
     // Initialize button structures
     uint8_t buttonPins[] = {BTN1_PIN, BTN2_PIN, BTN3_PIN, BTN4_PIN, BTN5_PIN, BTN6_PIN};
 
+    // Gesture table: press, double click, short press (release), long press
+    ButtonEvent gestures[6][4] = {
+        {BTN1_PRESSED, BTN1_DOUBLE_CLICK, BTN_NONE, BTN_NONE},
+        {BTN2_PRESSED, BTN_NONE, BTN_NONE, BTN_NONE},
+        {BTN3_PRESSED, BTN_NONE, BTN_NONE, BTN_NONE},
+        {BTN4_PRESSED, BTN_NONE, BTN_NONE, BTN_NONE},
+        {BTN_NONE, BTN_NONE, BTN5_SHORT_PRESS, BTN5_LONG_PRESS},
+        {BTN6_PRESSED, BTN_NONE, BTN_NONE, BTN_NONE}
+    };
+
     for (int i = 0; i < 6; i++) {
         buttons[i].pin = buttonPins[i];
-        buttons[i].lastState = HIGH;
-        buttons[i].currentState = HIGH;
+        buttons[i].pressEvent = gestures[i][0];
+        buttons[i].doubleEvent = gestures[i][1];
+        buttons[i].shortEvent = gestures[i][2];
+        buttons[i].longEvent = gestures[i][3];
+        buttons[i].pressed = false;
+        buttons[i].lockoutUntil = 0;
         buttons[i].pressTime = 0;
+        buttons[i].lastClick = 0;
         buttons[i].longPressTriggered = false;
     }
 }
 
 void ButtonHandler::begin() {
+    edgeQueue = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(uint8_t));
+    eventQueue = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(ButtonEvent));
+
+    if (edgeQueue == NULL || eventQueue == NULL) {
+        Serial.println("[Button] ERROR: Failed to create button queues");
+        return;
+    }
+
+    // Edge interrupts don't fire in light sleep. With light sleep on, each
+    // pin gets a level interrupt for the level it doesn't have - which is
+    // also its GPIO wakeup level - and the ISR flips it on every change,
+    // so a press and a release both wake the chip and interrupt once.
+    bool wakeOnLevel = powerManager.isLightSleepEnabled();
+
     // Initialize all button pins with internal pull-up
     for (int i = 0; i < 6; i++) {
         pinMode(buttons[i].pin, INPUT_PULLUP);
+        buttons[i].pressed = digitalRead(buttons[i].pin) == LOW;
+
+        isrArgs[i].queue = edgeQueue;
+        isrArgs[i].index = i;
+        isrArgs[i].pin = buttons[i].pin;
+        isrArgs[i].level = false;
+
+#ifdef CONFIG_PM_ENABLE
+        if (wakeOnLevel) {
+            isrArgs[i].level = true;
+            bool high = digitalRead(buttons[i].pin) == HIGH;
+            attachInterruptArg(digitalPinToInterrupt(buttons[i].pin), onEdge, &isrArgs[i],
+                               high ? ONLOW : ONHIGH);
+            gpio_wakeup_enable((gpio_num_t)buttons[i].pin, high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+            continue;
+        }
+#endif
+        attachInterruptArg(digitalPinToInterrupt(buttons[i].pin), onEdge, &isrArgs[i], CHANGE);
+    }
+
+#ifdef CONFIG_PM_ENABLE
+    if (wakeOnLevel && esp_sleep_enable_gpio_wakeup() != ESP_OK) {
+        Serial.println("[Button] ERROR: GPIO wakeup not available - buttons need the chip awake");
+    }
+#else
+    (void)wakeOnLevel;
+#endif
+
+    // Above the server tasks so pump buttons react while HTTP is busy
+    BaseType_t result = xTaskCreate(
+        buttonTask,                 // Task function
+        "Buttons",                  // Task name
+        BUTTON_TASK_STACK_SIZE,     // Stack size (bytes)
+        this,                       // Task parameters
+        BUTTON_TASK_PRIORITY,       // Priority
+        &taskHandle                 // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Button] ERROR: Failed to create button task");
+        taskHandle = NULL;
+        return;
     }
 
     Serial.println("[Button] Button handler initialized");
-    Serial.println("[Button] BTN1 (Pin " + String(BTN1_PIN) + "): Cycle screens");
+    Serial.println("[Button] BTN1 (Pin " + String(BTN1_PIN) + "): Cycle screens (double click: status)");
     Serial.println("[Button] BTN2 (Pin " + String(BTN2_PIN) + "): Pump ON");
     Serial.println("[Button] BTN3 (Pin " + String(BTN3_PIN) + "): Toggle mode");
     Serial.println("[Button] BTN4 (Pin " + String(BTN4_PIN) + "): Pump OFF");
@@ -28,92 +135,183 @@ void ButtonHandler::begin() {
     Serial.println("[Button] BTN6 (Pin " + String(BTN6_PIN) + "): Hardware override");
 }
 
-void ButtonHandler::readButton(int index) {
+void ButtonHandler::setEventCallback(ButtonEventCallback callback) {
+    eventCallback = callback;
+}
+
+// ============================================================================
+// INTERRUPT AND TASK
+// ============================================================================
+
+void IRAM_ATTR ButtonHandler::onEdge(void* arg) {
+    ButtonIsrArg* isrArg = static_cast<ButtonIsrArg*>(arg);
+    BaseType_t woken = pdFALSE;
+
+#ifdef CONFIG_PM_ENABLE
+    if (isrArg->level) {
+        // Wait for the opposite level (interrupt and wakeup share the type)
+        gpio_ll_set_intr_type(&GPIO, isrArg->pin,
+                              gpio_ll_get_level(&GPIO, isrArg->pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    }
+#endif
+
+    // A full queue only loses bounce edges - the task resamples after the lockout
+    xQueueSendFromISR(isrArg->queue, &isrArg->index, &woken);
+
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void ButtonHandler::buttonTask(void* parameter) {
+    ButtonHandler* self = static_cast<ButtonHandler*>(parameter);
+    uint8_t index;
+
+    for (;;) {
+        TickType_t timeout = self->nextTimeout(esp_timer_get_time());
+
+        if (xQueueReceive(self->edgeQueue, &index, timeout) == pdTRUE && index < 6) {
+            int64_t now = esp_timer_get_time();
+
+            // Edges during the lockout are bounce - sampled when it ends
+            if (self->buttons[index].lockoutUntil == 0) {
+                self->sampleButton(index, now);
+            }
+        }
+
+        self->processTimers(esp_timer_get_time());
+    }
+}
+
+// ============================================================================
+// DEBOUNCE AND GESTURES
+// ============================================================================
+
+void ButtonHandler::sampleButton(int index, int64_t now) {
     Button& btn = buttons[index];
 
     // Read current state (LOW = pressed with pull-up)
-    bool reading = digitalRead(btn.pin);
-
-    // Debounce logic
-    if (reading != btn.currentState) {
-        btn.currentState = reading;
-
-        // Button just pressed (HIGH -> LOW transition)
-        if (reading == LOW) {
-            btn.pressTime = millis();
-            btn.longPressTriggered = false;
-
-            // Generate immediate event for buttons 1-4 and 6
-            if (index == 0 && pendingEvent == BTN_NONE) {
-                pendingEvent = BTN1_PRESSED;
-                Serial.println("[Button] BTN1 pressed - Cycle screen");
-            } else if (index == 1 && pendingEvent == BTN_NONE) {
-                pendingEvent = BTN2_PRESSED;
-                Serial.println("[Button] BTN2 pressed - Pump ON");
-            } else if (index == 2 && pendingEvent == BTN_NONE) {
-                pendingEvent = BTN3_PRESSED;
-                Serial.println("[Button] BTN3 pressed - Toggle mode");
-            } else if (index == 3 && pendingEvent == BTN_NONE) {
-                pendingEvent = BTN4_PRESSED;
-                Serial.println("[Button] BTN4 pressed - Pump OFF");
-            } else if (index == 5 && pendingEvent == BTN_NONE) {
-                pendingEvent = BTN6_PRESSED;
-                Serial.println("[Button] BTN6 pressed - Hardware override");
-            }
+    bool pressed = digitalRead(btn.pin) == LOW;
+    if (pressed == btn.pressed) {
+        return;
+    }
+
+    btn.pressed = pressed;
+    btn.lockoutUntil = now + (int64_t)BUTTON_DEBOUNCE_MS * 1000;
+
+    if (pressed) {
+        onPress(index, now);
+    } else {
+        onRelease(index, now);
+    }
+}
+
+void ButtonHandler::processTimers(int64_t now) {
+    for (int i = 0; i < 6; i++) {
+        Button& btn = buttons[i];
+
+        // Lockout over: catch any change that happened during it
+        if (btn.lockoutUntil != 0 && now >= btn.lockoutUntil) {
+            btn.lockoutUntil = 0;
+            sampleButton(i, now);
         }
-        // Button released (LOW -> HIGH transition)
-        else if (reading == HIGH) {
-            // For BTN5, check if it was a short press
-            if (index == 4 && !btn.longPressTriggered && pendingEvent == BTN_NONE) {
-                unsigned long pressDuration = millis() - btn.pressTime;
-                if (pressDuration < BUTTON_LONG_PRESS_MS) {
-                    pendingEvent = BTN5_SHORT_PRESS;
-                    Serial.println("[Button] BTN5 short press");
-                }
-            }
+
+        if (btn.pressed && btn.longEvent != BTN_NONE && !btn.longPressTriggered &&
+            now - btn.pressTime >= (int64_t)BUTTON_LONG_PRESS_MS * 1000) {
+            btn.longPressTriggered = true;
+            postEvent(btn.longEvent);
         }
     }
-
-    btn.lastState = btn.currentState;
 }
 
-void ButtonHandler::checkLongPress() {
-    // Check BTN5 for long press
-    Button& btn5 = buttons[4]; // Index 4 = BTN5
+TickType_t ButtonHandler::nextTimeout(int64_t now) {
+    int64_t next = INT64_MAX;
 
-    if (btn5.currentState == LOW && !btn5.longPressTriggered) {
-        unsigned long pressDuration = millis() - btn5.pressTime;
+    for (int i = 0; i < 6; i++) {
+        const Button& btn = buttons[i];
 
-        if (pressDuration >= BUTTON_LONG_PRESS_MS) {
-            btn5.longPressTriggered = true;
+        if (btn.lockoutUntil != 0 && btn.lockoutUntil < next) {
+            next = btn.lockoutUntil;
+        }
 
-            if (pendingEvent == BTN_NONE) {
-                pendingEvent = BTN5_LONG_PRESS;
-                Serial.println("[Button] BTN5 long press - WiFi reset");
+        if (btn.pressed && btn.longEvent != BTN_NONE && !btn.longPressTriggered) {
+            int64_t longAt = btn.pressTime + (int64_t)BUTTON_LONG_PRESS_MS * 1000;
+            if (longAt < next) {
+                next = longAt;
             }
         }
     }
+
+    if (next == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    if (next <= now) {
+        return 0;
+    }
+
+    // Round up so the deadline has passed when the task wakes
+    return pdMS_TO_TICKS((next - now + 999) / 1000) + 1;
 }
 
-void ButtonHandler::update() {
-    // Read all buttons
-    for (int i = 0; i < 6; i++) {
-        readButton(i);
+void ButtonHandler::onPress(int index, int64_t now) {
+    Button& btn = buttons[index];
+
+    btn.pressTime = now;
+    btn.longPressTriggered = false;
+
+    // Second press within the window: double click replaces the press event
+    if (btn.doubleEvent != BTN_NONE && btn.lastClick != 0 &&
+        now - btn.lastClick <= (int64_t)BUTTON_DOUBLE_CLICK_MS * 1000) {
+        btn.lastClick = 0;
+        postEvent(btn.doubleEvent);
+        return;
+    }
+
+    btn.lastClick = now;
+
+    if (btn.pressEvent != BTN_NONE) {
+        postEvent(btn.pressEvent);
     }
+}
+
+void ButtonHandler::onRelease(int index, int64_t now) {
+    Button& btn = buttons[index];
 
-    // Check for long press on BTN5
-    checkLongPress();
+    if (btn.shortEvent != BTN_NONE && !btn.longPressTriggered &&
+        now - btn.pressTime < (int64_t)BUTTON_LONG_PRESS_MS * 1000) {
+        postEvent(btn.shortEvent);
+    }
 }
 
+void ButtonHandler::postEvent(ButtonEvent event) {
+    Serial.println("[Button] " + String(eventName(event)));
+
+    if (eventCallback != nullptr) {
+        eventCallback(event);
+    }
+
+    if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+        Serial.println("[Button] Event queue full - event dropped");
+    }
+}
+
+// ============================================================================
+// EVENT ACCESS
+// ============================================================================
+
 ButtonEvent ButtonHandler::getEvent() {
-    ButtonEvent event = pendingEvent;
-    pendingEvent = BTN_NONE; // Clear event after reading
+    ButtonEvent event = BTN_NONE;
+
+    if (eventQueue != NULL) {
+        xQueueReceive(eventQueue, &event, 0);
+    }
+
     return event;
 }
 
 bool ButtonHandler::isButtonPressed(uint8_t buttonNum) {
     if (buttonNum >= 1 && buttonNum <= 6) {
-        return buttons[buttonNum - 1].currentState == LOW;
+        return buttons[buttonNum - 1].pressed;
     }
     return false;
 }
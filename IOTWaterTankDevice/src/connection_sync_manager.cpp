@@ -1,6 +1,7 @@
 #include "connection_sync_manager.h"
 #include "storage_manager.h"
 #include "config.h"
+#include "esp_timer.h"
 
 // ============================================================================
 // CONSTRUCTOR
@@ -13,6 +14,15 @@ ConnectionSyncManager::ConnectionSyncManager() {
     syncStatus.lastServerTimestamp = 0;
     syncStatus.millisAtSync = 0;
     syncStatus.overflowCount = 0;
+    syncStatus.driftPpm = 0.0f;
+
+    // Clock discipline state
+    slewRemaining = 0;
+    lastSampleReference = 0;
+    lastSampleLocal = 0;
+    driftSamples = 0;
+    lastIssuedTimestamp = 0;
+    clockMux = portMUX_INITIALIZER_UNLOCKED;
 
     // Initialize callbacks
     fetchConfigCallback = nullptr;
@@ -27,6 +37,13 @@ ConnectionSyncManager::ConnectionSyncManager() {
 void ConnectionSyncManager::begin() {
     DEBUG_PRINTLN("[ConnSync] Initializing Connection Sync Manager");
     loadSyncStatus();
+
+    // Stored millisAtSync belongs to the previous boot. The stored timestamp
+    // is the last known time, so count uptime from there - a lower bound
+    // until the next NTP sync corrects it.
+    syncStatus.millisAtSync = 0;
+    syncStatus.overflowCount = 0;
+    lastIssuedTimestamp = syncStatus.lastServerTimestamp;
 }
 
 void ConnectionSyncManager::setFetchConfigCallback(FetchConfigCallback callback) {
@@ -144,13 +161,8 @@ bool ConnectionSyncManager::syncTimeWithServer() {
     uint64_t serverTime = syncTimeCallback();
 
     if (serverTime > 0) {
-        syncStatus.lastServerTimestamp = serverTime;
-        syncStatus.millisAtSync = millis();
-        syncStatus.overflowCount = 0;
-
+        applyTimeSample(serverTime);
         DEBUG_PRINTF("[ConnSync] Time synced: %llu ms\n", serverTime);
-
-        saveSyncStatus();
         return true;
     } else {
         DEBUG_PRINTLN("[ConnSync] Failed to sync time with server");
@@ -161,30 +173,116 @@ bool ConnectionSyncManager::syncTimeWithServer() {
 void ConnectionSyncManager::setTimestamp(uint64_t timestamp) {
     DEBUG_PRINTF("[ConnSync] Manually setting timestamp: %llu\n", timestamp);
 
+    portENTER_CRITICAL(&clockMux);
     syncStatus.lastServerTimestamp = timestamp;
-    syncStatus.millisAtSync = millis();
-    syncStatus.overflowCount = 0;  // Reset overflow counter
+    syncStatus.millisAtSync = localMillis();
+    syncStatus.overflowCount = 0;
+    slewRemaining = 0;
+    lastIssuedTimestamp = timestamp;    // A step may go backwards
+    portEXIT_CRITICAL(&clockMux);
 
     saveSyncStatus();
     DEBUG_PRINTLN("[ConnSync] Time sync updated via manual correction");
 }
 
-uint64_t ConnectionSyncManager::getCurrentTimestamp() {
-    checkMillisOverflow();
+void ConnectionSyncManager::applyTimeSample(uint64_t referenceTime) {
+    uint64_t local = localMillis();
 
-    uint64_t currentMillis = millis();
-    uint64_t elapsedMillis = currentMillis - syncStatus.millisAtSync;
+    // First reference this boot: step and remember it as the drift baseline
+    if (lastSampleLocal == 0) {
+        portENTER_CRITICAL(&clockMux);
+        syncStatus.lastServerTimestamp = referenceTime;
+        syncStatus.millisAtSync = local;
+        slewRemaining = 0;
+        lastIssuedTimestamp = referenceTime;
+        portEXIT_CRITICAL(&clockMux);
 
-    // Add overflow compensation
-    uint64_t overflowCompensation = (uint64_t)syncStatus.overflowCount * 4294967296ULL;
+        lastSampleReference = referenceTime;
+        lastSampleLocal = local;
 
-    return syncStatus.lastServerTimestamp + elapsedMillis + overflowCompensation;
+        DEBUG_PRINTF("[ConnSync] Clock set: %llu ms (drift estimate %.2f ppm)\n",
+                     referenceTime, syncStatus.driftPpm);
+        saveSyncStatus();
+        return;
+    }
+
+    // Error against the current estimate (before the drift estimate changes)
+    portENTER_CRITICAL(&clockMux);
+    uint64_t predicted = estimateAt(local);
+    portEXIT_CRITICAL(&clockMux);
+    int64_t error = (int64_t)(referenceTime - predicted);
+
+    // Drift: compare reference elapsed time against the raw local oscillator
+    uint64_t localDelta = local - lastSampleLocal;
+    if (localDelta >= CLOCK_DRIFT_MIN_INTERVAL) {
+        int64_t referenceDelta = (int64_t)(referenceTime - lastSampleReference);
+        float measuredPpm = (float)((double)(referenceDelta - (int64_t)localDelta) * 1000000.0 / (double)localDelta);
+
+        if (fabsf(measuredPpm) <= CLOCK_DRIFT_MAX_PPM) {
+            // First measurement without a stored estimate is taken as-is,
+            // later ones are smoothed to filter NTP jitter
+            float driftPpm = (driftSamples == 0 && syncStatus.driftPpm == 0.0f)
+                                 ? measuredPpm
+                                 : syncStatus.driftPpm + 0.25f * (measuredPpm - syncStatus.driftPpm);
+            driftSamples++;
+
+            portENTER_CRITICAL(&clockMux);
+            syncStatus.driftPpm = driftPpm;
+            portEXIT_CRITICAL(&clockMux);
+
+            DEBUG_PRINTF("[ConnSync] Drift measured %.2f ppm, estimate %.2f ppm\n", measuredPpm, driftPpm);
+        } else {
+            DEBUG_PRINTF("[ConnSync] Ignoring drift sample %.2f ppm (out of range)\n", measuredPpm);
+        }
+
+        lastSampleReference = referenceTime;
+        lastSampleLocal = local;
+    }
+
+    portENTER_CRITICAL(&clockMux);
+    if (error > CLOCK_STEP_THRESHOLD || error < -CLOCK_STEP_THRESHOLD) {
+        // Too far off to slew in reasonable time - step. The monotonic floor
+        // is reset with it, or a bad forward time would freeze the clock
+        // until real time caught up.
+        syncStatus.lastServerTimestamp = referenceTime;
+        slewRemaining = 0;
+        lastIssuedTimestamp = referenceTime;
+    } else {
+        // Rebase on the current estimate (continuous) and slew the error in
+        syncStatus.lastServerTimestamp = predicted;
+        slewRemaining = error;
+    }
+    syncStatus.millisAtSync = local;
+    portEXIT_CRITICAL(&clockMux);
+
+    DEBUG_PRINTF("[ConnSync] Clock error %lld ms -> %s\n", error,
+                 (error > CLOCK_STEP_THRESHOLD || error < -CLOCK_STEP_THRESHOLD) ? "stepped" : "slewing");
+
+    saveSyncStatus();
+}
+
+uint64_t ConnectionSyncManager::getCurrentTimestamp() {
+    portENTER_CRITICAL(&clockMux);
+    uint64_t timestamp = estimateAt(localMillis());
+
+    // Never go backwards (lastModified ordering depends on it)
+    if (timestamp < lastIssuedTimestamp) {
+        timestamp = lastIssuedTimestamp;
+    }
+    lastIssuedTimestamp = timestamp;
+    portEXIT_CRITICAL(&clockMux);
+
+    return timestamp;
 }
 
 bool ConnectionSyncManager::isTimeSynced() {
     return syncStatus.lastServerTimestamp > 0;
 }
 
+bool ConnectionSyncManager::hasReferenceTime() {
+    return lastSampleLocal != 0;
+}
+
 // ============================================================================
 // STATUS QUERIES
 // ============================================================================
@@ -211,6 +309,7 @@ void ConnectionSyncManager::saveSyncStatus() {
     storageManager.saveServerTime(syncStatus.lastServerTimestamp);
     storageManager.saveMillisSync(syncStatus.millisAtSync);
     storageManager.saveOverflowCount(syncStatus.overflowCount);
+    storageManager.saveClockDrift(syncStatus.driftPpm);
 
     DEBUG_PRINTLN("[ConnSync] Sync status saved to storage");
 }
@@ -221,29 +320,36 @@ void ConnectionSyncManager::loadSyncStatus() {
     syncStatus.lastServerTimestamp = storageManager.getServerTime();
     syncStatus.millisAtSync = storageManager.getMillisSync();
     syncStatus.overflowCount = storageManager.getOverflowCount();
+    syncStatus.driftPpm = storageManager.getClockDrift();
 
     DEBUG_PRINTLN("[ConnSync] Sync status loaded from storage:");
     DEBUG_PRINTF("[ConnSync]   serverSync: %s\n", syncStatus.serverSync ? "true" : "false");
     DEBUG_PRINTF("[ConnSync]   device_config_sync_status: %s\n", syncStatus.device_config_sync_status ? "true" : "false");
     DEBUG_PRINTF("[ConnSync]   lastServerTimestamp: %llu\n", syncStatus.lastServerTimestamp);
     DEBUG_PRINTF("[ConnSync]   millisAtSync: %llu\n", syncStatus.millisAtSync);
-    DEBUG_PRINTF("[ConnSync]   overflowCount: %u\n", syncStatus.overflowCount);
+    DEBUG_PRINTF("[ConnSync]   driftPpm: %.2f\n", syncStatus.driftPpm);
 }
 
 // ============================================================================
 // HELPER METHODS
 // ============================================================================
 
-void ConnectionSyncManager::checkMillisOverflow() {
-    static unsigned long lastMillis = 0;
-    unsigned long currentMillis = millis();
+uint64_t ConnectionSyncManager::localMillis() {
+    return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+uint64_t ConnectionSyncManager::estimateAt(uint64_t local) {
+    int64_t elapsed = (int64_t)(local - syncStatus.millisAtSync);
 
-    // Detect overflow (millis() wrapped around)
-    if (currentMillis < lastMillis) {
-        syncStatus.overflowCount++;
-        DEBUG_PRINTF("[ConnSync] millis() overflow detected! Count: %u\n", syncStatus.overflowCount);
-        saveSyncStatus();
-    }
+    // Drift correction (integer ppb math, float is too coarse for long spans)
+    int64_t driftPpb = (int64_t)(syncStatus.driftPpm * 1000.0f);
+    int64_t corrected = elapsed + (elapsed * driftPpb) / 1000000000LL;
+
+    // Slew: apply the pending correction no faster than CLOCK_SLEW_RATE_PPM
+    int64_t maxSlew = (elapsed * CLOCK_SLEW_RATE_PPM) / 1000000LL;
+    int64_t slew = slewRemaining;
+    if (slew > maxSlew) slew = maxSlew;
+    if (slew < -maxSlew) slew = -maxSlew;
 
-    lastMillis = currentMillis;
+    return syncStatus.lastServerTimestamp + corrected + slew;
 }
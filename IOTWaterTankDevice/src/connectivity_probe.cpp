@@ -0,0 +1,145 @@
+#include "connectivity_probe.h"
+#include "server_url.h"
+#include <WiFi.h>
+
+// Global instance
+ConnectivityProbe connectivityProbe;
+
+ConnectivityProbe::ConnectivityProbe()
+    : port(80),
+      state(CONNECTIVITY_UNKNOWN),
+      resultTime(0),
+      consecutiveFailures(0),
+      lastProbeTime(0),
+      targetGeneration(0),
+      taskHandle(NULL),
+      mux(portMUX_INITIALIZER_UNLOCKED) {
+}
+
+void ConnectivityProbe::begin() {
+    updateTarget();
+}
+
+// Host/port of the current server URL; a changed URL also drops results
+// and failures that belonged to the previous backend
+void ConnectivityProbe::updateTarget() {
+    targetGeneration = serverUrl.getGeneration();
+    if (!ServerUrl::parseHostPort(serverUrl.get(), host, port)) {
+        host = "";
+    }
+    reset();
+
+    Serial.printf("[Probe] Backend probe target %s:%u\n", host.c_str(), port);
+}
+
+// ============================================================================
+// PASSIVE SIGNALS
+// ============================================================================
+
+void ConnectivityProbe::reportSuccess() {
+    consecutiveFailures = 0;
+    setResult(CONNECTIVITY_REACHABLE);
+}
+
+void ConnectivityProbe::reportFailure() {
+    consecutiveFailures++;
+}
+
+void ConnectivityProbe::reset() {
+    consecutiveFailures = 0;
+    setResult(CONNECTIVITY_UNKNOWN);
+}
+
+// ============================================================================
+// ACTIVE PROBE
+// ============================================================================
+
+void ConnectivityProbe::update() {
+    if (targetGeneration != serverUrl.getGeneration() && !isProbing()) {
+        updateTarget();
+    }
+
+    if (consecutiveFailures < CONNECTIVITY_PROBE_FAILURES || isProbing()) {
+        return;
+    }
+
+    // A fresh result (passive or active) already answers the question
+    if (getState() != CONNECTIVITY_UNKNOWN) {
+        return;
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+        setResult(CONNECTIVITY_UNREACHABLE);
+        return;
+    }
+
+    startProbe();
+}
+
+bool ConnectivityProbe::startProbe() {
+    if (isProbing() || host.length() == 0) {
+        return false;
+    }
+
+    BaseType_t result = xTaskCreate(
+        probeTask,                      // Task function
+        "ConnProbe",                    // Task name
+        CONNECTIVITY_PROBE_STACK_SIZE,  // Stack size (bytes)
+        this,                           // Task parameters
+        1,                              // Priority (1 = low, same as other server tasks)
+        &taskHandle                     // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Probe] Failed to create probe task");
+        taskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void ConnectivityProbe::probeTask(void* parameter) {
+    ConnectivityProbe* self = static_cast<ConnectivityProbe*>(parameter);
+
+    WiFiClient client;
+    unsigned long start = millis();
+    bool connected = client.connect(self->host.c_str(), self->port, CONNECTIVITY_PROBE_TIMEOUT);
+    unsigned long elapsed = millis() - start;
+    client.stop();
+
+    if (connected) {
+        self->lastProbeTime = elapsed;
+        self->setResult(CONNECTIVITY_REACHABLE);
+        Serial.printf("[Probe] Backend reachable (TCP connect %lu ms)\n", elapsed);
+    } else {
+        self->setResult(CONNECTIVITY_UNREACHABLE);
+        Serial.printf("[Probe] Backend unreachable (%lu ms)\n", elapsed);
+    }
+
+    self->taskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// STATE
+// ============================================================================
+
+ConnectivityState ConnectivityProbe::getState() {
+    portENTER_CRITICAL(&mux);
+    ConnectivityState current = state;
+    unsigned long age = millis() - resultTime;
+    portEXIT_CRITICAL(&mux);
+
+    if (current != CONNECTIVITY_UNKNOWN && age >= CONNECTIVITY_PROBE_TTL) {
+        return CONNECTIVITY_UNKNOWN;
+    }
+    return current;
+}
+
+void ConnectivityProbe::setResult(ConnectivityState newState) {
+    portENTER_CRITICAL(&mux);
+    state = newState;
+    resultTime = millis();
+    portEXIT_CRITICAL(&mux);
+}
@@ -1,11 +1,18 @@
 #include "control_data.h"
 #include "endpoints.h"
+#include "server_url.h"
 
 // ============================================================================
 // CONSTRUCTOR
 // ============================================================================
 
-ControlDataManager::ControlDataManager() {
+ControlDataManager::ControlDataManager() : unauthorized(false) {
+}
+
+bool ControlDataManager::consumeUnauthorized() {
+    bool result = unauthorized;
+    unauthorized = false;
+    return result;
 }
 
 // ============================================================================
@@ -96,7 +103,7 @@ bool ControlDataManager::httpRequest(const String& method, const String& endpoin
     while (attempt < retries) {
         attempt++;
 
-        String url = String(SERVER_URL) + endpoint;
+        String url = serverUrl.get() + endpoint;
         http.begin(url);
         http.addHeader("Content-Type", "application/json");
         http.setTimeout(HTTP_TIMEOUT);
@@ -124,6 +131,11 @@ bool ControlDataManager::httpRequest(const String& method, const String& endpoin
             if (httpCode >= 200 && httpCode < 300) {
                 DEBUG_PRINTF("[ControlData] Request successful (HTTP %d)\n", httpCode);
                 return true;
+            } else if (httpCode == 401) {
+                // Token expired or revoked - retrying with it cannot succeed
+                Serial.println("[ControlData] Unauthorized (401) - token rejected");
+                unauthorized = true;
+                return false;
             } else {
                 Serial.println("[ControlData] Request failed (HTTP " + String(httpCode) + "): " + response);
             }
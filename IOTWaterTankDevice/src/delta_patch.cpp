@@ -0,0 +1,276 @@
+#include "delta_patch.h"
+#include <string.h>
+
+// ============================================================================
+// CONSTRUCTOR
+// ============================================================================
+
+DeltaPatcher::DeltaPatcher()
+    : source(nullptr),
+      sink(nullptr),
+      state(STATE_ERROR),
+      error("Not started"),
+      headerFill(0),
+      newSize(0),
+      newPos(0),
+      oldPos(0),
+      diffRemaining(0),
+      extraRemaining(0),
+      seek(0),
+      bodySink(this) {
+}
+
+void DeltaPatcher::begin(PatchSource* patchSource, PatchSink* patchSink) {
+    source = patchSource;
+    sink = patchSink;
+    state = STATE_HEADER;
+    error = nullptr;
+    headerFill = 0;
+    newSize = 0;
+    newPos = 0;
+    oldPos = 0;
+    diffRemaining = 0;
+    extraRemaining = 0;
+    seek = 0;
+    decoder.begin(&bodySink);
+}
+
+// ============================================================================
+// STREAM INPUT
+// ============================================================================
+
+bool DeltaPatcher::feed(const uint8_t* data, size_t length) {
+    if (state == STATE_ERROR) {
+        return false;
+    }
+
+    // Uncompressed file header
+    if (state == STATE_HEADER) {
+        size_t used = collect(data, length, DELTA_PATCH_HEADER_LEN);
+        if (headerFill == DELTA_PATCH_HEADER_LEN && !parseHeader()) {
+            return false;
+        }
+        data += used;
+        length -= used;
+    }
+
+    if (length == 0 || state == STATE_HEADER) {
+        return state != STATE_ERROR;
+    }
+
+    // Compressed body - the decoder calls feedBody() with its output
+    if (!decoder.feed(data, length)) {
+        if (state != STATE_ERROR) {
+            fail(decoder.getError());
+        }
+        return false;
+    }
+    return true;
+}
+
+bool DeltaPatcher::finish() {
+    if (state == STATE_ERROR) {
+        return false;
+    }
+    if (state == STATE_HEADER) {
+        return fail("Patch ended in the header");
+    }
+
+    // Push out the decoder's buffered tail
+    if (!decoder.finish()) {
+        if (state != STATE_ERROR) {
+            fail(decoder.getError());
+        }
+        return false;
+    }
+
+    if (state != STATE_DONE) {
+        return fail("Patch ended before the new image was complete");
+    }
+    return true;
+}
+
+bool DeltaPatcher::feedBody(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t used = 0;
+
+        switch (state) {
+            case STATE_CONTROL:
+                used = collect(data, length, 24);
+                if (headerFill == 24 && !parseControl()) {
+                    return false;
+                }
+                break;
+
+            case STATE_DIFF:
+                used = applyDiff(data, length);
+                if (used == 0) {
+                    return false;
+                }
+                break;
+
+            case STATE_EXTRA:
+                used = applyExtra(data, length);
+                if (used == 0) {
+                    return false;
+                }
+                break;
+
+            case STATE_DONE:
+                return fail("Trailing data after end of patch");
+
+            case STATE_HEADER:
+            case STATE_ERROR:
+            default:
+                return false;
+        }
+
+        data += used;
+        length -= used;
+    }
+
+    return true;
+}
+
+size_t DeltaPatcher::collect(const uint8_t* data, size_t length, size_t needed) {
+    size_t take = needed - headerFill;
+    if (take > length) {
+        take = length;
+    }
+    memcpy(header + headerFill, data, take);
+    headerFill += take;
+    return take;
+}
+
+bool DeltaPatcher::parseHeader() {
+    if (memcmp(header, DELTA_PATCH_MAGIC, DELTA_PATCH_MAGIC_LEN) != 0) {
+        return fail("Bad patch magic");
+    }
+
+    int64_t size = offtin(header + DELTA_PATCH_MAGIC_LEN);
+    if (size <= 0) {
+        return fail("Bad new image size");
+    }
+
+    if (header[16] != HEATSHRINK_WINDOW_BITS || header[17] != HEATSHRINK_LOOKAHEAD_BITS) {
+        return fail("Patch compressed with other heatshrink parameters");
+    }
+
+    newSize = (uint64_t)size;
+    headerFill = 0;
+    state = STATE_CONTROL;
+    return true;
+}
+
+bool DeltaPatcher::parseControl() {
+    int64_t add = offtin(header);
+    int64_t copy = offtin(header + 8);
+    seek = offtin(header + 16);
+    headerFill = 0;
+
+    if (add < 0 || copy < 0) {
+        return fail("Negative block length");
+    }
+    if ((uint64_t)add > newSize - newPos || (uint64_t)copy > newSize - newPos - (uint64_t)add) {
+        return fail("Block exceeds new image size");
+    }
+
+    diffRemaining = (uint64_t)add;
+    extraRemaining = (uint64_t)copy;
+
+    if (diffRemaining > 0) {
+        state = STATE_DIFF;
+    } else if (extraRemaining > 0) {
+        state = STATE_EXTRA;
+    } else {
+        finishBlock();
+    }
+    return true;
+}
+
+// ============================================================================
+// BLOCK APPLICATION
+// ============================================================================
+
+size_t DeltaPatcher::applyDiff(const uint8_t* data, size_t length) {
+    size_t n = length;
+    if (n > DELTA_PATCH_CHUNK) n = DELTA_PATCH_CHUNK;
+    if (n > diffRemaining) n = (size_t)diffRemaining;
+
+    // Old bytes outside the source image count as zero (as in bspatch)
+    memset(oldBuffer, 0, n);
+    int64_t oldSize = (int64_t)source->size();
+    int64_t start = oldPos < 0 ? 0 : oldPos;
+    int64_t end = oldPos + (int64_t)n;
+    if (end > oldSize) end = oldSize;
+    if (start < end) {
+        if (!source->read((size_t)start, oldBuffer + (start - oldPos), (size_t)(end - start))) {
+            fail("Source image read failed");
+            return 0;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        outBuffer[i] = (uint8_t)(oldBuffer[i] + data[i]);
+    }
+
+    if (!sink->write(outBuffer, n)) {
+        fail("Sink write failed");
+        return 0;
+    }
+
+    oldPos += n;
+    newPos += n;
+    diffRemaining -= n;
+
+    if (diffRemaining == 0) {
+        if (extraRemaining > 0) {
+            state = STATE_EXTRA;
+        } else {
+            finishBlock();
+        }
+    }
+    return n;
+}
+
+size_t DeltaPatcher::applyExtra(const uint8_t* data, size_t length) {
+    size_t n = length;
+    if (n > extraRemaining) n = (size_t)extraRemaining;
+
+    if (!sink->write(data, n)) {
+        fail("Sink write failed");
+        return 0;
+    }
+
+    newPos += n;
+    extraRemaining -= n;
+
+    if (extraRemaining == 0) {
+        finishBlock();
+    }
+    return n;
+}
+
+void DeltaPatcher::finishBlock() {
+    oldPos += seek;
+    seek = 0;
+    state = (newPos == newSize) ? STATE_DONE : STATE_CONTROL;
+}
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+bool DeltaPatcher::fail(const char* message) {
+    error = message;
+    state = STATE_ERROR;
+    return false;
+}
+
+int64_t DeltaPatcher::offtin(const uint8_t* buf) {
+    uint64_t value = buf[7] & 0x7F;
+    for (int i = 6; i >= 0; i--) {
+        value = (value << 8) | buf[i];
+    }
+    return (buf[7] & 0x80) ? -(int64_t)value : (int64_t)value;
+}
@@ -1,11 +1,19 @@
 #include "device_config.h"
 #include "endpoints.h"
+#include "server_url.h"
+#include "handle_config_data.h"
 
 // ============================================================================
 // CONSTRUCTOR
 // ============================================================================
 
-DeviceConfigManager::DeviceConfigManager() {
+DeviceConfigManager::DeviceConfigManager() : unauthorized(false) {
+}
+
+bool DeviceConfigManager::consumeUnauthorized() {
+    bool result = unauthorized;
+    unauthorized = false;
+    return result;
 }
 
 // ============================================================================
@@ -107,6 +115,7 @@ bool DeviceConfigManager::configValuesChanged(const DeviceConfig& a, const Devic
     if (a.force_update != b.force_update) return true;
     if (a.ipAddress != b.ipAddress) return true;
     if (a.auto_update != b.auto_update) return true;
+    if (a.heartbeatSec != b.heartbeatSec) return true;
 
     // All values identical
     return false;
@@ -125,7 +134,7 @@ bool DeviceConfigManager::httpRequest(const String& method, const String& endpoi
     while (attempt < retries) {
         attempt++;
 
-        String url = String(SERVER_URL) + endpoint;
+        String url = serverUrl.get() + endpoint;
         http.begin(url);
         http.addHeader("Content-Type", "application/json");
         http.setTimeout(HTTP_TIMEOUT);
@@ -153,6 +162,11 @@ bool DeviceConfigManager::httpRequest(const String& method, const String& endpoi
             if (httpCode >= 200 && httpCode < 300) {
                 DEBUG_PRINTF("[DeviceConfig] Request successful (HTTP %d)\n", httpCode);
                 return true;
+            } else if (httpCode == 401) {
+                // Token expired or revoked - retrying with it cannot succeed
+                Serial.println("[DeviceConfig] Unauthorized (401) - token rejected");
+                unauthorized = true;
+                return false;
             } else {
                 Serial.println("[DeviceConfig] Request failed (HTTP " + String(httpCode) + "): " + response);
             }
@@ -251,6 +265,10 @@ bool DeviceConfigManager::parseConfig(const String& json, DeviceConfig& config)
 
         config.auto_update = deviceConfig["auto_update"]["value"] | true;
         config.autoUpdateLastModified = deviceConfig["auto_update"]["lastModified"] | (uint64_t)0;
+
+        // Backends without the field get the compiled-in heartbeat
+        config.heartbeatSec = deviceConfig["heartbeatSec"]["value"] | (float)(TELEMETRY_HEARTBEAT_INTERVAL / 1000);
+        config.heartbeatSecLastModified = deviceConfig["heartbeatSec"]["lastModified"] | (uint64_t)0;
     } else {
         // Direct format: {upperThreshold: 95, lowerThreshold: 20, ...}
         config.upperThreshold = deviceConfig["upperThreshold"] | DEFAULT_UPPER_THRESHOLD;
@@ -282,6 +300,16 @@ bool DeviceConfigManager::parseConfig(const String& json, DeviceConfig& config)
 
         config.auto_update = deviceConfig["auto_update"] | true;
         config.autoUpdateLastModified = 0;
+
+        config.heartbeatSec = deviceConfig["heartbeatSec"] | (float)(TELEMETRY_HEARTBEAT_INTERVAL / 1000);
+        config.heartbeatSecLastModified = 0;
+    }
+
+    if (!ConfigDataHandler::isPlausible(config.upperThreshold, config.lowerThreshold,
+                                        config.tankHeight, config.tankWidth,
+                                        config.usedTotal, config.maxInflow)) {
+        Serial.println("[DeviceConfig] Rejected implausible config values");
+        return false;
     }
 
     return true;
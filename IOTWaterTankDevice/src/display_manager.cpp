@@ -1,32 +1,66 @@
 #include "display_manager.h"
+#include "power_manager.h"
 
 DisplayManager::DisplayManager()
-    : display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET),
+    : display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK, OLED_I2C_CLOCK),
       currentScreen(SCREEN_STATUS),
       tankHeight(DEFAULT_TANK_HEIGHT),
       tankWidth(DEFAULT_TANK_WIDTH),
       tankShape("Cylindrical"),
       upperThreshold(DEFAULT_UPPER_THRESHOLD),
       lowerThreshold(DEFAULT_LOWER_THRESHOLD),
-      uptime(0) {
+      uptime(0),
+      otaProgress(-1),
+      messageUntil(0),
+      frontFrame(nullptr),
+      shadowFrame(nullptr),
+      shadowValid(false),
+      frameMutex(NULL),
+      taskHandle(NULL) {
 }
 
 bool DisplayManager::begin() {
     // Initialize I2C with custom pins
     Wire.begin(OLED_SDA_PIN, OLED_SCL_PIN);
+    Wire.setClock(OLED_I2C_CLOCK);
 
     // Initialize display
-    if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
+    if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_I2C_ADDRESS)) {
         Serial.println("[Display] SSD1306 allocation failed");
         return false;
     }
 
+    frontFrame = (uint8_t*)malloc(OLED_WIDTH * OLED_HEIGHT / 8);
+    shadowFrame = (uint8_t*)malloc(OLED_WIDTH * OLED_HEIGHT / 8);
+    frameMutex = xSemaphoreCreateMutex();
+    shadowValid = false;
+
+    if (frontFrame == nullptr || shadowFrame == nullptr || frameMutex == NULL) {
+        Serial.println("[Display] Frame buffer allocation failed");
+        return false;
+    }
+
     display.clearDisplay();
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
 
     Serial.println("[Display] OLED initialized");
 
+    // From here on only the display task talks to the panel
+    BaseType_t result = xTaskCreate(
+        displayTask,                // Task function
+        "Display",                  // Task name
+        DISPLAY_TASK_STACK_SIZE,    // Stack size (bytes)
+        this,                       // Task parameters
+        1,                          // Priority (1 = low, higher than idle)
+        &taskHandle                 // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Display] Failed to create display task - flushing on the main loop");
+        taskHandle = NULL;
+    }
+
     showSplash();
 
     return true;
@@ -44,19 +78,24 @@ void DisplayManager::showSplash() {
     display.setCursor(0, 50);
     display.println("Initializing...");
 
-    display.display();
-    delay(2000);
+    flush();
+    messageUntil = millis() + 2000;
 }
 
 void DisplayManager::clear() {
     display.clearDisplay();
-    display.display();
+    flush();
 }
 
 void DisplayManager::update(float waterLevel, float waterLevelPercent, bool pumpOn,
                            const String& pumpMode, int rssi, bool wifiConnected) {
     uptime = millis();
 
+    // Leave a message up until it expires
+    if ((long)(messageUntil - uptime) > 0) {
+        return;
+    }
+
     display.clearDisplay();
 
     switch (currentScreen) {
@@ -77,7 +116,26 @@ void DisplayManager::update(float waterLevel, float waterLevelPercent, bool pump
             break;
     }
 
-    display.display();
+    if (otaProgress >= 0) {
+        drawOtaOverlay();
+    }
+
+    flush();
+}
+
+void DisplayManager::setOtaProgress(int percent) {
+    otaProgress = percent;
+}
+
+void DisplayManager::drawOtaOverlay() {
+    // Bottom strip: "OTA xx%" + bar, drawn over the current screen
+    display.fillRect(0, OLED_HEIGHT - 10, OLED_WIDTH, 10, SSD1306_BLACK);
+
+    display.setTextSize(1);
+    display.setCursor(0, OLED_HEIGHT - 8);
+    display.print("OTA " + String(otaProgress) + "%");
+
+    drawProgressBar(48, OLED_HEIGHT - 8, OLED_WIDTH - 48, 7, otaProgress);
 }
 
 void DisplayManager::drawStatusScreen(float waterLevel, float waterLevelPercent,
@@ -264,6 +322,12 @@ void DisplayManager::nextScreen() {
     Serial.println("[Display] Screen changed to: " + String(next + 1) + "/" + String(SCREEN_COUNT));
 }
 
+void DisplayManager::setScreen(DisplayScreen screen) {
+    if (screen < SCREEN_COUNT) {
+        currentScreen = screen;
+    }
+}
+
 DisplayScreen DisplayManager::getCurrentScreen() {
     return currentScreen;
 }
@@ -292,10 +356,109 @@ void DisplayManager::showMessage(const String& title, const String& message, int
     display.setCursor(0, 20);
     display.println(message);
 
-    display.display();
+    flush();
+
+    messageUntil = millis() + (duration > 0 ? duration : 0);
+}
+
+void DisplayManager::flush() {
+    if (taskHandle == NULL) {
+        // No display task: diff and send right here
+        uint8_t first[OLED_HEIGHT / 8];
+        uint8_t last[OLED_HEIGHT / 8];
+        collectDirty(display.getBuffer(), first, last);
+        sendDirty(first, last);
+        return;
+    }
+
+    // Swap: publish the back buffer as the new front frame. Only the copy
+    // is under the lock - the I2C transfer runs in the display task.
+    xSemaphoreTake(frameMutex, portMAX_DELAY);
+    memcpy(frontFrame, display.getBuffer(), OLED_WIDTH * OLED_HEIGHT / 8);
+    xSemaphoreGive(frameMutex);
+
+    xTaskNotifyGive(taskHandle);
+}
+
+void DisplayManager::displayTask(void* parameter) {
+    DisplayManager* self = static_cast<DisplayManager*>(parameter);
+    uint8_t first[OLED_HEIGHT / 8];
+    uint8_t last[OLED_HEIGHT / 8];
+
+    for (;;) {
+        // Frames presented while sending coalesce into one notification
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(self->frameMutex, portMAX_DELAY);
+        self->collectDirty(self->frontFrame, first, last);
+        xSemaphoreGive(self->frameMutex);
+
+        powerManager.beginActivity(POWER_DISPLAY);
+        self->sendDirty(first, last);
+        powerManager.endActivity(POWER_DISPLAY);
+    }
+}
+
+void DisplayManager::collectDirty(const uint8_t* frame, uint8_t* first, uint8_t* last) {
+    // Each page is 8 pixel rows = OLED_WIDTH bytes. Record the column span
+    // that changed; the first frame (panel content unknown) is sent whole.
+    for (uint8_t page = 0; page < OLED_HEIGHT / 8; page++) {
+        const uint8_t* row = frame + page * OLED_WIDTH;
+        uint8_t* shown = shadowFrame + page * OLED_WIDTH;
+
+        int lo = 0;
+        int hi = OLED_WIDTH - 1;
+
+        if (shadowValid) {
+            while (lo < OLED_WIDTH && row[lo] == shown[lo]) {
+                lo++;
+            }
+            if (lo == OLED_WIDTH) {
+                first[page] = 1;
+                last[page] = 0;
+                continue;
+            }
+            while (row[hi] == shown[hi]) {
+                hi--;
+            }
+        }
+
+        memcpy(shown + lo, row + lo, hi - lo + 1);
+        first[page] = lo;
+        last[page] = hi;
+    }
+
+    shadowValid = true;
+}
+
+void DisplayManager::sendDirty(const uint8_t* first, const uint8_t* last) {
+    for (uint8_t page = 0; page < OLED_HEIGHT / 8; page++) {
+        if (first[page] <= last[page]) {
+            writePage(page, first[page], last[page], shadowFrame + page * OLED_WIDTH + first[page]);
+        }
+    }
+}
 
-    if (duration > 0) {
-        delay(duration);
+void DisplayManager::writePage(uint8_t page, uint8_t firstCol, uint8_t lastCol, const uint8_t* data) {
+    // Horizontal addressing: restrict the write window to this page/span
+    display.ssd1306_command(SSD1306_PAGEADDR);
+    display.ssd1306_command(page);
+    display.ssd1306_command(page);
+    display.ssd1306_command(SSD1306_COLUMNADDR);
+    display.ssd1306_command(firstCol);
+    display.ssd1306_command(lastCol);
+
+    size_t remaining = lastCol - firstCol + 1;
+    while (remaining > 0) {
+        size_t count = min(remaining, (size_t)OLED_I2C_CHUNK);
+
+        Wire.beginTransmission(OLED_I2C_ADDRESS);
+        Wire.write((uint8_t)0x40);  // Co = 0, D/C = 1: data stream
+        Wire.write(data, count);
+        Wire.endTransmission();
+
+        data += count;
+        remaining -= count;
     }
 }
 
@@ -1,6 +1,7 @@
 #include "handle_config_data.h"
 #include "sync_merge.h"
 #include "config.h"
+#include <math.h>
 
 void ConfigDataHandler::begin() {
     // Initialize with default values
@@ -14,6 +15,8 @@ void ConfigDataHandler::begin() {
     forceUpdate.value = false;
     ipAddress.value = "";
     autoUpdate.value = true;
+    heartbeatSec.value = TELEMETRY_HEARTBEAT_INTERVAL / 1000;
+    heartbeatSec.api_value = heartbeatSec.value;
 
     DEBUG_PRINTLN("[ConfigHandler] Initialized with defaults");
 }
@@ -27,7 +30,8 @@ void ConfigDataHandler::updateFromAPI(float api_upperThreshold, uint64_t api_upp
                                        float api_maxInflow, uint64_t api_maxInflow_ts,
                                        bool api_forceUpdate, uint64_t api_forceUpdate_ts,
                                        const String& api_ipAddress, uint64_t api_ipAddress_ts,
-                                       bool api_autoUpdate, uint64_t api_autoUpdate_ts) {
+                                       bool api_autoUpdate, uint64_t api_autoUpdate_ts,
+                                       float api_heartbeatSec, uint64_t api_heartbeatSec_ts) {
     upperThreshold.api_value = api_upperThreshold;
     upperThreshold.api_lastModified = api_upperThreshold_ts;
 
@@ -58,6 +62,9 @@ void ConfigDataHandler::updateFromAPI(float api_upperThreshold, uint64_t api_upp
     autoUpdate.api_value = api_autoUpdate;
     autoUpdate.api_lastModified = api_autoUpdate_ts;
 
+    heartbeatSec.api_value = api_heartbeatSec;
+    heartbeatSec.api_lastModified = api_heartbeatSec_ts;
+
     DEBUG_PRINTLN("[ConfigHandler] Updated from API");
 }
 
@@ -160,6 +167,7 @@ bool ConfigDataHandler::merge() {
     changed |= SyncMerge::mergeBool(forceUpdate);
     changed |= SyncMerge::mergeString(ipAddress);
     changed |= SyncMerge::mergeBool(autoUpdate);
+    changed |= SyncMerge::mergeFloat(heartbeatSec);
 
     if (changed) {
         DEBUG_PRINTLN("[ConfigHandler] Config values changed after merge");
@@ -168,6 +176,36 @@ bool ConfigDataHandler::merge() {
     return changed;
 }
 
+bool ConfigDataHandler::isPlausible(float upperThreshold, float lowerThreshold,
+                                    float tankHeight, float tankWidth,
+                                    float usedTotal, float maxInflow) {
+    // Written so that NaN fails every comparison
+    if (!(lowerThreshold >= 0.0f && upperThreshold <= 100.0f && lowerThreshold < upperThreshold)) {
+        return false;
+    }
+    if (!(tankHeight > 0.0f && tankHeight <= MAX_TANK_DIMENSION)) {
+        return false;
+    }
+    if (!(tankWidth > 0.0f && tankWidth <= MAX_TANK_DIMENSION)) {
+        return false;
+    }
+    return isfinite(usedTotal) && usedTotal >= 0.0f && isfinite(maxInflow) && maxInflow >= 0.0f;
+}
+
+unsigned long ConfigDataHandler::heartbeatIntervalMs(float seconds) {
+    float ms = seconds * 1000.0f;
+    if (!(ms > 0.0f)) {
+        return TELEMETRY_HEARTBEAT_INTERVAL;  // NaN, 0 or negative
+    }
+    if (ms < TELEMETRY_HEARTBEAT_MIN) {
+        return TELEMETRY_HEARTBEAT_MIN;
+    }
+    if (ms > TELEMETRY_HEARTBEAT_MAX) {
+        return TELEMETRY_HEARTBEAT_MAX;
+    }
+    return (unsigned long)ms;
+}
+
 void ConfigDataHandler::setAllPriority() {
     // Set priority flag (timestamp=0) for all fields
     upperThreshold.lastModified = 0;
@@ -180,6 +218,7 @@ void ConfigDataHandler::setAllPriority() {
     forceUpdate.lastModified = 0;
     ipAddress.lastModified = 0;
     autoUpdate.lastModified = 0;
+    heartbeatSec.lastModified = 0;
 
     DEBUG_PRINTLN("[ConfigHandler] Set all config fields with priority flag");
 }
@@ -239,10 +278,47 @@ bool ConfigDataHandler::valuesDifferFromAPI() const {
                      autoUpdate.value, autoUpdate.api_value);
         return true;
     }
+    if (abs(heartbeatSec.value - heartbeatSec.api_value) > EPSILON) {
+        DEBUG_PRINTF("[ConfigHandler] heartbeatSec differs: value=%.0f, api_value=%.0f\n",
+                     heartbeatSec.value, heartbeatSec.api_value);
+        return true;
+    }
 
     return false;  // All values match API values
 }
 
+void ConfigDataHandler::toSnapshot(ConfigSnapshot& snapshot) const {
+    packSyncFloat(upperThreshold, snapshot.upperThreshold);
+    packSyncFloat(lowerThreshold, snapshot.lowerThreshold);
+    packSyncFloat(tankHeight, snapshot.tankHeight);
+    packSyncFloat(tankWidth, snapshot.tankWidth);
+    packSyncString(tankShape, snapshot.tankShape);
+    packSyncFloat(usedTotal, snapshot.usedTotal);
+    packSyncFloat(maxInflow, snapshot.maxInflow);
+    packSyncBool(forceUpdate, snapshot.forceUpdate);
+    packSyncString(ipAddress, snapshot.ipAddress);
+    packSyncBool(autoUpdate, snapshot.autoUpdate);
+    packSyncFloat(heartbeatSec, snapshot.heartbeatSec);
+}
+
+void ConfigDataHandler::fromSnapshot(const ConfigSnapshot& snapshot) {
+    // Restores API, Local and Self values with their original timestamps,
+    // so the next merge after a reboot behaves exactly as before the reboot
+    unpackSyncFloat(snapshot.upperThreshold, upperThreshold);
+    unpackSyncFloat(snapshot.lowerThreshold, lowerThreshold);
+    unpackSyncFloat(snapshot.tankHeight, tankHeight);
+    unpackSyncFloat(snapshot.tankWidth, tankWidth);
+    unpackSyncString(snapshot.tankShape, tankShape);
+    unpackSyncFloat(snapshot.usedTotal, usedTotal);
+    unpackSyncFloat(snapshot.maxInflow, maxInflow);
+    unpackSyncBool(snapshot.forceUpdate, forceUpdate);
+    unpackSyncString(snapshot.ipAddress, ipAddress);
+    unpackSyncBool(snapshot.autoUpdate, autoUpdate);
+    unpackSyncFloat(snapshot.heartbeatSec, heartbeatSec);
+
+    DEBUG_PRINTLN("[ConfigHandler] Restored from snapshot");
+}
+
 void ConfigDataHandler::printState() {
     Serial.println("[ConfigHandler] Current State:");
     Serial.printf("  upperThreshold: %.2f (API: %.2f, Local: %.2f)\n",
@@ -95,6 +95,18 @@ void ControlDataHandler::setConfigUpdatePriority(bool value) {
     DEBUG_PRINTF("[ControlHandler] Set configUpdate with priority: %s\n", value ? "true" : "false");
 }
 
+void ControlDataHandler::toSnapshot(ControlSnapshot& snapshot) const {
+    packSyncBool(pumpSwitch, snapshot.pumpSwitch);
+    packSyncBool(configUpdate, snapshot.configUpdate);
+}
+
+void ControlDataHandler::fromSnapshot(const ControlSnapshot& snapshot) {
+    unpackSyncBool(snapshot.pumpSwitch, pumpSwitch);
+    unpackSyncBool(snapshot.configUpdate, configUpdate);
+
+    DEBUG_PRINTLN("[ControlHandler] Restored from snapshot");
+}
+
 void ControlDataHandler::printState() {
     Serial.println("[ControlHandler] Current State:");
     Serial.println("  pumpSwitch:");
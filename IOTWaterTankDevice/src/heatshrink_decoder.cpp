@@ -0,0 +1,157 @@
+#include "heatshrink_decoder.h"
+#include <string.h>
+
+#define HEATSHRINK_WINDOW_MASK ((1 << HEATSHRINK_WINDOW_BITS) - 1)
+
+// ============================================================================
+// CONSTRUCTOR
+// ============================================================================
+
+HeatshrinkDecoder::HeatshrinkDecoder()
+    : sink(nullptr),
+      state(STATE_ERROR),
+      error("Not started"),
+      bitBuffer(0),
+      bitCount(0),
+      backrefIndex(0),
+      outputSize(0),
+      windowHead(0),
+      outFill(0) {
+}
+
+void HeatshrinkDecoder::begin(PatchSink* outputSink) {
+    sink = outputSink;
+    state = STATE_TAG;
+    error = nullptr;
+    bitBuffer = 0;
+    bitCount = 0;
+    backrefIndex = 0;
+    outputSize = 0;
+    windowHead = 0;
+    outFill = 0;
+
+    // References before the start of the stream read zeros (as the encoder assumes)
+    memset(window, 0, sizeof(window));
+}
+
+// ============================================================================
+// STREAM INPUT
+// ============================================================================
+
+bool HeatshrinkDecoder::feed(const uint8_t* data, size_t length) {
+    if (state == STATE_ERROR) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        bitBuffer = (bitBuffer << 8) | data[i];
+        bitCount += 8;
+
+        // Decode every complete symbol in the bit buffer
+        bool progress = true;
+        while (progress) {
+            progress = false;
+
+            switch (state) {
+                case STATE_TAG:
+                    if (bitCount >= 1) {
+                        state = takeBits(1) ? STATE_LITERAL : STATE_INDEX;
+                        progress = true;
+                    }
+                    break;
+
+                case STATE_LITERAL:
+                    if (bitCount >= 8) {
+                        if (!emit((uint8_t)takeBits(8))) {
+                            return false;
+                        }
+                        state = STATE_TAG;
+                        progress = true;
+                    }
+                    break;
+
+                case STATE_INDEX:
+                    if (bitCount >= HEATSHRINK_WINDOW_BITS) {
+                        backrefIndex = takeBits(HEATSHRINK_WINDOW_BITS) + 1;
+                        state = STATE_COUNT;
+                        progress = true;
+                    }
+                    break;
+
+                case STATE_COUNT:
+                    if (bitCount >= HEATSHRINK_LOOKAHEAD_BITS) {
+                        uint16_t count = takeBits(HEATSHRINK_LOOKAHEAD_BITS) + 1;
+                        for (uint16_t n = 0; n < count; n++) {
+                            uint8_t value = window[(windowHead - backrefIndex) & HEATSHRINK_WINDOW_MASK];
+                            if (!emit(value)) {
+                                return false;
+                            }
+                        }
+                        state = STATE_TAG;
+                        progress = true;
+                    }
+                    break;
+
+                case STATE_ERROR:
+                default:
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool HeatshrinkDecoder::finish() {
+    if (state == STATE_ERROR) {
+        return false;
+    }
+
+    // Anything left in the bit buffer is padding of the final byte
+    return flush();
+}
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+uint16_t HeatshrinkDecoder::takeBits(uint8_t count) {
+    bitCount -= count;
+    uint16_t value = (uint16_t)((bitBuffer >> bitCount) & ((1u << count) - 1));
+    bitBuffer &= (1u << bitCount) - 1;
+    return value;
+}
+
+bool HeatshrinkDecoder::emit(uint8_t value) {
+    window[windowHead] = value;
+    windowHead = (windowHead + 1) & HEATSHRINK_WINDOW_MASK;
+
+    outBuffer[outFill++] = value;
+    outputSize++;
+
+    if (outFill == HEATSHRINK_OUTPUT_CHUNK) {
+        return flush();
+    }
+    return true;
+}
+
+bool HeatshrinkDecoder::flush() {
+    if (outFill == 0) {
+        return true;
+    }
+
+    if (!sink->write(outBuffer, outFill)) {
+        return fail("Sink write failed");
+    }
+
+    outFill = 0;
+    return true;
+}
+
+bool HeatshrinkDecoder::fail(const char* message) {
+    if (state != STATE_ERROR) {
+        error = message;
+        state = STATE_ERROR;
+    }
+    return false;
+}
@@ -0,0 +1,145 @@
+#include "leak_detector.h"
+#include "storage_manager.h"
+#include "batch_kernels.h"
+
+#define LEAK_MINUTE_MS 60000UL
+
+LeakDetector leakDetector;
+
+LeakDetector::LeakDetector()
+    : mux(portMUX_INITIALIZER_UNLOCKED),
+      minuteSum(0),
+      minuteReadings(0),
+      minuteValid(true),
+      minuteStart(0),
+      minuteCount(0),
+      windowHead(0),
+      windowCount(0),
+      learnedWindows(0),
+      windowsSinceSave(0) {
+    memset(&status, 0, sizeof(status));
+    status.learning = true;
+}
+
+void LeakDetector::begin() {
+    float baselineLph;
+    uint32_t windows;
+    if (storageManager.loadLeakBaseline(baselineLph, windows)) {
+        learnedWindows = windows;
+        status.baselineLph = baselineLph;
+        status.learning = learnedWindows < LEAK_LEARN_WINDOWS;
+        Serial.printf("[Leak] Baseline %.2f L/h (%u windows)\n", baselineLph, (unsigned)windows);
+    } else {
+        Serial.println("[Leak] No baseline yet, learning");
+    }
+    minuteStart = millis();
+}
+
+LeakStatus LeakDetector::getStatus() {
+    portENTER_CRITICAL(&mux);
+    LeakStatus copy = status;
+    portEXIT_CRITICAL(&mux);
+    return copy;
+}
+
+// ============================================================================
+// SAMPLING
+// ============================================================================
+
+void LeakDetector::addSample(float volumeLiters, int pumpStatus) {
+    // Any pump time spoils the minute (and with it the window)
+    if (pumpStatus) {
+        minuteValid = false;
+    }
+    minuteSum += volumeLiters;
+    minuteReadings++;
+
+    if (millis() - minuteStart < LEAK_MINUTE_MS) {
+        return;
+    }
+    closeMinute();
+    minuteStart = millis();
+}
+
+void LeakDetector::closeMinute() {
+    if (!minuteValid || minuteReadings == 0) {
+        minuteCount = 0;
+    } else {
+        minutes[minuteCount++] = minuteSum / minuteReadings;
+        if (minuteCount == LEAK_WINDOW_MINUTES) {
+            closeWindow();
+            minuteCount = 0;
+        }
+    }
+
+    minuteSum = 0;
+    minuteReadings = 0;
+    minuteValid = true;
+}
+
+void LeakDetector::closeWindow() {
+    // Outflow per minute
+    float drops[LEAK_WINDOW_MINUTES - 1];
+    for (int i = 0; i < LEAK_WINDOW_MINUTES - 1; i++) {
+        drops[i] = minutes[i] - minutes[i + 1];
+    }
+    float outflowLph = batchMedianF32(drops, LEAK_WINDOW_MINUTES - 1) * 60.0f;
+
+    windows[windowHead] = outflowLph;
+    windowHead = (windowHead + 1) % LEAK_MIN_WINDOWS;
+    if (windowCount < LEAK_MIN_WINDOWS) {
+        windowCount++;
+    }
+    if (windowCount < LEAK_MIN_WINDOWS) {
+        return;
+    }
+
+    float nightFlowLph;
+    float highest;
+    batchMinMaxF32(windows, LEAK_MIN_WINDOWS, &nightFlowLph, &highest);
+    update(nightFlowLph);
+}
+
+// ============================================================================
+// BASELINE + CUSUM
+// ============================================================================
+
+void LeakDetector::update(float nightFlowLph) {
+    LeakStatus next = getStatus();
+    next.nightFlowLph = nightFlowLph;
+
+    if (learnedWindows == 0) {
+        next.baselineLph = nightFlowLph;
+    } else if (!next.alarm) {
+        // Frozen during an alarm so the leak doesn't become the new normal
+        float rate = nightFlowLph < next.baselineLph ? LEAK_BASELINE_DOWN : LEAK_BASELINE_UP;
+        next.baselineLph += rate * (nightFlowLph - next.baselineLph);
+    }
+    learnedWindows++;
+
+    if (learnedWindows < LEAK_LEARN_WINDOWS) {
+        next.learning = true;
+    } else {
+        next.learning = false;
+        float excess = nightFlowLph - next.baselineLph - LEAK_CUSUM_K_LPH;
+        next.cusum = constrain(next.cusum + excess, 0.0f, LEAK_CUSUM_MAX_LPH);
+
+        if (!next.alarm && next.cusum >= LEAK_CUSUM_H_LPH) {
+            next.alarm = true;
+            Serial.printf("[Leak] ALARM: night flow %.2f L/h, baseline %.2f L/h\n",
+                          nightFlowLph, next.baselineLph);
+        } else if (next.alarm && next.cusum == 0) {
+            next.alarm = false;
+            Serial.printf("[Leak] Alarm cleared: night flow %.2f L/h\n", nightFlowLph);
+        }
+    }
+
+    portENTER_CRITICAL(&mux);
+    status = next;
+    portEXIT_CRITICAL(&mux);
+
+    if (++windowsSinceSave >= LEAK_SAVE_WINDOWS) {
+        windowsSinceSave = 0;
+        storageManager.saveLeakBaseline(next.baselineLph, learnedWindows);
+    }
+}
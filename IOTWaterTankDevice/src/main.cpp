@@ -10,16 +10,19 @@
  * - Button controls
  * - Local web server for Flutter app
  * - OTA firmware updates
+ * - On-device ML inference (int8 MLP) on the level/flow stream
+ * - Leak detection (night-flow baseline + CUSUM) with immediate alarm uploads
  *
  * Data Flow:
  * Startup: Connect WiFi → Login → Fetch config → Start webserver
  * Every 1s: Update sensor readings
- * Every 30s: Upload telemetry
+ * On change: Upload telemetry (deadbands, 5s minimum gap, heartbeatSec heartbeat);
+ *            leak alarms are pushed as soon as they change
  * Every 5min: Fetch control data → Check config_update → Check force_update
+ * Every 1h: Check for a new ML model
  */
 
 #include <Arduino.h>
-#include <ESP32Ping.h>
 #include "config.h"
 #include "storage_manager.h"
 #include "wifi_manager.h"
@@ -30,10 +33,17 @@
 #include "button_handler.h"
 #include "webserver.h"
 #include "ota_updater.h"
+#include "ml_runtime.h"
+#include "leak_detector.h"
 #include "handle_control_data.h"
 #include "handle_config_data.h"
 #include "handle_telemetry_data.h"
 #include "calculate_level.h"
+#include "telemetry_queue.h"
+#include "telemetry_reporter.h"
+#include "connectivity_probe.h"
+#include "power_manager.h"
+#include "server_url.h"
 
 // ============================================================================
 // GLOBAL OBJECTS
@@ -46,6 +56,8 @@ DisplayManager displayManager;
 ButtonHandler buttonHandler;
 WebServer webServer;
 OTAUpdater otaUpdater;
+MLRuntime mlRuntime;
+TelemetryReporter telemetryReporter;
 
 // 3-way sync handlers
 ControlDataHandler controlHandler;
@@ -64,20 +76,26 @@ ControlData controlData;
 
 // Timing variables
 unsigned long lastSensorRead = 0;
-unsigned long lastTelemetryUpload = 0;
 unsigned long lastControlFetch = 0;
 unsigned long lastConfigCheck = 0;
 unsigned long lastOTACheck = 0;
+unsigned long lastMLCheck = 0;
 unsigned long lastDisplayUpdate = 0;
+unsigned long lastTelemetryBacklog = 0;
+unsigned long lastLeakAlarmAttempt = 0;  // 0 = no failed attempt pending
 
 // System state
 bool systemInitialized = false;
 bool configFetched = false;
 bool deviceIsOnline = false;       // True when NTP sync successful and device can communicate with server
 bool initial_config_update = false; // True after NTP sync until first config fetch completes
-int failedCount = 0;               // Count consecutive server request failures (reset deviceIsOnline after 10)
 unsigned long lastNTPRetry = 0;    // Track NTP retry attempts when offline
-unsigned long last24HourCheck = 0; // Track when we last checked for 24-hour reboot
+unsigned long ntpPendingSince = 0; // When NTP was first found unavailable (0 = not pending)
+unsigned long lastHttpTimeCheck = 0; // Last HTTP time cross-check while online
+unsigned long restartAt = 0;       // Scheduled restart (millis, 0 = none) - lets a message show first
+unsigned long lastReloginAttempt = 0; // Last re-login attempt after losing the session
+unsigned long reloginBackoff = RELOGIN_RETRY_MIN_MS; // Current re-login retry interval
+volatile bool leakAlarmReported = false; // Leak alarm state the server last acknowledged
 
 // FreeRTOS task management
 SemaphoreHandle_t configMutex = NULL;  // Protect deviceConfig and lastSyncedConfig
@@ -87,6 +105,44 @@ TaskHandle_t controlUploadTaskHandle = NULL;
 TaskHandle_t configFetchTaskHandle = NULL;
 TaskHandle_t configSyncTaskHandle = NULL;
 TaskHandle_t ntpSyncTaskHandle = NULL;
+TaskHandle_t telemetryBacklogTaskHandle = NULL;
+TaskHandle_t httpTimeSyncTaskHandle = NULL;
+TaskHandle_t reloginTaskHandle = NULL;
+TaskHandle_t leakAlarmTaskHandle = NULL;
+
+// WiFi provisioning (credentials from the web portal). The AsyncTCP
+// handler only queues a job; the loop drives the WiFi connection and
+// provisioningTask does the blocking login/config steps.
+enum ProvisioningState {
+    PROV_IDLE,
+    PROV_QUEUED,            // Credentials received, loop hasn't started yet
+    PROV_CONNECTING,        // WiFi association (driven by handleWiFiConnection)
+    PROV_LOGGING_IN,        // Time sync + device login (provisioning task)
+    PROV_FETCHING_CONFIG,   // Config fetch and merge (provisioning task)
+    PROV_DONE,
+    PROV_FAILED
+};
+
+struct ProvisioningJob {
+    uint32_t id;               // 0 = no job yet
+    ProvisioningState state;
+    String message;
+    String ssid;
+    String password;
+    String dashUser;
+    String dashPass;
+    bool fromAP;               // Started in setup AP mode (client mode not set up yet)
+    unsigned long finishedAt;  // millis() when DONE/FAILED was reached
+    // OLED message from provisioningTask, drawn by the loop (string literals only)
+    const char* displayTitle;
+    const char* displayText;
+    int displayDuration;
+    bool displayPending;
+};
+
+ProvisioningJob provisioning;
+SemaphoreHandle_t provisioningMutex = NULL;  // Protect provisioning (web handler vs loop vs task)
+TaskHandle_t provisioningTaskHandle = NULL;
 
 // Task limiting to prevent too many concurrent tasks
 #define MAX_CONCURRENT_SERVER_TASKS 2  // Maximum 2 server tasks at once
@@ -102,6 +158,20 @@ void uploadControlData();
 void ntpSyncTask(void* parameter);
 bool syncWithInternet();
 void finalizeNTP(uint64_t timestamp);
+void handleTimeSyncEvent();
+void markDeviceOnline();
+void checkBackendTime();
+void relogin();
+void uploadLeakAlarm();
+void saveSyncState();
+void queueTelemetrySample(float waterLevelPercent, float currInflow, int pumpStatus);
+void onButtonEvent(ButtonEvent event);
+void recordServerSuccess();
+void recordServerFailure();
+void handleConnectivity();
+void scheduleRestart(unsigned long delayMs);
+void attachWebServerClientMode();
+void getProvisioningStatus(JsonObject status);
 
 // ============================================================================
 // CALLBACK FUNCTIONS
@@ -127,142 +197,346 @@ void onPumpControl(bool state) {
     }
 }
 
+/**
+ * Register client-mode callbacks and components with the web server
+ * Used at boot and when provisioning leaves AP mode without a restart
+ */
+void attachWebServerClientMode() {
+    webServer.setAPIClient(&apiClient);
+    webServer.setPumpControlCallback(onPumpControl);
+    webServer.setConfigSyncCallback(syncConfigToServer);    // Immediate async sync when config changes
+    webServer.setControlSyncCallback(uploadControlData);    // Immediate async sync when control changes
+    webServer.setTimestampSyncCallback(finalizeNTP);        // Called when app syncs time
+    webServer.setComponentPointers(&sensorManager, &displayManager, &storageManager, &levelCalculator);
+}
+
+// ============================================================================
+// WIFI PROVISIONING
+// ============================================================================
+
+const char* provisioningStateName(ProvisioningState state) {
+    switch (state) {
+        case PROV_IDLE:            return "idle";
+        case PROV_QUEUED:          return "queued";
+        case PROV_CONNECTING:      return "connecting";
+        case PROV_LOGGING_IN:      return "logging_in";
+        case PROV_FETCHING_CONFIG: return "fetching_config";
+        case PROV_DONE:            return "done";
+        case PROV_FAILED:          return "failed";
+        default:                   return "unknown";
+    }
+}
+
+bool isProvisioningActive(ProvisioningState state) {
+    return state != PROV_IDLE && state != PROV_DONE && state != PROV_FAILED;
+}
+
+/**
+ * Move the current provisioning job to a new step (any task)
+ */
+void setProvisioningState(ProvisioningState state, const String& message) {
+    if (xSemaphoreTake(provisioningMutex, portMAX_DELAY) == pdTRUE) {
+        provisioning.state = state;
+        provisioning.message = message;
+        if (!isProvisioningActive(state)) {
+            provisioning.finishedAt = millis();
+        }
+        xSemaphoreGive(provisioningMutex);
+    }
+
+    Serial.printf("[Main] Provisioning job %u: %s - %s\n",
+                 provisioning.id, provisioningStateName(state), message.c_str());
+}
+
+/**
+ * Queue an OLED message for handleProvisioning() to show (any task)
+ * Only the loop draws, so the task never touches the shared frame buffer.
+ */
+void setProvisioningDisplay(const char* title, const char* text, int duration) {
+    if (xSemaphoreTake(provisioningMutex, portMAX_DELAY) == pdTRUE) {
+        provisioning.displayTitle = title;
+        provisioning.displayText = text;
+        provisioning.displayDuration = duration;
+        provisioning.displayPending = true;
+        xSemaphoreGive(provisioningMutex);
+    }
+}
+
 /**
  * WiFi credentials save callback for web server
- * Called when user submits WiFi credentials via provisioning interface
+ * Runs in the AsyncTCP task, so it only queues a provisioning job and
+ * returns its id (0 = a job is already running). handleProvisioning()
+ * picks the job up from the loop.
  */
-void onWiFiSave(const String& ssid, const String& password,
-                const String& dashUser, const String& dashPass) {
+uint32_t onWiFiSave(const String& ssid, const String& password,
+                    const String& dashUser, const String& dashPass) {
     Serial.println("[Main] WiFi credentials received from web interface");
-    Serial.println("[Main] Attempting to connect to: " + ssid);
 
-    // Display connection status
-    displayManager.showMessage("Connecting...", ssid, 0);
+    uint32_t jobId = 0;
+
+    if (xSemaphoreTake(provisioningMutex, portMAX_DELAY) == pdTRUE) {
+        if (!isProvisioningActive(provisioning.state)) {
+            provisioning.id++;
+            provisioning.state = PROV_QUEUED;
+            provisioning.message = "Waiting to connect";
+            provisioning.ssid = ssid;
+            provisioning.password = password;
+            provisioning.dashUser = dashUser;
+            provisioning.dashPass = dashPass;
+            provisioning.fromAP = getWiFiMode() == WIFI_AP_MODE;
+            provisioning.finishedAt = 0;
+            jobId = provisioning.id;
+        }
+        xSemaphoreGive(provisioningMutex);
+    }
+
+    if (jobId == 0) {
+        Serial.println("[Main] Provisioning already in progress - request rejected");
+    } else {
+        Serial.printf("[Main] Provisioning job %u queued for: %s\n", jobId, ssid.c_str());
+    }
+
+    return jobId;
+}
+
+/**
+ * Provisioning status for GET /{device_id}/provisionStatus (AsyncTCP task)
+ */
+void getProvisioningStatus(JsonObject status) {
+    if (xSemaphoreTake(provisioningMutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
 
-    // Start WiFi client connection
-    startWiFiClient();
+    status["jobId"] = provisioning.id;
+    status["state"] = provisioningStateName(provisioning.state);
+    status["message"] = provisioning.message;
+    if (provisioning.id != 0) {
+        status["ssid"] = provisioning.ssid;
+    }
+    ProvisioningState state = provisioning.state;
+    xSemaphoreGive(provisioningMutex);
 
-    // Wait for connection to complete (non-blocking check in loop)
-    unsigned long startTime = millis();
-    while (isWiFiConnecting() && (millis() - startTime < WIFI_TIMEOUT_MS)) {
-        updateWiFiConnection();
-        delay(100);
+    status["wifiStatus"] = getWiFiStatus();
+    if (state == PROV_DONE) {
+        status["ip"] = getIPAddress();
+        status["authenticated"] = apiClient.isAuthenticated();
     }
+}
 
-    if (isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
-        Serial.println("[Main] WiFi connected successfully!");
-        displayManager.showMessage("Connected!", getIPAddress(), 3000);
+/**
+ * Async task: blocking provisioning steps once WiFi is up
+ * Login and config fetch failures don't fail the job - the device keeps
+ * working locally and the loop retries the backend later.
+ */
+void provisioningTask(void* parameter) {
+    Serial.println("[AsyncTask] Provisioning started");
 
-        // Initialize backend API
-        String hardwareId = getMACAddress();
-        apiClient.begin(hardwareId);
+    // ------------------------------------------------------------------
+    // Login (claims the device to the user account and returns the JWT)
+    // ------------------------------------------------------------------
+    // Authentication needs a valid clock - same bounded wait as at boot
+    apiClient.waitForTimeSync(NTP_BOOT_WAIT_TIMEOUT);
 
-        // Authentication flow:
-        // Admin pre-creates device in dashboard, then device calls login
-        // Login will claim the device to user AND return JWT token in one step
+    String result = "Online";
 
-        if (apiClient.isAuthenticated()) {
-            // Already have valid token - skip authentication
-            Serial.println("[Main] Valid token found - skipping authentication");
-            displayManager.showMessage("Backend", "Authenticated", 2000);
+    if (apiClient.isAuthenticated()) {
+        Serial.println("[AsyncTask] Valid token found - skipping authentication");
+    } else {
+        String dashUsername, dashPassword;
+        if (xSemaphoreTake(provisioningMutex, portMAX_DELAY) == pdTRUE) {
+            dashUsername = provisioning.dashUser;
+            dashPassword = provisioning.dashPass;
+            xSemaphoreGive(provisioningMutex);
+        }
+        if (dashUsername.length() == 0 || dashPassword.length() == 0) {
+            getDashboardCredentials(dashUsername, dashPassword);
+        }
+
+        if (dashUsername.length() == 0 || dashPassword.length() == 0) {
+            Serial.println("[AsyncTask] No dashboard credentials - device will work locally");
+            setProvisioningDisplay("Error", "No credentials", 3000);
+            result = "Local mode: no dashboard credentials";
         } else {
-            // Need to authenticate - login to claim device and get JWT token
-            Serial.println("[Main] No valid token - attempting login");
-            Serial.println("[Main] (Login will claim device to user account if unclaimed)");
-
-            // Load dashboard credentials from storage (entered by user via web portal)
-            String dashUsername, dashPassword;
-            bool hasCredentials = getDashboardCredentials(dashUsername, dashPassword);
-
-            if (!hasCredentials || dashUsername.length() == 0 || dashPassword.length() == 0) {
-                Serial.println("[Main] ERROR: No dashboard credentials found!");
-                Serial.println("[Main] Please configure credentials via web portal:");
-                Serial.println("[Main]   1. Connect to WiFi AP: " + String(AP_SSID));
-                Serial.println("[Main]   2. Go to http://192.168.4.1");
-                Serial.println("[Main]   3. Enter WiFi and dashboard credentials");
-                displayManager.showMessage("Error", "No credentials", 3000);
-                // Continue anyway - device can still work in local mode
+            setProvisioningDisplay("Backend", "Logging in...", 0);
+
+            if (apiClient.loginDevice(dashUsername, dashPassword)) {
+                Serial.println("[AsyncTask] Device logged in - claimed and JWT token obtained");
+                setProvisioningDisplay("Backend", "Logged in!", 2000);
             } else {
-                Serial.println("[Main] Using dashboard credentials from storage");
-                displayManager.showMessage("Backend", "Logging in...", 0);
+                Serial.println("[AsyncTask] Login failed (device not created by admin, wrong password or server down)");
+                setProvisioningDisplay("Backend", "Login failed", 3000);
+                recordServerFailure();
+                result = "Local mode: login failed";
+            }
+        }
+    }
 
-                if (apiClient.loginDevice(dashUsername, dashPassword)) {
-                    Serial.println("[Main] Device logged in successfully");
-                    Serial.println("[Main] Device claimed and JWT token obtained");
-                    displayManager.showMessage("Backend", "Logged in!", 2000);
-                } else {
-                    Serial.println("[Main] ERROR: Login failed");
-                    Serial.println("[Main] Possible reasons:");
-                    Serial.println("[Main]   1. Device not created by admin in dashboard");
-                    Serial.println("[Main]   2. Invalid username/password");
-                    Serial.println("[Main]   3. Network/server issues");
-                    displayManager.showMessage("Backend", "Login failed", 3000);
-                    // Continue anyway - device can still work in local mode
+    // ------------------------------------------------------------------
+    // Config fetch and 3-way merge
+    // ------------------------------------------------------------------
+    if (apiClient.isAuthenticated()) {
+        setProvisioningState(PROV_FETCHING_CONFIG, "Fetching config");
+
+        if (xSemaphoreTake(configMutex, portMAX_DELAY) == pdTRUE) {
+            bool configChanged = false;
+            bool deviceWon = false;
+
+            if (apiClient.fetchAndApplyServerConfig(deviceConfig, &configChanged, &deviceWon)) {
+                recordServerSuccess();
+
+                if (configChanged) {
+                    sensorManager.setTankConfig(
+                        deviceConfig.tankHeight,
+                        deviceConfig.tankWidth,
+                        deviceConfig.tankShape
+                    );
+                    levelCalculator.setTankConfig(
+                        deviceConfig.tankHeight,
+                        deviceConfig.tankWidth,
+                        deviceConfig.tankShape
+                    );
+                    displayManager.setTankSettings(
+                        deviceConfig.tankHeight,
+                        deviceConfig.tankWidth,
+                        deviceConfig.tankShape,
+                        deviceConfig.upperThreshold,
+                        deviceConfig.lowerThreshold
+                    );
+                    webServer.updateDeviceConfig(deviceConfig);
+                    Serial.println("[AsyncTask] Merged config applied to system components");
                 }
+
+                // Persist merged sync state (API timestamps may change even when values don't)
+                saveSyncState();
+
+                if (deviceWon && !apiClient.sendConfigWithPriority(deviceConfig)) {
+                    Serial.println("[AsyncTask] Failed to sync device config to server");
+                    recordServerFailure();
+                }
+
+                configFetched = true;
+            } else {
+                Serial.println("[AsyncTask] Config fetch failed - using local config");
+                recordServerFailure();
             }
+
+            lastSyncedConfig = deviceConfig;
+            xSemaphoreGive(configMutex);
         }
+    }
 
-        // Fetch config from server and perform 3-way merge
-        bool configChanged = false;
-        bool deviceWon = false;
-        if (apiClient.fetchAndApplyServerConfig(deviceConfig, &configChanged, &deviceWon)) {
-            Serial.println("[Main] Config fetched and merged successfully");
+    setProvisioningState(PROV_DONE, result);
 
-            // If values changed after merge, apply to system components
-            if (configChanged) {
-                Serial.println("[Main] Applying merged config to system components...");
+    provisioningTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
 
-                sensorManager.setTankConfig(
-                    deviceConfig.tankHeight,
-                    deviceConfig.tankWidth,
-                    deviceConfig.tankShape
-                );
-                levelCalculator.setTankConfig(
-                    deviceConfig.tankHeight,
-                    deviceConfig.tankWidth,
-                    deviceConfig.tankShape
-                );
-                displayManager.setTankSettings(
-                    deviceConfig.tankHeight,
-                    deviceConfig.tankWidth,
-                    deviceConfig.tankShape,
-                    deviceConfig.upperThreshold,
-                    deviceConfig.lowerThreshold
-                );
+/**
+ * Drive the provisioning job (non-blocking, called in loop)
+ * QUEUED -> start WiFi, CONNECTING -> wait for handleWiFiConnection,
+ * then hand over to provisioningTask. Coming from the setup AP the device
+ * switches to client mode in place - no restart - and drops the AP once
+ * the app had time to read the final status.
+ */
+void handleProvisioning() {
+    static bool apLingering = false;
+
+    ProvisioningState state = PROV_IDLE;
+    String ssid, password, dashUser, dashPass;
+    bool fromAP = false;
+    unsigned long finishedAt = 0;
+    const char* displayTitle = nullptr;
+    const char* displayText = nullptr;
+    int displayDuration = 0;
+
+    if (xSemaphoreTake(provisioningMutex, 0) != pdTRUE) {
+        return;  // Web handler or task is updating - check next loop
+    }
+    state = provisioning.state;
+    fromAP = provisioning.fromAP;
+    finishedAt = provisioning.finishedAt;
+    if (state == PROV_QUEUED) {
+        ssid = provisioning.ssid;
+        password = provisioning.password;
+        dashUser = provisioning.dashUser;
+        dashPass = provisioning.dashPass;
+    }
+    if (provisioning.displayPending) {
+        displayTitle = provisioning.displayTitle;
+        displayText = provisioning.displayText;
+        displayDuration = provisioning.displayDuration;
+        provisioning.displayPending = false;
+    }
+    xSemaphoreGive(provisioningMutex);
 
-                // Save to NVS storage for persistence
-                storageManager.saveDeviceConfig(
-                    deviceConfig.upperThreshold,
-                    deviceConfig.lowerThreshold,
-                    deviceConfig.tankHeight,
-                    deviceConfig.tankWidth,
-                    deviceConfig.tankShape
-                );
-                Serial.println("[Main] Config applied and saved to NVS");
+    if (displayTitle != nullptr) {
+        displayManager.showMessage(displayTitle, displayText, displayDuration);
+    }
+
+    switch (state) {
+        case PROV_QUEUED:
+            // NVS writes and WiFi driver calls happen here, not in AsyncTCP
+            saveWiFiCredentials(ssid.c_str(), password.c_str());
+            if (dashUser.length() > 0 && dashPass.length() > 0) {
+                saveDashboardCredentials(dashUser.c_str(), dashPass.c_str());
+            }
+
+            displayManager.showMessage("Connecting...", ssid, 0);
+            if (startWiFiClient()) {
+                setProvisioningState(PROV_CONNECTING, "Connecting to " + ssid);
             } else {
-                Serial.println("[Main] Config values unchanged after merge");
+                setProvisioningState(PROV_FAILED, "No WiFi credentials");
             }
+            apLingering = false;
+            break;
 
-            // If device values won, sync to server
-            if (deviceWon) {
-                Serial.println("[Main] Device config differs from server - syncing to server...");
-                if (apiClient.sendConfigWithPriority(deviceConfig)) {
-                    Serial.println("[Main] Device config synced to server successfully");
-                } else {
-                    Serial.println("[Main] Failed to sync device config to server");
-                }
+        case PROV_CONNECTING:
+            if (isWiFiConnecting()) {
+                break;
             }
-        }
 
-        systemInitialized = true;
+            if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE) {
+                displayManager.showMessage("Failed", "Check credentials", 3000);
+                setProvisioningState(PROV_FAILED, "WiFi connection failed");
+                break;
+            }
 
-        // Restart to enter normal mode
-        Serial.println("[Main] WiFi configured. Restarting in 3 seconds...");
-        delay(3000);
-        ESP.restart();
-    } else {
-        Serial.println("[Main] WiFi connection failed");
-        displayManager.showMessage("Failed", "Check credentials", 3000);
+            Serial.println("[Main] Provisioning: WiFi connected - " + getIPAddress());
+            displayManager.showMessage("Connected!", getIPAddress(), 3000);
+            displayManager.setNetworkInfo(getIPAddress(), "Connected");
+
+            if (fromAP) {
+                // Client mode was never set up at boot
+                apiClient.begin(getMACAddress());
+                attachWebServerClientMode();
+            }
+
+            setProvisioningState(PROV_LOGGING_IN, "Logging in");
+            if (xTaskCreate(provisioningTask, "Provisioning", PROVISIONING_TASK_STACK_SIZE,
+                            NULL, 1, &provisioningTaskHandle) != pdPASS) {
+                Serial.println("[Main] Failed to create provisioning task");
+                provisioningTaskHandle = NULL;
+                setProvisioningState(PROV_DONE, "Local mode: backend setup skipped");
+            }
+            break;
+
+        case PROV_DONE:
+            if (!systemInitialized) {
+                // Normal operation takes over (NTP, sync tasks) - no restart needed
+                systemInitialized = true;
+                apLingering = fromAP;
+                Serial.println("[Main] Provisioning complete - entering normal mode");
+                displayManager.showMessage("Ready", "WiFi configured", 2000);
+            }
+
+            if (apLingering && millis() - finishedAt >= PROVISIONING_AP_LINGER_MS) {
+                apLingering = false;
+                stopWiFiAP();
+            }
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -272,46 +546,70 @@ void onWiFiSave(const String& ssid, const String& password,
 
 /**
  * Synchronize with internet via NTP
- * Attempts to sync time with NTP servers
- * Returns true if successful, false otherwise
+ * Non-blocking: SNTP runs in the background and reports completion through
+ * a callback. This only picks up a completed sync (callback event or a
+ * system clock already set by SNTP) and never waits.
+ * Returns true if time is synced, false otherwise
  */
 bool syncWithInternet() {
-    Serial.println("[Main] Attempting to sync with internet via NTP...");
-
     // Don't attempt NTP sync in AP mode (no internet)
     if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE) {
         Serial.println("[Main] Cannot sync - not in client mode (no internet)");
         return false;
     }
 
-    // Attempt NTP time sync
-    if (apiClient.syncTimeWithServer()) {
-        // Get the synced timestamp
-        uint64_t ntpTimestamp = apiClient.getCurrentTimestamp();
+    // Starts SNTP on first call, no-op afterwards
+    apiClient.startTimeSync();
 
+    uint64_t ntpTimestamp = 0;
+    if (apiClient.consumeTimeSyncEvent(ntpTimestamp)) {
         // Validate timestamp (sanity check: must be > 2025-11-19)
-        const uint64_t MIN_VALID_TIMESTAMP = 1763520052526ULL;  // 2025-11-19 approx
-
-        if (ntpTimestamp > MIN_VALID_TIMESTAMP) {
-            Serial.println("[Main] NTP sync successful!");
-            Serial.printf("[Main] Timestamp: %llu ms\n", ntpTimestamp);
-
-            // Finalize NTP and mark device as online
-            finalizeNTP(ntpTimestamp);
-            return true;
-        } else {
+        if (ntpTimestamp <= MIN_VALID_TIMESTAMP) {
             Serial.printf("[Main] NTP sync returned invalid timestamp: %llu (expected > %llu)\n",
                          ntpTimestamp, MIN_VALID_TIMESTAMP);
             return false;
         }
-    } else {
-        Serial.println("[Main] NTP sync failed");
+        apiClient.applyTimeSample(ntpTimestamp);
+    } else if (!apiClient.syncTimeWithServer()) {
+        // System clock not set by SNTP yet (syncTimeWithServer validates it)
+        Serial.println("[Main] NTP sync pending");
         return false;
     }
+
+    Serial.println("[Main] NTP sync successful!");
+    Serial.printf("[Main] Timestamp: %llu ms\n", apiClient.getCurrentTimestamp());
+
+    // Clock is disciplined from NTP - mark device as online
+    markDeviceOnline();
+    return true;
+}
+
+/**
+ * Handle an SNTP completion event (polled from loop, never waits)
+ * Every event disciplines the clock (drift estimate + slew). If the
+ * device was offline, it also brings it online.
+ */
+void handleTimeSyncEvent() {
+    uint64_t ntpTimestamp = 0;
+    if (!apiClient.consumeTimeSyncEvent(ntpTimestamp)) {
+        return;
+    }
+
+    if (ntpTimestamp <= MIN_VALID_TIMESTAMP) {
+        Serial.printf("[Main] Ignoring invalid SNTP timestamp: %llu\n", ntpTimestamp);
+        return;
+    }
+
+    apiClient.applyTimeSample(ntpTimestamp);
+
+    if (!deviceIsOnline && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
+        Serial.println("[Main] SNTP sync completed - device is now ONLINE");
+        markDeviceOnline();
+    }
 }
 
 /**
- * Finalize NTP synchronization
+ * Finalize NTP synchronization (app-provided time)
  * Sets the timestamp and marks device as online
  */
 void finalizeNTP(uint64_t timestamp) {
@@ -320,9 +618,16 @@ void finalizeNTP(uint64_t timestamp) {
     // Set timestamp in API client
     apiClient.setTimestamp(timestamp);
 
+    markDeviceOnline();
+}
+
+/**
+ * Mark device as online after a successful time sync
+ */
+void markDeviceOnline() {
     // Mark device as online
     deviceIsOnline = true;
-    failedCount = 0;  // Reset failure counter
+    connectivityProbe.reset();  // Old failures/results predate this connection
 
     // Set initial_config_update flag to trigger first config fetch
     initial_config_update = true;
@@ -332,6 +637,81 @@ void finalizeNTP(uint64_t timestamp) {
     displayManager.showMessage("Online", "Internet OK", 2000);
 }
 
+/**
+ * Passive connectivity signals from real server requests (any task)
+ */
+void recordServerSuccess() {
+    connectivityProbe.reportSuccess();
+}
+
+void recordServerFailure() {
+    connectivityProbe.reportFailure();
+}
+
+/**
+ * Probe the backend when requests keep failing and go OFFLINE only when
+ * the probe confirms it is unreachable (non-blocking, called in loop)
+ */
+void handleConnectivity() {
+    if (!systemInitialized || getWiFiMode() != WIFI_CLIENT_MODE) {
+        return;
+    }
+
+    connectivityProbe.update();
+
+    if (deviceIsOnline && connectivityProbe.getState() == CONNECTIVITY_UNREACHABLE) {
+        Serial.printf("[Main] Backend unreachable after %u failed requests - marking device as OFFLINE\n",
+                     connectivityProbe.getFailureCount());
+        deviceIsOnline = false;
+
+        // A stale cached lease (router reset or renumbered) looks exactly
+        // like this: associated, but nothing answers
+        dropCachedWiFiLease();
+    }
+}
+
+// ============================================================================
+// SYNC STATE PERSISTENCE
+// ============================================================================
+
+/**
+ * Mirror merged handler values into the legacy deviceConfig struct
+ */
+void copyConfigHandlerToDeviceConfig() {
+    deviceConfig.upperThreshold = configHandler.getUpperThreshold();
+    deviceConfig.upperThresholdLastModified = configHandler.getUpperThresholdTimestamp();
+    deviceConfig.lowerThreshold = configHandler.getLowerThreshold();
+    deviceConfig.lowerThresholdLastModified = configHandler.getLowerThresholdTimestamp();
+    deviceConfig.tankHeight = configHandler.getTankHeight();
+    deviceConfig.tankHeightLastModified = configHandler.getTankHeightTimestamp();
+    deviceConfig.tankWidth = configHandler.getTankWidth();
+    deviceConfig.tankWidthLastModified = configHandler.getTankWidthTimestamp();
+    deviceConfig.tankShape = configHandler.getTankShape();
+    deviceConfig.tankShapeLastModified = configHandler.getTankShapeTimestamp();
+    deviceConfig.usedTotal = configHandler.getUsedTotal();
+    deviceConfig.usedTotalLastModified = configHandler.getUsedTotalTimestamp();
+    deviceConfig.maxInflow = configHandler.getMaxInflow();
+    deviceConfig.maxInflowLastModified = configHandler.getMaxInflowTimestamp();
+    deviceConfig.force_update = configHandler.getForceUpdate();
+    deviceConfig.forceUpdateLastModified = configHandler.getForceUpdateTimestamp();
+    deviceConfig.ipAddress = configHandler.getIpAddress();
+    deviceConfig.ipAddressLastModified = configHandler.getIpAddressTimestamp();
+    deviceConfig.auto_update = configHandler.getAutoUpdate();
+    deviceConfig.autoUpdateLastModified = configHandler.getAutoUpdateTimestamp();
+    deviceConfig.heartbeatSec = configHandler.getHeartbeatSec();
+    deviceConfig.heartbeatSecLastModified = configHandler.getHeartbeatSecTimestamp();
+}
+
+/**
+ * Persist the full config + control sync state (A/B snapshot)
+ * Cheap to call after every merge - unchanged state is not rewritten
+ */
+void saveSyncState() {
+    if (!storageManager.saveSyncSnapshot(configHandler, controlHandler)) {
+        Serial.println("[Main] WARNING: Failed to save sync snapshot");
+    }
+}
+
 // ============================================================================
 // INITIALIZATION FUNCTIONS
 // ============================================================================
@@ -349,6 +729,10 @@ void initializeSystem() {
     Serial.println("  Firmware: " + String(FIRMWARE_VERSION));
     Serial.println("========================================\n");
 
+    // DFS / light sleep - boot itself runs at full clock (released at the end of setup)
+    powerManager.begin();
+    powerManager.beginActivity(POWER_LOOP);
+
     // Initialize display first (for visual feedback)
     if (!displayManager.begin()) {
         Serial.println("[Main] ERROR: Display initialization failed!");
@@ -356,8 +740,9 @@ void initializeSystem() {
 
     displayManager.showMessage("Starting...", "Initializing system", 2000);
 
-    // Initialize storage manager
+    // Initialize storage manager (and the backend URL override kept in NVS)
     storageManager.begin();
+    serverUrl.begin();
 
     // Initialize 3-way sync handlers
     controlHandler.begin();
@@ -365,35 +750,59 @@ void initializeSystem() {
     telemetryHandler.begin();
     Serial.println("[Main] Sync handlers initialized");
 
-    // Load device config from NVS if available
-    // This allows device to work offline without server on first boot
-    float upperThr, lowerThr, tankH, tankW;
-    String tankSh;
-    if (storageManager.loadDeviceConfig(upperThr, lowerThr, tankH, tankW, tankSh)) {
-        Serial.println("[Main] Device config loaded from NVS storage");
-        Serial.printf("  Tank: %.0f x %.0f cm (%s)\n", tankH, tankW, tankSh.c_str());
+    // Restore the complete 3-way sync state (API/Local/Self + timestamps)
+    // from the snapshot in one read. This keeps per-field timestamps intact
+    // across reboots, so the first sync doesn't see "device changed everything".
+    if (storageManager.loadSyncSnapshot(configHandler, controlHandler)) {
+        Serial.println("[Main] Sync state restored from snapshot");
+        copyConfigHandlerToDeviceConfig();
+        Serial.printf("  Tank: %.0f x %.0f cm (%s)\n",
+                      deviceConfig.tankHeight, deviceConfig.tankWidth, deviceConfig.tankShape.c_str());
+    } else {
+        // No snapshot yet (first boot or firmware upgrade) - migrate legacy per-key config
+        // This allows device to work offline without server on first boot
+        float upperThr, lowerThr, tankH, tankW;
+        String tankSh;
+        if (storageManager.loadDeviceConfig(upperThr, lowerThr, tankH, tankW, tankSh)) {
+            Serial.println("[Main] Device config loaded from NVS storage (legacy)");
+            Serial.printf("  Tank: %.0f x %.0f cm (%s)\n", tankH, tankW, tankSh.c_str());
 
-        // Update config handler with loaded values
-        configHandler.updateSelf(upperThr, lowerThr, tankH, tankW, tankSh,
-                                 0.0f, 0.0f, false, "", true,
-                                 apiClient.getCurrentTimestamp());
+            // Update config handler with loaded values
+            configHandler.updateSelf(upperThr, lowerThr, tankH, tankW, tankSh,
+                                     0.0f, 0.0f, false, "", true,
+                                     apiClient.getCurrentTimestamp());
+        } else {
+            Serial.println("[Main] No stored config - will fetch from server on connect");
+
+            // Initialize config handler with defaults to ensure timestamps are set
+            configHandler.updateSelf(DEFAULT_UPPER_THRESHOLD, DEFAULT_LOWER_THRESHOLD,
+                                     DEFAULT_TANK_HEIGHT, DEFAULT_TANK_WIDTH, "Cylindrical",
+                                     0.0f, 0.0f, false, "", true,
+                                     apiClient.getCurrentTimestamp());
+        }
 
         // Also update old deviceConfig for backward compatibility
-        deviceConfig.upperThreshold = upperThr;
-        deviceConfig.lowerThreshold = lowerThr;
-        deviceConfig.tankHeight = tankH;
-        deviceConfig.tankWidth = tankW;
-        deviceConfig.tankShape = tankSh;
-    } else {
-        Serial.println("[Main] No stored config - will fetch from server on connect");
+        copyConfigHandlerToDeviceConfig();
 
-        // Initialize config handler with defaults to ensure timestamps are set
-        configHandler.updateSelf(DEFAULT_UPPER_THRESHOLD, DEFAULT_LOWER_THRESHOLD,
-                                 DEFAULT_TANK_HEIGHT, DEFAULT_TANK_WIDTH, "Cylindrical",
-                                 0.0f, 0.0f, false, "", true,
-                                 apiClient.getCurrentTimestamp());
+        // Write the first snapshot so the next boot takes the fast path
+        saveSyncState();
     }
 
+    // Apply restored tank geometry before the first sensor read
+    sensorManager.setTankConfig(deviceConfig.tankHeight, deviceConfig.tankWidth, deviceConfig.tankShape);
+    levelCalculator.setTankConfig(deviceConfig.tankHeight, deviceConfig.tankWidth, deviceConfig.tankShape);
+    displayManager.setTankSettings(deviceConfig.tankHeight, deviceConfig.tankWidth, deviceConfig.tankShape,
+                                   deviceConfig.upperThreshold, deviceConfig.lowerThreshold);
+
+    // Mount LittleFS and recover the offline telemetry queue
+    telemetryQueue.begin();
+
+    // Load the installed ML model (LittleFS)
+    mlRuntime.begin();
+
+    // Restore the learned leak baseline (NVS)
+    leakDetector.begin();
+
     // Initialize WiFi manager
     initWiFiManager();
 
@@ -403,12 +812,16 @@ void initializeSystem() {
     // Initialize relay
     relayController.begin();
 
-    // Initialize buttons
+    // Initialize buttons (pump buttons act from the button task)
+    buttonHandler.setEventCallback(onButtonEvent);
     buttonHandler.begin();
 
     // Initialize OTA
     otaUpdater.begin();
 
+    // Backend reachability tracking
+    connectivityProbe.begin();
+
     Serial.println("[Main] System components initialized");
 }
 
@@ -441,6 +854,7 @@ bool connectToBackend() {
         // Start web server for WiFi configuration (no API client yet in AP mode)
         webServer.begin(DEVICE_ID, nullptr);
         webServer.setWiFiSaveCallback(onWiFiSave);
+        webServer.setProvisioningStatusCallback(getProvisioningStatus);
         return false;
     }
 
@@ -462,12 +876,9 @@ bool connectToBackend() {
 
     // Start web server immediately for local control (works even if backend is unreachable)
     webServer.begin(DEVICE_ID, &apiClient);
-    webServer.setPumpControlCallback(onPumpControl);
     webServer.setWiFiSaveCallback(onWiFiSave);
-    webServer.setConfigSyncCallback(syncConfigToServer);    // Immediate async sync when config changes
-    webServer.setControlSyncCallback(uploadControlData);    // Immediate async sync when control changes
-    webServer.setTimestampSyncCallback(finalizeNTP);        // Called when app syncs time
-    webServer.setComponentPointers(&sensorManager, &displayManager, &storageManager, &levelCalculator);
+    webServer.setProvisioningStatusCallback(getProvisioningStatus);
+    attachWebServerClientMode();
 
     Serial.println("[Main] Local webserver started - device accessible at http://" + getIPAddress());
 
@@ -480,8 +891,22 @@ bool connectToBackend() {
 
     displayManager.showMessage("NTP Sync", "Connecting...", 0);
 
+    // Boot is the only place that waits for SNTP (bounded) - authentication
+    // needs a valid clock. The main loop picks up later syncs via callback.
+    apiClient.waitForTimeSync(NTP_BOOT_WAIT_TIMEOUT);
+
     if (!syncWithInternet()) {
-        Serial.println("[Main] NTP sync failed - device will work locally only");
+        // NTP may be blocked (UDP/123) - fall back to the backend's clock
+        Serial.println("[Main] NTP sync failed - trying HTTP time sync with backend");
+        displayManager.showMessage("Time Sync", "Via server...", 0);
+
+        if (apiClient.syncTimeWithBackend()) {
+            markDeviceOnline();
+        }
+    }
+
+    if (!deviceIsOnline) {
+        Serial.println("[Main] Time sync failed - device will work locally only");
         Serial.println("[Main] App can sync time via webserver, or device will retry NTP periodically");
         displayManager.showMessage("Offline", "No internet", 3000);
 
@@ -518,7 +943,7 @@ bool connectToBackend() {
             Serial.println("[Main] Device will work locally but cannot sync with backend");
             displayManager.showMessage("Local Mode", "Login failed", 3000);
             deviceIsOnline = false;  // Mark as offline since can't authenticate
-            failedCount++;
+            recordServerFailure();
             return true;  // Local mode
         }
 
@@ -567,19 +992,14 @@ bool connectToBackend() {
                 deviceConfig.lowerThreshold
             );
 
-            // Save to NVS storage for persistence
-            storageManager.saveDeviceConfig(
-                deviceConfig.upperThreshold,
-                deviceConfig.lowerThreshold,
-                deviceConfig.tankHeight,
-                deviceConfig.tankWidth,
-                deviceConfig.tankShape
-            );
-            Serial.println("[Main] Config applied and saved to NVS");
+            Serial.println("[Main] Config applied to system components");
         } else {
             Serial.println("[Main] Config values unchanged after merge");
         }
 
+        // Persist merged sync state (API timestamps may change even when values don't)
+        saveSyncState();
+
         // If device values won, sync to server
         if (deviceWon) {
             Serial.println("[Main] Device config differs from server - syncing to server...");
@@ -587,32 +1007,18 @@ bool connectToBackend() {
                 Serial.println("[Main] Device config synced to server successfully");
             } else {
                 Serial.println("[Main] Failed to sync device config to server");
-                failedCount++;
+                recordServerFailure();
             }
         }
 
         configFetched = true;
-        failedCount = 0;  // Reset on success
+        recordServerSuccess();
     } else {
         Serial.println("[Main] Failed to fetch config from server - using local config");
-        failedCount++;
-
-        // Load config from NVS storage (fallback)
-        float upperThr, lowerThr, tankH, tankW;
-        String tankSh;
-        if (storageManager.loadDeviceConfig(upperThr, lowerThr, tankH, tankW, tankSh)) {
-            deviceConfig.upperThreshold = upperThr;
-            deviceConfig.lowerThreshold = lowerThr;
-            deviceConfig.tankHeight = tankH;
-            deviceConfig.tankWidth = tankW;
-            deviceConfig.tankShape = tankSh;
+        recordServerFailure();
 
-            sensorManager.setTankConfig(tankH, tankW, tankSh);
-            levelCalculator.setTankConfig(tankH, tankW, tankSh);
-            displayManager.setTankSettings(tankH, tankW, tankSh, upperThr, lowerThr);
-
-            Serial.println("[Main] Loaded config from NVS storage");
-        }
+        // Config restored from the sync snapshot at boot is already applied
+        Serial.println("[Main] Continuing with stored config");
     }
 
     // Initialize last synced config (oldData = newData)
@@ -640,9 +1046,15 @@ void uploadTelemetryTask(void* parameter) {
     Serial.println("[AsyncTask] Telemetry upload started");
     activeServerTasks++;  // Increment active task counter
 
+    // Sample once - the same values go to the server or to the offline queue
+    float waterLevelPercent = levelCalculator.getWaterLevelPercent();
+    float currInflow = sensorManager.getCurrentInflow();
+    int pumpStatus = relayController.getPumpStatus();
+
     // Don't attempt server calls if device is offline
     if (!deviceIsOnline) {
-        Serial.println("[AsyncTask] Cannot upload telemetry - device is offline");
+        Serial.println("[AsyncTask] Cannot upload telemetry - device is offline, queueing sample");
+        queueTelemetrySample(waterLevelPercent, currInflow, pumpStatus);
         activeServerTasks--;  // Decrement before exit
         telemetryTaskHandle = NULL;
         vTaskDelete(NULL);
@@ -652,38 +1064,172 @@ void uploadTelemetryTask(void* parameter) {
     // Don't attempt server calls in AP mode (no internet) or when not authenticated
     if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
         Serial.println("[AsyncTask] Cannot upload telemetry - not in client mode or not authenticated");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        queueTelemetrySample(waterLevelPercent, currInflow, pumpStatus);
+        recordServerFailure();
         activeServerTasks--;  // Decrement before exit
         telemetryTaskHandle = NULL;
         vTaskDelete(NULL);
         return;
     }
 
-    // Telemetry doesn't need time sync - it's just sensor data for monitoring
-    // Time sync is only needed for control/config uploads (conflict resolution)
+    // Telemetry doesn't need time sync - it's just sensor data for monitoring
+    // Time sync is only needed for control/config uploads (conflict resolution)
+
+    MLResult ml = mlRuntime.getResult();
+    LeakStatus leak = leakDetector.getStatus();
+    if (apiClient.uploadTelemetry(waterLevelPercent, currInflow, pumpStatus, &ml, &leak)) {
+        Serial.println("[AsyncTask] Telemetry uploaded successfully");
+        recordServerSuccess();
+    } else {
+        Serial.println("[AsyncTask] Failed to upload telemetry - queueing sample");
+        queueTelemetrySample(waterLevelPercent, currInflow, pumpStatus);
+        recordServerFailure();
+    }
+
+    activeServerTasks--;  // Decrement after completion
+    telemetryTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * Async task: Push a leak alarm raise/clear to the backend
+ * Not tied to the telemetry cadence - runs as soon as the detector changes state
+ */
+void uploadLeakAlarmTask(void* parameter) {
+    activeServerTasks++;  // Increment active task counter
+
+    LeakStatus leak = leakDetector.getStatus();
+    Serial.printf("[AsyncTask] Leak alarm upload (%s)\n", leak.alarm ? "raised" : "cleared");
+
+    if (apiClient.uploadLeakAlarm(levelCalculator.getWaterLevelPercent(),
+                                  sensorManager.getCurrentInflow(),
+                                  relayController.getPumpStatus(), leak)) {
+        Serial.println("[AsyncTask] Leak alarm delivered");
+        leakAlarmReported = leak.alarm;
+        lastLeakAlarmAttempt = 0;
+        recordServerSuccess();
+    } else {
+        Serial.println("[AsyncTask] Failed to deliver leak alarm - will retry");
+        recordServerFailure();
+    }
+
+    activeServerTasks--;  // Decrement after completion
+    leakAlarmTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * Async task: Upload one batch of queued (offline) telemetry
+ * Launched only while no live request is in flight, one batch per run,
+ * so backfill never delays current telemetry
+ */
+void drainTelemetryBacklogTask(void* parameter) {
+    activeServerTasks++;  // Increment active task counter
+
+    if (!deviceIsOnline || !isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
+        activeServerTasks--;  // Decrement before exit
+        telemetryBacklogTaskHandle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    TelemetryRecord batch[TELEMETRY_BACKLOG_BATCH_SIZE];
+    size_t slots = 0;
+    size_t count = telemetryQueue.peek(batch, TELEMETRY_BACKLOG_BATCH_SIZE, &slots);
+
+    if (count == 0) {
+        // Only corrupt records in this window - skip past them
+        telemetryQueue.consume(slots);
+    } else if (apiClient.uploadTelemetryBatch(batch, count)) {
+        telemetryQueue.consume(slots);
+        recordServerSuccess();
+        Serial.printf("[AsyncTask] Telemetry backlog: uploaded %u records, %u remaining\n",
+                     (unsigned)count, telemetryQueue.pendingCount());
+    } else {
+        // Records stay queued, retried on the next backlog interval
+        Serial.println("[AsyncTask] Failed to upload telemetry backlog batch");
+        recordServerFailure();
+    }
+
+    activeServerTasks--;  // Decrement after completion
+    telemetryBacklogTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * Async task: HTTP time sync with backend (API_TIME_SYNC)
+ * - NTP fresh: cross-check only, clock is left alone
+ * - NTP stale or unavailable: discipline the clock from the backend and
+ *   bring the device online if it was waiting for time
+ */
+void httpTimeSyncTask(void* parameter) {
+    Serial.println("[AsyncTask] HTTP time sync started");
+    activeServerTasks++;  // Increment active task counter
+
+    if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE) {
+        Serial.println("[AsyncTask] Cannot sync time - not in client mode (no internet)");
+        activeServerTasks--;  // Decrement before exit
+        httpTimeSyncTaskHandle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    if (apiClient.isNtpFresh()) {
+        apiClient.crossCheckTime();
+    } else if (apiClient.syncTimeWithBackend()) {
+        if (!deviceIsOnline) {
+            Serial.println("[AsyncTask] HTTP time sync successful - device is now ONLINE");
+            markDeviceOnline();
+        }
+    } else {
+        Serial.println("[AsyncTask] HTTP time sync failed - will retry later");
+    }
+
+    activeServerTasks--;  // Decrement after completion
+    httpTimeSyncTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * Async task: Log in again after the session was lost
+ * (token expired/revoked, backend URL changed, or the boot login failed)
+ */
+void reloginTask(void* parameter) {
+    Serial.println("[AsyncTask] Re-login started");
+    activeServerTasks++;  // Increment active task counter
+
+    if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE) {
+        activeServerTasks--;  // Decrement before exit
+        reloginTaskHandle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    String dashUsername, dashPassword;
+    if (!getDashboardCredentials(dashUsername, dashPassword) ||
+        dashUsername.length() == 0 || dashPassword.length() == 0) {
+        // Local mode - provisioning logs in once credentials are set
+        reloginBackoff = RELOGIN_RETRY_MAX_MS;
+        activeServerTasks--;  // Decrement before exit
+        reloginTaskHandle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
 
-    float waterLevelPercent = levelCalculator.getWaterLevelPercent();
-    float currInflow = sensorManager.getCurrentInflow();
-    int pumpStatus = relayController.getPumpStatus();
+    if (apiClient.loginDevice(dashUsername, dashPassword)) {
+        Serial.println("[AsyncTask] Re-login successful");
+        reloginBackoff = RELOGIN_RETRY_MIN_MS;
+        recordServerSuccess();
 
-    if (apiClient.uploadTelemetry(waterLevelPercent, currInflow, pumpStatus)) {
-        Serial.println("[AsyncTask] Telemetry uploaded successfully");
-        failedCount = 0;  // Reset failure counter on success
+        // Catch up on control changes made while the session was down
+        lastControlFetch = millis() - CONTROL_FETCH_INTERVAL + 5000;
     } else {
-        Serial.println("[AsyncTask] Failed to upload telemetry");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        reloginBackoff = min(reloginBackoff * 2, (unsigned long)RELOGIN_RETRY_MAX_MS);
+        Serial.printf("[AsyncTask] Re-login failed - next attempt in %lus\n", reloginBackoff / 1000);
     }
 
     activeServerTasks--;  // Decrement after completion
-    telemetryTaskHandle = NULL;
+    reloginTaskHandle = NULL;
     vTaskDelete(NULL);
 }
 
@@ -745,11 +1291,7 @@ void uploadControlTask(void* parameter) {
     if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
         Serial.println("[AsyncTask] Cannot upload control - not in client mode or not authenticated");
         delete jsonPayload;  // Free allocated memory before exit
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        recordServerFailure();
         activeServerTasks--;  // Decrement before exit
         controlUploadTaskHandle = NULL;
         vTaskDelete(NULL);
@@ -770,14 +1312,10 @@ void uploadControlTask(void* parameter) {
     // No race condition because JSON was built synchronously when callback was triggered
     if (apiClient.uploadControlWithPayload(*jsonPayload)) {
         Serial.println("[AsyncTask] Control data uploaded to server successfully");
-        failedCount = 0;  // Reset failure counter on success
+        recordServerSuccess();
     } else {
         Serial.println("[AsyncTask] Failed to upload control data to server");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        recordServerFailure();
     }
 
     // Free the allocated memory
@@ -808,11 +1346,7 @@ void fetchControlDataTask(void* parameter) {
     // Don't attempt server calls in AP mode (no internet) or when not authenticated
     if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
         Serial.println("[AsyncTask] Cannot fetch control - not in client mode or not authenticated");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        recordServerFailure();
         activeServerTasks--;  // Decrement before exit
         controlTaskHandle = NULL;
         vTaskDelete(NULL);
@@ -822,7 +1356,7 @@ void fetchControlDataTask(void* parameter) {
     ControlData tempControlData;
     if (apiClient.fetchControl(tempControlData)) {
         Serial.println("[AsyncTask] Control data fetched");
-        failedCount = 0;  // Reset failure counter on success
+        recordServerSuccess();
 
         // Take mutex before updating shared state
         if (xSemaphoreTake(configMutex, portMAX_DELAY) == pdTRUE) {
@@ -886,18 +1420,9 @@ void fetchControlDataTask(void* parameter) {
 
                         webServer.updateDeviceConfig(deviceConfig);
 
-                        // Save config to NVS for persistence across reboots
-                        storageManager.saveDeviceConfig(
-                            deviceConfig.upperThreshold,
-                            deviceConfig.lowerThreshold,
-                            deviceConfig.tankHeight,
-                            deviceConfig.tankWidth,
-                            deviceConfig.tankShape
-                        );
-
                         Serial.println("[AsyncTask] Configuration updated successfully");
                     } else {
-                        Serial.println("[AsyncTask] Config fetched but values unchanged - skipping save");
+                        Serial.println("[AsyncTask] Config fetched but values unchanged");
                     }
 
                     // Reset config_update flag to false after processing
@@ -919,15 +1444,14 @@ void fetchControlDataTask(void* parameter) {
                 }
             }
 
+            // Persist merged control (and any re-fetched config) sync state
+            saveSyncState();
+
             xSemaphoreGive(configMutex);
         }
     } else {
         Serial.println("[AsyncTask] Failed to fetch control data");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        recordServerFailure();
     }
 
     activeServerTasks--;  // Decrement after completion
@@ -955,11 +1479,7 @@ void fetchConfigFromServerTask(void* parameter) {
     // Don't attempt server calls in AP mode (no internet) or when not authenticated
     if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
         Serial.println("[AsyncTask] Cannot fetch config - not in client mode or not authenticated");
-        failedCount++;
-        if (failedCount >= 10) {
-            Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-            deviceIsOnline = false;
-        }
+        recordServerFailure();
         activeServerTasks--;  // Decrement before exit
         configFetchTaskHandle = NULL;
         vTaskDelete(NULL);
@@ -984,7 +1504,7 @@ void fetchConfigFromServerTask(void* parameter) {
 
         // Fetch latest config from server
         if (apiClient.fetchAndApplyServerConfig(deviceConfig)) {
-            failedCount = 0;  // Reset failure counter on success
+            recordServerSuccess();
 
             // Clear initial_config_update flag after successful first fetch
             if (initial_config_update) {
@@ -1040,26 +1560,16 @@ void fetchConfigFromServerTask(void* parameter) {
 
                 webServer.updateDeviceConfig(deviceConfig);
 
-                // Save config to NVS for persistence across reboots
-                storageManager.saveDeviceConfig(
-                    deviceConfig.upperThreshold,
-                    deviceConfig.lowerThreshold,
-                    deviceConfig.tankHeight,
-                    deviceConfig.tankWidth,
-                    deviceConfig.tankShape
-                );
-
                 Serial.println("[AsyncTask] Config fetched and applied from server");
             } else {
-                Serial.println("[AsyncTask] Config fetched but values unchanged - skipping save");
+                Serial.println("[AsyncTask] Config fetched but values unchanged");
             }
+
+            // Persist merged sync state (API timestamps may change even when values don't)
+            saveSyncState();
         } else {
             Serial.println("[AsyncTask] Failed to fetch config from server");
-            failedCount++;
-            if (failedCount >= 10) {
-                Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-                deviceIsOnline = false;
-            }
+            recordServerFailure();
         }
 
         xSemaphoreGive(configMutex);
@@ -1115,13 +1625,7 @@ void syncConfigToServerTask(void* parameter) {
                     lastSyncedConfig = deviceConfig;
 
                     // Save config to NVS for persistence across reboots
-                    storageManager.saveDeviceConfig(
-                        deviceConfig.upperThreshold,
-                        deviceConfig.lowerThreshold,
-                        deviceConfig.tankHeight,
-                        deviceConfig.tankWidth,
-                        deviceConfig.tankShape
-                    );
+                    saveSyncState();
 
                     // Reapply config after sync
                     sensorManager.setTankConfig(
@@ -1144,11 +1648,7 @@ void syncConfigToServerTask(void* parameter) {
                     webServer.updateDeviceConfig(deviceConfig);
                 } else {
                     Serial.println("[AsyncTask] Failed to upload config to server");
-                    failedCount++;
-                    if (failedCount >= 10) {
-                        Serial.println("[AsyncTask] 10 consecutive failures - marking device as OFFLINE");
-                        deviceIsOnline = false;
-                    }
+                    recordServerFailure();
                 }
             } else {
                 Serial.println("[AsyncTask] Config values unchanged - skipping sync");
@@ -1171,6 +1671,8 @@ void syncConfigToServerTask(void* parameter) {
  * Update sensor readings (every 1 second)
  */
 void updateSensors() {
+    powerManager.beginActivity(POWER_SENSOR);
+
     sensorManager.update();
 
     float waterLevelPercent = levelCalculator.getWaterLevelPercent();
@@ -1186,23 +1688,40 @@ void updateSensors() {
     // Update web server data (send percentage for telemetry)
     int pumpStatus = relayController.getPumpStatus();
     webServer.updateSensorData(waterLevelPercent, currInflow, pumpStatus);
+
+    // Model window (runs inference once per model stride)
+    mlRuntime.addSample(waterLevelPercent, currInflow, pumpStatus);
+
+    // Night-flow windows (pump-off volume loss)
+    leakDetector.addSample(levelCalculator.getCurrentVolume(), pumpStatus);
+
+    // Deadband state for report-by-exception telemetry
+    telemetryReporter.addSample(waterLevelPercent, currInflow, pumpStatus);
+
+    powerManager.endActivity(POWER_SENSOR);
 }
 
 /**
- * Upload telemetry to backend (every 30 seconds)
+ * Upload telemetry to backend (when telemetryReporter says a report is due)
  * Launches async task to prevent blocking main loop
  */
 void uploadTelemetry() {
     // Skip if task is already running
     if (telemetryTaskHandle != NULL) {
-        Serial.println("[Main] Telemetry task already running, skipping...");
+        Serial.println("[Main] Telemetry task already running, queueing sample...");
+        queueTelemetrySample(levelCalculator.getWaterLevelPercent(),
+                             sensorManager.getCurrentInflow(),
+                             relayController.getPumpStatus());
         return;
     }
 
     // Check if too many tasks are running (prevent device crash)
     if (activeServerTasks >= MAX_CONCURRENT_SERVER_TASKS) {
-        Serial.printf("[Main] Too many active tasks (%d/%d), skipping telemetry upload\n",
+        Serial.printf("[Main] Too many active tasks (%d/%d), queueing telemetry sample\n",
                      activeServerTasks, MAX_CONCURRENT_SERVER_TASKS);
+        queueTelemetrySample(levelCalculator.getWaterLevelPercent(),
+                             sensorManager.getCurrentInflow(),
+                             relayController.getPumpStatus());
         return;
     }
 
@@ -1222,6 +1741,160 @@ void uploadTelemetry() {
     }
 }
 
+/**
+ * Store a telemetry sample in the offline queue (LittleFS)
+ * Samples are only kept once the clock is synced - without a valid
+ * timestamp the server can't place them in the history
+ */
+void queueTelemetrySample(float waterLevelPercent, float currInflow, int pumpStatus) {
+    if (!apiClient.isTimeSynced()) {
+        return;
+    }
+
+    telemetryQueue.append(apiClient.getCurrentTimestamp(), waterLevelPercent, currInflow, pumpStatus);
+}
+
+/**
+ * Backfill queued telemetry (every TELEMETRY_BACKLOG_INTERVAL while backlog exists)
+ * Stays behind live traffic: never runs alongside another server task,
+ * and never right before a live telemetry upload is due
+ */
+void drainTelemetryBacklog() {
+    if (telemetryBacklogTaskHandle != NULL || telemetryQueue.isEmpty()) {
+        return;
+    }
+
+    // Leave all task slots (and bandwidth during OTA) to live traffic
+    if (activeServerTasks > 0 || telemetryTaskHandle != NULL || otaUpdater.isUpdating()) {
+        return;
+    }
+
+    // Don't start a batch that could overlap the next heartbeat (reports
+    // on change can't be foreseen - they share the two task slots)
+    if (telemetryReporter.sinceLastReport(millis()) + TELEMETRY_BACKLOG_LIVE_GUARD >=
+        telemetryReporter.getHeartbeatInterval()) {
+        return;
+    }
+
+    BaseType_t result = xTaskCreate(
+        drainTelemetryBacklogTask,   // Task function
+        "TelemetryBacklog",          // Task name
+        8192,                        // Stack size (bytes) - batch buffer + HTTP
+        NULL,                        // Task parameters
+        1,                           // Priority (1 = low, higher than idle)
+        &telemetryBacklogTaskHandle  // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Main] Failed to create telemetry backlog task");
+        telemetryBacklogTaskHandle = NULL;
+    }
+}
+
+/**
+ * Push a pending leak alarm raise/clear (high priority)
+ * Not subject to MAX_CONCURRENT_SERVER_TASKS - an alarm must not wait
+ * behind routine traffic. Failed uploads retry every LEAK_ALARM_RETRY_INTERVAL.
+ */
+void uploadLeakAlarm() {
+    // Skip if task is already running
+    if (leakAlarmTaskHandle != NULL) {
+        return;
+    }
+
+    if (lastLeakAlarmAttempt != 0 && millis() - lastLeakAlarmAttempt < LEAK_ALARM_RETRY_INTERVAL) {
+        return;
+    }
+    lastLeakAlarmAttempt = millis();
+
+    BaseType_t result = xTaskCreate(
+        uploadLeakAlarmTask,       // Task function
+        "LeakAlarm",               // Task name
+        8192,                      // Stack size (bytes) - HTTP + JSON
+        NULL,                      // Task parameters
+        LEAK_ALARM_TASK_PRIORITY,  // Priority (above other server tasks)
+        &leakAlarmTaskHandle       // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Main] Failed to create leak alarm task");
+        leakAlarmTaskHandle = NULL;
+    }
+}
+
+/**
+ * HTTP time sync with backend (NTP fallback / cross-check)
+ * Launches async task to prevent blocking main loop
+ */
+void checkBackendTime() {
+    // Skip if task is already running
+    if (httpTimeSyncTaskHandle != NULL) {
+        return;
+    }
+
+    // Check if too many tasks are running (prevent device crash)
+    if (activeServerTasks >= MAX_CONCURRENT_SERVER_TASKS) {
+        Serial.printf("[Main] Too many active tasks (%d/%d), skipping HTTP time sync\n",
+                     activeServerTasks, MAX_CONCURRENT_SERVER_TASKS);
+        return;
+    }
+
+    BaseType_t result = xTaskCreate(
+        httpTimeSyncTask,          // Task function
+        "HttpTimeSync",            // Task name
+        8192,                      // Stack size (bytes) - HTTP + JSON
+        NULL,                      // Task parameters
+        1,                         // Priority (1 = low, higher than idle)
+        &httpTimeSyncTaskHandle    // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Main] Failed to create HTTP time sync task");
+        httpTimeSyncTaskHandle = NULL;
+    }
+}
+
+/**
+ * Re-login with backoff while the session is lost
+ * Launches async task to prevent blocking main loop
+ */
+void relogin() {
+    // Skip if task is already running
+    if (reloginTaskHandle != NULL) {
+        return;
+    }
+
+    // The provisioning job logs in itself
+    if (provisioningTaskHandle != NULL) {
+        return;
+    }
+
+    if (millis() - lastReloginAttempt < reloginBackoff) {
+        return;
+    }
+
+    // Check if too many tasks are running (prevent device crash)
+    if (activeServerTasks >= MAX_CONCURRENT_SERVER_TASKS) {
+        return;
+    }
+
+    lastReloginAttempt = millis();
+
+    BaseType_t result = xTaskCreate(
+        reloginTask,               // Task function
+        "Relogin",                 // Task name
+        8192,                      // Stack size (bytes) - HTTP + JSON
+        NULL,                      // Task parameters
+        1,                         // Priority (1 = low, higher than idle)
+        &reloginTaskHandle         // Task handle
+    );
+
+    if (result != pdPASS) {
+        Serial.println("[Main] Failed to create re-login task");
+        reloginTaskHandle = NULL;
+    }
+}
+
 /**
  * Upload control data to backend (called immediately when app updates control)
  * Launches async task to prevent blocking main loop
@@ -1316,6 +1989,8 @@ void fetchControlData() {
 
 /**
  * Check for OTA firmware updates (every 5 minutes)
+ * The download runs in the OTA updater's background task - pump control
+ * and sensors keep running in the main loop meanwhile
  */
 void checkOTAUpdate() {
     // Don't attempt OTA checks in AP mode (no internet)
@@ -1325,16 +2000,54 @@ void checkOTAUpdate() {
     }
 
     // Check force_update flag
-    if (deviceConfig.force_update) {
-        Serial.println("[Main] Force update flag detected, starting OTA update...");
+    if (deviceConfig.force_update && !otaUpdater.isUpdating()) {
+        Serial.println("[Main] Force update flag detected, starting background OTA update...");
 
-        displayManager.showMessage("OTA Update", "Downloading...", 0);
+        if (otaUpdater.startUpdate(apiClient.getToken())) {
+            displayManager.showMessage("OTA Update", "Downloading...", 1000);
+        }
+    }
+}
 
-        if (otaUpdater.checkAndUpdate(apiClient.getToken())) {
-            // Device will restart after successful update
-        } else {
+/**
+ * Check for a new ML model (every hour)
+ * Download and validation run in the ML runtime's background task;
+ * the loop picks the new model up on its next sample
+ */
+void checkMLModelUpdate() {
+    if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE || !apiClient.isAuthenticated()) {
+        return;
+    }
+
+    // Firmware first - both compete for the radio
+    if (otaUpdater.isUpdating() || mlRuntime.isUpdating()) {
+        return;
+    }
+
+    mlRuntime.startUpdate(apiClient.getToken());
+}
+
+/**
+ * Track background OTA: progress on the display, restart once the new
+ * image is verified, report failures once
+ */
+void handleOTAStatus() {
+    static OTAState lastState = OTA_IDLE;
+    OTAState state = otaUpdater.getState();
+
+    displayManager.setOtaProgress(otaUpdater.isUpdating() ? otaUpdater.getProgress() : -1);
+
+    if (state != lastState) {
+        if (state == OTA_FAILED) {
             displayManager.showMessage("OTA Failed", otaUpdater.getLastError(), 3000);
         }
+        lastState = state;
+    }
+
+    if (otaUpdater.isRestartPending() && restartAt == 0) {
+        Serial.println("[Main] Firmware update successful, restarting in 3 seconds...");
+        displayManager.showMessage("OTA Complete", "Restarting...", 3000);
+        scheduleRestart(3000);
     }
 }
 
@@ -1445,66 +2158,130 @@ void updateDisplay() {
  * will override server values.
  */
 void handleButtons() {
-    buttonHandler.update();
+    ButtonEvent event;
+
+    // Drain the queue - every press is handled, even several per loop
+    while ((event = buttonHandler.getEvent()) != BTN_NONE) {
+        switch (event) {
+            case BTN1_PRESSED:
+                // Cycle display screens
+                displayManager.nextScreen();
+                break;
+
+            case BTN1_DOUBLE_CLICK:
+                // Back to the status screen
+                displayManager.setScreen(SCREEN_STATUS);
+                break;
+
+            case BTN2_PRESSED:
+                // Manual pump ON (already switched in onButtonEvent)
+                if (relayController.getMode() == MODE_MANUAL) {
+                    displayManager.showMessage("Pump", "Turned ON", 1000);
+                } else {
+                    displayManager.showMessage("Error", "Not in MANUAL mode", 2000);
+                }
+                break;
 
-    ButtonEvent event = buttonHandler.getEvent();
+            case BTN3_PRESSED:
+                // Auto/Manual toggle (already switched in onButtonEvent)
+                displayManager.showMessage("Mode", relayController.getModeString(), 1500);
+                break;
 
-    switch (event) {
-        case BTN1_PRESSED:
-            // Cycle display screens
-            displayManager.nextScreen();
-            break;
+            case BTN4_PRESSED:
+                // Manual pump OFF (already switched in onButtonEvent)
+                if (relayController.getMode() == MODE_MANUAL) {
+                    displayManager.showMessage("Pump", "Turned OFF", 1000);
+                } else {
+                    displayManager.showMessage("Error", "Not in MANUAL mode", 2000);
+                }
+                break;
+
+            case BTN5_LONG_PRESS:
+                // Reset WiFi credentials
+                displayManager.showMessage("WiFi Reset", "Clearing credentials...", 2000);
+                clearWiFiCredentials();
+                scheduleRestart(2000);
+                break;
+
+            case BTN6_PRESSED:
+                // Hardware override toggle (already switched in onButtonEvent)
+                displayManager.showMessage("Override",
+                    relayController.isHardwareOverride() ? "ENABLED" : "DISABLED", 1500);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
 
+/**
+ * Button task callback - runs as soon as a press is recognized, independent
+ * of loop() (which may be busy with network work). Every pump-related
+ * button (mode toggle included) is applied here, in press order, so BTN3
+ * then BTN2 switches to MANUAL before the pump command is checked.
+ * RelayController locks each action and leaves NVS to the loop; messages
+ * are shown by handleButtons().
+ */
+void onButtonEvent(ButtonEvent event) {
+    switch (event) {
         case BTN2_PRESSED:
-            // Manual pump ON
-            if (relayController.getMode() == MODE_MANUAL) {
-                relayController.turnOn();
-                displayManager.showMessage("Pump", "Turned ON", 1000);
-            } else {
-                displayManager.showMessage("Error", "Not in MANUAL mode", 2000);
-            }
+            relayController.setManualPump(true);
             break;
 
         case BTN3_PRESSED:
-            // Toggle Auto/Manual mode
             relayController.toggleMode();
-            displayManager.showMessage("Mode", relayController.getModeString(), 1500);
             break;
 
         case BTN4_PRESSED:
-            // Manual pump OFF
-            if (relayController.getMode() == MODE_MANUAL) {
-                relayController.turnOff();
-                displayManager.showMessage("Pump", "Turned OFF", 1000);
-            } else {
-                displayManager.showMessage("Error", "Not in MANUAL mode", 2000);
-            }
-            break;
-
-        case BTN5_LONG_PRESS:
-            // Reset WiFi credentials
-            displayManager.showMessage("WiFi Reset", "Clearing credentials...", 2000);
-            clearWiFiCredentials();
-            delay(1000);
-            ESP.restart();
+            relayController.setManualPump(false);
             break;
 
         case BTN6_PRESSED:
-            {
-                // Hardware override toggle
-                bool currentOverride = relayController.isHardwareOverride();
-                relayController.setHardwareOverride(!currentOverride);
-                displayManager.showMessage("Override",
-                    !currentOverride ? "ENABLED" : "DISABLED", 1500);
-            }
+            relayController.setHardwareOverride(!relayController.isHardwareOverride());
             break;
 
         default:
-            // No event
             break;
     }
 }
 
+/**
+ * Restart after a delay without blocking the loop (the message on screen
+ * stays visible meanwhile)
+ */
+void scheduleRestart(unsigned long delayMs) {
+    restartAt = millis() + delayMs;
+    if (restartAt == 0) {
+        restartAt = 1;
+    }
+}
+
+/**
+ * Time until the next periodic loop job (sensor read, display update),
+ * capped so WiFi and provisioning state are still polled regularly
+ */
+unsigned long loopIdleTime() {
+    unsigned long now = millis();
+    unsigned long idle = POWER_LOOP_IDLE_MAX_MS;
+
+    unsigned long sinceSensor = now - lastSensorRead;
+    if (sinceSensor < SENSOR_READ_INTERVAL) {
+        idle = min(idle, SENSOR_READ_INTERVAL - sinceSensor);
+    } else {
+        idle = 0;
+    }
+
+    unsigned long sinceDisplay = now - lastDisplayUpdate;
+    if (sinceDisplay < DISPLAY_UPDATE_INTERVAL) {
+        idle = min(idle, DISPLAY_UPDATE_INTERVAL - sinceDisplay);
+    } else {
+        idle = 0;
+    }
+
+    return idle > 0 ? idle : 1;  // Always yield (watchdog, lower-priority tasks)
+}
+
 // ============================================================================
 // ARDUINO SETUP AND LOOP
 // ============================================================================
@@ -1521,6 +2298,11 @@ void setup() {
         Serial.println("[Main] Config mutex created successfully");
     }
 
+    provisioningMutex = xSemaphoreCreateMutex();
+    if (provisioningMutex == NULL) {
+        Serial.println("[Main] ERROR: Failed to create provisioning mutex!");
+    }
+
     // Connect to backend
     systemInitialized = connectToBackend();
 
@@ -1532,86 +2314,23 @@ void setup() {
 
     // Initialize timing
     lastSensorRead = millis();
-    lastTelemetryUpload = millis();
+    telemetryReporter.setHeartbeatInterval(configHandler.getHeartbeatMs());
+    telemetryReporter.scheduleReport(millis(), TELEMETRY_MIN_INTERVAL);
     lastControlFetch = millis();
     lastConfigCheck = millis();
     lastOTACheck = millis();
+    lastMLCheck = millis() - ML_CHECK_INTERVAL + ML_FIRST_CHECK_DELAY;
     lastDisplayUpdate = millis();
-    last24HourCheck = millis();
-
-    Serial.println("[Main] Entering main loop...\n");
-}
-
-// ============================================================================
-// 24-HOUR UPTIME REBOOT FOR NTP RESYNC
-// ============================================================================
-
-/**
- * Check internet connectivity by pinging Google DNS
- * Returns true if internet is reachable
- */
-bool checkInternetConnectivity() {
-    if (!isWiFiConnected() || getWiFiMode() != WIFI_CLIENT_MODE) {
-        return false;
-    }
-
-    // Ping Google DNS (8.8.8.8) to check internet connectivity
-    Serial.println("[Main] Checking internet connectivity (ping 8.8.8.8)...");
-
-    bool success = Ping.ping("8.8.8.8", 3);  // 3 attempts
-
-    if (success) {
-        Serial.println("[Main] Internet connectivity: OK");
-    } else {
-        Serial.println("[Main] Internet connectivity: FAILED");
-    }
-
-    return success;
-}
-
-/**
- * Check if device has been running for 24 hours and reboot
- * Reboot reduces NTP time drift by resyncing after 24 hours
- * Only reboots if internet is available (so NTP sync works after reboot)
- *
- * Uses millis() uptime to detect 24-hour runtime:
- * - Check if millis() >= 24 hours
- * - If yes and internet available → reboot immediately
- * - After reboot, millis() resets to 0, won't trigger for another 24 hours
- */
-void check24HourReboot() {
-    // Only check if we have a synced timestamp
-    if (!apiClient.isTimeSynced()) {
-        return;
-    }
-
-    // Check if device has been running for 24 hours (86400000 milliseconds)
-    const unsigned long TWENTY_FOUR_HOURS = 86400000UL;  // 24 * 60 * 60 * 1000
-
-    unsigned long currentUptime = millis();
 
-    // If uptime >= 24 hours, check internet and reboot
-    if (currentUptime >= TWENTY_FOUR_HOURS) {
-        Serial.println("[Main] ========================================");
-        Serial.println("[Main] 24 HOUR UPTIME REACHED");
-        Serial.println("[Main] ========================================");
-        Serial.printf("[Main] Uptime: %lu ms (%.1f hours)\n", currentUptime, currentUptime / 3600000.0);
-        Serial.println("[Main] Checking internet connectivity before reboot...");
+    powerManager.endActivity(POWER_LOOP);
 
-        if (checkInternetConnectivity()) {
-            Serial.println("[Main] Internet available - rebooting now...");
-            Serial.println("[Main] Device will resync NTP after reboot");
-            displayManager.showMessage("Rebooting", "NTP resync", 2000);
-            delay(2000);
-            ESP.restart();  // Reboot → millis() resets to 0
-        } else {
-            Serial.println("[Main] No internet - will retry in 1 minute");
-            // Will check again in 1 minute (via main loop)
-        }
-    }
+    Serial.println("[Main] Entering main loop...\n");
 }
 
 void loop() {
+    // Active phase: CPU at max clock until the idle at the end
+    powerManager.beginActivity(POWER_LOOP);
+
     unsigned long currentTime = millis();
     static bool wasConnected = false;
 
@@ -1621,6 +2340,18 @@ void loop() {
     // Handle buttons
     handleButtons();
 
+    // WiFi provisioning job from the web portal
+    handleProvisioning();
+
+    // Backend reachability (passive signals + async probe)
+    handleConnectivity();
+
+    // Scheduled restart (WiFi reset, OTA complete)
+    if (restartAt != 0 && (long)(currentTime - restartAt) >= 0) {
+        Serial.println("[Main] Restarting...");
+        ESP.restart();
+    }
+
     // Detect online/offline transitions
     if (systemInitialized) {
         bool isConnected = isWiFiConnected();
@@ -1632,8 +2363,8 @@ void loop() {
             // NOTE: Don't call apiClient.onDeviceOnline() here - it's BLOCKING with retries!
             // The periodic sync tasks will handle syncing within 30 seconds (non-blocking).
             // Just reset the sync timers to trigger sync quickly.
-            lastTelemetryUpload = millis() - TELEMETRY_UPLOAD_INTERVAL + 5000;  // Upload in 5s
-            lastConfigCheck = millis() - TELEMETRY_UPLOAD_INTERVAL + 5000;      // Fetch config in 5s
+            telemetryReporter.scheduleReport(millis(), 5000);                 // Upload in 5s
+            lastConfigCheck = millis() - CONFIG_FETCH_RETRY_INTERVAL + 5000;  // Fetch config in 5s
             lastControlFetch = millis() - CONTROL_FETCH_INTERVAL + 10000;       // Fetch control in 10s
 
             Serial.println("[Main] Scheduled async sync tasks to run soon");
@@ -1657,45 +2388,96 @@ void loop() {
     // Update display (every 0.5 seconds)
     if (currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
         lastDisplayUpdate = currentTime;
+        handleOTAStatus();
         updateDisplay();
     }
 
     // ============================================================================
-    // PERIODIC NTP RETRY WHEN OFFLINE
+    // NTP SYNC EVENTS / OFFLINE RECOVERY
     // ============================================================================
-    // If device is offline but WiFi is connected, periodically retry NTP sync
-    if (systemInitialized && !deviceIsOnline && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
-        const unsigned long NTP_RETRY_INTERVAL = 15000;  // 15 seconds
+    // SNTP completion is reported by callback - the loop only checks a flag
+    if (systemInitialized) {
+        handleTimeSyncEvent();
+    }
 
-        if (currentTime - lastNTPRetry >= NTP_RETRY_INTERVAL) {
+    // If device is offline but WiFi is connected, periodically check whether
+    // SNTP has a valid time (non-blocking - starts SNTP if needed)
+    if (systemInitialized && !deviceIsOnline && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
+        // While a fresh probe says the backend is down, coming back online would only fail again
+        if (currentTime - lastNTPRetry >= NTP_RETRY_INTERVAL &&
+            connectivityProbe.getState() != CONNECTIVITY_UNREACHABLE) {
             lastNTPRetry = currentTime;
-            Serial.println("[Main] Device is offline - attempting NTP sync...");
 
             if (syncWithInternet()) {
                 Serial.println("[Main] NTP sync successful - device is now ONLINE");
                 // Device is now online, will start syncing with server on next iteration
+                ntpPendingSince = 0;
             } else {
-                Serial.println("[Main] NTP sync failed - will retry in " + String(NTP_RETRY_INTERVAL / 1000) + " seconds");
+                if (ntpPendingSince == 0) {
+                    ntpPendingSince = currentTime;
+                }
+
+                // NTP unavailable for too long (UDP blocked?) - use backend time
+                if (currentTime - ntpPendingSince >= NTP_FALLBACK_DELAY) {
+                    checkBackendTime();
+                }
             }
         }
+    } else {
+        ntpPendingSince = 0;
+    }
+
+    // Online: cross-check NTP against backend time (or resync from it if NTP went stale)
+    if (systemInitialized && deviceIsOnline && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
+        if (currentTime - lastHttpTimeCheck >= HTTP_TIME_SYNC_INTERVAL) {
+            lastHttpTimeCheck = currentTime;
+            checkBackendTime();
+        }
+    }
+
+    // Telemetry by exception (pump change, level/inflow deadband, heartbeat) -
+    // reported even when offline so outages are backfilled from the LittleFS
+    // queue after reconnect. The heartbeat follows the synced device config.
+    telemetryReporter.setHeartbeatInterval(configHandler.getHeartbeatMs());
+    TelemetryReason reportReason = telemetryReporter.check(currentTime);
+    if (reportReason != TELEMETRY_REPORT_NONE) {
+        DEBUG_PRINTF("[Main] Telemetry report (%s)\n", TelemetryReporter::reasonName(reportReason));
+        telemetryReporter.markReported(currentTime);
+        if (systemInitialized && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
+            uploadTelemetry();
+        } else {
+            queueTelemetrySample(levelCalculator.getWaterLevelPercent(),
+                                 sensorManager.getCurrentInflow(),
+                                 relayController.getPumpStatus());
+        }
     }
 
     // Only perform backend operations if connected, initialized, and in client mode
     // IMPORTANT: Don't attempt server calls in AP mode (no internet, only for WiFi provisioning)
     if (systemInitialized && isWiFiConnected() && getWiFiMode() == WIFI_CLIENT_MODE) {
 
-        // Upload telemetry (every 30 seconds)
-        if (currentTime - lastTelemetryUpload >= TELEMETRY_UPLOAD_INTERVAL) {
-            lastTelemetryUpload = currentTime;
-            uploadTelemetry();
+        // Session lost (token rejected or boot login failed) - log in again
+        if (!apiClient.isAuthenticated()) {
+            relogin();
+        }
+
+        // Leak alarm raised or cleared since the last acknowledged upload
+        if (apiClient.isAuthenticated() && leakDetector.getStatus().alarm != leakAlarmReported) {
+            uploadLeakAlarm();
+        }
+
+        // Backfill offline telemetry (rate-limited, lowest priority)
+        if (deviceIsOnline && currentTime - lastTelemetryBacklog >= TELEMETRY_BACKLOG_INTERVAL) {
+            lastTelemetryBacklog = currentTime;
+            drainTelemetryBacklog();
         }
 
-        // Fetch config from server (every 30 seconds) if needed
+        // Fetch config from server (every CONFIG_FETCH_RETRY_INTERVAL) if needed
         // Only fetch if:
         // 1. initial_config_update is true (after NTP sync on first boot), OR
         // 2. config_update flag is set by server (checked in control data fetch every 5 min)
         // Note: auto_update is for firmware OTA updates, NOT config updates
-        if (currentTime - lastConfigCheck >= TELEMETRY_UPLOAD_INTERVAL) {
+        if (currentTime - lastConfigCheck >= CONFIG_FETCH_RETRY_INTERVAL) {
             lastConfigCheck = currentTime;
             // Check if initial config fetch is needed after NTP sync
             if (apiClient.isTimeSynced() && initial_config_update) {
@@ -1716,14 +2498,21 @@ void loop() {
             checkOTAUpdate();
         }
 
-        // Check 24-hour uptime reboot (every minute to avoid spam)
-        // Reduces NTP drift by resyncing after 24-hour uptime
-        if (currentTime - last24HourCheck >= 60000) {  // Check every minute
-            last24HourCheck = currentTime;
-            check24HourReboot();
+        // Check ML model updates (every hour)
+        if (currentTime - lastMLCheck >= ML_CHECK_INTERVAL) {
+            lastMLCheck = currentTime;
+            checkMLModelUpdate();
         }
     }
 
-    // Small delay to prevent watchdog issues
-    delay(10);
+    // Radio busy while server tasks / OTA / a model download / a probe are in flight
+    powerManager.setActive(POWER_NETWORK, activeServerTasks > 0 || otaUpdater.isUpdating() ||
+                                          mlRuntime.isUpdating() || connectivityProbe.isProbing());
+    powerManager.update();
+
+    // Idle phase: sleep until the next scheduled job instead of spinning.
+    // With the PM lock released the CPU clocks down or light-sleeps.
+    unsigned long idleMs = loopIdleTime();
+    powerManager.endActivity(POWER_LOOP);
+    delay(idleMs);
 }
@@ -0,0 +1,213 @@
+#include "ml_model.h"
+#include "crc32.h"
+#include "batch_kernels.h"
+#include <math.h>
+
+#define ML_MAX_BIAS (1L << 30)
+
+alignas(16) int8_t MLModel::activations[2][ML_MAX_LAYER_WIDTH];
+
+MLModel::MLModel()
+    : data(nullptr),
+      size(0),
+      macs(0),
+      error("") {
+    memset(&head, 0, sizeof(head));
+}
+
+MLModel::~MLModel() {
+    end();
+}
+
+void MLModel::end() {
+    free(data);
+    data = nullptr;
+    size = 0;
+}
+
+bool MLModel::fail(const char* message) {
+    error = message;
+    end();
+    return false;
+}
+
+int MLModel::inputCount() const {
+    int channels = 0;
+    for (int bit = 0; bit < ML_CHANNEL_COUNT; bit++) {
+        if (head.channels & (1 << bit)) {
+            channels++;
+        }
+    }
+    return head.window * channels;
+}
+
+// ============================================================================
+// LOADING
+// ============================================================================
+
+static size_t align4(size_t value) {
+    return (value + 3) & ~(size_t)3;
+}
+
+bool MLModel::begin(uint8_t* buffer, size_t length) {
+    end();
+    data = buffer;
+    size = length;
+    macs = 0;
+
+    if (data == nullptr || size < sizeof(MLModelHeader) + sizeof(uint32_t)) {
+        return fail("File too short");
+    }
+    if (size > ML_MAX_MODEL_SIZE) {
+        return fail("Model exceeds ML_MAX_MODEL_SIZE");
+    }
+
+    uint32_t storedCrc;
+    memcpy(&storedCrc, data + size - sizeof(storedCrc), sizeof(storedCrc));
+    if (crc32Compute(data, size - sizeof(storedCrc)) != storedCrc) {
+        return fail("CRC mismatch");
+    }
+
+    memcpy(&head, data, sizeof(head));
+    if (memcmp(head.magic, ML_MODEL_MAGIC, sizeof(head.magic)) != 0 || head.format != ML_MODEL_FORMAT) {
+        return fail("Unknown model format");
+    }
+    if (head.outputKind > ML_OUTPUT_FORECAST) {
+        return fail("Unknown output kind");
+    }
+    if (head.channels == 0 || head.channels >= (1 << ML_CHANNEL_COUNT)) {
+        return fail("Invalid channel mask");
+    }
+    if (head.window == 0 || head.window > ML_MAX_WINDOW || head.strideSec == 0) {
+        return fail("Window exceeds ML_MAX_WINDOW");
+    }
+    if (head.layerCount == 0 || head.layerCount > ML_MAX_LAYERS) {
+        return fail("Layer count exceeds ML_MAX_LAYERS");
+    }
+    if (!(head.inputScale > 0) || !isfinite(head.outputGain) || !isfinite(head.outputOffset)) {
+        return fail("Invalid input quantization");
+    }
+
+    // Walk the layers: each one must consume what the previous produced
+    size_t offset = sizeof(MLModelHeader);
+    size_t limit = size - sizeof(uint32_t);
+    int inputs = inputCount();
+    float inScale = head.inputScale;
+    int8_t inZeroPoint = head.inputZeroPoint;
+
+    for (int i = 0; i < head.layerCount; i++) {
+        Layer& layer = layers[i];
+        if (offset + sizeof(MLLayerHeader) > limit) {
+            return fail("Truncated layer");
+        }
+        memcpy(&layer.head, data + offset, sizeof(MLLayerHeader));
+        offset += sizeof(MLLayerHeader);
+
+        const MLLayerHeader& lh = layer.head;
+        if (lh.inputs != inputs || lh.inputs > ML_MAX_LAYER_WIDTH) {
+            return fail("Layer input width mismatch");
+        }
+        if (lh.outputs == 0 || lh.outputs > ML_MAX_LAYER_WIDTH) {
+            return fail("Layer exceeds ML_MAX_LAYER_WIDTH");
+        }
+        if (lh.activation > ML_ACTIVATION_RELU || !(lh.weightScale > 0) || !(lh.outputScale > 0)) {
+            return fail("Invalid layer quantization");
+        }
+
+        size_t weightBytes = align4((size_t)lh.inputs * lh.outputs);
+        size_t biasBytes = (size_t)lh.outputs * sizeof(int32_t);
+        if (offset + weightBytes + biasBytes > limit) {
+            return fail("Truncated layer");
+        }
+
+        // Sections are 4-byte aligned in the file and malloc() aligns the buffer
+        int32_t* bias = (int32_t*)(data + offset + weightBytes);
+        layer.weights = (const int8_t*)(data + offset);
+        layer.bias = bias;
+        layer.multiplier = inScale * lh.weightScale / lh.outputScale;
+        offset += weightBytes + biasBytes;
+
+        // sum(w * (in - zp)) = sum(w * in) - zp * sum(w): fold the second
+        // term into the bias (in place, the CRC is checked) so inference is
+        // a plain dot product. Real biases are far below 2^30, which keeps
+        // the accumulator clear of int32 overflow.
+        const int8_t* row = layer.weights;
+        for (int o = 0; o < lh.outputs; o++) {
+            if (bias[o] < -ML_MAX_BIAS || bias[o] > ML_MAX_BIAS) {
+                return fail("Layer bias out of range");
+            }
+            bias[o] -= (int32_t)inZeroPoint * batchSumS8(row, lh.inputs);
+            row += lh.inputs;
+        }
+
+        macs += (uint32_t)lh.inputs * lh.outputs;
+        inputs = lh.outputs;
+        inScale = lh.outputScale;
+        inZeroPoint = lh.outputZeroPoint;
+    }
+
+    if (offset != limit) {
+        return fail("Trailing bytes after last layer");
+    }
+    if (macs > ML_MAX_MACS) {
+        return fail("Model exceeds ML_MAX_MACS");
+    }
+
+    error = "";
+    return true;
+}
+
+// ============================================================================
+// INFERENCE
+// ============================================================================
+
+static int8_t saturate(int32_t value) {
+    return (int8_t)(value < -128 ? -128 : (value > 127 ? 127 : value));
+}
+
+// Rounded to int32 without overflow (anything past +-1000 saturates anyway)
+static int32_t roundClamped(float value) {
+    if (!(value > -1000.0f)) {
+        return isnan(value) ? 0 : -1000;
+    }
+    return value < 1000.0f ? (int32_t)lroundf(value) : 1000;
+}
+
+bool MLModel::run(const float* features, float& value) {
+    if (data == nullptr) {
+        return false;
+    }
+
+    // Quantize the (already normalized) features
+    int8_t* in = activations[0];
+    int8_t* out = activations[1];
+    int count = inputCount();
+    for (int i = 0; i < count; i++) {
+        in[i] = saturate(roundClamped(features[i] / head.inputScale) + head.inputZeroPoint);
+    }
+
+    for (int l = 0; l < head.layerCount; l++) {
+        const Layer& layer = layers[l];
+        const MLLayerHeader& lh = layer.head;
+        const int8_t* row = layer.weights;
+
+        // ReLU clamps at the output zero point (real 0)
+        int32_t lowest = lh.activation == ML_ACTIVATION_RELU ? lh.outputZeroPoint : -128;
+
+        for (int o = 0; o < lh.outputs; o++) {
+            int32_t acc = layer.bias[o] + batchDotS8(row, in, lh.inputs);
+            row += lh.inputs;
+
+            int32_t q = roundClamped(acc * layer.multiplier) + lh.outputZeroPoint;
+            out[o] = saturate(q < lowest ? lowest : q);
+        }
+
+        int8_t* swap = in;
+        in = out;
+        out = swap;
+    }
+
+    const MLLayerHeader& last = layers[head.layerCount - 1].head;
+    value = head.outputGain * last.outputScale * (in[0] - last.outputZeroPoint) + head.outputOffset;
+    return true;
+}
@@ -0,0 +1,592 @@
+#include "ml_runtime.h"
+#include "batch_kernels.h"
+#include "endpoints.h"
+#include "server_url.h"
+#include "sha256_compat.h"
+#include "esp_timer.h"
+#include <LittleFS.h>
+
+#define ML_MODEL_PATH ML_MODEL_DIR "/model.bin"
+#define ML_MODEL_META ML_MODEL_DIR "/model.json"
+#define ML_PREV_PATH ML_MODEL_DIR "/prev.bin"
+#define ML_PREV_META ML_MODEL_DIR "/prev.json"
+#define ML_TMP_PATH ML_MODEL_DIR "/model.tmp"
+#define ML_TMP_META ML_MODEL_DIR "/meta.tmp"
+
+#define ML_DOWNLOAD_CHUNK 1024
+
+MLRuntime::MLRuntime()
+    : state(ML_UPDATE_IDLE),
+      lastError(""),
+      taskHandle(NULL),
+      errorMutex(NULL),
+      mux(portMUX_INITIALIZER_UNLOCKED),
+      active(nullptr),
+      sampleHead(0),
+      sampleCount(0),
+      strideReadings(0),
+      strideStart(0),
+      pending(nullptr) {
+    activeVersion[0] = '\0';
+    pendingVersion[0] = '\0';
+    memset(strideSum, 0, sizeof(strideSum));
+    memset(&result, 0, sizeof(result));
+}
+
+void MLRuntime::begin() {
+    errorMutex = xSemaphoreCreateMutex();
+
+    if (!batchKernelsSelfTest()) {
+        Serial.println("[ML] int8 vector kernels disagree with the scalar loop - using scalar");
+    }
+
+    if (!LittleFS.exists(ML_MODEL_DIR)) {
+        LittleFS.mkdir(ML_MODEL_DIR);
+    }
+    LittleFS.remove(ML_TMP_PATH);  // Interrupted download
+
+    // Installed model, or the previous one if it doesn't load
+    const char* paths[2][2] = { { ML_MODEL_PATH, ML_MODEL_META }, { ML_PREV_PATH, ML_PREV_META } };
+    for (auto& candidate : paths) {
+        if (!LittleFS.exists(candidate[0])) {
+            continue;
+        }
+
+        String error;
+        MLModel* model = loadFile(candidate[0], error);
+        if (model == nullptr) {
+            Serial.printf("[ML] %s does not load: %s\n", candidate[0], error.c_str());
+            continue;
+        }
+
+        readMeta(candidate[1], installedId, installedVersion);
+        offer(model, installedVersion);
+        adoptPending();
+        Serial.printf("[ML] Model %s loaded (%u MACs, window %u x %us)\n", installedVersion.c_str(),
+                     (unsigned)model->macCount(), model->header().window, model->header().strideSec);
+        return;
+    }
+
+    Serial.println("[ML] No model installed");
+}
+
+// ============================================================================
+// TASK CONTROL
+// ============================================================================
+
+bool MLRuntime::startUpdate(const String& deviceToken) {
+    if (isUpdating()) {
+        Serial.println("[ML] Model update already in progress");
+        return false;
+    }
+
+    token = deviceToken;
+    setError("");
+    state = ML_UPDATE_CHECKING;
+
+    BaseType_t result = xTaskCreate(
+        updateTask,             // Task function
+        "MLUpdate",             // Task name
+        ML_TASK_STACK_SIZE,     // Stack size (bytes)
+        this,                   // Task parameters
+        1,                      // Priority (1 = low, same as other server tasks)
+        &taskHandle             // Task handle
+    );
+
+    if (result != pdPASS) {
+        setError("Failed to create model update task");
+        Serial.println("[ML] " + getLastError());
+        state = ML_UPDATE_FAILED;
+        taskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void MLRuntime::updateTask(void* parameter) {
+    MLRuntime* self = static_cast<MLRuntime*>(parameter);
+
+    if (self->runUpdate()) {
+        self->state = ML_UPDATE_IDLE;
+    } else if (self->state != ML_UPDATE_IDLE) {
+        Serial.println("[ML] Model update failed: " + self->getLastError());
+        self->state = ML_UPDATE_FAILED;
+    }
+
+    self->taskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// UPDATE SEQUENCE
+// ============================================================================
+
+bool MLRuntime::runUpdate() {
+    MLModelInfo info;
+    if (!fetchModelInfo(info)) {
+        return false;
+    }
+
+    if (info.id == installedId && info.version == installedVersion) {
+        state = ML_UPDATE_IDLE;
+        return false;
+    }
+
+    Serial.printf("[ML] Downloading model %s (%u bytes), sha256 %s\n",
+                 info.version.c_str(), (unsigned)info.size, info.sha256.c_str());
+
+    state = ML_UPDATE_DOWNLOADING;
+    bool ok = downloadModel(info, ML_TMP_PATH) && install(info, ML_TMP_PATH);
+    LittleFS.remove(ML_TMP_PATH);
+    return ok;
+}
+
+bool MLRuntime::fetchModelInfo(MLModelInfo& info) {
+    HTTPClient http;
+    String url = serverUrl.get() + API_MLMODEL_LATEST + "?deviceId=" + String(DEVICE_ID) +
+                 "&currentVersion=" + installedVersion + "&format=tmlm" + String(ML_MODEL_FORMAT);
+
+    http.begin(url);
+    http.addHeader("Authorization", "Bearer " + token);
+    http.setTimeout(ML_HTTP_TIMEOUT);
+
+    int httpCode = http.GET();
+
+    // No model published for this device
+    if (httpCode == HTTP_CODE_NOT_FOUND) {
+        http.end();
+        state = ML_UPDATE_IDLE;
+        return false;
+    }
+
+    if (httpCode != HTTP_CODE_OK) {
+        setError("HTTP error: " + String(httpCode));
+        http.end();
+        return false;
+    }
+
+    String response = http.getString();
+    http.end();
+
+    StaticJsonDocument<768> doc;
+    DeserializationError error = deserializeJson(doc, response);
+
+    if (error) {
+        setError("Invalid model info: " + String(error.c_str()));
+        return false;
+    }
+
+    // Accept {..}, {model: {..}}, {mlmodel: {..}} and {data: {..}}
+    JsonObject model = doc.as<JsonObject>();
+    if (doc.containsKey("model")) {
+        model = doc["model"];
+    } else if (doc.containsKey("mlmodel")) {
+        model = doc["mlmodel"];
+    } else if (doc.containsKey("data")) {
+        model = doc["data"];
+    }
+
+    if (model.isNull()) {
+        state = ML_UPDATE_IDLE;
+        return false;
+    }
+
+    const char* id = model["id"] | (const char*)nullptr;
+    if (id == nullptr) {
+        id = model["_id"] | "";
+    }
+
+    info.id = id;
+    info.version = model["version"] | "";
+    info.version = info.version.substring(0, ML_VERSION_MAX_LENGTH);
+    info.size = model["size"] | (size_t)0;
+    info.sha256 = model["sha256"] | "";
+    info.sha256.toLowerCase();
+
+    if (info.id.length() == 0 || info.size == 0) {
+        setError("Model info missing id or size");
+        return false;
+    }
+
+    if (info.size > ML_MAX_MODEL_SIZE) {
+        setError("Model exceeds ML_MAX_MODEL_SIZE: " + String(info.size));
+        return false;
+    }
+
+    if (info.sha256.length() != 64) {
+        setError("Model info missing sha256 digest");
+        return false;
+    }
+
+    return true;
+}
+
+bool MLRuntime::downloadModel(const MLModelInfo& info, const String& path) {
+    HTTPClient http;
+    String url = serverUrl.get() + API_MLMODEL_DOWNLOAD + "/" + info.id;
+
+    http.begin(url);
+    http.addHeader("Authorization", "Bearer " + token);
+    http.setTimeout(ML_HTTP_TIMEOUT);
+
+    int httpCode = http.GET();
+    if (httpCode != HTTP_CODE_OK) {
+        setError("HTTP error: " + String(httpCode));
+        http.end();
+        return false;
+    }
+
+    File file = LittleFS.open(path, "w");
+    uint8_t* buffer = (uint8_t*)malloc(ML_DOWNLOAD_CHUNK);
+    if (!file || buffer == nullptr) {
+        setError(buffer == nullptr ? "Out of memory" : "Cannot create " + path);
+        free(buffer);
+        http.end();
+        return false;
+    }
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    SHA256_STARTS(&sha);
+
+    // Models are small: a dropped connection fails the update, the next
+    // check starts over
+    WiFiClient* stream = http.getStreamPtr();
+    unsigned long lastData = millis();
+    size_t downloaded = 0;
+    bool ok = true;
+
+    while (downloaded < info.size) {
+        size_t available = stream->available();
+
+        if (available == 0) {
+            if (!http.connected() || millis() - lastData > ML_HTTP_TIMEOUT) {
+                break;
+            }
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+
+        size_t toRead = min(min(available, (size_t)ML_DOWNLOAD_CHUNK), info.size - downloaded);
+        size_t len = stream->readBytes(buffer, toRead);
+        if (len == 0) {
+            continue;
+        }
+        lastData = millis();
+
+        if (file.write(buffer, len) != len) {
+            setError("LittleFS write failed");
+            ok = false;
+            break;
+        }
+        SHA256_UPDATE(&sha, buffer, len);
+        downloaded += len;
+    }
+
+    uint8_t digest[32];
+    SHA256_FINISH(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    free(buffer);
+    file.close();
+    http.end();
+
+    if (!ok) {
+        return false;
+    }
+
+    if (downloaded != info.size) {
+        setError("Download incomplete: " + String(downloaded) + "/" + String(info.size));
+        return false;
+    }
+
+    char digestHex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(digestHex + i * 2, 3, "%02x", digest[i]);
+    }
+
+    if (info.sha256 != digestHex) {
+        setError("SHA-256 mismatch");
+        Serial.printf("[ML] Expected %s, got %s\n", info.sha256.c_str(), digestHex);
+        return false;
+    }
+
+    return true;
+}
+
+bool MLRuntime::install(const MLModelInfo& info, const String& downloadPath) {
+    // Validate before touching the installed model
+    String error;
+    MLModel* model = loadFile(downloadPath, error);
+    if (model == nullptr) {
+        setError("Model rejected: " + error);
+        return false;
+    }
+
+    if (!writeMeta(ML_TMP_META, info)) {
+        delete model;
+        setError("Cannot write model metadata");
+        return false;
+    }
+
+    // model -> prev, download -> model. A power loss in between leaves
+    // either the old model, the new one, or prev (tried when model.bin is missing).
+    if (LittleFS.exists(ML_MODEL_PATH)) {
+        LittleFS.remove(ML_PREV_PATH);
+        LittleFS.remove(ML_PREV_META);
+        LittleFS.rename(ML_MODEL_PATH, ML_PREV_PATH);
+        LittleFS.rename(ML_MODEL_META, ML_PREV_META);
+    }
+
+    if (!LittleFS.rename(downloadPath, ML_MODEL_PATH) || !LittleFS.rename(ML_TMP_META, ML_MODEL_META)) {
+        delete model;
+        setError("Cannot install model file");
+        return false;
+    }
+
+    installedId = info.id;
+    installedVersion = info.version;
+    offer(model, info.version);
+
+    Serial.printf("[ML] Model %s installed (%u MACs, window %u x %us)\n", info.version.c_str(),
+                 (unsigned)model->macCount(), model->header().window, model->header().strideSec);
+    return true;
+}
+
+// ============================================================================
+// MODEL FILES
+// ============================================================================
+
+MLModel* MLRuntime::loadFile(const String& path, String& error) {
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        error = "Cannot open file";
+        return nullptr;
+    }
+
+    size_t size = file.size();
+    if (size > ML_MAX_MODEL_SIZE) {
+        file.close();
+        error = "Model exceeds ML_MAX_MODEL_SIZE";
+        return nullptr;
+    }
+
+    uint8_t* data = (uint8_t*)malloc(size > 0 ? size : 1);
+    if (data == nullptr) {
+        file.close();
+        error = "Out of memory";
+        return nullptr;
+    }
+
+    size_t read = file.read(data, size);
+    file.close();
+
+    MLModel* model = new MLModel();
+    if (read != size) {
+        free(data);
+        data = nullptr;
+    }
+    if (!model->begin(data, size)) {
+        error = data == nullptr ? "Read failed" : model->getError();
+        delete model;
+        return nullptr;
+    }
+    return model;
+}
+
+bool MLRuntime::readMeta(const String& path, String& id, String& version) {
+    id = "";
+    version = "unknown";
+
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    String text = file.readString();
+    file.close();
+
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, text)) {
+        return false;
+    }
+
+    id = doc["id"] | "";
+    version = doc["version"] | "unknown";
+    return true;
+}
+
+bool MLRuntime::writeMeta(const String& path, const MLModelInfo& info) {
+    File file = LittleFS.open(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    StaticJsonDocument<256> doc;
+    doc["id"] = info.id;
+    doc["version"] = info.version;
+    doc["sha256"] = info.sha256;
+    String text;
+    serializeJson(doc, text);
+    bool ok = file.print(text) == text.length();
+    file.close();
+    return ok;
+}
+
+// ============================================================================
+// INFERENCE (loop)
+// ============================================================================
+
+void MLRuntime::offer(MLModel* model, const String& version) {
+    portENTER_CRITICAL(&mux);
+    MLModel* replaced = pending;
+    pending = model;
+    strlcpy(pendingVersion, version.c_str(), sizeof(pendingVersion));
+    portEXIT_CRITICAL(&mux);
+
+    delete replaced;  // Never picked up by the loop
+}
+
+void MLRuntime::adoptPending() {
+    portENTER_CRITICAL(&mux);
+    MLModel* model = pending;
+    pending = nullptr;
+    if (model != nullptr) {
+        strlcpy(activeVersion, pendingVersion, sizeof(activeVersion));
+        memset(&result, 0, sizeof(result));
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (model == nullptr) {
+        return;
+    }
+
+    delete active;
+    active = model;
+
+    // The window is model-specific (stride, channels) - start it over
+    sampleHead = 0;
+    sampleCount = 0;
+    strideReadings = 0;
+    memset(strideSum, 0, sizeof(strideSum));
+    strideStart = millis();
+}
+
+void MLRuntime::addSample(float waterLevel, float currInflow, int pumpStatus) {
+    adoptPending();
+    if (active == nullptr) {
+        return;
+    }
+
+    strideSum[0] += waterLevel;
+    strideSum[1] += currInflow;
+    strideSum[2] += pumpStatus ? 1.0f : 0.0f;
+    strideReadings++;
+
+    if (millis() - strideStart < (unsigned long)active->header().strideSec * 1000UL) {
+        return;
+    }
+
+    for (int c = 0; c < ML_CHANNEL_COUNT; c++) {
+        samples[sampleHead][c] = strideSum[c] / strideReadings;
+        strideSum[c] = 0;
+    }
+    strideReadings = 0;
+    strideStart = millis();
+
+    sampleHead = (sampleHead + 1) % ML_MAX_WINDOW;
+    if (sampleCount < ML_MAX_WINDOW) {
+        sampleCount++;
+    }
+
+    if (sampleCount >= active->header().window) {
+        runInference();
+    }
+}
+
+void MLRuntime::runInference() {
+    const MLModelHeader& head = active->header();
+    float features[ML_MAX_LAYER_WIDTH];
+    int n = 0;
+
+    // Oldest sample first, enabled channels in bit order
+    for (int s = 0; s < head.window; s++) {
+        int slot = (sampleHead - head.window + s + ML_MAX_WINDOW) % ML_MAX_WINDOW;
+        for (int c = 0; c < ML_CHANNEL_COUNT; c++) {
+            if (head.channels & (1 << c)) {
+                features[n++] = (samples[slot][c] - head.channelOffset[c]) * head.channelScale[c];
+            }
+        }
+    }
+
+    float value;
+    int64_t start = esp_timer_get_time();
+    bool ok = active->run(features, value);
+    uint32_t latencyUs = (uint32_t)(esp_timer_get_time() - start);
+
+    if (!ok) {
+        return;
+    }
+
+    portENTER_CRITICAL(&mux);
+    result.valid = true;
+    result.outputKind = head.outputKind;
+    result.horizonSec = head.horizonSec;
+    result.value = value;
+    strlcpy(result.version, activeVersion, sizeof(result.version));
+    result.latencyUs = latencyUs;
+    if (latencyUs > result.maxLatencyUs) {
+        result.maxLatencyUs = latencyUs;
+    }
+    if (latencyUs > ML_LATENCY_BUDGET_US) {
+        result.overruns++;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (latencyUs > ML_LATENCY_BUDGET_US) {
+        Serial.printf("[ML] Inference took %u us (budget %u us)\n", (unsigned)latencyUs, ML_LATENCY_BUDGET_US);
+    }
+    DEBUG_PRINTF("[ML] %s = %.3f (%u us)\n", head.outputKind == ML_OUTPUT_FORECAST ? "Forecast" : "Score",
+                value, (unsigned)latencyUs);
+}
+
+// ============================================================================
+// STATUS
+// ============================================================================
+
+MLResult MLRuntime::getResult() {
+    portENTER_CRITICAL(&mux);
+    MLResult copy = result;
+    portEXIT_CRITICAL(&mux);
+    return copy;
+}
+
+bool MLRuntime::isUpdating() {
+    return state == ML_UPDATE_CHECKING || state == ML_UPDATE_DOWNLOADING;
+}
+
+MLUpdateState MLRuntime::getState() {
+    return state;
+}
+
+String MLRuntime::getLastError() {
+    if (errorMutex == NULL) {
+        return lastError;
+    }
+
+    xSemaphoreTake(errorMutex, portMAX_DELAY);
+    String error = lastError;
+    xSemaphoreGive(errorMutex);
+    return error;
+}
+
+void MLRuntime::setError(const String& error) {
+    if (errorMutex == NULL) {
+        lastError = error;
+        return;
+    }
+
+    xSemaphoreTake(errorMutex, portMAX_DELAY);
+    lastError = error;
+    xSemaphoreGive(errorMutex);
+}
@@ -1,141 +1,522 @@
 #include "ota_updater.h"
-
-OTAUpdater* OTAUpdater::instance = nullptr;
-
-OTAUpdater::OTAUpdater() : updating(false), progress(0), lastError("") {
-    instance = this;
+#include "endpoints.h"
+#include "server_url.h"
+#include "sha256_compat.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+
+OTAUpdater::OTAUpdater()
+    : state(OTA_IDLE),
+      progress(0),
+      lastError(""),
+      taskHandle(NULL),
+      errorMutex(NULL),
+      deltaMode(false),
+      compressedMode(false),
+      imageWritten(0),
+      decodedSink(this) {
 }
 
 void OTAUpdater::begin() {
+    errorMutex = xSemaphoreCreateMutex();
     Serial.println("[OTA] OTA Updater initialized");
 }
 
-void OTAUpdater::onProgress(size_t current, size_t total) {
-    if (instance) {
-        instance->progress = (current * 100) / total;
+// ============================================================================
+// TASK CONTROL
+// ============================================================================
+
+bool OTAUpdater::startUpdate(const String& deviceToken) {
+    if (isUpdating() || state == OTA_SUCCESS) {
+        Serial.println("[OTA] Update already in progress");
+        return false;
+    }
+
+    token = deviceToken;
+    progress = 0;
+    setError("");
+    state = OTA_CHECKING;
+
+    BaseType_t result = xTaskCreate(
+        updateTask,             // Task function
+        "OTAUpdate",            // Task name
+        OTA_TASK_STACK_SIZE,    // Stack size (bytes)
+        this,                   // Task parameters
+        1,                      // Priority (1 = low, same as other server tasks)
+        &taskHandle             // Task handle
+    );
+
+    if (result != pdPASS) {
+        setError("Failed to create OTA task");
+        Serial.println("[OTA] " + getLastError());
+        state = OTA_FAILED;
+        taskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void OTAUpdater::updateTask(void* parameter) {
+    OTAUpdater* self = static_cast<OTAUpdater*>(parameter);
+
+    Serial.println("[OTA] Background update started");
+
+    if (self->runUpdate()) {
+        Serial.println("[OTA] Update verified and installed - restart pending");
+        self->state = OTA_SUCCESS;
+    } else if (self->state != OTA_IDLE) {
+        Serial.println("[OTA] Firmware update failed: " + self->getLastError());
+        self->state = OTA_FAILED;
+    }
+
+    self->taskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// PATCH SOURCE (running partition)
+// ============================================================================
+
+class RunningPartitionSource : public PatchSource {
+public:
+    RunningPartitionSource() : partition(esp_ota_get_running_partition()) {}
+
+    size_t size() override {
+        return partition ? partition->size : 0;
+    }
+
+    bool read(size_t offset, uint8_t* buffer, size_t length) override {
+        return partition && esp_partition_read(partition, offset, buffer, length) == ESP_OK;
+    }
+
+private:
+    const esp_partition_t* partition;
+};
+
+static RunningPartitionSource runningImage;
+
+static bool isHeatshrink(JsonObject obj) {
+    const char* encoding = obj["encoding"] | "";
+    return strcmp(encoding, "heatshrink") == 0;
+}
+
+// ============================================================================
+// UPDATE SEQUENCE
+// ============================================================================
+
+bool OTAUpdater::runUpdate() {
+    Serial.println("[OTA] Checking for firmware update...");
+
+    FirmwareInfo info;
+    if (!fetchFirmwareInfo(info)) {
+        return false;
+    }
+
+    if (info.version.length() > 0 && info.version == FIRMWARE_VERSION) {
+        Serial.println("[OTA] Firmware " + info.version + " already installed");
+        state = OTA_IDLE;
+        return false;
+    }
+
+    Serial.printf("[OTA] Firmware %s (%u bytes, %u to download%s), sha256 %s\n",
+                 info.version.c_str(), (unsigned)info.size, (unsigned)info.transferSize,
+                 info.compressed ? ", heatshrink" : "", info.sha256.c_str());
+
+    // Check if we have enough space
+    if (!Update.begin(info.size)) {
+        setError("Not enough space for update");
+        return false;
+    }
+
+    bool installed = false;
+
+    // Prefer the delta patch when it was built against the running version
+    if (info.patchId.length() > 0 && info.patchBase == FIRMWARE_VERSION) {
+        Serial.printf("[OTA] Using delta patch %s (%u bytes, base %s)\n",
+                     info.patchId.c_str(), (unsigned)info.patchSize, info.patchBase.c_str());
 
-        if (instance->progress % 10 == 0) {
-            Serial.println("[OTA] Progress: " + String(instance->progress) + "%");
+        installed = downloadImage(info, true);
+
+        if (!installed) {
+            Serial.println("[OTA] Delta update failed (" + getLastError() + ") - falling back to full image");
+            Update.abort();
+            setError("");
+            if (!Update.begin(info.size)) {
+                setError("Not enough space for update");
+                return false;
+            }
         }
     }
+
+    if (!installed) {
+        installed = downloadImage(info, false);
+        if (!installed) {
+            Update.abort();
+            return false;
+        }
+    }
+
+    // End update (marks the new partition bootable)
+    if (!Update.end()) {
+        setError("Update end failed: " + String(Update.getError()));
+        return false;
+    }
+
+    if (!Update.isFinished()) {
+        setError("Update not finished");
+        return false;
+    }
+
+    progress = 100;
+    return true;
 }
 
-bool OTAUpdater::downloadAndInstall(const String& url, const String& token) {
+bool OTAUpdater::fetchFirmwareInfo(FirmwareInfo& info) {
     HTTPClient http;
-
-    Serial.println("[OTA] Downloading firmware from: " + url);
+    String url = serverUrl.get() + API_FIRMWARE_LATEST + "?deviceId=" + String(DEVICE_ID) +
+                 "&currentVersion=" + String(FIRMWARE_VERSION) + "&accept=heatshrink" +
+                 "&hsWindow=" + String(HEATSHRINK_WINDOW_BITS) + "&hsLookahead=" + String(HEATSHRINK_LOOKAHEAD_BITS);
 
     http.begin(url);
     http.addHeader("Authorization", "Bearer " + token);
-    http.setTimeout(30000); // 30 second timeout
+    http.setTimeout(OTA_HTTP_TIMEOUT);
 
     int httpCode = http.GET();
 
     if (httpCode != HTTP_CODE_OK) {
-        lastError = "HTTP error: " + String(httpCode);
-        Serial.println("[OTA] " + lastError);
+        setError("HTTP error: " + String(httpCode));
         http.end();
         return false;
     }
 
-    int contentLength = http.getSize();
+    String response = http.getString();
+    http.end();
 
-    if (contentLength <= 0) {
-        lastError = "Invalid content length";
-        Serial.println("[OTA] " + lastError);
-        http.end();
+    StaticJsonDocument<1024> doc;
+    DeserializationError error = deserializeJson(doc, response);
+
+    if (error) {
+        setError("Invalid firmware info: " + String(error.c_str()));
         return false;
     }
 
-    Serial.println("[OTA] Firmware size: " + String(contentLength) + " bytes");
+    // Accept {..}, {firmware: {..}} and {data: {..}}
+    JsonObject fw = doc.as<JsonObject>();
+    if (doc.containsKey("firmware")) {
+        fw = doc["firmware"];
+    } else if (doc.containsKey("data")) {
+        fw = doc["data"];
+    }
 
-    // Check if we have enough space
-    if (!Update.begin(contentLength)) {
-        lastError = "Not enough space for update";
-        Serial.println("[OTA] " + lastError);
-        http.end();
+    const char* id = fw["id"] | (const char*)nullptr;
+    if (id == nullptr) {
+        id = fw["_id"] | "";
+    }
+
+    info.id = id;
+    info.version = fw["version"] | "";
+    info.size = fw["size"] | (size_t)0;
+    info.sha256 = fw["sha256"] | "";
+    info.sha256.toLowerCase();
+
+    // Compressed image: {encoding: "heatshrink", transferSize}
+    info.compressed = isHeatshrink(fw);
+    info.transferSize = info.compressed ? (fw["transferSize"] | (size_t)0) : info.size;
+
+    // Optional delta patch: {patch: {id, size, baseVersion}}
+    JsonObject patch = fw["patch"];
+    info.patchId = patch["id"] | "";
+    info.patchSize = patch["size"] | (size_t)0;
+    info.patchBase = patch["baseVersion"] | "";
+    if (info.patchSize == 0) {
+        info.patchId = "";
+    }
+
+    if (info.transferSize == 0) {
+        setError("Firmware info missing transfer size");
         return false;
     }
 
-    // Set progress callback
-    Update.onProgress(onProgress);
+    if (info.id.length() == 0 || info.size == 0) {
+        setError("Firmware info missing id or size");
+        return false;
+    }
 
-    // Get stream
-    WiFiClient* stream = http.getStreamPtr();
+    if (info.sha256.length() != 64) {
+        setError("Firmware info missing sha256 digest");
+        return false;
+    }
 
-    // Write firmware
-    size_t written = Update.writeStream(*stream);
+    return true;
+}
 
-    if (written != contentLength) {
-        lastError = "Write failed: " + String(written) + "/" + String(contentLength);
-        Serial.println("[OTA] " + lastError);
-        Update.abort();
-        http.end();
+bool OTAUpdater::downloadImage(const FirmwareInfo& info, bool delta) {
+    state = OTA_DOWNLOADING;
+    progress = 0;
+
+    deltaMode = delta;
+    compressedMode = !delta && info.compressed;
+    imageWritten = 0;
+    if (delta) {
+        patcher.begin(&runningImage, this);
+    }
+    if (compressedMode) {
+        decoder.begin(&decodedSink);
+    }
+
+    String url = serverUrl.get() + API_FIRMWARE_DOWNLOAD_ID + "/" + (delta ? info.patchId : info.id);
+    size_t downloadSize = delta ? info.patchSize : info.transferSize;
+
+    mbedtls_sha256_init(&sha);
+    SHA256_STARTS(&sha);
+
+    size_t downloaded = 0;
+    int attempts = 0;
+
+    // Resume from the last downloaded offset until complete, giving up after
+    // OTA_MAX_RESUME_ATTEMPTS rounds in a row without progress
+    while (downloaded < downloadSize && attempts < OTA_MAX_RESUME_ATTEMPTS) {
+        size_t before = downloaded;
+
+        if (!downloadFrom(url, downloadSize, downloaded)) {
+            break;  // Fatal (flash write, bad patch, bad response) - resuming won't help
+        }
+
+        if (downloaded < downloadSize) {
+            attempts = (downloaded > before) ? 1 : attempts + 1;
+            Serial.printf("[OTA] Connection lost at %u/%u bytes - resuming (attempt %d/%d)\n",
+                         (unsigned)downloaded, (unsigned)downloadSize, attempts, OTA_MAX_RESUME_ATTEMPTS);
+            vTaskDelay(pdMS_TO_TICKS(OTA_RESUME_DELAY * attempts));
+        }
+    }
+
+    // Push out the decoder's buffered tail before the digest is taken
+    bool flushed = true;
+    if (downloaded == downloadSize && compressedMode && !decoder.finish()) {
+        if (getLastError().length() == 0) {
+            setError("Decompression error: " + String(decoder.getError()));
+        }
+        flushed = false;
+    }
+    if (downloaded == downloadSize && delta && !patcher.finish()) {
+        if (getLastError().length() == 0) {
+            setError("Patch error: " + String(patcher.getError()));
+        }
+        flushed = false;
+    }
+
+    uint8_t digest[32];
+    SHA256_FINISH(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (!flushed) {
         return false;
     }
 
-    Serial.println("[OTA] Firmware written: " + String(written) + " bytes");
+    if (downloaded != downloadSize) {
+        if (getLastError().length() == 0) {
+            setError("Download incomplete: " + String(downloaded) + "/" + String(downloadSize));
+        }
+        return false;
+    }
 
-    // End update
-    if (!Update.end()) {
-        lastError = "Update end failed: " + String(Update.getError());
-        Serial.println("[OTA] " + lastError);
-        http.end();
+    if ((delta && !patcher.isComplete()) || imageWritten != info.size) {
+        setError("Image size mismatch: " + String(imageWritten) + "/" + String(info.size));
         return false;
     }
 
-    http.end();
+    state = OTA_VERIFYING;
 
-    // Verify update
-    if (Update.isFinished()) {
-        Serial.println("[OTA] Update successfully completed!");
-        return true;
-    } else {
-        lastError = "Update not finished";
-        Serial.println("[OTA] " + lastError);
+    char digestHex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(digestHex + i * 2, 3, "%02x", digest[i]);
+    }
+
+    if (info.sha256 != digestHex) {
+        setError("SHA-256 mismatch");
+        Serial.printf("[OTA] Expected %s, got %s\n", info.sha256.c_str(), digestHex);
         return false;
     }
+
+    Serial.println("[OTA] SHA-256 verified");
+    return true;
 }
 
-bool OTAUpdater::checkAndUpdate(const String& deviceToken) {
-    if (updating) {
-        Serial.println("[OTA] Update already in progress");
+bool OTAUpdater::downloadFrom(const String& url, size_t totalSize, size_t& downloaded) {
+    HTTPClient http;
+
+    http.begin(url);
+    http.addHeader("Authorization", "Bearer " + token);
+    http.setTimeout(OTA_HTTP_TIMEOUT);
+
+    if (downloaded > 0) {
+        http.addHeader("Range", "bytes=" + String(downloaded) + "-");
+    }
+
+    Serial.printf("[OTA] Downloading from offset %u: %s\n", (unsigned)downloaded, url.c_str());
+
+    int httpCode = http.GET();
+
+    // 206 = resumed at 'downloaded'. 200 = whole file (server ignored Range),
+    // skip what was already consumed.
+    size_t skip = 0;
+    if (httpCode == HTTP_CODE_PARTIAL_CONTENT) {
+        skip = 0;
+    } else if (httpCode == HTTP_CODE_OK) {
+        skip = downloaded;
+    } else {
+        Serial.println("[OTA] HTTP error: " + String(httpCode));
+        http.end();
+
+        // Network/server errors are retryable, anything else is fatal
+        if (httpCode > 0 && httpCode < 500) {
+            setError("HTTP error: " + String(httpCode));
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t* buffer = (uint8_t*)malloc(OTA_BUFFER_SIZE);
+    if (buffer == nullptr) {
+        setError("Out of memory");
+        http.end();
         return false;
     }
 
-    updating = true;
-    progress = 0;
-    lastError = "";
+    WiFiClient* stream = http.getStreamPtr();
+    unsigned long lastData = millis();
+    bool ok = true;
+
+    while (downloaded < totalSize) {
+        size_t available = stream->available();
+
+        if (available == 0) {
+            if (!http.connected() || millis() - lastData > OTA_STALL_TIMEOUT) {
+                break;  // Dropped - caller resumes from 'downloaded'
+            }
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
 
-    Serial.println("[OTA] Checking for firmware update...");
+        size_t toRead = min(available, (size_t)OTA_BUFFER_SIZE);
+        size_t len = stream->readBytes(buffer, toRead);
+        if (len == 0) {
+            continue;
+        }
+        lastData = millis();
+
+        uint8_t* data = buffer;
+        if (skip > 0) {
+            size_t skipped = min(skip, len);
+            skip -= skipped;
+            data += skipped;
+            len -= skipped;
+            if (len == 0) {
+                continue;
+            }
+        }
+
+        // Never consume past the announced size
+        len = min(len, totalSize - downloaded);
 
-    // Build firmware URL
-    String firmwareUrl = String(SERVER_URL) + API_FIRMWARE_LATEST;
+        if (!consume(data, len)) {
+            ok = false;
+            break;
+        }
+        downloaded += len;
+
+        int newProgress = (int)((uint64_t)downloaded * 100 / totalSize);
+        if (newProgress != progress) {
+            progress = newProgress;
+            if (progress % 10 == 0) {
+                Serial.println("[OTA] Progress: " + String(progress) + "%");
+            }
+        }
+    }
 
-    // Download and install
-    bool success = downloadAndInstall(firmwareUrl, deviceToken);
+    free(buffer);
+    http.end();
+    return ok;
+}
 
-    updating = false;
+bool OTAUpdater::consume(const uint8_t* data, size_t length) {
+    if (!compressedMode) {
+        return consumeDecoded(data, length);
+    }
 
-    if (success) {
-        Serial.println("[OTA] Firmware update successful, restarting in 3 seconds...");
-        delay(3000);
-        ESP.restart();
-        return true;
-    } else {
-        Serial.println("[OTA] Firmware update failed: " + lastError);
+    if (!decoder.feed(data, length)) {
+        if (getLastError().length() == 0) {
+            setError("Decompression error: " + String(decoder.getError()));
+        }
+        return false;
+    }
+    return true;
+}
+
+bool OTAUpdater::consumeDecoded(const uint8_t* data, size_t length) {
+    if (!deltaMode) {
+        return write(data, length);
+    }
+
+    if (!patcher.feed(data, length)) {
+        if (getLastError().length() == 0) {
+            setError("Patch error: " + String(patcher.getError()));
+        }
+        return false;
+    }
+    return true;
+}
+
+bool OTAUpdater::write(const uint8_t* data, size_t length) {
+    if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+        setError("Flash write failed: " + String(Update.getError()));
         return false;
     }
+
+    SHA256_UPDATE(&sha, data, length);
+    imageWritten += length;
+    return true;
 }
 
+// ============================================================================
+// STATUS
+// ============================================================================
+
 bool OTAUpdater::isUpdating() {
-    return updating;
+    return state == OTA_CHECKING || state == OTA_DOWNLOADING || state == OTA_VERIFYING;
+}
+
+OTAState OTAUpdater::getState() {
+    return state;
 }
 
 int OTAUpdater::getProgress() {
     return progress;
 }
 
+bool OTAUpdater::isRestartPending() {
+    return state == OTA_SUCCESS;
+}
+
 String OTAUpdater::getLastError() {
-    return lastError;
+    if (errorMutex == NULL) {
+        return lastError;
+    }
+
+    xSemaphoreTake(errorMutex, portMAX_DELAY);
+    String error = lastError;
+    xSemaphoreGive(errorMutex);
+    return error;
+}
+
+void OTAUpdater::setError(const String& error) {
+    if (errorMutex == NULL) {
+        lastError = error;
+        return;
+    }
+
+    xSemaphoreTake(errorMutex, portMAX_DELAY);
+    lastError = error;
+    xSemaphoreGive(errorMutex);
 }
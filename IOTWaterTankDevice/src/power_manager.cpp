@@ -0,0 +1,232 @@
+#include "power_manager.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#include "driver/gpio.h"
+#include "soc/soc_caps.h"
+#include <ArduinoJson.h>
+
+// Global instance
+PowerManager powerManager;
+
+PowerManager::PowerManager()
+    : pmConfigured(false),
+      lightSleepEnabled(false),
+#ifdef CONFIG_PM_ENABLE
+      cpuLock(NULL),
+#endif
+      windowStart(0),
+      lastWindowLength(0),
+      bootStart(0),
+      mux(portMUX_INITIALIZER_UNLOCKED) {
+    for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        depth[i] = 0;
+        activeSince[i] = 0;
+        windowActive[i] = 0;
+        bootActive[i] = 0;
+        lastDuty[i] = 0;
+    }
+}
+
+void PowerManager::begin() {
+    bootStart = esp_timer_get_time();
+    windowStart = bootStart;
+
+#ifdef CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pmConfig;
+#else
+    esp_pm_config_esp32s3_t pmConfig;
+#endif
+    pmConfig.max_freq_mhz = POWER_CPU_MAX_MHZ;
+    pmConfig.min_freq_mhz = POWER_CPU_MIN_MHZ;
+    pmConfig.light_sleep_enable = POWER_LIGHT_SLEEP_ENABLED;
+
+    esp_err_t err = esp_pm_configure(&pmConfig);
+    if (err == ESP_ERR_NOT_SUPPORTED && pmConfig.light_sleep_enable) {
+        // Auto light sleep needs tickless idle in the SDK config - keep DFS
+        Serial.println("[Power] Light sleep not supported by this SDK build (no tickless idle) - DFS only");
+        pmConfig.light_sleep_enable = false;
+        err = esp_pm_configure(&pmConfig);
+    }
+
+    if (err != ESP_OK) {
+        Serial.printf("[Power] esp_pm_configure failed (%d) - running at full clock\n", err);
+        return;
+    }
+
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop", &cpuLock) != ESP_OK) {
+        Serial.println("[Power] Failed to create PM lock - running at full clock");
+        cpuLock = NULL;
+        return;
+    }
+
+    pmConfigured = true;
+    lightSleepEnabled = pmConfig.light_sleep_enable;
+
+#if SOC_GPIO_SUPPORT_SLP_SWITCH
+    // Keep driving the relay while in light sleep (no switch to the sleep pin config)
+    gpio_sleep_sel_dis((gpio_num_t)RELAY_PIN);
+#endif
+
+    Serial.printf("[Power] DFS %d-%d MHz, light sleep %s\n", POWER_CPU_MIN_MHZ, POWER_CPU_MAX_MHZ,
+                 lightSleepEnabled ? "ON" : "OFF");
+#else
+    Serial.println("[Power] Power management not in this SDK build (CONFIG_PM_ENABLE) - duty cycle tracking only");
+#endif
+}
+
+// ============================================================================
+// ACTIVITY TRACKING
+// ============================================================================
+
+void PowerManager::beginActivity(PowerSubsystem subsystem) {
+    bool first = false;
+
+    portENTER_CRITICAL(&mux);
+    if (depth[subsystem]++ == 0) {
+        activeSince[subsystem] = esp_timer_get_time();
+        first = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+#ifdef CONFIG_PM_ENABLE
+    if (first && subsystem == POWER_LOOP && pmConfigured) {
+        esp_pm_lock_acquire(cpuLock);
+    }
+#else
+    (void)first;
+#endif
+}
+
+void PowerManager::endActivity(PowerSubsystem subsystem) {
+    bool last = false;
+
+    portENTER_CRITICAL(&mux);
+    if (depth[subsystem] > 0 && --depth[subsystem] == 0) {
+        int64_t active = esp_timer_get_time() - activeSince[subsystem];
+        windowActive[subsystem] += active;
+        bootActive[subsystem] += active;
+        last = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+#ifdef CONFIG_PM_ENABLE
+    if (last && subsystem == POWER_LOOP && pmConfigured) {
+        esp_pm_lock_release(cpuLock);
+    }
+#else
+    (void)last;
+#endif
+}
+
+void PowerManager::setActive(PowerSubsystem subsystem, bool active) {
+    bool running = depth[subsystem] > 0;
+
+    if (active && !running) {
+        beginActivity(subsystem);
+    } else if (!active && running) {
+        endActivity(subsystem);
+    }
+}
+
+// ============================================================================
+// REPORTING
+// ============================================================================
+
+void PowerManager::update() {
+    int64_t now = esp_timer_get_time();
+    if (now - windowStart < (int64_t)POWER_REPORT_INTERVAL * 1000) {
+        return;
+    }
+
+    portENTER_CRITICAL(&mux);
+    int64_t length = now - windowStart;
+    for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        // Running activities are split at the window boundary
+        if (depth[i] > 0) {
+            windowActive[i] += now - activeSince[i];
+            bootActive[i] += now - activeSince[i];
+            activeSince[i] = now;
+        }
+        lastDuty[i] = (float)windowActive[i] / (float)length;
+        windowActive[i] = 0;
+    }
+    windowStart = now;
+    lastWindowLength = length;
+    portEXIT_CRITICAL(&mux);
+
+    Serial.printf("[Power] fw %s, %lus window: loop %.2f%%, sensor %.2f%%, display %.2f%%, network %.2f%% - est. %.1f mA\n",
+                 FIRMWARE_VERSION, (unsigned long)(length / 1000000),
+                 lastDuty[POWER_LOOP] * 100, lastDuty[POWER_SENSOR] * 100,
+                 lastDuty[POWER_DISPLAY] * 100, lastDuty[POWER_NETWORK] * 100,
+                 getEstimatedCurrent());
+}
+
+float PowerManager::getDutyCycle(PowerSubsystem subsystem) {
+    return lastDuty[subsystem];
+}
+
+float PowerManager::getBootDutyCycle(PowerSubsystem subsystem) {
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&mux);
+    int64_t active = bootActive[subsystem];
+    if (depth[subsystem] > 0) {
+        active += now - activeSince[subsystem];
+    }
+    portEXIT_CRITICAL(&mux);
+
+    int64_t length = now - bootStart;
+    return length > 0 ? (float)active / (float)length : 0;
+}
+
+float PowerManager::getEstimatedCurrent() {
+    return estimateCurrent(lastDuty);
+}
+
+// Idle floor (light sleep or DFS idle) + CPU active share + radio share
+float PowerManager::estimateCurrent(const float* duty) {
+    float idle = lightSleepEnabled ? POWER_CURRENT_SLEEP_MA : POWER_CURRENT_IDLE_MA;
+
+    return idle +
+           duty[POWER_LOOP] * (POWER_CURRENT_ACTIVE_MA - idle) +
+           duty[POWER_NETWORK] * POWER_CURRENT_RADIO_MA;
+}
+
+String PowerManager::getReportJson() {
+    StaticJsonDocument<768> doc;
+
+    doc["firmware"] = FIRMWARE_VERSION;
+    doc["pmEnabled"] = pmConfigured;
+    doc["lightSleep"] = lightSleepEnabled;
+    doc["cpuMinMhz"] = POWER_CPU_MIN_MHZ;
+    doc["cpuMaxMhz"] = POWER_CPU_MAX_MHZ;
+    doc["cpuMhz"] = getCpuFrequencyMhz();
+    doc["windowSec"] = (uint32_t)(lastWindowLength / 1000000);
+    doc["estimatedMa"] = getEstimatedCurrent();
+
+    float bootDuty[POWER_SUBSYSTEM_COUNT];
+    JsonObject window = doc.createNestedObject("duty");
+    JsonObject boot = doc.createNestedObject("dutySinceBoot");
+    for (int i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        PowerSubsystem subsystem = (PowerSubsystem)i;
+        bootDuty[i] = getBootDutyCycle(subsystem);
+        window[subsystemName(subsystem)] = lastDuty[i];
+        boot[subsystemName(subsystem)] = bootDuty[i];
+    }
+    doc["estimatedMaSinceBoot"] = estimateCurrent(bootDuty);
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+const char* PowerManager::subsystemName(PowerSubsystem subsystem) {
+    switch (subsystem) {
+        case POWER_LOOP:    return "loop";
+        case POWER_SENSOR:  return "sensor";
+        case POWER_DISPLAY: return "display";
+        case POWER_NETWORK: return "network";
+        default:            return "unknown";
+    }
+}
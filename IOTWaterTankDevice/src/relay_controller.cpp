@@ -5,10 +5,15 @@ RelayController::RelayController()
       currentMode(MODE_AUTO),
       cloudCommand(false),
       hardwareOverride(false),
-      autoModeEnabled(false) {
+      autoModeEnabled(false),
+      savedMode(MODE_AUTO),
+      modeDirty(false),
+      mutex(NULL) {
 }
 
 void RelayController::begin() {
+    mutex = xSemaphoreCreateMutex();
+
     pinMode(RELAY_PIN, OUTPUT);
     digitalWrite(RELAY_PIN, LOW); // Ensure pump is OFF at startup
 
@@ -20,18 +25,32 @@ void RelayController::begin() {
     Serial.println("[Relay] Pump: OFF");
 }
 
+void RelayController::lock() {
+    if (mutex != NULL) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+}
+
+void RelayController::unlock() {
+    if (mutex != NULL) {
+        xSemaphoreGive(mutex);
+    }
+}
+
 void RelayController::loadMode() {
     // Open preferences namespace for reading
     if (!preferences.begin(PREF_NAMESPACE, true)) {
         Serial.println("[Relay] Failed to open preferences for reading");
         autoModeEnabled = true;  // Default to auto mode
         currentMode = MODE_AUTO;
+        savedMode = MODE_AUTO;
         return;
     }
 
     // Load saved auto mode preference
     autoModeEnabled = preferences.getBool(PREF_AUTO_MODE, true);
     currentMode = autoModeEnabled ? MODE_AUTO : MODE_MANUAL;
+    savedMode = currentMode;
 
     // Close preferences namespace
     preferences.end();
@@ -45,7 +64,7 @@ void RelayController::saveMode() {
     }
 
     // Save auto mode preference
-    preferences.putBool(PREF_AUTO_MODE, currentMode == MODE_AUTO);
+    preferences.putBool(PREF_AUTO_MODE, savedMode == MODE_AUTO);
 
     // Close preferences namespace
     preferences.end();
@@ -80,67 +99,92 @@ void RelayController::update(float waterLevel, float upperThreshold, float lower
     // 2. Auto mode (if enabled)
     // 3. Manual/Cloud control
 
-    if (hardwareOverride) {
-        // Hardware override is active - maintain current state
-        // User controls pump directly via BTN6
-        return;
+    lock();
+    bool save = modeDirty;
+    modeDirty = false;
+
+    if (!hardwareOverride) {
+        switch (currentMode) {
+            case MODE_AUTO:
+                handleAutoMode(waterLevel, upperThreshold, lowerThreshold);
+                break;
+
+            case MODE_MANUAL:
+                // In manual mode, pump state is controlled by:
+                // - Cloud commands (setCloudCommand)
+                // - Button presses (setManualPump)
+                // State is already set, no action needed here
+                break;
+
+            case MODE_OVERRIDE:
+                // Override mode - no automatic changes
+                break;
+        }
     }
+    // Hardware override active: maintain current state (user controls the
+    // pump directly via BTN6)
+    unlock();
 
-    switch (currentMode) {
-        case MODE_AUTO:
-            handleAutoMode(waterLevel, upperThreshold, lowerThreshold);
-            break;
-
-        case MODE_MANUAL:
-            // In manual mode, pump state is controlled by:
-            // - Cloud commands (setCloudCommand)
-            // - Button presses (turnOn/turnOff)
-            // State is already set, no action needed here
-            break;
-
-        case MODE_OVERRIDE:
-            // Override mode - no automatic changes
-            break;
+    // Mode changed from a button or the web server since the last update
+    if (save) {
+        saveMode();
     }
 }
 
 void RelayController::turnOn() {
+    lock();
     if (currentMode == MODE_AUTO) {
         Serial.println("[Relay] Cannot manually control in AUTO mode");
-        return;
+    } else {
+        applyPumpState(true);
     }
-
-    applyPumpState(true);
+    unlock();
 }
 
 void RelayController::turnOff() {
+    lock();
     if (currentMode == MODE_AUTO) {
         Serial.println("[Relay] Cannot manually control in AUTO mode");
-        return;
+    } else {
+        applyPumpState(false);
     }
+    unlock();
+}
 
-    applyPumpState(false);
+bool RelayController::setManualPump(bool state) {
+    lock();
+    bool manual = currentMode == MODE_MANUAL;
+    if (manual) {
+        applyPumpState(state);
+    }
+    unlock();
+    return manual;
 }
 
-void RelayController::setMode(PumpMode mode) {
+void RelayController::changeMode(PumpMode mode) {
     if (currentMode != mode) {
         currentMode = mode;
-        saveMode();
+        savedMode = mode;
+        modeDirty = true;
 
         Serial.println("[Relay] Mode changed to: " + getModeString());
     }
 }
 
+void RelayController::setMode(PumpMode mode) {
+    lock();
+    changeMode(mode);
+    unlock();
+}
+
 PumpMode RelayController::getMode() {
     return currentMode;
 }
 
 void RelayController::toggleMode() {
-    if (currentMode == MODE_AUTO) {
-        setMode(MODE_MANUAL);
-    } else {
-        setMode(MODE_AUTO);
-    }
+    lock();
+    changeMode(currentMode == MODE_AUTO ? MODE_MANUAL : MODE_AUTO);
+    unlock();
 }
 
 bool RelayController::isPumpOn() {
@@ -153,6 +197,7 @@ int RelayController::getPumpStatus() {
 }
 
 void RelayController::setCloudCommand(bool state) {
+    lock();
     cloudCommand = state;
 
     if (currentMode == MODE_MANUAL) {
@@ -160,9 +205,11 @@ void RelayController::setCloudCommand(bool state) {
     } else {
         Serial.println("[Relay] Cloud command received but ignored (not in MANUAL mode)");
     }
+    unlock();
 }
 
 void RelayController::setHardwareOverride(bool state) {
+    lock();
     if (hardwareOverride != state) {
         hardwareOverride = state;
 
@@ -170,11 +217,12 @@ void RelayController::setHardwareOverride(bool state) {
             currentMode = MODE_OVERRIDE;
             Serial.println("[Relay] Hardware override activated");
         } else {
-            // Return to previous mode
-            loadMode();
+            // Return to the mode before the override (kept in RAM, no NVS read)
+            currentMode = savedMode;
             Serial.println("[Relay] Hardware override deactivated, returning to " + getModeString());
         }
     }
+    unlock();
 }
 
 bool RelayController::isHardwareOverride() {
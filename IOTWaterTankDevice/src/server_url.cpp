@@ -0,0 +1,135 @@
+#include "server_url.h"
+#include "storage_manager.h"
+
+// Global instance
+ServerUrl serverUrl;
+
+ServerUrl::ServerUrl()
+    : overridden(false),
+      generation(0),
+      mux(portMUX_INITIALIZER_UNLOCKED) {
+    strlcpy(url, SERVER_URL, sizeof(url));
+}
+
+void ServerUrl::begin() {
+    String stored = storageManager.getServerUrl();
+
+    if (stored.length() > 0 && isValid(stored)) {
+        apply(stored, true);
+        Serial.printf("[Server] Using server URL override: %s\n", stored.c_str());
+    } else {
+        if (stored.length() > 0) {
+            Serial.printf("[Server] Ignoring invalid stored server URL: %s\n", stored.c_str());
+        }
+        Serial.printf("[Server] Using server URL: %s\n", SERVER_URL);
+    }
+}
+
+String ServerUrl::get() {
+    char copy[SERVER_URL_MAX_LENGTH + 1];
+    portENTER_CRITICAL(&mux);
+    memcpy(copy, url, sizeof(copy));
+    portEXIT_CRITICAL(&mux);
+    return String(copy);
+}
+
+bool ServerUrl::set(const String& newUrl) {
+    String trimmed = newUrl;
+    trimmed.trim();
+    while (trimmed.endsWith("/")) {
+        trimmed.remove(trimmed.length() - 1);
+    }
+
+    if (trimmed.length() == 0) {
+        storageManager.saveServerUrl("");
+        apply(SERVER_URL, false);
+        Serial.printf("[Server] Server URL reset to default: %s\n", SERVER_URL);
+        return true;
+    }
+
+    if (!isValid(trimmed)) {
+        Serial.printf("[Server] Rejected server URL: %s\n", trimmed.c_str());
+        return false;
+    }
+
+    storageManager.saveServerUrl(trimmed);
+    apply(trimmed, true);
+    Serial.printf("[Server] Server URL set to: %s\n", trimmed.c_str());
+    return true;
+}
+
+bool ServerUrl::isOverridden() {
+    portENTER_CRITICAL(&mux);
+    bool result = overridden;
+    portEXIT_CRITICAL(&mux);
+    return result;
+}
+
+void ServerUrl::apply(const String& newUrl, bool override) {
+    portENTER_CRITICAL(&mux);
+    strlcpy(url, newUrl.c_str(), sizeof(url));
+    overridden = override;
+    generation++;
+    portEXIT_CRITICAL(&mux);
+}
+
+// ============================================================================
+// PARSING
+// ============================================================================
+
+bool ServerUrl::parseHostPort(const String& fullUrl, String& host, uint16_t& port) {
+    String rest = fullUrl;
+    port = 80;
+
+    int schemeEnd = rest.indexOf("://");
+    if (schemeEnd >= 0) {
+        if (rest.startsWith("https")) {
+            port = 443;
+        }
+        rest = rest.substring(schemeEnd + 3);
+    }
+
+    int pathStart = rest.indexOf('/');
+    if (pathStart >= 0) {
+        rest = rest.substring(0, pathStart);
+    }
+
+    int portStart = rest.indexOf(':');
+    if (portStart >= 0) {
+        long value = rest.substring(portStart + 1).toInt();
+        if (value <= 0 || value > 65535) {
+            return false;
+        }
+        port = (uint16_t)value;
+        rest = rest.substring(0, portStart);
+    }
+
+    host = rest;
+    return host.length() > 0;
+}
+
+bool ServerUrl::isValid(const String& candidate) {
+    if (candidate.length() > SERVER_URL_MAX_LENGTH) {
+        return false;
+    }
+    if (!candidate.startsWith("https://")) {
+#ifdef SERVER_URL_OVERRIDE
+        // Mock backends (sim --serve) speak plain HTTP
+        if (!candidate.startsWith("http://")) {
+            return false;
+        }
+#else
+        return false;  // Credentials and OTA images would go out in the clear
+#endif
+    }
+    for (unsigned int i = 0; i < candidate.length(); i++) {
+        char c = candidate[i];
+        if (c <= ' ' || c == '"' || c == '?' || c == '#') {
+            return false;
+        }
+    }
+
+    String host;
+    uint16_t port;
+    return parseHostPort(candidate, host, port);
+}
@@ -1,16 +1,41 @@
 #include "storage_manager.h"
 #include "config.h"
+#include "handle_config_data.h"
+#include "handle_control_data.h"
+#include "crc32.h"
+
+// Snapshot slots live in their own namespace so a wipe of "devcfg" or
+// "watertank" never touches them
+#define SNAPSHOT_NAMESPACE "syncsnap"
+static const char* SNAPSHOT_SLOT_KEYS[2] = { "snapA", "snapB" };
 
 // Global instance
 StorageManager storageManager;
 
-StorageManager::StorageManager() {
+StorageManager::StorageManager()
+    : snapshotSequence(0),
+      snapshotCrc(0),
+      snapshotSlot(-1),
+      snapshotMutex(NULL) {
 }
 
 void StorageManager::begin() {
+    snapshotMutex = xSemaphoreCreateMutex();
     DEBUG_PRINTLN("[Storage] Storage Manager initialized");
 }
 
+void StorageManager::lockSnapshot() {
+    if (snapshotMutex != NULL) {
+        xSemaphoreTake(snapshotMutex, portMAX_DELAY);
+    }
+}
+
+void StorageManager::unlockSnapshot() {
+    if (snapshotMutex != NULL) {
+        xSemaphoreGive(snapshotMutex);
+    }
+}
+
 bool StorageManager::openNamespace(const char* ns, bool readOnly) {
     return prefs.begin(ns, readOnly);
 }
@@ -71,6 +96,92 @@ void StorageManager::clearWiFiCredentials() {
     DEBUG_PRINTLN("[Storage] Cleared WiFi credentials");
 }
 
+bool StorageManager::loadWiFiProfile(int slot, String& ssid, String& password) {
+    if (slot == 0) {
+        return loadWiFiCredentials(ssid, password);
+    }
+
+    if (!openNamespace("wificfg", true)) {
+        return false;
+    }
+
+    ssid = prefs.getString(("ssid" + String(slot)).c_str(), "");
+    password = prefs.getString(("pass" + String(slot)).c_str(), "");
+
+    closeNamespace();
+
+    return ssid.length() > 0;
+}
+
+void StorageManager::saveWiFiProfile(int slot, const String& ssid, const String& password) {
+    if (slot == 0) {
+        saveWiFiCredentials(ssid, password);
+        return;
+    }
+
+    if (!openNamespace("wificfg", false)) {
+        DEBUG_PRINTLN("[Storage] Failed to open wificfg namespace");
+        return;
+    }
+
+    prefs.putString(("ssid" + String(slot)).c_str(), ssid);
+    prefs.putString(("pass" + String(slot)).c_str(), password);
+
+    closeNamespace();
+
+    DEBUG_PRINTF("[Storage] Saved WiFi profile %d: %s\n", slot, ssid.c_str());
+}
+
+void StorageManager::clearWiFiProfile(int slot) {
+    if (slot == 0) {
+        clearWiFiCredentials();
+        return;
+    }
+
+    if (!openNamespace("wificfg", false)) {
+        return;
+    }
+
+    prefs.remove(("ssid" + String(slot)).c_str());
+    prefs.remove(("pass" + String(slot)).c_str());
+
+    closeNamespace();
+
+    DEBUG_PRINTF("[Storage] Cleared WiFi profile %d\n", slot);
+}
+
+bool StorageManager::loadWiFiConnectionCache(WiFiConnectionCache& cache) {
+    if (!openNamespace("wificfg", true)) {
+        return false;
+    }
+
+    size_t length = prefs.getBytes(PREF_WIFI_CACHE, &cache, sizeof(cache));
+    closeNamespace();
+
+    return length == sizeof(cache) && cache.channel > 0;
+}
+
+void StorageManager::saveWiFiConnectionCache(const WiFiConnectionCache& cache) {
+    if (!openNamespace("wificfg", false)) {
+        DEBUG_PRINTLN("[Storage] Failed to open wificfg namespace");
+        return;
+    }
+
+    prefs.putBytes(PREF_WIFI_CACHE, &cache, sizeof(cache));
+    closeNamespace();
+
+    DEBUG_PRINTF("[Storage] Saved WiFi connection cache (channel %d)\n", (int)cache.channel);
+}
+
+void StorageManager::clearWiFiConnectionCache() {
+    if (!openNamespace("wificfg", false)) {
+        return;
+    }
+
+    prefs.remove(PREF_WIFI_CACHE);
+    closeNamespace();
+}
+
 // ============================================================================
 // Dashboard Credentials
 // ============================================================================
@@ -197,6 +308,38 @@ void StorageManager::saveHardwareId(const String& hardwareId) {
     DEBUG_PRINTF("[Storage] Saved hardware ID: %s\n", hardwareId.c_str());
 }
 
+// ============================================================================
+// Backend Server URL
+// ============================================================================
+
+String StorageManager::getServerUrl() {
+    if (!openNamespace(PREF_NAMESPACE, true)) {
+        DEBUG_PRINTLN("[Storage] Failed to open namespace");
+        return "";
+    }
+
+    String url = prefs.getString(PREF_SERVER_URL, "");
+    closeNamespace();
+
+    return url;
+}
+
+void StorageManager::saveServerUrl(const String& url) {
+    if (!openNamespace(PREF_NAMESPACE, false)) {
+        DEBUG_PRINTLN("[Storage] Failed to open namespace");
+        return;
+    }
+
+    if (url.length() > 0) {
+        prefs.putString(PREF_SERVER_URL, url);
+    } else {
+        prefs.remove(PREF_SERVER_URL);
+    }
+    closeNamespace();
+
+    DEBUG_PRINTF("[Storage] Saved server URL: %s\n", url.length() > 0 ? url.c_str() : "(default)");
+}
+
 // ============================================================================
 // Auto Mode
 // ============================================================================
@@ -329,6 +472,55 @@ void StorageManager::saveOverflowCount(uint32_t count) {
     closeNamespace();
 }
 
+float StorageManager::getClockDrift() {
+    if (!openNamespace(PREF_NAMESPACE, true)) {
+        return 0.0f;
+    }
+
+    float driftPpm = prefs.getFloat(PREF_CLOCK_DRIFT, 0.0f);
+    closeNamespace();
+
+    return driftPpm;
+}
+
+void StorageManager::saveClockDrift(float driftPpm) {
+    if (!openNamespace(PREF_NAMESPACE, false)) {
+        return;
+    }
+
+    prefs.putFloat(PREF_CLOCK_DRIFT, driftPpm);
+    closeNamespace();
+}
+
+// ============================================================================
+// Leak Detector Baseline
+// ============================================================================
+
+bool StorageManager::loadLeakBaseline(float& baselineLph, uint32_t& learnedWindows) {
+    if (!openNamespace(PREF_NAMESPACE, true)) {
+        return false;
+    }
+
+    bool exists = prefs.isKey(PREF_LEAK_BASELINE);
+    if (exists) {
+        baselineLph = prefs.getFloat(PREF_LEAK_BASELINE, 0.0f);
+        learnedWindows = prefs.getUInt(PREF_LEAK_LEARNED, 0);
+    }
+    closeNamespace();
+
+    return exists;
+}
+
+void StorageManager::saveLeakBaseline(float baselineLph, uint32_t learnedWindows) {
+    if (!openNamespace(PREF_NAMESPACE, false)) {
+        return;
+    }
+
+    prefs.putFloat(PREF_LEAK_BASELINE, baselineLph);
+    prefs.putUInt(PREF_LEAK_LEARNED, learnedWindows);
+    closeNamespace();
+}
+
 // ============================================================================
 // WiFi Configured Flag
 // ============================================================================
@@ -356,30 +548,10 @@ void StorageManager::setWiFiConfigured(bool configured) {
 }
 
 // ============================================================================
-// DEVICE CONFIGURATION PERSISTENCE
+// DEVICE CONFIGURATION PERSISTENCE (legacy per-key layout)
 // ============================================================================
-
-void StorageManager::saveDeviceConfig(float upperThreshold, float lowerThreshold,
-                                      float tankHeight, float tankWidth, const String& tankShape) {
-    if (!openNamespace("devcfg", false)) {
-        return;
-    }
-
-    prefs.putFloat("upperThr", upperThreshold);
-    prefs.putFloat("lowerThr", lowerThreshold);
-    prefs.putFloat("tankH", tankHeight);
-    prefs.putFloat("tankW", tankWidth);
-    prefs.putString("tankShape", tankShape);
-
-    closeNamespace();
-
-    DEBUG_PRINTLN("[Storage] Device config saved to NVS:");
-    DEBUG_PRINTF("  Upper Threshold: %.2f\n", upperThreshold);
-    DEBUG_PRINTF("  Lower Threshold: %.2f\n", lowerThreshold);
-    DEBUG_PRINTF("  Tank Height: %.2f\n", tankHeight);
-    DEBUG_PRINTF("  Tank Width: %.2f\n", tankWidth);
-    DEBUG_PRINTF("  Tank Shape: %s\n", tankShape.c_str());
-}
+// Written by firmware before the sync snapshot existed. Only read at boot to
+// migrate into the first snapshot.
 
 bool StorageManager::loadDeviceConfig(float& upperThreshold, float& lowerThreshold,
                                       float& tankHeight, float& tankWidth, String& tankShape) {
@@ -422,3 +594,158 @@ bool StorageManager::hasDeviceConfig() {
 
     return hasConfig;
 }
+
+// ============================================================================
+// SYNC STATE SNAPSHOT
+// ============================================================================
+
+bool StorageManager::readSnapshotSlot(int slot, SyncSnapshot& snapshot) {
+    const char* key = SNAPSHOT_SLOT_KEYS[slot];
+
+    size_t length = snapshotPrefs.getBytesLength(key);
+    if (length != sizeof(SyncSnapshot) && length != SYNC_SNAPSHOT_V1_LENGTH) {
+        return false;
+    }
+
+    uint8_t raw[sizeof(SyncSnapshot)];
+    if (snapshotPrefs.getBytes(key, raw, length) != length) {
+        return false;
+    }
+
+    SyncSnapshotHeader header;
+    memcpy(&header, raw, sizeof(header));
+    uint16_t expectedVersion = (length == sizeof(SyncSnapshot)) ? SYNC_SNAPSHOT_VERSION : 1;
+    if (header.magic != SYNC_SNAPSHOT_MAGIC ||
+        header.version != expectedVersion ||
+        header.length != length) {
+        DEBUG_PRINTF("[Storage] Snapshot slot %s has unknown layout (version %u)\n",
+                     key, header.version);
+        return false;
+    }
+
+    if (crc32Compute(raw + sizeof(header), length - sizeof(header)) != header.crc) {
+        DEBUG_PRINTF("[Storage] Snapshot slot %s failed CRC check\n", key);
+        return false;
+    }
+
+    if (length == sizeof(SyncSnapshot)) {
+        memcpy(&snapshot, raw, sizeof(SyncSnapshot));
+        return true;
+    }
+
+    // Version 1: heartbeatSec was added at the end of the config part.
+    // Leaving every source unset lets the next merge take the default
+    // (and the next server value) without claiming a local change.
+    const size_t configV1 = sizeof(ConfigSnapshot) - sizeof(SyncFloatRecord);
+    memset(&snapshot, 0, sizeof(snapshot));
+    memcpy(&snapshot.header, &header, sizeof(header));
+    memcpy(&snapshot.config, raw + sizeof(header), configV1);
+    memcpy(&snapshot.control, raw + sizeof(header) + configV1, sizeof(ControlSnapshot));
+    SyncFloatRecord& heartbeat = snapshot.config.heartbeatSec;
+    heartbeat.api_value = heartbeat.local_value = heartbeat.value = TELEMETRY_HEARTBEAT_INTERVAL / 1000;
+    return true;
+}
+
+bool StorageManager::loadSyncSnapshot(ConfigDataHandler& config, ControlDataHandler& control) {
+    lockSnapshot();
+    if (!snapshotPrefs.begin(SNAPSHOT_NAMESPACE, true)) {
+        DEBUG_PRINTLN("[Storage] No sync snapshot namespace");
+        snapshotSlot = -1;
+        unlockSnapshot();
+        return false;
+    }
+
+    SyncSnapshot slots[2];
+    bool valid[2];
+    valid[0] = readSnapshotSlot(0, slots[0]);
+    valid[1] = readSnapshotSlot(1, slots[1]);
+
+    snapshotPrefs.end();
+
+    int newest = -1;
+    if (valid[0] && valid[1]) {
+        // Sequence comparison is wrap-safe
+        newest = ((int32_t)(slots[1].header.sequence - slots[0].header.sequence) > 0) ? 1 : 0;
+    } else if (valid[0]) {
+        newest = 0;
+    } else if (valid[1]) {
+        newest = 1;
+    }
+
+    if (newest < 0) {
+        DEBUG_PRINTLN("[Storage] No valid sync snapshot found");
+        snapshotSlot = -1;
+        unlockSnapshot();
+        return false;
+    }
+
+    const SyncSnapshot& snapshot = slots[newest];
+    config.fromSnapshot(snapshot.config);
+    control.fromSnapshot(snapshot.control);
+
+    snapshotSlot = newest;
+    snapshotSequence = snapshot.header.sequence;
+    snapshotCrc = snapshot.header.crc;
+
+    DEBUG_PRINTF("[Storage] Sync snapshot restored from slot %s (seq %u)\n",
+                 SNAPSHOT_SLOT_KEYS[newest], snapshotSequence);
+    unlockSnapshot();
+    return true;
+}
+
+bool StorageManager::saveSyncSnapshot(const ConfigDataHandler& config, const ControlDataHandler& control) {
+    // The loop, the server tasks and AsyncTCP all save. Without the lock two
+    // saves can pick the same slot and leave the sequence/CRC bookkeeping
+    // describing the other one's data.
+    lockSnapshot();
+    bool saved = writeSyncSnapshot(config, control);
+    unlockSnapshot();
+    return saved;
+}
+
+bool StorageManager::writeSyncSnapshot(const ConfigDataHandler& config, const ControlDataHandler& control) {
+    SyncSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));  // Deterministic padding for CRC
+
+    config.toSnapshot(snapshot.config);
+    control.toSnapshot(snapshot.control);
+
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(&snapshot.config);
+    size_t payloadLength = sizeof(SyncSnapshot) - sizeof(SyncSnapshotHeader);
+    uint32_t crc = crc32Compute(payload, payloadLength);
+
+    // Skip the flash write if nothing changed since the last snapshot
+    if (snapshotSlot >= 0 && crc == snapshotCrc) {
+        return true;
+    }
+
+    // Always write the slot NOT holding the newest snapshot
+    int targetSlot = (snapshotSlot == 0) ? 1 : 0;
+
+    snapshot.header.magic = SYNC_SNAPSHOT_MAGIC;
+    snapshot.header.version = SYNC_SNAPSHOT_VERSION;
+    snapshot.header.length = sizeof(SyncSnapshot);
+    snapshot.header.sequence = snapshotSequence + 1;
+    snapshot.header.crc = crc;
+
+    if (!snapshotPrefs.begin(SNAPSHOT_NAMESPACE, false)) {
+        DEBUG_PRINTLN("[Storage] Failed to open syncsnap namespace");
+        return false;
+    }
+
+    size_t written = snapshotPrefs.putBytes(SNAPSHOT_SLOT_KEYS[targetSlot], &snapshot, sizeof(snapshot));
+    snapshotPrefs.end();
+
+    if (written != sizeof(snapshot)) {
+        DEBUG_PRINTF("[Storage] Failed to write sync snapshot slot %s\n", SNAPSHOT_SLOT_KEYS[targetSlot]);
+        return false;
+    }
+
+    snapshotSlot = targetSlot;
+    snapshotSequence = snapshot.header.sequence;
+    snapshotCrc = crc;
+
+    DEBUG_PRINTF("[Storage] Sync snapshot saved to slot %s (seq %u, %u bytes)\n",
+                 SNAPSHOT_SLOT_KEYS[targetSlot], snapshotSequence, (unsigned)sizeof(snapshot));
+    return true;
+}
@@ -1,11 +1,22 @@
 #include "telemetry.h"
 #include "endpoints.h"
+#include "server_url.h"
+#include "handle_config_data.h"
+
+// Synced heartbeat (defined in main.cpp)
+extern ConfigDataHandler configHandler;
 
 // ============================================================================
 // CONSTRUCTOR
 // ============================================================================
 
-TelemetryManager::TelemetryManager() {
+TelemetryManager::TelemetryManager() : unauthorized(false) {
+}
+
+bool TelemetryManager::consumeUnauthorized() {
+    bool result = unauthorized;
+    unauthorized = false;
+    return result;
 }
 
 // ============================================================================
@@ -24,14 +35,37 @@ void TelemetryManager::setHardwareId(const String& id) {
 // TELEMETRY OPERATIONS
 // ============================================================================
 
-bool TelemetryManager::uploadTelemetry(float waterLevel, float currInflow, int pumpStatus) {
-    String payload = buildTelemetryPayload(waterLevel, currInflow, pumpStatus);
+bool TelemetryManager::uploadTelemetry(float waterLevel, float currInflow, int pumpStatus,
+                                       const MLResult* ml, const LeakStatus* leak) {
+    String payload = buildTelemetryPayload(waterLevel, currInflow, pumpStatus, ml, leak);
     String response;
 
     // Single attempt for telemetry to avoid blocking
     return httpRequest("POST", API_DEVICE_TELEMETRY, payload, response, 1);
 }
 
+bool TelemetryManager::uploadLeakAlarm(float waterLevel, float currInflow, int pumpStatus,
+                                       const LeakStatus& leak) {
+    String payload = buildTelemetryPayload(waterLevel, currInflow, pumpStatus, nullptr, &leak,
+                                           leak.alarm ? "leakAlarm" : "leakCleared");
+    String response;
+
+    // Runs in its own task, so it can afford the full retry sequence
+    return httpRequest("POST", API_DEVICE_TELEMETRY, payload, response);
+}
+
+bool TelemetryManager::uploadTelemetryBatch(const TelemetryRecord* records, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+
+    String payload = buildTelemetryBatchPayload(records, count);
+    String response;
+
+    DEBUG_PRINTF("[Telemetry] Uploading backlog batch of %u records\n", (unsigned)count);
+    return httpRequest("POST", API_DEVICE_TELEMETRY_BATCH, payload, response, 1);
+}
+
 // ============================================================================
 // HELPER METHODS
 // ============================================================================
@@ -45,7 +79,7 @@ bool TelemetryManager::httpRequest(const String& method, const String& endpoint,
     while (attempt < retries) {
         attempt++;
 
-        String url = String(SERVER_URL) + endpoint;
+        String url = serverUrl.get() + endpoint;
         http.begin(url);
         http.addHeader("Content-Type", "application/json");
         http.setTimeout(HTTP_TIMEOUT);
@@ -73,6 +107,11 @@ bool TelemetryManager::httpRequest(const String& method, const String& endpoint,
             if (httpCode >= 200 && httpCode < 300) {
                 DEBUG_PRINTF("[Telemetry] Upload successful (HTTP %d)\n", httpCode);
                 return true;
+            } else if (httpCode == 401) {
+                // Token expired or revoked - retrying with it cannot succeed
+                Serial.println("[Telemetry] Unauthorized (401) - token rejected");
+                unauthorized = true;
+                return false;
             } else {
                 DEBUG_PRINTF("[Telemetry] Upload failed (HTTP %d): %s\n",
                            httpCode, response.c_str());
@@ -100,11 +139,22 @@ void TelemetryManager::addAuthHeader(HTTPClient& http) {
     DEBUG_PRINTLN("[Telemetry] Added JWT Authorization header");
 }
 
-String TelemetryManager::buildTelemetryPayload(float waterLevel, float currInflow, int pumpStatus) {
+String TelemetryManager::buildTelemetryPayload(float waterLevel, float currInflow, int pumpStatus,
+                                               const MLResult* ml, const LeakStatus* leak,
+                                               const char* event) {
     StaticJsonDocument<2048> doc;
 
     doc["deviceId"] = DEVICE_ID;
 
+    // Uploads are sent on change - at most this long passes between them
+    doc["heartbeatSec"] = configHandler.getHeartbeatMs() / 1000;
+
+    // Alarm uploads: the backend handles these ahead of regular telemetry
+    if (event != nullptr) {
+        doc["priority"] = "high";
+        doc["event"] = event;
+    }
+
     // Backend expects telemetry data with named keys (not array)
     JsonObject telemetryData = doc.createNestedObject("sensorData");
 
@@ -137,6 +187,63 @@ String TelemetryManager::buildTelemetryPayload(float waterLevel, float currInflo
     status["type"] = "number";
     status["value"] = 1;
 
+    // On-device model output (anomaly score or level forecast)
+    if (ml != nullptr && ml->valid) {
+        bool forecast = ml->outputKind == ML_OUTPUT_FORECAST;
+        JsonObject output = telemetryData.createNestedObject(forecast ? "mlForecast" : "mlScore");
+        output["key"] = forecast ? "mlForecast" : "mlScore";
+        output["label"] = forecast ? "Level Forecast" : "Anomaly Score";
+        output["type"] = "number";
+        output["value"] = ml->value;
+
+        JsonObject model = doc.createNestedObject("mlModel");
+        model["version"] = ml->version;
+        if (forecast) {
+            model["horizonSec"] = ml->horizonSec;
+        }
+        model["latencyUs"] = ml->latencyUs;
+        model["maxLatencyUs"] = ml->maxLatencyUs;
+        model["overruns"] = ml->overruns;
+    }
+
+    // Leak detector (night flow vs the learned baseline)
+    if (leak != nullptr) {
+        if (!leak->learning) {
+            JsonObject alarm = telemetryData.createNestedObject("leakAlarm");
+            alarm["key"] = "leakAlarm";
+            alarm["label"] = "Leak Alarm";
+            alarm["type"] = "number";
+            alarm["value"] = leak->alarm ? 1 : 0;
+        }
+
+        JsonObject detector = doc.createNestedObject("leak");
+        detector["state"] = leak->learning ? "learning" : (leak->alarm ? "alarm" : "ok");
+        detector["nightFlowLph"] = leak->nightFlowLph;
+        detector["baselineLph"] = leak->baselineLph;
+        detector["cusum"] = leak->cusum;
+    }
+
+    String payload;
+    serializeJson(doc, payload);
+    return payload;
+}
+
+String TelemetryManager::buildTelemetryBatchPayload(const TelemetryRecord* records, size_t count) {
+    StaticJsonDocument<2048> doc;
+
+    doc["deviceId"] = DEVICE_ID;
+
+    // Compact per-record form - the timestamp is when the sample was taken,
+    // not when it reached the server
+    JsonArray list = doc.createNestedArray("records");
+    for (size_t i = 0; i < count; i++) {
+        JsonObject record = list.createNestedObject();
+        record["timestamp"] = records[i].timestamp;
+        record["waterLevel"] = records[i].waterLevel;
+        record["currInflow"] = records[i].currInflow;
+        record["pumpStatus"] = records[i].pumpStatus;
+    }
+
     String payload;
     serializeJson(doc, payload);
     return payload;
@@ -0,0 +1,338 @@
+#include "telemetry_queue.h"
+#include "crc32.h"
+#include <LittleFS.h>
+
+// Global instance
+TelemetryQueue telemetryQueue;
+
+#define CURSOR_MAGIC 0x52435154UL  // "TQCR"
+
+struct TelemetryCursor {
+    uint32_t magic;
+    uint32_t segment;
+    uint32_t index;
+    uint32_t crc;
+};
+
+// ============================================================================
+// CONSTRUCTOR
+// ============================================================================
+
+TelemetryQueue::TelemetryQueue()
+    : mounted(false),
+      mutex(NULL),
+      headSegment(0),
+      headCount(0),
+      cursorSegment(0),
+      cursorIndex(0),
+      droppedCount(0) {
+}
+
+// ============================================================================
+// INITIALIZATION / RECOVERY
+// ============================================================================
+
+bool TelemetryQueue::begin() {
+    if (mutex == NULL) {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    // Format on first use (partition never mounted before)
+    if (!LittleFS.begin(true)) {
+        Serial.println("[TelemetryQueue] ERROR: Failed to mount LittleFS");
+        mounted = false;
+        return false;
+    }
+
+    if (!LittleFS.exists(TELEMETRY_QUEUE_DIR)) {
+        LittleFS.mkdir(TELEMETRY_QUEUE_DIR);
+    }
+
+    // Find oldest and newest segment on flash
+    bool found = false;
+    uint32_t minSegment = 0;
+    uint32_t maxSegment = 0;
+
+    File dir = LittleFS.open(TELEMETRY_QUEUE_DIR);
+    if (dir && dir.isDirectory()) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            String name = entry.name();
+            int slash = name.lastIndexOf('/');
+            if (slash >= 0) {
+                name = name.substring(slash + 1);
+            }
+            if (name.endsWith(".seg")) {
+                uint32_t id = (uint32_t)strtoul(name.c_str(), nullptr, 10);
+                if (!found || id < minSegment) minSegment = id;
+                if (!found || id > maxSegment) maxSegment = id;
+                found = true;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+
+    mounted = true;
+
+    if (!found) {
+        headSegment = 0;
+        headCount = 0;
+        cursorSegment = 0;
+        cursorIndex = 0;
+        saveCursor();
+        Serial.println("[TelemetryQueue] Initialized (empty)");
+        return true;
+    }
+
+    headSegment = maxSegment;
+
+    // A partial record at the end of the head segment means power was lost
+    // mid-append. Readers ignore the fragment; new appends go to a fresh
+    // segment so records stay aligned.
+    File head = LittleFS.open(segmentPath(headSegment), "r");
+    size_t headSize = head ? head.size() : 0;
+    if (head) head.close();
+
+    headCount = headSize / sizeof(TelemetryRecord);
+    if (headSize % sizeof(TelemetryRecord) != 0) {
+        Serial.printf("[TelemetryQueue] Torn record in segment %u - starting new segment\n", headSegment);
+        headSegment++;
+        headCount = 0;
+    }
+
+    if (!loadCursor() || cursorSegment < minSegment || cursorSegment > headSegment) {
+        // Lost or stale checkpoint - resume from the oldest data on flash
+        cursorSegment = minSegment;
+        cursorIndex = 0;
+        saveCursor();
+    }
+
+    Serial.printf("[TelemetryQueue] Recovered: segments %u..%u, cursor %u:%u, ~%u records pending\n",
+                  cursorSegment, headSegment, cursorSegment, cursorIndex, pendingCount());
+    return true;
+}
+
+// ============================================================================
+// APPEND
+// ============================================================================
+
+bool TelemetryQueue::append(uint64_t timestamp, float waterLevel, float currInflow, int pumpStatus) {
+    if (!mounted) {
+        return false;
+    }
+
+    TelemetryRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timestamp;
+    record.waterLevel = waterLevel;
+    record.currInflow = currInflow;
+    record.pumpStatus = pumpStatus ? 1 : 0;
+    record.crc = recordCrc(record);
+
+    if (xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    // Rotate to a new segment when the head is full
+    if (headCount >= TELEMETRY_QUEUE_SEGMENT_RECORDS) {
+        headSegment++;
+        headCount = 0;
+    }
+
+    // Enforce the size bound before writing into a new segment
+    while (headSegment - cursorSegment + 1 > TELEMETRY_QUEUE_MAX_SEGMENTS) {
+        evictOldest();
+    }
+
+    bool ok = false;
+    File file = LittleFS.open(segmentPath(headSegment), "a");
+    if (file) {
+        ok = file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+        file.close();
+    }
+
+    if (ok) {
+        headCount++;
+    } else {
+        Serial.println("[TelemetryQueue] ERROR: Failed to append record");
+    }
+
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+void TelemetryQueue::evictOldest() {
+    // Caller holds the mutex
+    uint32_t lost = segmentRecordCount(cursorSegment);
+    lost = (lost > cursorIndex) ? lost - cursorIndex : 0;
+
+    LittleFS.remove(segmentPath(cursorSegment));
+    droppedCount += lost;
+
+    Serial.printf("[TelemetryQueue] Queue full - evicted segment %u (%u records)\n", cursorSegment, lost);
+
+    cursorSegment++;
+    cursorIndex = 0;
+    saveCursor();
+}
+
+// ============================================================================
+// READ / CONSUME
+// ============================================================================
+
+size_t TelemetryQueue::peek(TelemetryRecord* out, size_t maxRecords, size_t* slotsRead) {
+    *slotsRead = 0;
+    if (!mounted || maxRecords == 0) {
+        return 0;
+    }
+
+    if (xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    dropDrainedSegments();
+
+    size_t valid = 0;
+    uint32_t available = segmentRecordCount(cursorSegment);
+
+    if (available > cursorIndex) {
+        File file = LittleFS.open(segmentPath(cursorSegment), "r");
+        if (file && file.seek(cursorIndex * sizeof(TelemetryRecord))) {
+            size_t toRead = min((size_t)(available - cursorIndex), maxRecords);
+            for (size_t i = 0; i < toRead; i++) {
+                TelemetryRecord record;
+                if (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+                    break;
+                }
+                (*slotsRead)++;
+
+                if (record.crc != recordCrc(record)) {
+                    Serial.printf("[TelemetryQueue] Skipping corrupt record %u:%u\n",
+                                  cursorSegment, cursorIndex + (uint32_t)i);
+                    continue;
+                }
+                out[valid++] = record;
+            }
+        }
+        if (file) file.close();
+    }
+
+    xSemaphoreGive(mutex);
+    return valid;
+}
+
+void TelemetryQueue::consume(size_t slots) {
+    if (!mounted || slots == 0) {
+        return;
+    }
+
+    if (xSemaphoreTake(mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    cursorIndex += slots;
+    dropDrainedSegments();
+
+    saveCursor();
+    xSemaphoreGive(mutex);
+}
+
+void TelemetryQueue::dropDrainedSegments() {
+    // Caller holds the mutex. A segment that is fully read and no longer
+    // appended to is deleted; the cursor moves to the next one.
+    while (cursorSegment < headSegment && cursorIndex >= segmentRecordCount(cursorSegment)) {
+        LittleFS.remove(segmentPath(cursorSegment));
+        cursorSegment++;
+        cursorIndex = 0;
+    }
+}
+
+uint32_t TelemetryQueue::pendingCount() {
+    if (!mounted) {
+        return 0;
+    }
+
+    // Non-head segments are assumed full (a torn segment may hold fewer)
+    uint32_t total = (headSegment - cursorSegment) * TELEMETRY_QUEUE_SEGMENT_RECORDS + headCount;
+    if (cursorSegment == headSegment) {
+        total = headCount;
+    }
+    return (total > cursorIndex) ? total - cursorIndex : 0;
+}
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+String TelemetryQueue::segmentPath(uint32_t segment) {
+    char path[40];
+    snprintf(path, sizeof(path), "%s/%08u.seg", TELEMETRY_QUEUE_DIR, segment);
+    return String(path);
+}
+
+uint32_t TelemetryQueue::segmentRecordCount(uint32_t segment) {
+    if (segment == headSegment) {
+        return headCount;
+    }
+
+    File file = LittleFS.open(segmentPath(segment), "r");
+    if (!file) {
+        return 0;
+    }
+    uint32_t count = file.size() / sizeof(TelemetryRecord);
+    file.close();
+    return count;
+}
+
+bool TelemetryQueue::loadCursor() {
+    File file = LittleFS.open(String(TELEMETRY_QUEUE_DIR) + "/cursor", "r");
+    if (!file) {
+        return false;
+    }
+
+    TelemetryCursor cursor;
+    bool ok = file.read(reinterpret_cast<uint8_t*>(&cursor), sizeof(cursor)) == sizeof(cursor);
+    file.close();
+
+    if (!ok || cursor.magic != CURSOR_MAGIC ||
+        cursor.crc != crc32Compute(reinterpret_cast<const uint8_t*>(&cursor), offsetof(TelemetryCursor, crc))) {
+        Serial.println("[TelemetryQueue] Cursor checkpoint invalid");
+        return false;
+    }
+
+    cursorSegment = cursor.segment;
+    cursorIndex = cursor.index;
+    return true;
+}
+
+bool TelemetryQueue::saveCursor() {
+    TelemetryCursor cursor;
+    cursor.magic = CURSOR_MAGIC;
+    cursor.segment = cursorSegment;
+    cursor.index = cursorIndex;
+    cursor.crc = crc32Compute(reinterpret_cast<const uint8_t*>(&cursor), offsetof(TelemetryCursor, crc));
+
+    // Write-then-rename keeps the previous checkpoint valid until the new one is complete
+    String tmpPath = String(TELEMETRY_QUEUE_DIR) + "/cursor.tmp";
+    String path = String(TELEMETRY_QUEUE_DIR) + "/cursor";
+
+    File file = LittleFS.open(tmpPath, "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = file.write(reinterpret_cast<const uint8_t*>(&cursor), sizeof(cursor)) == sizeof(cursor);
+    file.close();
+
+    if (!ok) {
+        return false;
+    }
+
+    // LittleFS rename atomically replaces the existing checkpoint
+    return LittleFS.rename(tmpPath, path);
+}
+
+uint32_t TelemetryQueue::recordCrc(const TelemetryRecord& record) {
+    return crc32Compute(reinterpret_cast<const uint8_t*>(&record), offsetof(TelemetryRecord, crc));
+}
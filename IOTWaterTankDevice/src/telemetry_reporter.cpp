@@ -0,0 +1,84 @@
+#include "telemetry_reporter.h"
+
+TelemetryReporter::TelemetryReporter()
+    : samples(0),
+      level(0),
+      inflowRecent{0, 0, 0},
+      inflowAvg(0),
+      pump(0),
+      heartbeatMs(TELEMETRY_HEARTBEAT_INTERVAL),
+      reportedAt(0),
+      hasReported(false),
+      reportedLevel(0),
+      reportedInflow(0),
+      reportedPump(0) {
+}
+
+void TelemetryReporter::addSample(float waterLevel, float currInflow, int pumpStatus) {
+    level = waterLevel;
+    pump = pumpStatus;
+
+    inflowRecent[0] = inflowRecent[1];
+    inflowRecent[1] = inflowRecent[2];
+    inflowRecent[2] = currInflow;
+    if (samples < 3) {
+        samples++;
+        inflowAvg = currInflow;     // Warm-up: follow the raw value
+        return;
+    }
+
+    float a = inflowRecent[0];
+    float b = inflowRecent[1];
+    float c = inflowRecent[2];
+    float median = fmaxf(fminf(a, b), fminf(fmaxf(a, b), c));
+    inflowAvg += TELEMETRY_INFLOW_SMOOTHING * (median - inflowAvg);
+}
+
+TelemetryReason TelemetryReporter::check(unsigned long now) const {
+    unsigned long since = now - reportedAt;
+    if (since < TELEMETRY_MIN_INTERVAL) {
+        return TELEMETRY_REPORT_NONE;
+    }
+    if (since >= heartbeatMs) {
+        return TELEMETRY_REPORT_HEARTBEAT;
+    }
+
+    // Nothing to compare with before the first (scheduled) report
+    if (!hasReported || samples == 0) {
+        return TELEMETRY_REPORT_NONE;
+    }
+
+    if (pump != reportedPump) {
+        return TELEMETRY_REPORT_PUMP;
+    }
+    if (fabsf(level - reportedLevel) >= TELEMETRY_LEVEL_DEADBAND) {
+        return TELEMETRY_REPORT_LEVEL;
+    }
+    if (fabsf(inflowAvg - reportedInflow) >= TELEMETRY_INFLOW_DEADBAND) {
+        return TELEMETRY_REPORT_INFLOW;
+    }
+    return TELEMETRY_REPORT_NONE;
+}
+
+void TelemetryReporter::markReported(unsigned long now) {
+    reportedAt = now;
+    hasReported = true;
+    reportedLevel = level;
+    reportedInflow = inflowAvg;
+    reportedPump = pump;
+}
+
+void TelemetryReporter::scheduleReport(unsigned long now, unsigned long delayMs) {
+    // Backdate the last report so the heartbeat falls due after delayMs
+    reportedAt = now - heartbeatMs + delayMs;
+}
+
+const char* TelemetryReporter::reasonName(TelemetryReason reason) {
+    switch (reason) {
+        case TELEMETRY_REPORT_PUMP:      return "pump";
+        case TELEMETRY_REPORT_LEVEL:     return "level";
+        case TELEMETRY_REPORT_INFLOW:    return "inflow";
+        case TELEMETRY_REPORT_HEARTBEAT: return "heartbeat";
+        default:                         return "none";
+    }
+}
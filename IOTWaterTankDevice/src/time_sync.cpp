@@ -0,0 +1,142 @@
+#include "time_sync.h"
+#include "endpoints.h"
+#include "server_url.h"
+#include "esp_timer.h"
+
+// ============================================================================
+// CONSTRUCTOR
+// ============================================================================
+
+TimeSyncManager::TimeSyncManager() {
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+void TimeSyncManager::setToken(const String& token) {
+    deviceToken = token;
+}
+
+// ============================================================================
+// TIME OPERATIONS
+// ============================================================================
+
+bool TimeSyncManager::fetchServerTime(HttpTimeSample& sample) {
+    HTTPClient http;
+    http.setReuse(true);  // Keep-alive: only the first sample pays for the TCP handshake
+
+    bool found = false;
+
+    for (int i = 0; i < HTTP_TIME_SYNC_SAMPLES; i++) {
+        HttpTimeSample current;
+        if (!takeSample(http, current)) {
+            continue;
+        }
+
+        DEBUG_PRINTF("[TimeSync] Sample %d: server %llu ms, RTT %u ms\n", i + 1, current.serverTime, current.rtt);
+
+        if (!found || current.rtt < sample.rtt) {
+            sample = current;
+            found = true;
+        }
+    }
+
+    http.end();
+
+    if (!found) {
+        Serial.println("[TimeSync] No valid time sample from server");
+        return false;
+    }
+
+    if (sample.rtt > HTTP_TIME_SYNC_MAX_RTT) {
+        Serial.printf("[TimeSync] Best RTT %u ms exceeds limit (%u ms) - rejecting\n",
+                     sample.rtt, (unsigned)HTTP_TIME_SYNC_MAX_RTT);
+        return false;
+    }
+
+    Serial.printf("[TimeSync] Server time %llu ms (RTT %u ms, +/- %u ms)\n",
+                 sample.serverTime, sample.rtt, sample.rtt / 2);
+    return true;
+}
+
+uint64_t TimeSyncManager::localMillis() {
+    return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+// ============================================================================
+// HELPER METHODS
+// ============================================================================
+
+bool TimeSyncManager::takeSample(HTTPClient& http, HttpTimeSample& sample) {
+    String url = serverUrl.get() + API_TIME_SYNC + "?deviceId=" + String(DEVICE_ID);
+    http.begin(url);
+    http.setTimeout(HTTP_TIMEOUT);
+
+    if (deviceToken.length() > 0) {
+        http.addHeader("Authorization", "Bearer " + deviceToken);
+    }
+
+    uint64_t t0 = localMillis();
+    int httpCode = http.GET();
+    uint64_t t1 = localMillis();
+
+    if (httpCode != 200) {
+        if (httpCode > 0) {
+            Serial.printf("[TimeSync] Request failed (HTTP %d)\n", httpCode);
+        } else {
+            Serial.println("[TimeSync] HTTP error: " + http.errorToString(httpCode));
+        }
+        return false;
+    }
+
+    // Reading the body is not part of the round trip
+    String response = http.getString();
+
+    uint64_t serverTime = 0;
+    if (!parseServerTime(response, serverTime)) {
+        return false;
+    }
+
+    uint32_t rtt = (uint32_t)(t1 - t0);
+    sample.serverTime = serverTime + rtt / 2;
+    sample.localMillis = t1;
+    sample.rtt = rtt;
+    return true;
+}
+
+bool TimeSyncManager::parseServerTime(const String& json, uint64_t& serverTime) {
+    // Only the time fields are needed - the response may carry device data too
+    StaticJsonDocument<128> filter;
+    filter["serverTime"] = true;
+    filter["timestamp"] = true;
+    filter["data"]["serverTime"] = true;
+
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, json, DeserializationOption::Filter(filter));
+
+    if (error) {
+        Serial.println("[TimeSync] JSON parse error: " + String(error.c_str()));
+        return false;
+    }
+
+    serverTime = doc["serverTime"] | (uint64_t)0;
+    if (serverTime == 0) {
+        serverTime = doc["data"]["serverTime"] | (uint64_t)0;
+    }
+    if (serverTime == 0) {
+        serverTime = doc["timestamp"] | (uint64_t)0;
+    }
+
+    // Accept seconds as well as milliseconds
+    if (serverTime > 0 && serverTime < 10000000000ULL) {
+        serverTime *= 1000ULL;
+    }
+
+    if (serverTime <= MIN_VALID_TIMESTAMP) {
+        Serial.printf("[TimeSync] Invalid server time: %llu\n", serverTime);
+        return false;
+    }
+
+    return true;
+}
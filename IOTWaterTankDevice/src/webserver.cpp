@@ -7,6 +7,8 @@
 #include "display_manager.h"
 #include "storage_manager.h"
 #include "calculate_level.h"
+#include "power_manager.h"
+#include "server_url.h"
 
 // External references to global handlers (defined in main.cpp)
 extern ControlDataHandler controlHandler;
@@ -32,6 +34,7 @@ WebServer::WebServer()
       levelCalculator(nullptr),
       pumpCallback(nullptr),
       wifiSaveCallback(nullptr),
+      provisioningStatusCallback(nullptr),
       configSyncCallback(nullptr),
       controlSyncCallback(nullptr),
       timestampSyncCallback(nullptr) {
@@ -54,9 +57,25 @@ void WebServer::begin(const String& devId, APIClient* apiCli) {
     Serial.println("  POST /" + deviceId + "/config         - Update device configuration from app");
     Serial.println("  GET  /" + deviceId + "/timestamp      - Get device timestamp and sync status");
     Serial.println("  POST /" + deviceId + "/timestamp      - Sync device time from app (auto-detects seconds/millis)");
+    Serial.println("  GET  /" + deviceId + "/power          - Duty cycle and estimated current");
     Serial.println("  GET  /" + deviceId + "/status         - Provisioning status");
     Serial.println("  GET  /" + deviceId + "/scanWifi       - Scan WiFi networks");
-    Serial.println("  POST /" + deviceId + "/save           - Save WiFi credentials");
+    Serial.println("  POST /" + deviceId + "/save           - Save WiFi credentials (starts provisioning job)");
+    Serial.println("  GET  /" + deviceId + "/provisionStatus - Provisioning job progress");
+    Serial.println("  GET  /" + deviceId + "/wifiProfiles   - WiFi profiles with connect statistics");
+    Serial.println("  POST /" + deviceId + "/wifiProfiles   - Add/replace/remove a WiFi profile");
+    Serial.println("  GET  /" + deviceId + "/server         - Backend server URL");
+#ifdef SERVER_URL_OVERRIDE
+    Serial.println("  POST /" + deviceId + "/server         - Point the device at another backend");
+#endif
+}
+
+// Request handler of the POST routes: the body handler answers, but it only
+// runs when there is a body - without one the request would never complete
+static void rejectEmptyBody(AsyncWebServerRequest* request) {
+    if (request->contentLength() == 0) {
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"EMPTY_BODY\"}");
+    }
 }
 
 void WebServer::setupRoutes() {
@@ -83,9 +102,7 @@ void WebServer::setupRoutes() {
 
     // POST /{device_id}/control - Update control data from app
     server.on(controlEndpoint.c_str(), HTTP_POST,
-        [](AsyncWebServerRequest* request) {
-            // Response will be sent in body handler
-        },
+        rejectEmptyBody,
         NULL,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
             handlePostControl(request, data, len, index, total);
@@ -100,9 +117,7 @@ void WebServer::setupRoutes() {
 
     // POST /{device_id}/config - Update device configuration from app
     server.on(configEndpoint.c_str(), HTTP_POST,
-        [](AsyncWebServerRequest* request) {
-            // Response will be sent in body handler
-        },
+        rejectEmptyBody,
         NULL,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
             handlePostDeviceConfig(request, data, len, index, total);
@@ -117,15 +132,19 @@ void WebServer::setupRoutes() {
 
     // POST /{device_id}/timestamp - Set device timestamp (time correction from app)
     server.on(timestampEndpoint.c_str(), HTTP_POST,
-        [](AsyncWebServerRequest* request) {
-            // Response will be sent in body handler
-        },
+        rejectEmptyBody,
         NULL,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
             handlePostTimestamp(request, data, len, index, total);
         }
     );
 
+    // GET /{device_id}/power - Duty cycle per subsystem and estimated current
+    String powerEndpoint = "/" + deviceId + "/power";
+    server.on(powerEndpoint.c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(200, "application/json", powerManager.getReportJson());
+    });
+
     // ========================================================================
     // PROVISIONING ENDPOINTS (WiFi setup mode)
     // ========================================================================
@@ -145,21 +164,84 @@ void WebServer::setupRoutes() {
     // POST /{device_id}/save - Save WiFi and dashboard credentials
     String saveEndpoint = "/" + deviceId + "/save";
     server.on(saveEndpoint.c_str(), HTTP_POST,
-        [](AsyncWebServerRequest* request) {
-            // Response will be sent in body handler
-        },
+        rejectEmptyBody,
         NULL,
         [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
             handleSaveCredentials(request, data, len, index, total);
         }
     );
 
+    // GET /{device_id}/provisionStatus - Progress of the job started by /save
+    String provisionStatusEndpoint = "/" + deviceId + "/provisionStatus";
+    server.on(provisionStatusEndpoint.c_str(), HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleProvisionJobStatus(request);
+    });
+
+    // GET /{device_id}/wifiProfiles - Stored networks with connect statistics
+    String profilesEndpoint = "/" + deviceId + "/wifiProfiles";
+    server.on(profilesEndpoint.c_str(), HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleGetWiFiProfiles(request);
+    });
+
+    // POST /{device_id}/wifiProfiles - Add/replace ({slot, ssid, password}) or remove ({slot, remove: true})
+    server.on(profilesEndpoint.c_str(), HTTP_POST,
+        rejectEmptyBody,
+        NULL,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            handlePostWiFiProfile(request, data, len, index, total);
+        }
+    );
+
+    // GET /{device_id}/server - Backend URL in use
+    String serverEndpoint = "/" + deviceId + "/server";
+    server.on(serverEndpoint.c_str(), HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleGetServerUrl(request);
+    });
+
+#ifdef SERVER_URL_OVERRIDE
+    // POST /{device_id}/server - Override the backend URL ({url, username, password})
+    server.on(serverEndpoint.c_str(), HTTP_POST,
+        rejectEmptyBody,
+        NULL,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            handlePostServerUrl(request, data, len, index, total);
+        }
+    );
+#endif
+
     // 404 handler
     server.onNotFound([this](AsyncWebServerRequest* request) {
         handleNotFound(request);
     });
 }
 
+bool WebServer::collectBody(AsyncWebServerRequest* request, String& buffer, uint8_t* data,
+                            size_t len, size_t index, size_t total) {
+    // total comes from Content-Length: refuse before buffering anything
+    if (total > WEB_MAX_BODY_SIZE) {
+        if (index == 0) {
+            Serial.printf("[WebServer] Body too large (%u bytes), rejected\n", (unsigned)total);
+            request->send(413, "application/json", "{\"success\":false,\"error\":\"BODY_TOO_LARGE\"}");
+        }
+        return false;
+    }
+
+    if (index == 0) {
+        buffer = "";  // Start of new request
+        buffer.reserve(total);
+    } else if (index != buffer.length()) {
+        // Another request on the same route started in between
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"INCOMPLETE_BODY\"}");
+        buffer = "";
+        return false;
+    }
+
+    // Chunks are not NUL-terminated
+    buffer.concat((const char*)data, len);
+
+    return index + len >= total;
+}
+
 // ========================================================================
 // PROVISIONING HANDLERS
 // ========================================================================
@@ -178,6 +260,24 @@ void WebServer::handleProvisioningStatus(AsyncWebServerRequest* request) {
     request->send(200, "application/json", response);
 }
 
+void WebServer::handleProvisionJobStatus(AsyncWebServerRequest* request) {
+    // GET /{device_id}/provisionStatus - Poll the job started by /save
+    StaticJsonDocument<512> doc;
+    JsonObject status = doc.to<JsonObject>();
+
+    if (provisioningStatusCallback != nullptr) {
+        provisioningStatusCallback(status);
+    } else {
+        status["jobId"] = 0;
+        status["state"] = "idle";
+    }
+
+    String response;
+    serializeJson(doc, response);
+
+    request->send(200, "application/json", response);
+}
+
 void WebServer::handleScanWiFi(AsyncWebServerRequest* request) {
     // GET /{device_id}/scanWifi - Scan and return available networks
     Serial.println("[WebServer] GET /" + deviceId + "/scanWifi - Scanning networks...");
@@ -195,13 +295,18 @@ void WebServer::handleScanWiFi(AsyncWebServerRequest* request) {
 
 void WebServer::handleSaveCredentials(AsyncWebServerRequest* request, uint8_t* data,
                                      size_t len, size_t index, size_t total) {
-    // POST /{device_id}/save - Save credentials and attempt connection
+    // POST /{device_id}/save - Queue a provisioning job and return at once
+    // (connect, login and config fetch run outside the AsyncTCP task)
     Serial.println("[WebServer] POST /" + deviceId + "/save");
 
-    String body = String((char*)data).substring(0, len);
+    static String body;
+    if (!collectBody(request, body, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
+    }
 
     StaticJsonDocument<1024> doc;
     DeserializationError error = deserializeJson(doc, body);
+    body = "";  // The document holds copies of the strings
 
     if (error) {
         request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid JSON\"}");
@@ -230,34 +335,169 @@ void WebServer::handleSaveCredentials(AsyncWebServerRequest* request, uint8_t* d
         return;
     }
 
+    // 802.11 limits - WiFi.begin() would refuse them later
+    if (ssid.length() > 32 || password.length() > 64) {
+        request->send(400, "application/json",
+                     "{\"success\":false,\"message\":\"SSID or password too long\"}");
+        Serial.println("[WebServer] SSID or password too long");
+        return;
+    }
+
     Serial.println("[WebServer] Received credentials:");
     Serial.println("  SSID: " + ssid);
     Serial.println("  Dashboard User: " + dashUser);
 
-    // Save credentials to NVS using new function-based API
-    saveWiFiCredentials(ssid.c_str(), password.c_str());
-
-    if (dashUser.length() > 0 && dashPass.length() > 0) {
-        saveDashboardCredentials(dashUser.c_str(), dashPass.c_str());
-    }
+    uint32_t jobId = 0;
 
-    // Call callback if set (for main.cpp to handle connection)
     if (wifiSaveCallback != nullptr) {
-        wifiSaveCallback(ssid, password, dashUser, dashPass);
+        // main.cpp saves the credentials when it starts the job
+        jobId = wifiSaveCallback(ssid, password, dashUser, dashPass);
+
+        if (jobId == 0) {
+            request->send(409, "application/json",
+                         "{\"success\":false,\"message\":\"Provisioning already in progress\"}");
+            Serial.println("[WebServer] Provisioning busy - credentials not saved");
+            return;
+        }
+    } else {
+        // No provisioning handler - just store the credentials
+        saveWiFiCredentials(ssid.c_str(), password.c_str());
+
+        if (dashUser.length() > 0 && dashPass.length() > 0) {
+            saveDashboardCredentials(dashUser.c_str(), dashPass.c_str());
+        }
     }
 
     // Send success response
     StaticJsonDocument<1024> responseDoc;
     responseDoc["success"] = true;
     responseDoc["message"] = "Connecting to WiFi...";
+    responseDoc["jobId"] = jobId;
+    responseDoc["statusUrl"] = "/" + deviceId + "/provisionStatus";
 
     String response;
     serializeJson(responseDoc, response);
 
+    request->send(200, "application/json", response);  // 200 - existing apps check for it
+
+    Serial.printf("[WebServer] Provisioning job %u queued\n", jobId);
+}
+
+void WebServer::handleGetWiFiProfiles(AsyncWebServerRequest* request) {
+    // GET /{device_id}/wifiProfiles - Profiles in priority order with statistics
+    Serial.println("[WebServer] GET /" + deviceId + "/wifiProfiles");
+
+    String response = "{\"maxProfiles\":" + String(WIFI_MAX_PROFILES) +
+                      ",\"profiles\":" + getWiFiProfilesJson() + "}";
+
     request->send(200, "application/json", response);
+}
+
+void WebServer::handlePostWiFiProfile(AsyncWebServerRequest* request, uint8_t* data,
+                                      size_t len, size_t index, size_t total) {
+    // POST /{device_id}/wifiProfiles - Add/replace or remove one profile
+    Serial.println("[WebServer] POST /" + deviceId + "/wifiProfiles");
+
+    static String body;
+    if (!collectBody(request, body, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
+    }
+
+    StaticJsonDocument<512> doc;
+    DeserializationError error = deserializeJson(doc, body);
+    body = "";  // The document holds copies of the strings
 
-    Serial.println("[WebServer] Credentials saved, attempting to connect...");
+    if (error) {
+        request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid JSON\"}");
+        Serial.println("[WebServer] Invalid JSON");
+        return;
+    }
+
+    int slot = doc["slot"] | -1;
+    if (slot < 0 || slot >= WIFI_MAX_PROFILES) {
+        request->send(400, "application/json",
+                     "{\"success\":false,\"message\":\"Invalid slot\"}");
+        return;
+    }
+
+    // The loop applies the change (profiles are read by the connection logic)
+    bool remove = doc["remove"] | false;
+    String ssid = doc["ssid"] | "";
+    String password = doc["password"] | "";
+    if (!queueWiFiProfileEdit(slot, ssid.c_str(), password.c_str(), remove)) {
+        request->send(400, "application/json",
+                     "{\"success\":false,\"message\":\"Profile not changed (empty or too long SSID, or slot 0 removal)\"}");
+        return;
+    }
+
+    request->send(200, "application/json",
+                 "{\"success\":true,\"message\":\"Profile change queued - GET wifiProfiles shows it once applied\"}");
+
+    Serial.println("[WebServer] WiFi profile " + String(slot) + " change queued");
+}
+
+void WebServer::handleGetServerUrl(AsyncWebServerRequest* request) {
+    // GET /{device_id}/server - Current backend URL and the build default
+    Serial.println("[WebServer] GET /" + deviceId + "/server");
+
+    StaticJsonDocument<384> doc;
+    doc["url"] = serverUrl.get();
+    doc["default"] = SERVER_URL;
+    doc["overridden"] = serverUrl.isOverridden();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+#ifdef SERVER_URL_OVERRIDE
+void WebServer::handlePostServerUrl(AsyncWebServerRequest* request, uint8_t* data,
+                                    size_t len, size_t index, size_t total) {
+    // POST /{device_id}/server - {url} switches backends, "" restores SERVER_URL.
+    // The device logs in to whatever backend this names, so the request has
+    // to carry the dashboard login it would be handing over.
+    Serial.println("[WebServer] POST /" + deviceId + "/server");
+
+    static String body;
+    if (!collectBody(request, body, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
+    }
+
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, body);
+    body = "";  // The document holds copies of the strings
+
+    if (error || !doc["url"].is<const char*>()) {
+        request->send(400, "application/json", "{\"success\":false,\"message\":\"Invalid JSON\"}");
+        Serial.println("[WebServer] Invalid JSON");
+        return;
+    }
+
+    String dashUser, dashPass;
+    if (!getDashboardCredentials(dashUser, dashPass) ||
+        !doc["username"].is<const char*>() || !doc["password"].is<const char*>() ||
+        dashUser != doc["username"].as<const char*>() || dashPass != doc["password"].as<const char*>()) {
+        request->send(401, "application/json",
+                     "{\"success\":false,\"message\":\"Dashboard username and password required\"}");
+        Serial.println("[WebServer] Server URL change refused: bad credentials");
+        return;
+    }
+
+    if (!serverUrl.set(doc["url"].as<String>())) {
+        request->send(400, "application/json",
+                     "{\"success\":false,\"message\":\"Invalid URL (http(s)://host[:port][/path])\"}");
+        return;
+    }
+
+    // The old backend's token means nothing to the new one
+    if (apiClient) {
+        apiClient->invalidateSession();
+    }
+
+    String response = "{\"success\":true,\"url\":\"" + serverUrl.get() + "\"}";
+    request->send(200, "application/json", response);
 }
+#endif
 
 // ========================================================================
 // NEW DEVICE ENDPOINT HANDLERS
@@ -352,19 +592,8 @@ void WebServer::handlePostControl(AsyncWebServerRequest* request, uint8_t* data,
 
     // Accumulate full request body
     static String jsonBuffer;
-
-    if (index == 0) {
-        jsonBuffer = "";  // Start of new request
-    }
-
-    // Append chunk
-    for (size_t i = 0; i < len; i++) {
-        jsonBuffer += (char)data[i];
-    }
-
-    // Wait for complete body
-    if (index + len < total) {
-        return;  // More chunks coming
+    if (!collectBody(request, jsonBuffer, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
     }
 
     // Parse incoming control data from app
@@ -414,6 +643,11 @@ void WebServer::handlePostControl(AsyncWebServerRequest* request, uint8_t* data,
     // Perform 3-way merge (API vs Local vs Self)
     bool changed = controlHandler.merge();
 
+    // Persist full sync state so the merge outcome survives a reboot
+    if (storageManager != nullptr) {
+        storageManager->saveSyncSnapshot(configHandler, controlHandler);
+    }
+
     // Trigger pump callback with merged value
     if (hasPumpSwitch && pumpCallback != nullptr) {
         bool mergedPumpValue = controlHandler.getPumpSwitch();
@@ -589,19 +823,8 @@ void WebServer::handlePostDeviceConfig(AsyncWebServerRequest* request, uint8_t*
 
     // Accumulate full request body
     static String jsonBuffer;
-
-    if (index == 0) {
-        jsonBuffer = "";  // Start of new request
-    }
-
-    // Append chunk
-    for (size_t i = 0; i < len; i++) {
-        jsonBuffer += (char)data[i];
-    }
-
-    // Wait for complete body
-    if (index + len < total) {
-        return;  // More chunks coming
+    if (!collectBody(request, jsonBuffer, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
     }
 
     // Parse incoming config from app
@@ -653,6 +876,17 @@ void WebServer::handlePostDeviceConfig(AsyncWebServerRequest* request, uint8_t*
     bool localAutoUpdate = doc["auto_update"]["value"] | configHandler.getAutoUpdate();
     uint64_t localAutoUpdateTs = doc["auto_update"]["lastModified"] | currentTime;
 
+    // Thresholds and tank size feed the pump logic directly - refuse the
+    // whole update rather than store a value it cannot work with
+    if (!ConfigDataHandler::isPlausible(localUpperThreshold, localLowerThreshold,
+                                        localTankHeight, localTankWidth,
+                                        localUsedTotal, localMaxInflow)) {
+        Serial.println("[WebServer] Rejected implausible config values");
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"INVALID_CONFIG\"}");
+        jsonBuffer = "";
+        return;
+    }
+
     // Update handler with values from Local (app webserver)
     configHandler.updateFromLocal(
         localUpperThreshold, localUpperThresholdTs,
@@ -693,6 +927,8 @@ void WebServer::handlePostDeviceConfig(AsyncWebServerRequest* request, uint8_t*
         deviceConfig.ipAddressLastModified = configHandler.getIpAddressTimestamp();
         deviceConfig.auto_update = configHandler.getAutoUpdate();
         deviceConfig.autoUpdateLastModified = configHandler.getAutoUpdateTimestamp();
+        deviceConfig.heartbeatSec = configHandler.getHeartbeatSec();
+        deviceConfig.heartbeatSecLastModified = configHandler.getHeartbeatSecTimestamp();
         xSemaphoreGive(configMutex);
     }
 
@@ -735,18 +971,11 @@ void WebServer::handlePostDeviceConfig(AsyncWebServerRequest* request, uint8_t*
                 configHandler.getLowerThreshold()
             );
         }
+    }
 
-        // Save config to NVS for persistence
-        if (storageManager != nullptr) {
-            storageManager->saveDeviceConfig(
-                configHandler.getUpperThreshold(),
-                configHandler.getLowerThreshold(),
-                configHandler.getTankHeight(),
-                configHandler.getTankWidth(),
-                configHandler.getTankShape()
-            );
-            Serial.println("[WebServer] Config saved to NVS storage");
-        }
+    // Persist full sync state (Local timestamps changed even if merged values didn't)
+    if (storageManager != nullptr) {
+        storageManager->saveSyncSnapshot(configHandler, controlHandler);
     }
 
     // Trigger config sync callback if provided
@@ -791,6 +1020,8 @@ void WebServer::handleGetTimestamp(AsyncWebServerRequest* request) {
         doc["synced"] = synced;                          // Has valid time sync
         doc["lastSync"] = syncStatus.lastServerTimestamp; // When last synced
         doc["drift"] = estimatedDrift;                   // Estimated drift in ms
+        doc["driftPpm"] = syncStatus.driftPpm;           // Measured oscillator drift rate
+        doc["httpOffset"] = apiClient->getLastTimeOffset(); // Backend time - device time at last HTTP check
     } else {
         // API client not available - return minimal info
         doc["timestamp"] = 0;
@@ -798,6 +1029,8 @@ void WebServer::handleGetTimestamp(AsyncWebServerRequest* request) {
         doc["synced"] = false;
         doc["lastSync"] = 0;
         doc["drift"] = 0;
+        doc["driftPpm"] = 0;
+        doc["httpOffset"] = 0;
     }
 
     String response;
@@ -816,19 +1049,8 @@ void WebServer::handlePostTimestamp(AsyncWebServerRequest* request, uint8_t* dat
 
     // Accumulate full request body
     static String jsonBuffer;
-
-    if (index == 0) {
-        jsonBuffer = "";  // Start of new request
-    }
-
-    // Append chunk
-    for (size_t i = 0; i < len; i++) {
-        jsonBuffer += (char)data[i];
-    }
-
-    // Wait for complete body
-    if (index + len < total) {
-        return;  // More chunks coming
+    if (!collectBody(request, jsonBuffer, data, len, index, total)) {
+        return;  // More chunks coming, or rejected
     }
 
     // Parse incoming timestamp
@@ -873,8 +1095,6 @@ void WebServer::handlePostTimestamp(AsyncWebServerRequest* request, uint8_t* dat
     }
 
     // Validate timestamp (sanity check: must be > 2025-11-19)
-    const uint64_t MIN_VALID_TIMESTAMP = 1763520052526ULL;  // 2025-11-19 approx
-
     if (newTimestamp < MIN_VALID_TIMESTAMP) {
         Serial.printf("[WebServer] Timestamp validation failed: %llu < %llu\n", newTimestamp, MIN_VALID_TIMESTAMP);
         request->send(400, "application/json", "{\"success\":false,\"error\":\"TIMESTAMP_TOO_OLD\"}");
@@ -882,6 +1102,19 @@ void WebServer::handlePostTimestamp(AsyncWebServerRequest* request, uint8_t* dat
         return;
     }
 
+    // Upper bound: an app on the LAN must not push the clock far ahead of a
+    // clock that NTP/HTTP already set - every timestamp would be wrong
+    uint64_t maxTimestamp = MAX_VALID_TIMESTAMP;
+    if (apiClient != nullptr && apiClient->hasReferenceTime()) {
+        maxTimestamp = apiClient->getCurrentTimestamp() + APP_TIME_MAX_AHEAD;
+    }
+    if (newTimestamp > maxTimestamp) {
+        Serial.printf("[WebServer] Timestamp validation failed: %llu > %llu\n", newTimestamp, maxTimestamp);
+        request->send(400, "application/json", "{\"success\":false,\"error\":\"TIMESTAMP_TOO_NEW\"}");
+        jsonBuffer = "";
+        return;
+    }
+
     // Set the timestamp via API client
     if (apiClient != nullptr) {
         apiClient->setTimestamp(newTimestamp);
@@ -937,10 +1170,18 @@ void WebServer::setPumpControlCallback(PumpControlCallback callback) {
     pumpCallback = callback;
 }
 
+void WebServer::setAPIClient(APIClient* apiCli) {
+    apiClient = apiCli;
+}
+
 void WebServer::setWiFiSaveCallback(WiFiSaveCallback callback) {
     wifiSaveCallback = callback;
 }
 
+void WebServer::setProvisioningStatusCallback(ProvisioningStatusCallback callback) {
+    provisioningStatusCallback = callback;
+}
+
 void WebServer::setConfigSyncCallback(ConfigSyncCallback callback) {
     configSyncCallback = callback;
 }
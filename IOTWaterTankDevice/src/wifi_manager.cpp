@@ -2,6 +2,7 @@
 #include "config.h"
 #include "storage_manager.h"
 #include <WiFi.h>
+#include <limits.h>
 
 // State variables
 static WiFiMode currentMode = WIFI_CLIENT_MODE;
@@ -12,10 +13,61 @@ static String savedSSID = "";
 static String savedPassword = "";
 static bool wifiDisabled = false;
 
+// Fast reconnect: last good BSSID/channel/lease, escalating retry delay
+static WiFiConnectionCache connCache;
+static bool connCacheValid = false;
+static bool fastAttempt = false;        // Current attempt is the directed fast connect
+static bool leaseReused = false;        // Current attempt/connection runs on the cached lease
+static bool everConnected = false;      // Reconnects after a first success retry forever
+static unsigned long retryDelay = 0;    // 0 = retry immediately (first attempt after a drop)
+
+// Profiles (slot 0 = primary). savedSSID/savedPassword hold the profile
+// of the current/last connection attempt.
+struct WiFiProfile {
+  String ssid;
+  String password;
+};
+
+struct WiFiProfileStats {
+  uint32_t attempts;
+  uint32_t successes;
+  uint32_t failures;
+  uint32_t roams;               // Left this profile/AP for a better one
+  int lastRssi;
+  unsigned long connectedMs;    // Total connected time (closed sessions)
+};
+
+static WiFiProfile profiles[WIFI_MAX_PROFILES];
+static WiFiProfileStats profileStats[WIFI_MAX_PROFILES];
+
+// Profile edits from the web server (AsyncTCP task), applied by the loop:
+// only the loop changes profiles[], under profileMutex so the web server
+// can still read them for GET /wifiProfiles. A newer edit of a slot
+// replaces one still queued.
+struct WiFiProfileEdit {
+  bool pending;
+  bool remove;
+  String ssid;
+  String password;
+};
+
+static WiFiProfileEdit profileEdits[WIFI_MAX_PROFILES];
+static SemaphoreHandle_t profileMutex = NULL;
+static int activeProfile = 0;
+static unsigned long connectedSince = 0;    // 0 = not connected
+
+// Roaming: averaged RSSI, poor-link timer, background scan
+static float rssiAverage = 0;
+static unsigned long lastRssiSample = 0;
+static unsigned long poorLinkSince = 0;
+static unsigned long lastRoamScan = 0;
+static bool roamScanActive = false;
+
 // Connection states
 enum ConnectionState {
   CONN_IDLE,
   CONN_STARTING,
+  CONN_SCANNING,      // Async scan to pick the best profile/AP
   CONN_CONNECTING,
   CONN_SUCCESS,
   CONN_FAILED
@@ -27,7 +79,43 @@ static SemaphoreHandle_t scanMutex = NULL;
 static String scanResults = "[]";
 static bool scanInProgress = false;
 
+static void lockProfiles() {
+  if (profileMutex != NULL) {
+    xSemaphoreTake(profileMutex, portMAX_DELAY);
+  }
+}
+
+static void unlockProfiles() {
+  if (profileMutex != NULL) {
+    xSemaphoreGive(profileMutex);
+  }
+}
+
+// Quoted JSON string - SSIDs are up to 32 arbitrary bytes
+static String jsonString(const String& value) {
+  String out = "\"";
+  for (unsigned int i = 0; i < value.length(); i++) {
+    char c = value[i];
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((uint8_t)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+  return out;
+}
+
 void initWiFiManager() {
+  if (profileMutex == NULL) {
+    profileMutex = xSemaphoreCreateMutex();
+  }
+
   WiFi.persistent(false);
   WiFi.setAutoReconnect(false);
 
@@ -43,27 +131,140 @@ bool loadWiFiCredentials(String &ssid, String &password) {
   if (result) {
     savedSSID = ssid;
     savedPassword = password;
+    activeProfile = 0;
+
+    profiles[0].ssid = ssid;
+    profiles[0].password = password;
+    for (int i = 1; i < WIFI_MAX_PROFILES; i++) {
+      if (storageManager.loadWiFiProfile(i, profiles[i].ssid, profiles[i].password)) {
+        DEBUG_PRINTF("[WIFI] Profile %d: %s\n", i, profiles[i].ssid.c_str());
+      }
+    }
+
+    connCacheValid = storageManager.loadWiFiConnectionCache(connCache) &&
+                     connCache.profile < WIFI_MAX_PROFILES &&
+                     profiles[connCache.profile].ssid.length() > 0;
   }
 
   return result;
 }
 
 void saveWiFiCredentials(const char* ssid, const char* password) {
-  storageManager.saveWiFiCredentials(ssid, password);
+  setWiFiProfile(0, ssid, password);
   savedSSID = String(ssid);
   savedPassword = String(password);
+  activeProfile = 0;
   wifiDisabled = false;
 }
 
 void clearWiFiCredentials() {
-  storageManager.clearWiFiCredentials();
+  lockProfiles();
+  for (int i = 0; i < WIFI_MAX_PROFILES; i++) {
+    storageManager.clearWiFiProfile(i);
+    profiles[i].ssid = "";
+    profiles[i].password = "";
+    profileEdits[i].pending = false;
+  }
+  unlockProfiles();
+  storageManager.clearWiFiConnectionCache();
   savedSSID = "";
   savedPassword = "";
+  connCacheValid = false;
 
   WiFi.disconnect(true, true);
   delay(100);
 }
 
+// 802.11 limits - WiFi.begin() refuses anything longer
+static bool validProfile(int slot, const char* ssid, const char* password) {
+  return slot >= 0 && slot < WIFI_MAX_PROFILES && strlen(ssid) > 0 &&
+         strlen(ssid) <= 32 && strlen(password) <= 64;
+}
+
+bool setWiFiProfile(int slot, const char* ssid, const char* password) {
+  if (!validProfile(slot, ssid, password)) {
+    return false;
+  }
+
+  // Cached BSSID/lease belong to the old network
+  if (connCacheValid && connCache.profile == slot && profiles[slot].ssid != ssid) {
+    storageManager.clearWiFiConnectionCache();
+    connCacheValid = false;
+  }
+
+  storageManager.saveWiFiProfile(slot, ssid, password);
+  lockProfiles();
+  profiles[slot].ssid = ssid;
+  profiles[slot].password = password;
+  memset(&profileStats[slot], 0, sizeof(profileStats[slot]));
+  unlockProfiles();
+
+  return true;
+}
+
+bool removeWiFiProfile(int slot) {
+  // The primary network is replaced via /save or cleared by a WiFi reset
+  if (slot <= 0 || slot >= WIFI_MAX_PROFILES) {
+    return false;
+  }
+
+  if (connCacheValid && connCache.profile == slot) {
+    storageManager.clearWiFiConnectionCache();
+    connCacheValid = false;
+  }
+
+  if (activeProfile == slot) {
+    activeProfile = 0;
+  }
+
+  storageManager.clearWiFiProfile(slot);
+  lockProfiles();
+  profiles[slot].ssid = "";
+  profiles[slot].password = "";
+  memset(&profileStats[slot], 0, sizeof(profileStats[slot]));
+  unlockProfiles();
+
+  return true;
+}
+
+bool queueWiFiProfileEdit(int slot, const char* ssid, const char* password, bool remove) {
+  // Same checks as setWiFiProfile/removeWiFiProfile, so the answer is final
+  if (remove ? (slot <= 0 || slot >= WIFI_MAX_PROFILES) : !validProfile(slot, ssid, password)) {
+    return false;
+  }
+
+  lockProfiles();
+  profileEdits[slot].pending = true;
+  profileEdits[slot].remove = remove;
+  profileEdits[slot].ssid = remove ? "" : ssid;
+  profileEdits[slot].password = remove ? "" : password;
+  unlockProfiles();
+
+  return true;
+}
+
+// Apply queued profile edits (loop): NVS writes and connection state
+// changes stay out of the AsyncTCP task
+static void applyWiFiProfileEdits() {
+  for (int slot = 0; slot < WIFI_MAX_PROFILES; slot++) {
+    lockProfiles();
+    WiFiProfileEdit edit = profileEdits[slot];
+    profileEdits[slot].pending = false;
+    unlockProfiles();
+
+    if (!edit.pending) {
+      continue;
+    }
+
+    if (edit.remove) {
+      removeWiFiProfile(slot);
+    } else {
+      setWiFiProfile(slot, edit.ssid.c_str(), edit.password.c_str());
+    }
+    DEBUG_PRINTF("[WIFI] Profile %d %s\n", slot, edit.remove ? "removed" : "updated");
+  }
+}
+
 void saveDashboardCredentials(const char* username, const char* password) {
   storageManager.saveDashboardCredentials(username, password);
 }
@@ -72,30 +273,195 @@ bool getDashboardCredentials(String &username, String &password) {
   return storageManager.loadDashboardCredentials(username, password);
 }
 
-bool startWiFiClient() {
-  if (savedSSID.length() == 0) {
-    DEBUG_PRINTLN("[WIFI] No credentials available for client mode.");
-    return false;
+// Static IP if configured, else the cached lease on a fast connect, else DHCP
+static void applyIPConfig(bool fast) {
+#ifdef WIFI_STATIC_IP
+  IPAddress ip, gateway, subnet, dns;
+  ip.fromString(WIFI_STATIC_IP);
+  gateway.fromString(WIFI_STATIC_GATEWAY);
+  subnet.fromString(WIFI_STATIC_SUBNET);
+  dns.fromString(WIFI_STATIC_DNS);
+  WiFi.config(ip, gateway, subnet, dns);
+  (void)fast;
+#else
+  leaseReused = fast && WIFI_REUSE_DHCP_LEASE && connCache.ip != 0;
+  if (leaseReused) {
+    WiFi.config(IPAddress(connCache.ip), IPAddress(connCache.gateway),
+                IPAddress(connCache.subnet), IPAddress(connCache.dns));
+  } else {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
   }
+#endif
+}
 
-  WiFi.disconnect(true);
-  delay(100);
+static int profileCount() {
+  int count = 0;
+  for (int i = 0; i < WIFI_MAX_PROFILES; i++) {
+    if (profiles[i].ssid.length() > 0) count++;
+  }
+  return count;
+}
 
-  WiFi.mode(WIFI_STA);
-  delay(100);
+// Lower slots are preferred: each slot costs WIFI_PROFILE_PRIORITY_STEP dB
+static int profileScore(int profile, int rssi) {
+  return rssi - profile * WIFI_PROFILE_PRIORITY_STEP;
+}
 
-  WiFi.begin(savedSSID.c_str(), savedPassword.c_str());
+// Best scan result matching a profile (-1 = none). Repeaters with the same
+// SSID are separate results, so the strongest AP of a network wins.
+static int selectBestNetwork(int count, int& bestProfile) {
+  int best = -1;
+  int bestScore = INT_MIN;
+
+  for (int i = 0; i < count; i++) {
+    String ssid = WiFi.SSID(i);
+
+    for (int p = 0; p < WIFI_MAX_PROFILES; p++) {
+      if (profiles[p].ssid.length() == 0 || profiles[p].ssid != ssid) {
+        continue;
+      }
+
+      int score = profileScore(p, WiFi.RSSI(i));
+      if (score > bestScore) {
+        bestScore = score;
+        best = i;
+        bestProfile = p;
+      }
+    }
+  }
 
-  DEBUG_PRINTF("[WIFI] Starting connection to '%s'", savedSSID.c_str());
+  return best;
+}
+
+// Start association with a profile - directed when bssid is given.
+// 'fast' marks the cached-association attempt (short timeout, cached lease).
+static void beginConnection(int profile, const uint8_t* bssid, int32_t channel, bool fast) {
+  activeProfile = profile;
+  savedSSID = profiles[profile].ssid;
+  savedPassword = profiles[profile].password;
+  profileStats[profile].attempts++;
+
+  fastAttempt = fast;
+  applyIPConfig(fast);
+
+  if (bssid != nullptr) {
+    // Directed connect: no scan, straight to the chosen AP
+    WiFi.begin(savedSSID.c_str(), savedPassword.c_str(), channel, bssid);
+    DEBUG_PRINTF("[WIFI] %s connect to '%s' (channel %d, BSSID %02X:%02X:%02X:%02X:%02X:%02X)",
+                 fast ? "Fast" : "Directed", savedSSID.c_str(), (int)channel,
+                 bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+  } else {
+    WiFi.begin(savedSSID.c_str(), savedPassword.c_str());
+    DEBUG_PRINTF("[WIFI] Starting connection to '%s'", savedSSID.c_str());
+  }
 
   connectionStartTime = millis();
   connectionInProgress = true;
   connState = CONN_STARTING;
   lastConnectionAttempt = millis();
+}
+
+// Full connect: with several profiles scan first and pick the best one,
+// with a single profile let the driver scan for it
+static void beginFullConnection() {
+  if (profileCount() <= 1 || scanInProgress) {
+    beginConnection(activeProfile, nullptr, 0, false);
+    return;
+  }
+
+  WiFi.scanNetworks(true, false, false, 300);
+  DEBUG_PRINTLN("[WIFI] Scanning to select the best network...");
+
+  connectionStartTime = millis();
+  connectionInProgress = true;
+  connState = CONN_SCANNING;
+  lastConnectionAttempt = millis();
+}
+
+// Close the connected-time accounting of the current session
+static void endSession() {
+  if (connectedSince != 0) {
+    profileStats[activeProfile].connectedMs += millis() - connectedSince;
+    connectedSince = 0;
+  }
+}
+
+// Remember the association (only written to NVS when it changed)
+static void saveConnectionCache() {
+  WiFiConnectionCache current;
+  memset(&current, 0, sizeof(current));
+
+  uint8_t* bssid = WiFi.BSSID();
+  if (bssid != nullptr) {
+    memcpy(current.bssid, bssid, sizeof(current.bssid));
+  }
+  current.profile = activeProfile;
+  current.channel = WiFi.channel();
+  current.ip = (uint32_t)WiFi.localIP();
+  current.gateway = (uint32_t)WiFi.gatewayIP();
+  current.subnet = (uint32_t)WiFi.subnetMask();
+  current.dns = (uint32_t)WiFi.dnsIP(0);
+
+  if (connCacheValid && memcmp(&current, &connCache, sizeof(current)) == 0) {
+    return;
+  }
+
+  connCache = current;
+  connCacheValid = current.channel > 0;
+  if (connCacheValid) {
+    storageManager.saveWiFiConnectionCache(connCache);
+  }
+}
+
+bool startWiFiClient() {
+  if (savedSSID.length() == 0) {
+    DEBUG_PRINTLN("[WIFI] No credentials available for client mode.");
+    return false;
+  }
+
+  // Credentials may have been set without loadWiFiCredentials (provisioning)
+  if (profiles[0].ssid.length() == 0) {
+    lockProfiles();
+    profiles[0].ssid = savedSSID;
+    profiles[0].password = savedPassword;
+    unlockProfiles();
+  }
+
+  // Only switch modes when needed - tearing the driver down on every
+  // reconnect costs seconds. A running setup AP stays up so the app can
+  // keep polling provisioning status; stopWiFiAP() removes it later.
+  if (WiFi.getMode() == WIFI_AP_STA && currentMode == WIFI_AP_MODE) {
+    WiFi.disconnect(false);
+  } else if (WiFi.getMode() != WIFI_STA) {
+    WiFi.mode(WIFI_STA);
+  } else {
+    WiFi.disconnect(false);
+  }
+
+  if (connCacheValid) {
+    beginConnection(connCache.profile, connCache.bssid, connCache.channel, true);
+  } else {
+    beginFullConnection();
+  }
 
   return true;  // Return true to indicate connection attempt started
 }
 
+bool dropCachedWiFiLease() {
+  if (!leaseReused || WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+
+  DEBUG_PRINTLN("[WIFI] Backend unreachable on the cached lease - reconnecting with DHCP");
+  connCache.ip = 0;
+  storageManager.saveWiFiConnectionCache(connCache);
+
+  endSession();
+  WiFi.disconnect(false);
+  beginConnection(connCache.profile, connCache.bssid, connCache.channel, true);
+  return true;
+}
+
 // Non-blocking connection check - call this in loop()
 bool updateWiFiConnection() {
   if (!connectionInProgress) {
@@ -105,6 +471,34 @@ bool updateWiFiConnection() {
   wl_status_t status = WiFi.status();
   unsigned long elapsed = millis() - connectionStartTime;
 
+  // Profile selection scan
+  if (connState == CONN_SCANNING) {
+    int count = WiFi.scanComplete();
+
+    if (count == WIFI_SCAN_RUNNING && elapsed < WIFI_SCAN_TIMEOUT) {
+      return false;
+    }
+
+    int profile = activeProfile;
+    int best = count > 0 ? selectBestNetwork(count, profile) : -1;
+
+    if (best >= 0) {
+      uint8_t bssid[6];
+      memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+      int32_t channel = WiFi.channel(best);
+      profileStats[profile].lastRssi = WiFi.RSSI(best);
+      DEBUG_PRINTF("[WIFI] Selected profile %d '%s' (%d dBm)\n", profile,
+                   profiles[profile].ssid.c_str(), profileStats[profile].lastRssi);
+      WiFi.scanDelete();
+      beginConnection(profile, bssid, channel, false);
+    } else {
+      DEBUG_PRINTLN("[WIFI] No known network in scan - trying the last profile.");
+      WiFi.scanDelete();
+      beginConnection(activeProfile, nullptr, 0, false);
+    }
+    return false;
+  }
+
   // Print dots every second
   static unsigned long lastDot = 0;
   if (millis() - lastDot > 1000) {
@@ -118,23 +512,72 @@ bool updateWiFiConnection() {
     connState = CONN_SUCCESS;
     currentMode = WIFI_CLIENT_MODE;
     wifiDisabled = false;
+    everConnected = true;
+    retryDelay = 0;
+
+    profileStats[activeProfile].successes++;
+    profileStats[activeProfile].lastRssi = WiFi.RSSI();
+    connectedSince = millis();
+    rssiAverage = WiFi.RSSI();
+    lastRssiSample = millis();
+    poorLinkSince = 0;
+
+    saveConnectionCache();
+
+    // Radio sleeps between DTIM beacons; the AP wakes it for our traffic
+    WiFi.setSleep(POWER_WIFI_MODEM_SLEEP ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
 
     DEBUG_PRINTLN("");
     DEBUG_PRINTLN("[WIFI] ✓ Connected!");
     DEBUG_PRINTF("[WIFI] IP Address: %s\n", WiFi.localIP().toString().c_str());
     DEBUG_PRINTF("[WIFI] Signal: %d dBm\n", WiFi.RSSI());
+    DEBUG_PRINTF("[WIFI] Connect time: %lu ms%s%s\n", elapsed, fastAttempt ? " (fast)" : "",
+                 leaseReused ? " (cached lease)" : "");
 
     return true;
   }
 
+  // Fast connect didn't work (AP moved/changed channel, lease gone) - full scan
+  if (fastAttempt && (elapsed >= WIFI_FAST_CONNECT_TIMEOUT_MS ||
+                      status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED)) {
+    DEBUG_PRINTLN("");
+    DEBUG_PRINTLN("[WIFI] Fast connect failed - falling back to full scan.");
+    profileStats[activeProfile].failures++;
+    WiFi.disconnect(false);
+    beginFullConnection();
+    return false;
+  }
+
   // Check for timeout
   if (elapsed >= WIFI_TIMEOUT_MS) {
     connectionInProgress = false;
     connState = CONN_FAILED;
+    profileStats[activeProfile].failures++;
+
+    // Lost a working connection: keep retrying with escalating delays
+    if (everConnected) {
+      retryDelay = retryDelay == 0 ? WIFI_RETRY_MIN_MS : min(retryDelay * 2, (unsigned long)WIFI_RETRY_INTERVAL_MS);
+      lastConnectionAttempt = millis();
+
+      DEBUG_PRINTLN("");
+      DEBUG_PRINTF("[WIFI] ✗ Reconnect failed (status %d). Next attempt in %lu ms.\n", status, retryDelay);
+
+      WiFi.disconnect(false);
+      return false;
+    }
 
     DEBUG_PRINTLN("");
     DEBUG_PRINTLN("[WIFI] ✗ Connection failed (timeout).");
     DEBUG_PRINTF("[WIFI] Status code: %d\n", status);
+
+    // Provisioning from the setup AP - keep the AP so the user can retry
+    if (WiFi.getMode() == WIFI_AP_STA) {
+      DEBUG_PRINTLN("[WIFI] Setup AP still running.");
+      WiFi.disconnect(false);
+      currentMode = WIFI_AP_MODE;
+      return false;
+    }
+
     DEBUG_PRINTLN("[WIFI] WiFi will remain off. Hold button to start hotspot.");
 
     WiFi.disconnect(true);
@@ -192,7 +635,83 @@ void startWiFiAP() {
   DEBUG_PRINTLN("[WIFI] ╚═══════════════════════════╝\n");
 }
 
+void stopWiFiAP() {
+  if (WiFi.getMode() != WIFI_AP_STA) {
+    return;
+  }
+
+  WiFi.softAPdisconnect(true);  // Drops the AP interface, station stays connected
+  DEBUG_PRINTLN("[WIFI] Setup AP stopped.");
+}
+
+// Roam when the averaged RSSI stays poor and a scan finds a clearly better
+// AP (same SSID on a repeater, or another profile)
+static void checkRoaming() {
+  unsigned long now = millis();
+
+  if (roamScanActive) {
+    int count = WiFi.scanComplete();
+    if (count == WIFI_SCAN_RUNNING && now - lastRoamScan < WIFI_SCAN_TIMEOUT) {
+      return;
+    }
+    roamScanActive = false;
+
+    int profile = activeProfile;
+    int best = count > 0 ? selectBestNetwork(count, profile) : -1;
+    int currentScore = profileScore(activeProfile, (int)rssiAverage);
+
+    if (best >= 0 && memcmp(WiFi.BSSID(best), WiFi.BSSID(), 6) != 0 &&
+        profileScore(profile, WiFi.RSSI(best)) >= currentScore + WIFI_ROAM_HYSTERESIS) {
+      uint8_t bssid[6];
+      memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+      int32_t channel = WiFi.channel(best);
+
+      DEBUG_PRINTF("[WIFI] Roaming from '%s' (%d dBm avg) to '%s' (%d dBm)\n",
+                   savedSSID.c_str(), (int)rssiAverage, profiles[profile].ssid.c_str(), WiFi.RSSI(best));
+
+      WiFi.scanDelete();
+      profileStats[activeProfile].roams++;
+      endSession();
+      WiFi.disconnect(false);
+      beginConnection(profile, bssid, channel, false);
+      return;
+    }
+
+    WiFi.scanDelete();
+    DEBUG_PRINTLN("[WIFI] Roaming scan: no better AP found.");
+    return;
+  }
+
+  if (now - lastRssiSample < WIFI_ROAM_CHECK_INTERVAL) {
+    return;
+  }
+  lastRssiSample = now;
+
+  int rssi = WiFi.RSSI();
+  profileStats[activeProfile].lastRssi = rssi;
+  rssiAverage = rssiAverage * 0.75f + rssi * 0.25f;
+
+  if (rssiAverage >= WIFI_ROAM_RSSI_THRESHOLD) {
+    poorLinkSince = 0;
+    return;
+  }
+
+  if (poorLinkSince == 0) {
+    poorLinkSince = now;
+  }
+
+  if (now - poorLinkSince >= WIFI_ROAM_POOR_DURATION && !scanInProgress &&
+      (lastRoamScan == 0 || now - lastRoamScan >= WIFI_ROAM_SCAN_INTERVAL)) {
+    DEBUG_PRINTF("[WIFI] Poor link (%d dBm avg) - scanning for a better AP\n", (int)rssiAverage);
+    WiFi.scanNetworks(true, false, false, 300);
+    roamScanActive = true;
+    lastRoamScan = now;
+  }
+}
+
 void handleWiFiConnection() {
+  applyWiFiProfileEdits();
+
   // If connection is in progress, update it
   if (connectionInProgress) {
     updateWiFiConnection();
@@ -204,13 +723,20 @@ void handleWiFiConnection() {
     return;
   }
 
-  // Already connected
+  // Already connected - watch link quality
   if (WiFi.status() == WL_CONNECTED) {
+    checkRoaming();
     return;
   }
 
-  // Check if enough time has passed since last attempt
-  if (millis() - lastConnectionAttempt < WIFI_RETRY_INTERVAL_MS) {
+  endSession();
+  if (roamScanActive) {
+    WiFi.scanDelete();
+    roamScanActive = false;
+  }
+
+  // First attempt after a drop is immediate, then the delay escalates
+  if (millis() - lastConnectionAttempt < retryDelay) {
     return;
   }
 
@@ -309,7 +835,6 @@ void wifiScanTask(void* parameter) {
   DEBUG_PRINTLN("[WIFI] Starting synchronous scan with periodic yielding...");
 
   int n = -2;
-  unsigned long scanStartTime = millis();
 
   // Start the scan - use longer timeout per channel (500ms instead of 200ms)
   // Note: We're in a separate FreeRTOS task, so this won't block the main loop
@@ -343,7 +868,7 @@ void wifiScanTask(void* parameter) {
       if (i > 0) json += ",";
 
       json += "{";
-      json += "\"ssid\":\"" + WiFi.SSID(i) + "\",";
+      json += "\"ssid\":" + jsonString(WiFi.SSID(i)) + ",";
       json += "\"rssi\":" + String(WiFi.RSSI(i)) + ",";
       json += "\"encryption\":" + String(WiFi.encryptionType(i));
       json += "}";
@@ -435,6 +960,45 @@ String scanWiFiNetworks() {
   return result;
 }
 
+String getWiFiProfilesJson() {
+  String json = "[";
+  bool first = true;
+
+  lockProfiles();
+
+  for (int i = 0; i < WIFI_MAX_PROFILES; i++) {
+    if (profiles[i].ssid.length() == 0) {
+      continue;
+    }
+
+    const WiFiProfileStats& stats = profileStats[i];
+    bool active = i == activeProfile && WiFi.status() == WL_CONNECTED && currentMode == WIFI_CLIENT_MODE;
+    unsigned long connectedMs = stats.connectedMs;
+    if (active && connectedSince != 0) {
+      connectedMs += millis() - connectedSince;
+    }
+
+    if (!first) json += ",";
+    first = false;
+
+    json += "{";
+    json += "\"slot\":" + String(i) + ",";
+    json += "\"ssid\":" + jsonString(profiles[i].ssid) + ",";
+    json += "\"active\":" + String(active ? "true" : "false") + ",";
+    json += "\"attempts\":" + String(stats.attempts) + ",";
+    json += "\"successes\":" + String(stats.successes) + ",";
+    json += "\"failures\":" + String(stats.failures) + ",";
+    json += "\"roams\":" + String(stats.roams) + ",";
+    json += "\"lastRssi\":" + String(stats.lastRssi) + ",";
+    json += "\"connectedSeconds\":" + String(connectedMs / 1000);
+    json += "}";
+  }
+  unlockProfiles();
+
+  json += "]";
+  return json;
+}
+
 String getMACAddress() {
   return WiFi.macAddress();
 }